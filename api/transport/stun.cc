@@ -87,6 +87,9 @@ bool LengthValid(int type, int length) {
   return true;
 }
 
+// RFC 2104, with the 64 byte blocks of SHA-1.
+constexpr size_t kHmacBlockSize = 64;
+
 }  // namespace
 
 const char STUN_ERROR_REASON_TRY_ALTERNATE_SERVER[] = "Try Alternate Server";
@@ -107,6 +110,75 @@ const char EMPTY_TRANSACTION_ID[] = "0000000000000000";
 const uint32_t STUN_FINGERPRINT_XOR_VALUE = 0x5354554E;
 const int SERVER_NOT_REACHABLE_ERROR = 701;
 
+// StunIntegrityKey
+
+StunIntegrityKey::StunIntegrityKey() : StunIntegrityKey("") {}
+
+StunIntegrityKey::StunIntegrityKey(absl::string_view key)
+    : key_(key.data(), key.size()),
+      inner_(rtc::MessageDigestFactory::Create(rtc::DIGEST_SHA_1)),
+      outer_(rtc::MessageDigestFactory::Create(rtc::DIGEST_SHA_1)),
+      work_(rtc::MessageDigestFactory::Create(rtc::DIGEST_SHA_1)) {
+  if (!inner_ || !outer_ || !work_) {
+    return;
+  }
+  uint8_t block_key[kHmacBlockSize] = {0};
+  if (key.size() > kHmacBlockSize) {
+    rtc::ComputeDigest(work_.get(), key.data(), key.size(), block_key,
+                       kHmacBlockSize);
+  } else {
+    memcpy(block_key, key.data(), key.size());
+  }
+  uint8_t pad[kHmacBlockSize];
+  for (size_t i = 0; i < kHmacBlockSize; ++i) {
+    pad[i] = block_key[i] ^ 0x36;
+  }
+  inner_->Update(pad, kHmacBlockSize);
+  for (size_t i = 0; i < kHmacBlockSize; ++i) {
+    pad[i] = block_key[i] ^ 0x5c;
+  }
+  outer_->Update(pad, kHmacBlockSize);
+}
+
+StunIntegrityKey::StunIntegrityKey(StunIntegrityKey&&) = default;
+
+StunIntegrityKey& StunIntegrityKey::operator=(StunIntegrityKey&&) = default;
+
+StunIntegrityKey::~StunIntegrityKey() = default;
+
+void StunIntegrityKey::SetKey(absl::string_view key) {
+  if (key != key_) {
+    *this = StunIntegrityKey(key);
+  }
+}
+
+bool StunIntegrityKey::ComputeMessageIntegrity(
+    const char* data,
+    size_t mi_pos,
+    size_t mi_attr_size,
+    char hmac[kStunMessageIntegritySize]) const {
+  RTC_DCHECK_GE(mi_pos, kStunHeaderSize);
+  if (!work_ || !work_->CopyStateFrom(*inner_)) {
+    return false;
+  }
+  // Hash the header separately to avoid copying the message.
+  char header[kStunHeaderSize];
+  memcpy(header, data, kStunHeaderSize);
+  rtc::SetBE16(header + 2,
+               static_cast<uint16_t>(mi_pos + kStunAttributeHeaderSize +
+                                     mi_attr_size - kStunHeaderSize));
+  work_->Update(header, kStunHeaderSize);
+  work_->Update(data + kStunHeaderSize, mi_pos - kStunHeaderSize);
+  uint8_t inner_hash[rtc::MessageDigest::kMaxSize];
+  size_t inner_hash_size = work_->Finish(inner_hash, sizeof(inner_hash));
+  if (!work_->CopyStateFrom(*outer_)) {
+    return false;
+  }
+  work_->Update(inner_hash, inner_hash_size);
+  return work_->Finish(hmac, kStunMessageIntegritySize) ==
+         kStunMessageIntegritySize;
+}
+
 // StunMessage
 
 StunMessage::StunMessage()
@@ -248,11 +320,16 @@ const StunUInt16ListAttribute* StunMessage::GetUnknownAttributes() const {
 
 StunMessage::IntegrityStatus StunMessage::ValidateMessageIntegrity(
     const std::string& password) {
-  password_ = password;
+  return ValidateMessageIntegrity(StunIntegrityKey(password));
+}
+
+StunMessage::IntegrityStatus StunMessage::ValidateMessageIntegrity(
+    const StunIntegrityKey& key) {
+  password_ = key.key();
   if (GetByteString(STUN_ATTR_MESSAGE_INTEGRITY)) {
     if (ValidateMessageIntegrityOfType(
             STUN_ATTR_MESSAGE_INTEGRITY, kStunMessageIntegritySize,
-            buffer_.c_str(), buffer_.size(), password)) {
+            buffer_.c_str(), buffer_.size(), key)) {
       integrity_ = IntegrityStatus::kIntegrityOk;
     } else {
       integrity_ = IntegrityStatus::kIntegrityBad;
@@ -260,7 +337,7 @@ StunMessage::IntegrityStatus StunMessage::ValidateMessageIntegrity(
   } else if (GetByteString(STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32)) {
     if (ValidateMessageIntegrityOfType(
             STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32, kStunMessageIntegrity32Size,
-            buffer_.c_str(), buffer_.size(), password)) {
+            buffer_.c_str(), buffer_.size(), key)) {
       integrity_ = IntegrityStatus::kIntegrityOk;
     } else {
       integrity_ = IntegrityStatus::kIntegrityBad;
@@ -276,7 +353,7 @@ bool StunMessage::ValidateMessageIntegrity(const char* data,
                                            const std::string& password) {
   return ValidateMessageIntegrityOfType(STUN_ATTR_MESSAGE_INTEGRITY,
                                         kStunMessageIntegritySize, data, size,
-                                        password);
+                                        StunIntegrityKey(password));
 }
 
 bool StunMessage::ValidateMessageIntegrity32(const char* data,
@@ -284,7 +361,7 @@ bool StunMessage::ValidateMessageIntegrity32(const char* data,
                                              const std::string& password) {
   return ValidateMessageIntegrityOfType(STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32,
                                         kStunMessageIntegrity32Size, data, size,
-                                        password);
+                                        StunIntegrityKey(password));
 }
 
 // Verifies a STUN message has a valid MESSAGE-INTEGRITY attribute, using the
@@ -293,7 +370,7 @@ bool StunMessage::ValidateMessageIntegrityOfType(int mi_attr_type,
                                                  size_t mi_attr_size,
                                                  const char* data,
                                                  size_t size,
-                                                 const std::string& password) {
+                                                 const StunIntegrityKey& key) {
   RTC_DCHECK(mi_attr_size <= kStunMessageIntegritySize);
 
   // Verifying the size of the message.
@@ -338,32 +415,10 @@ bool StunMessage::ValidateMessageIntegrityOfType(int mi_attr_type,
     return false;
   }
 
-  // Getting length of the message to calculate Message Integrity.
-  size_t mi_pos = current_pos;
-  std::unique_ptr<char[]> temp_data(new char[current_pos]);
-  memcpy(temp_data.get(), data, current_pos);
-  if (size > mi_pos + kStunAttributeHeaderSize + mi_attr_size) {
-    // Stun message has other attributes after message integrity.
-    // Adjust the length parameter in stun message to calculate HMAC.
-    size_t extra_offset =
-        size - (mi_pos + kStunAttributeHeaderSize + mi_attr_size);
-    size_t new_adjusted_len = size - extra_offset - kStunHeaderSize;
-
-    // Writing new length of the STUN message @ Message Length in temp buffer.
-    //      0                   1                   2                   3
-    //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-    //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    //     |0 0|     STUN Message Type     |         Message Length        |
-    //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    rtc::SetBE16(temp_data.get() + 2, static_cast<uint16_t>(new_adjusted_len));
-  }
-
+  // Stun message may have other attributes after message integrity, which
+  // are excluded from the HMAC by adjusting the message length.
   char hmac[kStunMessageIntegritySize];
-  size_t ret =
-      rtc::ComputeHmac(rtc::DIGEST_SHA_1, password.c_str(), password.size(),
-                       temp_data.get(), mi_pos, hmac, sizeof(hmac));
-  RTC_DCHECK(ret == sizeof(hmac));
-  if (ret != sizeof(hmac)) {
+  if (!key.ComputeMessageIntegrity(data, current_pos, mi_attr_size, hmac)) {
     return false;
   }
 
@@ -373,21 +428,26 @@ bool StunMessage::ValidateMessageIntegrityOfType(int mi_attr_type,
 }
 
 bool StunMessage::AddMessageIntegrity(const std::string& password) {
+  return AddMessageIntegrity(StunIntegrityKey(password));
+}
+
+bool StunMessage::AddMessageIntegrity(const StunIntegrityKey& key) {
   return AddMessageIntegrityOfType(STUN_ATTR_MESSAGE_INTEGRITY,
-                                   kStunMessageIntegritySize, password.c_str(),
-                                   password.size());
+                                   kStunMessageIntegritySize, key);
 }
 
 bool StunMessage::AddMessageIntegrity32(absl::string_view password) {
+  return AddMessageIntegrity32(StunIntegrityKey(password));
+}
+
+bool StunMessage::AddMessageIntegrity32(const StunIntegrityKey& key) {
   return AddMessageIntegrityOfType(STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32,
-                                   kStunMessageIntegrity32Size, password.data(),
-                                   password.length());
+                                   kStunMessageIntegrity32Size, key);
 }
 
 bool StunMessage::AddMessageIntegrityOfType(int attr_type,
                                             size_t attr_size,
-                                            const char* key,
-                                            size_t keylen) {
+                                            const StunIntegrityKey& key) {
   // Add the attribute with a dummy value. Since this is a known attribute, it
   // can't fail.
   RTC_DCHECK(attr_size <= kStunMessageIntegritySize);
@@ -401,13 +461,12 @@ bool StunMessage::AddMessageIntegrityOfType(int attr_type,
   if (!Write(&buf))
     return false;
 
-  int msg_len_for_hmac = static_cast<int>(
-      buf.Length() - kStunAttributeHeaderSize - msg_integrity_attr->length());
+  size_t mi_pos =
+      buf.Length() - kStunAttributeHeaderSize - msg_integrity_attr->length();
   char hmac[kStunMessageIntegritySize];
-  size_t ret = rtc::ComputeHmac(rtc::DIGEST_SHA_1, key, keylen, buf.Data(),
-                                msg_len_for_hmac, hmac, sizeof(hmac));
-  RTC_DCHECK(ret == sizeof(hmac));
-  if (ret != sizeof(hmac)) {
+  bool ret = key.ComputeMessageIntegrity(buf.Data(), mi_pos, attr_size, hmac);
+  RTC_DCHECK(ret);
+  if (!ret) {
     RTC_LOG(LS_ERROR) << "HMAC computation failed. Message-Integrity "
                          "has dummy value.";
     return false;
@@ -415,7 +474,7 @@ bool StunMessage::AddMessageIntegrityOfType(int attr_type,
 
   // Insert correct HMAC into the attribute.
   msg_integrity_attr->CopyBytes(hmac, attr_size);
-  password_.assign(key, keylen);
+  password_ = key.key();
   integrity_ = IntegrityStatus::kIntegrityOk;
   return true;
 }
@@ -700,6 +759,257 @@ bool StunMessage::EqualAttributes(
   return true;
 }
 
+// StunMessageView
+
+bool StunMessageView::Parse(const char* data, size_t size) {
+  data_ = data;
+  size_ = size;
+  legacy_ = false;
+  fingerprint_valid_ = false;
+  num_indexed_attributes_ = 0;
+  unindexed_offset_ = size;
+  integrity_ = StunMessage::IntegrityStatus::kNotSet;
+  if (size < kStunHeaderSize) {
+    return false;
+  }
+  type_ = rtc::GetBE16(data);
+  if (type_ & 0x8000) {
+    // RTP and RTCP set the MSB of first byte, since first two bits are version,
+    // and version is always 2 (10). If set, this is not a STUN packet.
+    return false;
+  }
+  length_ = rtc::GetBE16(data + 2);
+  if (length_ != size - kStunHeaderSize) {
+    return false;
+  }
+  legacy_ = rtc::GetBE32(data + kStunTransactionIdOffset -
+                         kStunMagicCookieLength) != kStunMagicCookie;
+
+  size_t offset = kStunHeaderSize;
+  Attribute attr;
+  Attribute last_attr = {};
+  while (offset < size) {
+    size_t next_offset = ReadAttribute(offset, &attr);
+    if (next_offset == 0) {
+      return false;
+    }
+    if (num_indexed_attributes_ < kMaxIndexedAttributes) {
+      attributes_[num_indexed_attributes_++] = attr;
+    } else if (unindexed_offset_ == size) {
+      unindexed_offset_ = offset;
+    }
+    last_attr = attr;
+    offset = next_offset;
+  }
+
+  // FINGERPRINT must be the last attribute.
+  constexpr size_t kFingerprintAttrSize =
+      kStunAttributeHeaderSize + StunUInt32Attribute::SIZE;
+  if (!legacy_ && size % 4 == 0 && last_attr.type == STUN_ATTR_FINGERPRINT &&
+      last_attr.length == StunUInt32Attribute::SIZE &&
+      last_attr.offset == size - kFingerprintAttrSize) {
+    uint32_t fingerprint =
+        rtc::GetBE32(data + last_attr.offset + kStunAttributeHeaderSize);
+    fingerprint_valid_ =
+        (fingerprint ^ STUN_FINGERPRINT_XOR_VALUE) ==
+        rtc::ComputeCrc32(data, size - kFingerprintAttrSize);
+  }
+  return true;
+}
+
+absl::string_view StunMessageView::transaction_id() const {
+  if (legacy_) {
+    return absl::string_view(
+        data_ + kStunTransactionIdOffset - kStunMagicCookieLength,
+        kStunLegacyTransactionIdLength);
+  }
+  return absl::string_view(data_ + kStunTransactionIdOffset,
+                           kStunTransactionIdLength);
+}
+
+bool StunMessageView::HasAttribute(int type) const {
+  Attribute attr;
+  return FindAttribute(type, &attr);
+}
+
+absl::optional<absl::string_view> StunMessageView::GetByteString(
+    int type) const {
+  Attribute attr;
+  if (!FindAttribute(type, &attr) || !LengthValid(type, attr.length)) {
+    return absl::nullopt;
+  }
+  return absl::string_view(data_ + attr.offset + kStunAttributeHeaderSize,
+                           attr.length);
+}
+
+absl::optional<uint32_t> StunMessageView::GetUInt32(int type) const {
+  Attribute attr;
+  if (!FindAttribute(type, &attr) ||
+      attr.length != StunUInt32Attribute::SIZE) {
+    return absl::nullopt;
+  }
+  return rtc::GetBE32(data_ + attr.offset + kStunAttributeHeaderSize);
+}
+
+StunMessage::IntegrityStatus StunMessageView::ValidateMessageIntegrity(
+    absl::string_view password) {
+  return ValidateMessageIntegrity(StunIntegrityKey(password));
+}
+
+StunMessage::IntegrityStatus StunMessageView::ValidateMessageIntegrity(
+    const StunIntegrityKey& key) {
+  password_ = key.key();
+  Attribute attr;
+  size_t mi_attr_size;
+  if (FindAttribute(STUN_ATTR_MESSAGE_INTEGRITY, &attr)) {
+    mi_attr_size = kStunMessageIntegritySize;
+  } else if (FindAttribute(STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32, &attr)) {
+    mi_attr_size = kStunMessageIntegrity32Size;
+  } else {
+    integrity_ = StunMessage::IntegrityStatus::kNoIntegrity;
+    return integrity_;
+  }
+  char hmac[kStunMessageIntegritySize];
+  if (size_ % 4 != 0 || attr.length != mi_attr_size ||
+      !key.ComputeMessageIntegrity(data_, attr.offset, mi_attr_size, hmac) ||
+      memcmp(data_ + attr.offset + kStunAttributeHeaderSize, hmac,
+             mi_attr_size) != 0) {
+    integrity_ = StunMessage::IntegrityStatus::kIntegrityBad;
+  } else {
+    integrity_ = StunMessage::IntegrityStatus::kIntegrityOk;
+  }
+  return integrity_;
+}
+
+std::vector<uint16_t> StunMessageView::GetNonComprehendedAttributes(
+    const StunMessage& message) const {
+  std::vector<uint16_t> unknown_attributes;
+  Attribute attr;
+  size_t offset = kStunHeaderSize;
+  while (offset < size_) {
+    offset = ReadAttribute(offset, &attr);
+    // Read() skips the unknown attributes outside the designated expert
+    // range, which leaves 0x4000-0x7FFF of the "comprehension-required"
+    // range.
+    if (attr.type >= 0x4000 && attr.type <= 0x7FFF &&
+        message.GetAttributeValueType(attr.type) == STUN_VALUE_UNKNOWN) {
+      unknown_attributes.push_back(attr.type);
+    }
+  }
+  return unknown_attributes;
+}
+
+bool StunMessageView::ReadHeader(StunMessage* message) const {
+  if (!AttributesReadable(*message)) {
+    return false;
+  }
+  message->SetType(type_);
+  message->SetTransactionID(std::string(transaction_id()));
+  return true;
+}
+
+bool StunMessageView::ReadInto(StunMessage* message) const {
+  rtc::ByteBufferReader buf(data_, size_);
+  if (!message->Read(&buf) || buf.Length() > 0) {
+    return false;
+  }
+  if (integrity_ != StunMessage::IntegrityStatus::kNotSet) {
+    message->integrity_ = integrity_;
+    message->password_ = password_;
+  }
+  return true;
+}
+
+size_t StunMessageView::ReadAttribute(size_t offset, Attribute* attr) const {
+  if (offset + kStunAttributeHeaderSize > size_) {
+    return 0;
+  }
+  attr->type = rtc::GetBE16(data_ + offset);
+  attr->length = rtc::GetBE16(data_ + offset + 2);
+  attr->offset = static_cast<uint32_t>(offset);
+  size_t value_end = offset + kStunAttributeHeaderSize + attr->length;
+  if (value_end > size_) {
+    return 0;
+  }
+  // Like StunMessage::Read(), tolerate missing padding after the last
+  // attribute.
+  size_t padded_end = value_end + (4 - attr->length % 4) % 4;
+  return std::min(padded_end, size_);
+}
+
+bool StunMessageView::FindAttribute(int type, Attribute* attr) const {
+  for (size_t i = 0; i < num_indexed_attributes_; ++i) {
+    if (attributes_[i].type == type) {
+      *attr = attributes_[i];
+      return true;
+    }
+  }
+  // Parse() has checked the framing of the remaining attributes.
+  size_t offset = unindexed_offset_;
+  while (offset < size_) {
+    size_t next_offset = ReadAttribute(offset, attr);
+    RTC_DCHECK_NE(next_offset, 0);
+    if (attr->type == type) {
+      return true;
+    }
+    offset = next_offset;
+  }
+  return false;
+}
+
+bool StunMessageView::AttributesReadable(const StunMessage& message) const {
+  Attribute attr;
+  size_t offset = kStunHeaderSize;
+  while (offset < size_) {
+    offset = ReadAttribute(offset, &attr);
+    const char* value = data_ + attr.offset + kStunAttributeHeaderSize;
+    switch (message.GetAttributeValueType(attr.type)) {
+      case STUN_VALUE_ADDRESS:
+      case STUN_VALUE_XOR_ADDRESS:
+        if (attr.length < 4 ||
+            !((value[1] == STUN_ADDRESS_IPV4 &&
+               attr.length == StunAddressAttribute::SIZE_IP4) ||
+              (value[1] == STUN_ADDRESS_IPV6 &&
+               attr.length == StunAddressAttribute::SIZE_IP6))) {
+          return false;
+        }
+        break;
+      case STUN_VALUE_UINT32:
+        if (attr.length != StunUInt32Attribute::SIZE) {
+          return false;
+        }
+        break;
+      case STUN_VALUE_UINT64:
+        if (attr.length != StunUInt64Attribute::SIZE) {
+          return false;
+        }
+        break;
+      case STUN_VALUE_ERROR_CODE:
+        if (attr.length < StunErrorCodeAttribute::MIN_SIZE) {
+          return false;
+        }
+        break;
+      case STUN_VALUE_UINT16_LIST:
+        if (attr.length % 2 != 0) {
+          return false;
+        }
+        break;
+      case STUN_VALUE_UNKNOWN:
+        // Read() skips these with their padding, which must be present.
+        if (!DesignatedExpertRange(attr.type) &&
+            attr.offset + kStunAttributeHeaderSize + attr.length +
+                    (4 - attr.length % 4) % 4 >
+                size_) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
 // StunAttribute
 
 StunAttribute::StunAttribute(uint16_t type, uint16_t length)
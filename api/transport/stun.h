@@ -17,17 +17,23 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "api/array_view.h"
 #include "rtc_base/byte_buffer.h"
 #include "rtc_base/ip_address.h"
 #include "rtc_base/socket_address.h"
 
+namespace rtc {
+class MessageDigest;
+}  // namespace rtc
+
 namespace cricket {
 
 // These are the types of STUN messages defined in RFC 5389.
@@ -132,6 +138,41 @@ const size_t kStunMessageIntegritySize = 20;
 // Size of STUN_ATTR_MESSAGE_INTEGRITY_32
 const size_t kStunMessageIntegrity32Size = 4;
 
+// Precomputed HMAC-SHA1 state for the key of MESSAGE-INTEGRITY attributes,
+// i.e. an ICE password or a long-term credential hash. The padded key is
+// hashed once, rather than for every message that is signed or validated with
+// it, so holders of a key that is used for many messages, like ports and
+// connections, should keep one around. Not thread safe.
+class StunIntegrityKey {
+ public:
+  StunIntegrityKey();
+  explicit StunIntegrityKey(absl::string_view key);
+  StunIntegrityKey(StunIntegrityKey&&);
+  StunIntegrityKey& operator=(StunIntegrityKey&&);
+  ~StunIntegrityKey();
+
+  const std::string& key() const { return key_; }
+  // Recomputes the state if |key| differs from the current key.
+  void SetKey(absl::string_view key);
+
+  // Computes the HMAC of a MESSAGE-INTEGRITY attribute of |mi_attr_size| bytes
+  // at offset |mi_pos| of the STUN message in |data|, i.e. of the message up
+  // to that attribute, with the length in the header adjusted to end after
+  // it.
+  bool ComputeMessageIntegrity(const char* data,
+                               size_t mi_pos,
+                               size_t mi_attr_size,
+                               char hmac[kStunMessageIntegritySize]) const;
+
+ private:
+  std::string key_;
+  // The digest after hashing the key XORed with the inner and outer pads.
+  std::unique_ptr<rtc::MessageDigest> inner_;
+  std::unique_ptr<rtc::MessageDigest> outer_;
+  // Hashes a message starting from |inner_| and |outer_|.
+  std::unique_ptr<rtc::MessageDigest> work_;
+};
+
 class StunAddressAttribute;
 class StunAttribute;
 class StunByteStringAttribute;
@@ -204,6 +245,7 @@ class StunMessage {
   // Validates that a STUN message has a correct MESSAGE-INTEGRITY value.
   // This uses the buffered raw-format message stored by Read().
   IntegrityStatus ValidateMessageIntegrity(const std::string& password);
+  IntegrityStatus ValidateMessageIntegrity(const StunIntegrityKey& key);
 
   // Returns the current integrity status of the message.
   IntegrityStatus integrity() const { return integrity_; }
@@ -222,10 +264,12 @@ class StunMessage {
 
   // Adds a MESSAGE-INTEGRITY attribute that is valid for the current message.
   bool AddMessageIntegrity(const std::string& password);
+  bool AddMessageIntegrity(const StunIntegrityKey& key);
 
   // Adds a STUN_ATTR_GOOG_MESSAGE_INTEGRITY_32 attribute that is valid for the
   // current message.
   bool AddMessageIntegrity32(absl::string_view password);
+  bool AddMessageIntegrity32(const StunIntegrityKey& key);
 
   // Verify that a buffer has stun magic cookie and one of the specified
   // methods. Note that it does not check for the existance of FINGERPRINT.
@@ -293,18 +337,20 @@ class StunMessage {
   std::vector<std::unique_ptr<StunAttribute>> attrs_;
 
  private:
+  // Reads messages from its buffer and records the integrity checked on it.
+  friend class StunMessageView;
+
   StunAttribute* CreateAttribute(int type, size_t length) /* const*/;
   const StunAttribute* GetAttribute(int type) const;
   static bool IsValidTransactionId(const std::string& transaction_id);
   bool AddMessageIntegrityOfType(int mi_attr_type,
                                  size_t mi_attr_size,
-                                 const char* key,
-                                 size_t keylen);
+                                 const StunIntegrityKey& key);
   static bool ValidateMessageIntegrityOfType(int mi_attr_type,
                                              size_t mi_attr_size,
                                              const char* data,
                                              size_t size,
-                                             const std::string& password);
+                                             const StunIntegrityKey& key);
 
   uint16_t type_;
   uint16_t length_;
@@ -317,6 +363,97 @@ class StunMessage {
   std::string password_;
 };
 
+// A read-only view of a STUN message in a buffer owned by the caller, for
+// checking incoming messages without building a StunMessage. Parse() checks
+// the framing of the message and records the type, length and offset of its
+// attributes, the first |kMaxIndexedAttributes| in an inline array, without
+// allocating or copying. FINGERPRINT is verified in the same pass, while
+// attribute values are only decoded when accessed. MESSAGE-INTEGRITY is
+// verified on the recorded offsets once the password is known.
+//
+// Attribute values are not validated by Parse(), so the view accepts some
+// messages that StunMessage::Read() rejects. ReadHeader() checks them before
+// a rejected message is answered, and ReadInto() builds the StunMessage of a
+// message that passes the checks.
+class StunMessageView {
+ public:
+  static constexpr size_t kMaxIndexedAttributes = 16;
+
+  // Parses |size| bytes of |data|, which must outlive the view. Returns false
+  // if they don't hold exactly one STUN message.
+  bool Parse(const char* data, size_t size);
+
+  int type() const { return type_; }
+  // Length of the message, excluding the header.
+  size_t length() const { return length_; }
+  // True if the message has no magic cookie, as in RFC3489.
+  bool IsLegacy() const { return legacy_; }
+  absl::string_view transaction_id() const;
+  // True if the message ends with a FINGERPRINT attribute with a correct
+  // value, as checked by StunMessage::ValidateFingerprint().
+  bool fingerprint_valid() const { return fingerprint_valid_; }
+
+  bool HasAttribute(int type) const;
+  // Return the value of the first attribute of |type|, or nullopt if there is
+  // none or it has the wrong size.
+  absl::optional<absl::string_view> GetByteString(int type) const;
+  absl::optional<uint32_t> GetUInt32(int type) const;
+
+  // Validates MESSAGE-INTEGRITY, or GOOG-MESSAGE-INTEGRITY-32 if there is no
+  // MESSAGE-INTEGRITY, like StunMessage::ValidateMessageIntegrity(). The
+  // result and the password are passed on by ReadInto().
+  StunMessage::IntegrityStatus ValidateMessageIntegrity(
+      absl::string_view password);
+  StunMessage::IntegrityStatus ValidateMessageIntegrity(
+      const StunIntegrityKey& key);
+
+  // Returns the attribute types in the "comprehension-required" range that
+  // |message| doesn't recognize, like
+  // StunMessage::GetNonComprehendedAttributes() after reading the message.
+  std::vector<uint16_t> GetNonComprehendedAttributes(
+      const StunMessage& message) const;
+
+  // Sets the type and transaction ID of |message| without reading the
+  // attributes, for answering a message that is rejected. Returns false if
+  // |message| can't read the attributes, since such messages are dropped
+  // rather than answered. If this returns true, ReadInto() succeeds too.
+  bool ReadHeader(StunMessage* message) const;
+  // Reads the whole message into |message|. If MESSAGE-INTEGRITY was
+  // validated on the view, |message| gets the result without validating it
+  // again.
+  bool ReadInto(StunMessage* message) const;
+
+ private:
+  struct Attribute {
+    uint16_t type;
+    uint16_t length;
+    // Offset of the header of the attribute.
+    uint32_t offset;
+  };
+
+  // Reads the header of the attribute at |offset| into |attr| and returns the
+  // offset of the next attribute, or 0 if the attribute doesn't fit.
+  size_t ReadAttribute(size_t offset, Attribute* attr) const;
+  bool FindAttribute(int type, Attribute* attr) const;
+  // Returns false if StunMessage::Read() would fail on an attribute of
+  // |message|.
+  bool AttributesReadable(const StunMessage& message) const;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  uint16_t type_ = 0;
+  uint16_t length_ = 0;
+  bool legacy_ = false;
+  bool fingerprint_valid_ = false;
+  std::array<Attribute, kMaxIndexedAttributes> attributes_;
+  size_t num_indexed_attributes_ = 0;
+  // Offset of the first attribute that is not in |attributes_|, or |size_|.
+  size_t unindexed_offset_ = 0;
+  StunMessage::IntegrityStatus integrity_ =
+      StunMessage::IntegrityStatus::kNotSet;
+  std::string password_;
+};
+
 // Base class for all STUN/TURN attributes.
 class StunAttribute {
  public:
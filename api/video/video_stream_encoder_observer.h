@@ -105,6 +105,11 @@ class VideoStreamEncoderObserver : public CpuOveruseMetricsObserver {
   // down.
   virtual void OnEncoderInternalScalerUpdate(bool is_scaled) {}
 
+  // Informs observer of the number of pixel format conversions, e.g. from NV12
+  // to I420, that an input frame goes through before it is encoded. Called
+  // once for every frame passed to the encoder.
+  virtual void OnPixelFormatConversions(int num_conversions) {}
+
   // TODO(nisse): VideoStreamEncoder wants to query the stats, which makes this
   // not a pure observer. GetInputFrameRate is needed for the cpu adaptation, so
   // can be deleted if that responsibility is moved out to a VideoStreamAdaptor
@@ -55,6 +55,7 @@ class MockVideoStreamEncoderObserver : public VideoStreamEncoderObserver {
               (const VideoCodec&, const VideoBitrateAllocation&),
               (override));
   MOCK_METHOD(void, OnEncoderInternalScalerUpdate, (bool), (override));
+  MOCK_METHOD(void, OnPixelFormatConversions, (int), (override));
   MOCK_METHOD(int, GetInputFrameRate, (), (const, override));
 };
 
@@ -65,6 +65,7 @@
 #include "system_wrappers/include/field_trial.h"
 #include "system_wrappers/include/metrics.h"
 #include "video/call_stats2.h"
+#include "video/decode_executor.h"
 #include "video/send_delay_stats.h"
 #include "video/stats_counter.h"
 #include "video/video_receive_stream2.h"
@@ -368,6 +369,9 @@ class Call final : public webrtc::Call,
   RTC_NO_UNIQUE_ADDRESS SequenceChecker send_transport_sequence_checker_;
 
   const int num_cpu_cores_;
+  // Shared by the video receive streams to decode on, if the
+  // "WebRTC-Video-SharedDecodeExecutor" field trial is enabled.
+  const std::unique_ptr<DecodeExecutor> decode_executor_;
   const rtc::scoped_refptr<SharedModuleThread> module_process_thread_;
   const std::unique_ptr<CallStats> call_stats_;
   const std::unique_ptr<BitrateAllocator> bitrate_allocator_;
@@ -788,6 +792,10 @@ Call::Call(Clock* clock,
       network_thread_(config.network_task_queue_ ? config.network_task_queue_
                                                  : worker_thread_),
       num_cpu_cores_(CpuInfo::DetectNumberOfCores()),
+      decode_executor_(
+          field_trial::IsEnabled("WebRTC-Video-SharedDecodeExecutor")
+              ? std::make_unique<DecodeExecutor>(num_cpu_cores_)
+              : nullptr),
       module_process_thread_(std::move(module_process_thread)),
       call_stats_(new CallStats(clock_, worker_thread_)),
       bitrate_allocator_(new BitrateAllocator(this)),
@@ -1129,7 +1137,7 @@ webrtc::VideoReceiveStream* Call::CreateVideoReceiveStream(
   VideoReceiveStream2* receive_stream = new VideoReceiveStream2(
       task_queue_factory_, this, num_cpu_cores_,
       transport_send_->packet_router(), std::move(configuration),
-      call_stats_.get(), clock_, new VCMTiming(clock_));
+      call_stats_.get(), clock_, new VCMTiming(clock_), decode_executor_.get());
   // TODO(bugs.webrtc.org/11993): Set this up asynchronously on the network
   // thread.
   receive_stream->RegisterWithTransport(&video_receiver_controller_);
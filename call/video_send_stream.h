@@ -113,6 +113,9 @@ class VideoSendStream {
     uint32_t frames_dropped_by_rate_limiter = 0;
     uint32_t frames_dropped_by_congestion_window = 0;
     uint32_t frames_dropped_by_encoder = 0;
+    // Total number of pixel format conversions of the input frames, including
+    // conversions expected to be done by the encoder itself.
+    uint32_t pixel_format_conversions = 0;
     // Bitrate the encoder is currently configured to use due to bandwidth
     // limitations.
     int target_media_bitrate_bps = 0;
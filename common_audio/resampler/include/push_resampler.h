@@ -16,10 +16,16 @@
 
 namespace webrtc {
 
+class PolyphaseResampler;
 class PushSincResampler;
 
 // Wraps PushSincResampler to provide stereo support.
 // TODO(ajm): add support for an arbitrary number of channels.
+//
+// When the "WebRTC-Audio-PolyphasePushResampler" field trial is enabled, rate
+// pairs with a simple rational ratio (e.g. 48 kHz <-> 16 kHz) are instead
+// handled by a PolyphaseResampler, which processes all the channels in a single
+// pass over the interleaved audio.
 template <typename T>
 class PushResampler {
  public:
@@ -53,6 +59,13 @@ class PushResampler {
   };
 
   std::vector<ChannelResampler> channel_resamplers_;
+
+  // Set instead of `channel_resamplers_` when the polyphase path is used.
+  std::unique_ptr<PolyphaseResampler> polyphase_resampler_;
+  // Float conversion buffers for the polyphase path, only used when T is not
+  // float.
+  std::vector<float> polyphase_source_;
+  std::vector<float> polyphase_destination_;
 };
 }  // namespace webrtc
 
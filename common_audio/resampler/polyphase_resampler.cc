@@ -0,0 +1,198 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// MSVC++ requires this to be set before any other includes to get M_PI.
+#define _USE_MATH_DEFINES
+
+#include "common_audio/resampler/polyphase_resampler.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "rtc_base/checks.h"
+#include "system_wrappers/include/cpu_features_wrapper.h"
+
+namespace webrtc {
+namespace {
+
+// Fraction of the Nyquist frequency of the lower of the two rates which is kept
+// by the anti-aliasing filter. Same value as used by SincResampler.
+constexpr double kCutoffScale = 0.9;
+
+int GreatestCommonDivisor(int a, int b) {
+  while (b != 0) {
+    const int r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+size_t TapsPerPhase(int interpolation_factor, int decimation_factor) {
+  const int downsampling_factor =
+      (decimation_factor + interpolation_factor - 1) / interpolation_factor;
+  return PolyphaseResampler::kKernelSize * downsampling_factor;
+}
+
+// Returns the prototype low-pass filter, in the upsampled domain, of length
+// `interpolation_factor * taps_per_phase`, normalized to a DC gain of
+// `interpolation_factor`.
+std::vector<double> CreatePrototypeFilter(int interpolation_factor,
+                                          int decimation_factor,
+                                          size_t taps_per_phase) {
+  const size_t length = interpolation_factor * taps_per_phase;
+  // Cutoff, in cycles per upsampled sample.
+  const double cutoff =
+      kCutoffScale * 0.5 / std::max(interpolation_factor, decimation_factor);
+  const double center = 0.5 * (length - 1);
+  std::vector<double> filter(length);
+  for (size_t j = 0; j < length; ++j) {
+    const double x = j - center;
+    const double sinc =
+        x == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+    // Blackman window, as used by SincResampler.
+    const double window = 0.42 - 0.5 * cos(2.0 * M_PI * j / (length - 1)) +
+                          0.08 * cos(4.0 * M_PI * j / (length - 1));
+    filter[j] = sinc * window;
+  }
+  const double gain = interpolation_factor /
+                      std::accumulate(filter.begin(), filter.end(), 0.0);
+  for (double& tap : filter) {
+    tap *= gain;
+  }
+  return filter;
+}
+
+}  // namespace
+
+constexpr size_t PolyphaseResampler::kKernelSize;
+constexpr int PolyphaseResampler::kMaxFactor;
+
+bool PolyphaseResampler::IsSupported(int src_sample_rate_hz,
+                                     int dst_sample_rate_hz) {
+  if (src_sample_rate_hz <= 0 || dst_sample_rate_hz <= 0 ||
+      src_sample_rate_hz == dst_sample_rate_hz ||
+      src_sample_rate_hz % 100 != 0 || dst_sample_rate_hz % 100 != 0) {
+    return false;
+  }
+  const int gcd =
+      GreatestCommonDivisor(src_sample_rate_hz, dst_sample_rate_hz);
+  const int interpolation_factor = dst_sample_rate_hz / gcd;
+  const int decimation_factor = src_sample_rate_hz / gcd;
+  return interpolation_factor <= kMaxFactor &&
+         decimation_factor <= kMaxFactor &&
+         (src_sample_rate_hz / 100) % decimation_factor == 0;
+}
+
+float PolyphaseResampler::AlgorithmicDelaySeconds(int src_sample_rate_hz,
+                                                  int dst_sample_rate_hz) {
+  const int gcd =
+      GreatestCommonDivisor(src_sample_rate_hz, dst_sample_rate_hz);
+  const int interpolation_factor = dst_sample_rate_hz / gcd;
+  const int decimation_factor = src_sample_rate_hz / gcd;
+  const size_t length = interpolation_factor *
+                        TapsPerPhase(interpolation_factor, decimation_factor);
+  // The prototype filter is centered at (length - 1) / 2 upsampled samples.
+  const float delay_input_samples =
+      0.5f * (length - 1) / interpolation_factor;
+  return delay_input_samples / src_sample_rate_hz;
+}
+
+PolyphaseResampler::PolyphaseResampler(int src_sample_rate_hz,
+                                       int dst_sample_rate_hz,
+                                       size_t num_channels)
+    : interpolation_factor_(
+          dst_sample_rate_hz /
+          GreatestCommonDivisor(src_sample_rate_hz, dst_sample_rate_hz)),
+      decimation_factor_(
+          src_sample_rate_hz /
+          GreatestCommonDivisor(src_sample_rate_hz, dst_sample_rate_hz)),
+      num_channels_(num_channels),
+      src_frames_(static_cast<size_t>(src_sample_rate_hz / 100)),
+      dst_frames_(static_cast<size_t>(dst_sample_rate_hz / 100)),
+      taps_per_phase_(TapsPerPhase(interpolation_factor_, decimation_factor_)),
+      convolve_proc_(Convolve_C),
+      kernels_(interpolation_factor_ * taps_per_phase_ * num_channels),
+      buffer_((taps_per_phase_ - 1 + src_frames_) * num_channels, 0.f) {
+  RTC_DCHECK(IsSupported(src_sample_rate_hz, dst_sample_rate_hz));
+  RTC_DCHECK_GT(num_channels_, 0);
+
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  if (GetCPUInfo(kAVX2) != 0 && 8 % num_channels_ == 0) {
+    convolve_proc_ = Convolve_AVX2;
+  }
+#endif
+
+  // Split the prototype filter into one kernel per phase. Output sample n uses
+  // phase p = (n * M) % L and the input frames up to i = (n * M) / L as
+  //   y[n] = sum_k h[p + k * L] * x[i - k].
+  // The taps are stored in reverse order so that the kernel is applied to the
+  // input in increasing time order, and are repeated for every channel.
+  const std::vector<double> prototype =
+      CreatePrototypeFilter(interpolation_factor_, decimation_factor_,
+                            taps_per_phase_);
+  for (int p = 0; p < interpolation_factor_; ++p) {
+    float* kernel = &kernels_[p * taps_per_phase_ * num_channels_];
+    for (size_t k = 0; k < taps_per_phase_; ++k) {
+      const float tap =
+          static_cast<float>(prototype[p + k * interpolation_factor_]);
+      std::fill_n(&kernel[(taps_per_phase_ - 1 - k) * num_channels_],
+                  num_channels_, tap);
+    }
+  }
+}
+
+PolyphaseResampler::~PolyphaseResampler() = default;
+
+void PolyphaseResampler::Reset() {
+  std::fill(buffer_.begin(), buffer_.end(), 0.f);
+}
+
+size_t PolyphaseResampler::Resample(rtc::ArrayView<const float> src,
+                                    rtc::ArrayView<float> dst) {
+  RTC_DCHECK_EQ(src.size(), src_frames_ * num_channels_);
+  RTC_DCHECK_GE(dst.size(), dst_frames_ * num_channels_);
+  const size_t history_size = (taps_per_phase_ - 1) * num_channels_;
+  const size_t kernel_size = taps_per_phase_ * num_channels_;
+  std::copy(src.begin(), src.end(), buffer_.begin() + history_size);
+
+  // Since 10 ms of input is a whole number of decimation periods, every block
+  // starts at phase zero.
+  for (size_t n = 0; n < dst_frames_; ++n) {
+    const size_t t = n * decimation_factor_;
+    const size_t i = t / interpolation_factor_;
+    const size_t p = t % interpolation_factor_;
+    // Input frame i is stored at frame i + taps_per_phase_ - 1 in `buffer_`,
+    // so the window of the last taps_per_phase_ frames starts at frame i.
+    convolve_proc_(&buffer_[i * num_channels_], &kernels_[p * kernel_size],
+                   kernel_size, num_channels_, &dst[n * num_channels_]);
+  }
+
+  // Keep the tail of the input as history for the next block.
+  std::copy(buffer_.end() - history_size, buffer_.end(), buffer_.begin());
+  return dst_frames_ * num_channels_;
+}
+
+void PolyphaseResampler::Convolve_C(const float* input,
+                                    const float* kernel,
+                                    size_t length,
+                                    size_t num_channels,
+                                    float* output) {
+  std::fill_n(output, num_channels, 0.f);
+  for (size_t j = 0; j < length; j += num_channels) {
+    for (size_t ch = 0; ch < num_channels; ++ch) {
+      output[ch] += input[j + ch] * kernel[j + ch];
+    }
+  }
+}
+
+}  // namespace webrtc
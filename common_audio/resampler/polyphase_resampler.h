@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef COMMON_AUDIO_RESAMPLER_POLYPHASE_RESAMPLER_H_
+#define COMMON_AUDIO_RESAMPLER_POLYPHASE_RESAMPLER_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "api/array_view.h"
+#include "rtc_base/gtest_prod_util.h"
+#include "rtc_base/system/arch.h"
+
+namespace webrtc {
+
+// Polyphase FIR resampler for rational ratios L/M with small L and M, such as
+// 48 kHz <-> 16 kHz or 48 kHz <-> 32 kHz. Unlike SincResampler, which
+// interpolates between kernels for arbitrary ratios, every output sample is a
+// single dot product with one of L precomputed kernels.
+//
+// Operates on 10 ms blocks of interleaved audio. All the channels are filtered
+// in the same pass over the interleaved data, without de-interleaving.
+class PolyphaseResampler {
+ public:
+  // Length of the anti-aliasing filter, in samples of the lower of the two
+  // rates. When downsampling by M/L, M/L (rounded up) times as many taps are
+  // applied to the input for each output sample.
+  static constexpr size_t kKernelSize = 32;
+  // Largest interpolation or decimation factor supported after reduction of
+  // the ratio.
+  static constexpr int kMaxFactor = 6;
+
+  // Returns true if the rate pair can be handled, i.e., the rates are
+  // different, both are multiples of 100 Hz, the reduced ratio has numerator
+  // and denominator not greater than `kMaxFactor`, and 10 ms of input is a
+  // whole number of decimation periods.
+  static bool IsSupported(int src_sample_rate_hz, int dst_sample_rate_hz);
+
+  // Delay due to the filter kernel. Essentially, the time after which an input
+  // sample will appear in the resampled output.
+  static float AlgorithmicDelaySeconds(int src_sample_rate_hz,
+                                       int dst_sample_rate_hz);
+
+  // IsSupported() must be true for the rate pair.
+  PolyphaseResampler(int src_sample_rate_hz,
+                     int dst_sample_rate_hz,
+                     size_t num_channels);
+  PolyphaseResampler(const PolyphaseResampler&) = delete;
+  PolyphaseResampler& operator=(const PolyphaseResampler&) = delete;
+  ~PolyphaseResampler();
+
+  // Resamples 10 ms of interleaved audio. `src` must contain exactly
+  // `src_sample_rate_hz / 100 * num_channels` samples and `dst` room for at
+  // least `dst_sample_rate_hz / 100 * num_channels` samples. Returns the number
+  // of samples written to `dst`.
+  size_t Resample(rtc::ArrayView<const float> src, rtc::ArrayView<float> dst);
+
+  // Clears the filter history.
+  void Reset();
+
+ private:
+  FRIEND_TEST_ALL_PREFIXES(PolyphaseResamplerTest, OptimizedKernelsMatchC);
+
+  // Computes, for each of the `num_channels` channels, the dot product between
+  // the interleaved `input` and `kernel`, both with `length` samples, and
+  // writes it into `output`.
+  static void Convolve_C(const float* input,
+                         const float* kernel,
+                         size_t length,
+                         size_t num_channels,
+                         float* output);
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  // `num_channels` must divide 8 and `length` must be a multiple of 16.
+  static void Convolve_AVX2(const float* input,
+                            const float* kernel,
+                            size_t length,
+                            size_t num_channels,
+                            float* output);
+#endif
+
+  typedef void (*ConvolveProc)(const float*,
+                               const float*,
+                               size_t,
+                               size_t,
+                               float*);
+
+  const int interpolation_factor_;
+  const int decimation_factor_;
+  const size_t num_channels_;
+  const size_t src_frames_;
+  const size_t dst_frames_;
+  // Number of input frames each output frame is computed from.
+  const size_t taps_per_phase_;
+  ConvolveProc convolve_proc_;
+  // One kernel per phase, with every tap repeated `num_channels_` times so that
+  // it lines up with the interleaved input.
+  std::vector<float> kernels_;
+  // Interleaved input with the last `taps_per_phase_ - 1` frames of the
+  // previous block followed by the current block.
+  std::vector<float> buffer_;
+};
+
+}  // namespace webrtc
+
+#endif  // COMMON_AUDIO_RESAMPLER_POLYPHASE_RESAMPLER_H_
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <immintrin.h>
+#include <stddef.h>
+
+#include "common_audio/resampler/polyphase_resampler.h"
+#include "rtc_base/checks.h"
+
+namespace webrtc {
+
+void PolyphaseResampler::Convolve_AVX2(const float* input,
+                                       const float* kernel,
+                                       size_t length,
+                                       size_t num_channels,
+                                       float* output) {
+  RTC_DCHECK_EQ(8 % num_channels, 0);
+  RTC_DCHECK_EQ(length % 16, 0);
+
+  // Since `num_channels` divides 8, lane l of every 8 sample vector always
+  // holds channel l % num_channels. Two accumulators are used to hide the
+  // latency of the fused multiply-add.
+  __m256 m_sums1 = _mm256_setzero_ps();
+  __m256 m_sums2 = _mm256_setzero_ps();
+  for (size_t i = 0; i < length; i += 16) {
+    m_sums1 = _mm256_fmadd_ps(_mm256_loadu_ps(input + i),
+                              _mm256_loadu_ps(kernel + i), m_sums1);
+    m_sums2 = _mm256_fmadd_ps(_mm256_loadu_ps(input + i + 8),
+                              _mm256_loadu_ps(kernel + i + 8), m_sums2);
+  }
+  const __m256 m_sums = _mm256_add_ps(m_sums1, m_sums2);
+
+  if (num_channels == 8) {
+    _mm256_storeu_ps(output, m_sums);
+    return;
+  }
+
+  // Fold the lanes belonging to the same channel together.
+  __m128 m128_sums = _mm_add_ps(_mm256_extractf128_ps(m_sums, 0),
+                                _mm256_extractf128_ps(m_sums, 1));
+  if (num_channels == 4) {
+    _mm_storeu_ps(output, m128_sums);
+    return;
+  }
+  m128_sums = _mm_add_ps(m128_sums, _mm_movehl_ps(m128_sums, m128_sums));
+  if (num_channels == 2) {
+    _mm_storel_pi(reinterpret_cast<__m64*>(output), m128_sums);
+    return;
+  }
+  _mm_store_ss(output,
+               _mm_add_ss(m128_sums, _mm_shuffle_ps(m128_sums, m128_sums, 1)));
+}
+
+}  // namespace webrtc
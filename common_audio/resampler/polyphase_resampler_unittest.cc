@@ -0,0 +1,227 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// MSVC++ requires this to be set before any other includes to get M_PI.
+#define _USE_MATH_DEFINES
+
+#include "common_audio/resampler/polyphase_resampler.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common_audio/resampler/include/push_resampler.h"
+#include "rtc_base/system/arch.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/cpu_features_wrapper.h"
+#include "test/field_trial.h"
+#include "test/gtest.h"
+
+namespace webrtc {
+namespace {
+
+constexpr int kSampleRates[] = {8000, 16000, 32000, 44100, 48000};
+constexpr size_t kNumChannels[] = {1, 2, 4, 8};
+
+// Fills `frame` with the interleaved samples [`first_frame`, `first_frame` +
+// `frame.size() / num_channels`) of a sine wave with amplitude `amplitude` and
+// frequency `frequency_hz` + 100 Hz * channel.
+void GenerateSine(int sample_rate_hz,
+                  size_t num_channels,
+                  size_t first_frame,
+                  float frequency_hz,
+                  float amplitude,
+                  std::vector<float>* frame) {
+  const size_t num_frames = frame->size() / num_channels;
+  for (size_t n = 0; n < num_frames; ++n) {
+    for (size_t ch = 0; ch < num_channels; ++ch) {
+      const double f = frequency_hz + 100.0 * ch;
+      (*frame)[n * num_channels + ch] = static_cast<float>(
+          amplitude * sin(2.0 * M_PI * f * (first_frame + n) / sample_rate_hz));
+    }
+  }
+}
+
+// Resamples a sine wave and returns the signal-to-noise ratio, in dB, of the
+// output compared to the ideal, delay compensated, sine wave at the
+// destination rate.
+float ComputeSineSnr(int src_sample_rate_hz,
+                     int dst_sample_rate_hz,
+                     float frequency_hz) {
+  constexpr int kNumBlocks = 50;
+  constexpr float kAmplitude = 10000.f;
+  const size_t src_frames = src_sample_rate_hz / 100;
+  const size_t dst_frames = dst_sample_rate_hz / 100;
+  PolyphaseResampler resampler(src_sample_rate_hz, dst_sample_rate_hz, 1);
+  const double delay_s = PolyphaseResampler::AlgorithmicDelaySeconds(
+      src_sample_rate_hz, dst_sample_rate_hz);
+
+  std::vector<float> src(src_frames);
+  std::vector<float> dst(dst_frames);
+  double signal_energy = 0.0;
+  double error_energy = 0.0;
+  for (int b = 0; b < kNumBlocks; ++b) {
+    GenerateSine(src_sample_rate_hz, 1, b * src_frames, frequency_hz,
+                 kAmplitude, &src);
+    resampler.Resample(src, dst);
+    // Skip the initial blocks, where the filter history is being filled.
+    if (b < 2) {
+      continue;
+    }
+    for (size_t n = 0; n < dst_frames; ++n) {
+      const double t =
+          static_cast<double>(b * dst_frames + n) / dst_sample_rate_hz -
+          delay_s;
+      const double expected = kAmplitude * sin(2.0 * M_PI * frequency_hz * t);
+      signal_energy += expected * expected;
+      error_energy += (dst[n] - expected) * (dst[n] - expected);
+    }
+  }
+  return static_cast<float>(10.0 * log10(signal_energy / error_energy));
+}
+
+}  // namespace
+
+TEST(PolyphaseResamplerTest, SupportedRates) {
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(48000, 16000));
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(16000, 48000));
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(48000, 32000));
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(32000, 48000));
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(48000, 8000));
+  EXPECT_TRUE(PolyphaseResampler::IsSupported(8000, 16000));
+  EXPECT_FALSE(PolyphaseResampler::IsSupported(48000, 48000));
+  EXPECT_FALSE(PolyphaseResampler::IsSupported(44100, 48000));
+  EXPECT_FALSE(PolyphaseResampler::IsSupported(48000, 44100));
+  EXPECT_FALSE(PolyphaseResampler::IsSupported(96000, 8000));
+  EXPECT_FALSE(PolyphaseResampler::IsSupported(0, 8000));
+}
+
+// Verifies that an in-band sine wave is passed through with low distortion.
+TEST(PolyphaseResamplerTest, SineQuality) {
+  for (int src_rate : kSampleRates) {
+    for (int dst_rate : kSampleRates) {
+      if (!PolyphaseResampler::IsSupported(src_rate, dst_rate)) {
+        continue;
+      }
+      SCOPED_TRACE(src_rate);
+      SCOPED_TRACE(dst_rate);
+      const float frequency_hz = 0.25f * std::min(src_rate, dst_rate);
+      EXPECT_GT(ComputeSineSnr(src_rate, dst_rate, frequency_hz), 50.f);
+    }
+  }
+}
+
+// Verifies that the channels are filtered independently, and identically to a
+// mono resampler fed with the same channel.
+TEST(PolyphaseResamplerTest, InterleavedChannelsMatchMono) {
+  constexpr int kSrcRate = 48000;
+  constexpr int kDstRate = 16000;
+  constexpr size_t kChannels = 4;
+  PolyphaseResampler multichannel(kSrcRate, kDstRate, kChannels);
+  PolyphaseResampler mono(kSrcRate, kDstRate, 1);
+  std::vector<float> src(kSrcRate / 100 * kChannels);
+  std::vector<float> dst(kDstRate / 100 * kChannels);
+  std::vector<float> src_mono(kSrcRate / 100);
+  std::vector<float> dst_mono(kDstRate / 100);
+  constexpr size_t kCheckedChannel = 2;
+  for (size_t b = 0; b < 10; ++b) {
+    GenerateSine(kSrcRate, kChannels, b * kSrcRate / 100, 1000.f, 5000.f,
+                 &src);
+    for (size_t n = 0; n < src_mono.size(); ++n) {
+      src_mono[n] = src[n * kChannels + kCheckedChannel];
+    }
+    multichannel.Resample(src, dst);
+    mono.Resample(src_mono, dst_mono);
+    for (size_t n = 0; n < dst_mono.size(); ++n) {
+      EXPECT_NEAR(dst_mono[n], dst[n * kChannels + kCheckedChannel], 0.05f);
+    }
+  }
+}
+
+TEST(PolyphaseResamplerTest, OptimizedKernelsMatchC) {
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  if (GetCPUInfo(kAVX2) == 0) {
+    return;
+  }
+  for (size_t num_channels : kNumChannels) {
+    const size_t length = PolyphaseResampler::kKernelSize * num_channels;
+    std::vector<float> input(length);
+    std::vector<float> kernel(length);
+    for (size_t k = 0; k < length; ++k) {
+      input[k] = 1000.f * sin(0.1f * k);
+      kernel[k] = 0.1f * cos(0.3f * k);
+    }
+    std::vector<float> output_c(num_channels);
+    std::vector<float> output_avx2(num_channels);
+    PolyphaseResampler::Convolve_C(input.data(), kernel.data(), length,
+                                   num_channels, output_c.data());
+    PolyphaseResampler::Convolve_AVX2(input.data(), kernel.data(), length,
+                                      num_channels, output_avx2.data());
+    for (size_t ch = 0; ch < num_channels; ++ch) {
+      EXPECT_NEAR(output_c[ch], output_avx2[ch], 1e-3f);
+    }
+  }
+#endif
+}
+
+TEST(PolyphaseResamplerTest, UsedByPushResamplerWhenEnabled) {
+  test::ScopedFieldTrials field_trials(
+      "WebRTC-Audio-PolyphasePushResampler/Enabled/");
+  PushResampler<int16_t> resampler;
+  ASSERT_EQ(0, resampler.InitializeIfNeeded(48000, 16000, 2));
+  std::vector<int16_t> src(480 * 2, 1000);
+  std::vector<int16_t> dst(160 * 2);
+  for (int b = 0; b < 5; ++b) {
+    EXPECT_EQ(160 * 2, resampler.Resample(src.data(), src.size(), dst.data(),
+                                          dst.size()));
+  }
+  // Once the filter history is filled, DC is passed through unchanged.
+  for (int16_t sample : dst) {
+    EXPECT_NEAR(1000, sample, 2);
+  }
+}
+
+// Compares the time taken by PushResampler with the sinc and the polyphase
+// resamplers for all the supported rate pairs and channel counts.
+TEST(PolyphaseResamplerTest, DISABLED_PushResamplerBenchmark) {
+  constexpr int kNumBlocks = 10000;
+  for (int src_rate : kSampleRates) {
+    for (int dst_rate : kSampleRates) {
+      if (!PolyphaseResampler::IsSupported(src_rate, dst_rate)) {
+        continue;
+      }
+      for (size_t num_channels : kNumChannels) {
+        std::vector<float> src(src_rate / 100 * num_channels);
+        std::vector<float> dst(dst_rate / 100 * num_channels);
+        GenerateSine(src_rate, num_channels, 0, 440.f, 10000.f, &src);
+        double time_us[2];
+        for (int polyphase = 0; polyphase < 2; ++polyphase) {
+          test::ScopedFieldTrials field_trials(
+              polyphase ? "WebRTC-Audio-PolyphasePushResampler/Enabled/" : "");
+          PushResampler<float> resampler;
+          resampler.InitializeIfNeeded(src_rate, dst_rate, num_channels);
+          int64_t start = rtc::TimeNanos();
+          for (int b = 0; b < kNumBlocks; ++b) {
+            resampler.Resample(src.data(), src.size(), dst.data(), dst.size());
+          }
+          time_us[polyphase] = static_cast<double>(rtc::TimeNanos() - start) /
+                               rtc::kNumNanosecsPerMicrosec / kNumBlocks;
+        }
+        printf("%5d -> %5d Hz, %zu channels: sinc %.2f us, polyphase %.2f us "
+               "per 10 ms.\n",
+               src_rate, dst_rate, num_channels, time_us[0], time_us[1]);
+      }
+    }
+  }
+}
+
+}  // namespace webrtc
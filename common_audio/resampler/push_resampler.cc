@@ -14,10 +14,15 @@
 #include <string.h>
 
 #include <memory>
+#include <type_traits>
+#include <vector>
 
+#include "api/array_view.h"
 #include "common_audio/include/audio_util.h"
+#include "common_audio/resampler/polyphase_resampler.h"
 #include "common_audio/resampler/push_sinc_resampler.h"
 #include "rtc_base/checks.h"
+#include "system_wrappers/include/field_trial.h"
 
 namespace webrtc {
 namespace {
@@ -55,6 +60,39 @@ void CheckExpectedBufferSizes(size_t src_length,
   RTC_DCHECK_GE(dst_capacity, dst_size_10ms);
 #endif
 }
+
+bool UsePolyphaseResampler(int src_sample_rate_hz, int dst_sample_rate_hz) {
+  return field_trial::IsEnabled("WebRTC-Audio-PolyphasePushResampler") &&
+         PolyphaseResampler::IsSupported(src_sample_rate_hz,
+                                         dst_sample_rate_hz);
+}
+
+size_t ResamplePolyphase(PolyphaseResampler* resampler,
+                         const float* src,
+                         size_t src_length,
+                         float* dst,
+                         size_t dst_capacity,
+                         std::vector<float>* /* source */,
+                         std::vector<float>* /* destination */) {
+  return resampler->Resample(rtc::ArrayView<const float>(src, src_length),
+                             rtc::ArrayView<float>(dst, dst_capacity));
+}
+
+size_t ResamplePolyphase(PolyphaseResampler* resampler,
+                         const int16_t* src,
+                         size_t src_length,
+                         int16_t* dst,
+                         size_t dst_capacity,
+                         std::vector<float>* source,
+                         std::vector<float>* destination) {
+  RTC_DCHECK_EQ(source->size(), src_length);
+  S16ToFloatS16(src, src_length, source->data());
+  const size_t dst_length =
+      resampler->Resample(*source, rtc::ArrayView<float>(*destination));
+  RTC_DCHECK_LE(dst_length, dst_capacity);
+  FloatS16ToS16(destination->data(), dst_length, dst);
+  return dst_length;
+}
 }  // namespace
 
 template <typename T>
@@ -90,6 +128,18 @@ int PushResampler<T>::InitializeIfNeeded(int src_sample_rate_hz,
   const size_t dst_size_10ms_mono =
       static_cast<size_t>(dst_sample_rate_hz / 100);
   channel_resamplers_.clear();
+  polyphase_resampler_.reset();
+
+  if (UsePolyphaseResampler(src_sample_rate_hz, dst_sample_rate_hz)) {
+    polyphase_resampler_ = std::make_unique<PolyphaseResampler>(
+        src_sample_rate_hz, dst_sample_rate_hz, num_channels);
+    if (!std::is_same<T, float>::value) {
+      polyphase_source_.resize(src_size_10ms_mono * num_channels);
+      polyphase_destination_.resize(dst_size_10ms_mono * num_channels);
+    }
+    return 0;
+  }
+
   for (size_t i = 0; i < num_channels; ++i) {
     channel_resamplers_.push_back(ChannelResampler());
     auto channel_resampler = channel_resamplers_.rbegin();
@@ -119,6 +169,12 @@ int PushResampler<T>::Resample(const T* src,
     return static_cast<int>(src_length);
   }
 
+  if (polyphase_resampler_) {
+    return static_cast<int>(ResamplePolyphase(
+        polyphase_resampler_.get(), src, src_length, dst, dst_capacity,
+        &polyphase_source_, &polyphase_destination_));
+  }
+
   const size_t src_length_mono = src_length / num_channels_;
   const size_t dst_capacity_mono = dst_capacity / num_channels_;
 
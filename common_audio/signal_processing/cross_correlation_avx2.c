@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <immintrin.h>
+
+#include "common_audio/signal_processing/spl_avx2.h"
+
+static inline int32_t HorizontalSum(__m256i sum_256) {
+  __m128i sum_128 = _mm_add_epi32(_mm256_castsi256_si128(sum_256),
+                                  _mm256_extracti128_si256(sum_256, 1));
+  sum_128 = _mm_add_epi32(sum_128, _mm_srli_si128(sum_128, 8));
+  sum_128 = _mm_add_epi32(sum_128, _mm_srli_si128(sum_128, 4));
+  return _mm_cvtsi128_si32(sum_128);
+}
+
+// Dot product of `seq1` and `seq2`, where every product is shifted before
+// being accumulated, as in the C version. The sum wraps around on overflow, so
+// the order of the additions does not matter.
+static inline int32_t DotProductWithScale(const int16_t* seq1,
+                                          const int16_t* seq2,
+                                          size_t length,
+                                          int right_shifts) {
+  size_t j = 0;
+  uint32_t sum = 0;
+  const size_t residual = length & 0xF;
+  __m256i sum_256 = _mm256_setzero_si256();
+
+  if (right_shifts == 0) {
+    // Without scaling, the products can be summed pairwise.
+    for (j = 0; j < length - residual; j += 16) {
+      const __m256i s1 = _mm256_loadu_si256((const __m256i*)&seq1[j]);
+      const __m256i s2 = _mm256_loadu_si256((const __m256i*)&seq2[j]);
+      sum_256 = _mm256_add_epi32(sum_256, _mm256_madd_epi16(s1, s2));
+    }
+  } else {
+    const __m128i shift = _mm_cvtsi32_si128(right_shifts);
+    for (j = 0; j < length - residual; j += 16) {
+      const __m256i s1 = _mm256_loadu_si256((const __m256i*)&seq1[j]);
+      const __m256i s2 = _mm256_loadu_si256((const __m256i*)&seq2[j]);
+      // Form the full 32-bit products from their low and high halves.
+      const __m256i lo = _mm256_mullo_epi16(s1, s2);
+      const __m256i hi = _mm256_mulhi_epi16(s1, s2);
+      const __m256i p0 = _mm256_unpacklo_epi16(lo, hi);
+      const __m256i p1 = _mm256_unpackhi_epi16(lo, hi);
+      sum_256 = _mm256_add_epi32(sum_256, _mm256_sra_epi32(p0, shift));
+      sum_256 = _mm256_add_epi32(sum_256, _mm256_sra_epi32(p1, shift));
+    }
+  }
+  sum = (uint32_t)HorizontalSum(sum_256);
+
+  for (; j < length; j++) {
+    sum += (uint32_t)((seq1[j] * seq2[j]) >> right_shifts);
+  }
+  return (int32_t)sum;
+}
+
+// AVX2 version of WebRtcSpl_CrossCorrelation().
+void WebRtcSpl_CrossCorrelationAvx2(int32_t* cross_correlation,
+                                    const int16_t* seq1,
+                                    const int16_t* seq2,
+                                    size_t dim_seq,
+                                    size_t dim_cross_correlation,
+                                    int right_shifts,
+                                    int step_seq2) {
+  size_t i = 0;
+
+  for (i = 0; i < dim_cross_correlation; i++) {
+    *cross_correlation++ =
+        DotProductWithScale(seq1, seq2, dim_seq, right_shifts);
+    seq2 += step_seq2;
+  }
+}
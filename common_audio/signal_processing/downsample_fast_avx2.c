@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <immintrin.h>
+
+#include "common_audio/signal_processing/spl_avx2.h"
+#include "rtc_base/checks.h"
+
+static inline int16_t SatW32ToW16(int32_t value32) {
+  return (int16_t)(value32 > 32767 ? 32767
+                                   : value32 < -32768 ? -32768 : value32);
+}
+
+// AVX2 version of WebRtcSpl_DownsampleFast(). Eight output samples are
+// computed in parallel. For every pair of filter coefficients, the two input
+// samples needed by each output are fetched with one 32-bit gather, which are
+// then multiplied with the coefficient pair and summed by _mm256_madd_epi16().
+int WebRtcSpl_DownsampleFastAvx2(const int16_t* data_in,
+                                 size_t data_in_length,
+                                 int16_t* data_out,
+                                 size_t data_out_length,
+                                 const int16_t* __restrict coefficients,
+                                 size_t coefficients_length,
+                                 int factor,
+                                 size_t delay) {
+  int16_t* const original_data_out = data_out;
+  size_t i = 0;
+  size_t j = 0;
+  int32_t out_s32 = 0;
+  size_t endpos = delay + factor * (data_out_length - 1) + 1;
+  // The gathers read one sample past the input of the last output in each
+  // block, so the last output is always left for the C loop below.
+  size_t num_blocks = data_out_length > 0 ? (data_out_length - 1) >> 3 : 0;
+  size_t endpos1 = delay + factor * 8 * num_blocks;
+
+  // Return error if any of the running conditions doesn't meet.
+  if (data_out_length == 0 || coefficients_length == 0
+                           || data_in_length < endpos) {
+    return -1;
+  }
+
+  {
+    const __m256i offsets = _mm256_mullo_epi32(
+        _mm256_set1_epi32(factor), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i round = _mm256_set1_epi32(2048);  // 0.5 in Q12.
+    const size_t num_pairs = coefficients_length >> 1;
+
+    for (i = delay; i < endpos1; i += 8 * factor) {
+      __m256i out_256 = round;
+
+      for (j = 0; j < 2 * num_pairs; j += 2) {
+        // Lane n holds data_in[i + n * factor - j - 1] in the low and
+        // data_in[i + n * factor - j] in the high 16 bits.
+        const __m256i in = _mm256_i32gather_epi32(
+            (const int*)&data_in[(ptrdiff_t)i - (ptrdiff_t)j - 1], offsets, 2);
+        const __m256i coeffs = _mm256_set1_epi32(
+            (int32_t)(((uint32_t)(uint16_t)coefficients[j] << 16) |
+                      (uint16_t)coefficients[j + 1]));
+        out_256 = _mm256_add_epi32(out_256, _mm256_madd_epi16(in, coeffs));
+      }
+      if (coefficients_length & 1) {
+        // Lane n holds data_in[i + n * factor - j] in the low 16 bits.
+        const __m256i in = _mm256_i32gather_epi32(
+            (const int*)&data_in[(ptrdiff_t)i - (ptrdiff_t)j], offsets, 2);
+        const __m256i coeffs =
+            _mm256_set1_epi32((int32_t)(uint16_t)coefficients[j]);
+        out_256 = _mm256_add_epi32(out_256, _mm256_madd_epi16(in, coeffs));
+      }
+
+      // Q12 to Q0, then saturate and store the output.
+      out_256 = _mm256_srai_epi32(out_256, 12);
+      const __m256i packed = _mm256_permute4x64_epi64(
+          _mm256_packs_epi32(out_256, out_256), 0x08);
+      _mm_storeu_si128((__m128i*)data_out, _mm256_castsi256_si128(packed));
+      data_out += 8;
+    }
+  }
+
+  // Second part, do the remaining iterations (if any).
+  for (; i < endpos; i += factor) {
+    out_s32 = 2048;  // Round value, 0.5 in Q12.
+
+    for (j = 0; j < coefficients_length; j++) {
+      out_s32 += coefficients[j] * data_in[(ptrdiff_t) i - (ptrdiff_t) j];
+    }
+
+    out_s32 >>= 12;  // Q0.
+
+    // Saturate and store the output.
+    *data_out++ = SatW32ToW16(out_s32);
+  }
+
+  RTC_DCHECK_EQ(original_data_out + data_out_length, data_out);
+
+  return 0;
+}
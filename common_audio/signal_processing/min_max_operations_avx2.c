@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <immintrin.h>
+#include <stdlib.h>
+
+#include "common_audio/signal_processing/spl_avx2.h"
+#include "rtc_base/checks.h"
+
+// Maximum absolute value of word16 vector. AVX2 version.
+int16_t WebRtcSpl_MaxAbsValueW16Avx2(const int16_t* vector, size_t length) {
+  size_t i = 0;
+  int maximum = 0;
+  const size_t residual = length & 0xF;
+  __m256i max_256 = _mm256_setzero_si256();
+
+  RTC_DCHECK_GT(length, 0);
+
+  // abs(-32768) is 0x8000 in 16 bits, which is the largest value when
+  // interpreted as unsigned.
+  for (i = 0; i < length - residual; i += 16) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&vector[i]);
+    max_256 = _mm256_max_epu16(max_256, _mm256_abs_epi16(in));
+  }
+
+  // Reduce the 16 lanes to one.
+  __m128i max_128 = _mm_max_epu16(_mm256_castsi256_si128(max_256),
+                                  _mm256_extracti128_si256(max_256, 1));
+  max_128 = _mm_max_epu16(max_128, _mm_srli_si128(max_128, 8));
+  max_128 = _mm_max_epu16(max_128, _mm_srli_si128(max_128, 4));
+  max_128 = _mm_max_epu16(max_128, _mm_srli_si128(max_128, 2));
+  maximum = _mm_extract_epi16(max_128, 0);
+
+  // Second part, do the remaining iterations (if any).
+  for (; i < length; i++) {
+    const int absolute = abs((int)vector[i]);
+    if (absolute > maximum) {
+      maximum = absolute;
+    }
+  }
+
+  // Guard the case for abs(-32768).
+  if (maximum > INT16_MAX) {
+    maximum = INT16_MAX;
+  }
+
+  return (int16_t)maximum;
+}
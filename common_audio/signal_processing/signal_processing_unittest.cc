@@ -9,11 +9,19 @@
  */
 
 #include <algorithm>
+#include <vector>
 
 #include "common_audio/signal_processing/include/signal_processing_library.h"
+#include "rtc_base/random.h"
 #include "rtc_base/strings/string_builder.h"
+#include "rtc_base/system/arch.h"
 #include "test/gtest.h"
 
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+#include "common_audio/signal_processing/spl_avx2.h"
+#include "common_audio/signal_processing/spl_cpu_features.h"
+#endif
+
 static const size_t kVector16Size = 9;
 static const int16_t vector16[kVector16Size] = {1,
                                                 -15511,
@@ -539,18 +547,83 @@ TEST(SplTest, CrossCorrelationTest) {
   const int32_t kExpected[kCrossCorrelationDimension] = {-266947903, -15579555,
                                                          -171282001};
   const int32_t* expected = kExpected;
-#if !defined(MIPS32_LE)
+#if defined(WEBRTC_HAS_NEON)
   const int32_t kExpectedNeon[kCrossCorrelationDimension] = {
       -266947901, -15579553, -171281999};
-  if (WebRtcSpl_CrossCorrelation != WebRtcSpl_CrossCorrelationC) {
-    expected = kExpectedNeon;
-  }
+  expected = kExpectedNeon;
 #endif
   for (size_t i = 0; i < kCrossCorrelationDimension; ++i) {
     EXPECT_EQ(expected[i], vector32[i]);
   }
 }
 
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+// Verifies that the AVX2 versions are bit-exact with the C versions, which the
+// NetEq checksums rely on.
+TEST(SplTest, Avx2BitExactness) {
+  if (!WebRtcSpl_CpuHasAvx2()) {
+    return;
+  }
+  webrtc::Random random(42);
+  std::vector<int16_t> data(1000);
+  for (int16_t& sample : data) {
+    sample = random.Rand<int16_t>();
+  }
+  // Include the extreme values, in particular for abs(-32768).
+  data[17] = WEBRTC_SPL_WORD16_MIN;
+  data[18] = WEBRTC_SPL_WORD16_MAX;
+
+  for (size_t length : {1, 7, 16, 31, 33, 128, 500}) {
+    for (size_t offset : {0, 3}) {
+      EXPECT_EQ(WebRtcSpl_MaxAbsValueW16C(&data[offset], length),
+                WebRtcSpl_MaxAbsValueW16Avx2(&data[offset], length));
+    }
+  }
+
+  for (size_t dim_seq : {1, 15, 16, 60, 100}) {
+    for (int right_shifts : {0, 1, 6}) {
+      for (int step : {1, -1}) {
+        constexpr size_t kDimCrossCorrelation = 50;
+        int32_t expected[kDimCrossCorrelation];
+        int32_t actual[kDimCrossCorrelation];
+        const int16_t* seq2 = step > 0 ? &data[300] : &data[800];
+        WebRtcSpl_CrossCorrelationC(expected, &data[0], seq2, dim_seq,
+                                    kDimCrossCorrelation, right_shifts, step);
+        WebRtcSpl_CrossCorrelationAvx2(actual, &data[0], seq2, dim_seq,
+                                       kDimCrossCorrelation, right_shifts,
+                                       step);
+        for (size_t i = 0; i < kDimCrossCorrelation; ++i) {
+          EXPECT_EQ(expected[i], actual[i]);
+        }
+      }
+    }
+  }
+
+  // Q12 coefficients with unity DC gain, so that both saturation and the
+  // regular range are exercised.
+  const int16_t kCoefficients[] = {1229, 1638, 1229, -1024, 410, 307, -200};
+  for (int factor : {2, 3, 4, 12}) {
+    for (size_t num_coefficients = 1;
+         num_coefficients <= sizeof(kCoefficients) / sizeof(int16_t);
+         ++num_coefficients) {
+      for (size_t out_length : {1, 8, 9, 20, 64}) {
+        const size_t delay = num_coefficients;
+        const size_t in_length = delay + factor * (out_length - 1) + 1;
+        std::vector<int16_t> expected(out_length);
+        std::vector<int16_t> actual(out_length);
+        EXPECT_EQ(0, WebRtcSpl_DownsampleFastC(
+                         &data[0], in_length, expected.data(), out_length,
+                         kCoefficients, num_coefficients, factor, delay));
+        EXPECT_EQ(0, WebRtcSpl_DownsampleFastAvx2(
+                         &data[0], in_length, actual.data(), out_length,
+                         kCoefficients, num_coefficients, factor, delay));
+        EXPECT_EQ(expected, actual);
+      }
+    }
+  }
+}
+#endif  // defined(WEBRTC_ARCH_X86_FAMILY)
+
 TEST(SplTest, AutoCorrelationTest) {
   int scale = 0;
   int32_t vector32[kVector16Size];
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// AVX2 versions of some of the signal processing library functions. They are
+// bit-exact with the C versions and are selected at runtime in spl_init.c. See
+// include/signal_processing_library.h for the documentation of the functions.
+
+#ifndef COMMON_AUDIO_SIGNAL_PROCESSING_SPL_AVX2_H_
+#define COMMON_AUDIO_SIGNAL_PROCESSING_SPL_AVX2_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int16_t WebRtcSpl_MaxAbsValueW16Avx2(const int16_t* vector, size_t length);
+
+void WebRtcSpl_CrossCorrelationAvx2(int32_t* cross_correlation,
+                                    const int16_t* seq1,
+                                    const int16_t* seq2,
+                                    size_t dim_seq,
+                                    size_t dim_cross_correlation,
+                                    int right_shifts,
+                                    int step_seq2);
+
+int WebRtcSpl_DownsampleFastAvx2(const int16_t* data_in,
+                                 size_t data_in_length,
+                                 int16_t* data_out,
+                                 size_t data_out_length,
+                                 const int16_t* __restrict coefficients,
+                                 size_t coefficients_length,
+                                 int factor,
+                                 size_t delay);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+#endif  // COMMON_AUDIO_SIGNAL_PROCESSING_SPL_AVX2_H_
@@ -0,0 +1,23 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "common_audio/signal_processing/spl_cpu_features.h"
+
+#include "rtc_base/system/arch.h"
+#include "system_wrappers/include/cpu_features_wrapper.h"
+
+int WebRtcSpl_CpuHasAvx2(void) {
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  static const int has_avx2 = webrtc::GetCPUInfo(webrtc::kAVX2) != 0;
+  return has_avx2;
+#else
+  return 0;
+#endif
+}
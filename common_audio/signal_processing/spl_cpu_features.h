@@ -0,0 +1,25 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef COMMON_AUDIO_SIGNAL_PROCESSING_SPL_CPU_FEATURES_H_
+#define COMMON_AUDIO_SIGNAL_PROCESSING_SPL_CPU_FEATURES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns non-zero if the AVX2 versions of the signal processing library
+// functions can be used. The CPU is only queried on the first call.
+int WebRtcSpl_CpuHasAvx2(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+#endif  // COMMON_AUDIO_SIGNAL_PROCESSING_SPL_CPU_FEATURES_H_
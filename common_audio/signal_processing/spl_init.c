@@ -11,6 +11,12 @@
 // Some code came from common/rtcd.c in the WebM project.
 
 #include "common_audio/signal_processing/include/signal_processing_library.h"
+#include "rtc_base/system/arch.h"
+
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+#include "common_audio/signal_processing/spl_avx2.h"
+#include "common_audio/signal_processing/spl_cpu_features.h"
+#endif
 
 // TODO(bugs.webrtc.org/9553): These function pointers are useless. Refactor
 // things so that we simply have a bunch of regular functions with different
@@ -53,6 +59,61 @@ const ScaleAndAddVectorsWithRound WebRtcSpl_ScaleAndAddVectorsWithRound =
     WebRtcSpl_ScaleAndAddVectorsWithRoundC;
 #endif
 
+#elif defined(WEBRTC_ARCH_X86_FAMILY)
+
+// The AVX2 support is only known at runtime, so on x86 the pointers are set to
+// functions which forward to the best available version.
+static int16_t MaxAbsValueW16X86(const int16_t* vector, size_t length) {
+  return WebRtcSpl_CpuHasAvx2() ? WebRtcSpl_MaxAbsValueW16Avx2(vector, length)
+                                : WebRtcSpl_MaxAbsValueW16C(vector, length);
+}
+
+static void CrossCorrelationX86(int32_t* cross_correlation,
+                                const int16_t* seq1,
+                                const int16_t* seq2,
+                                size_t dim_seq,
+                                size_t dim_cross_correlation,
+                                int right_shifts,
+                                int step_seq2) {
+  if (WebRtcSpl_CpuHasAvx2()) {
+    WebRtcSpl_CrossCorrelationAvx2(cross_correlation, seq1, seq2, dim_seq,
+                                   dim_cross_correlation, right_shifts,
+                                   step_seq2);
+  } else {
+    WebRtcSpl_CrossCorrelationC(cross_correlation, seq1, seq2, dim_seq,
+                                dim_cross_correlation, right_shifts,
+                                step_seq2);
+  }
+}
+
+static int DownsampleFastX86(const int16_t* data_in,
+                             size_t data_in_length,
+                             int16_t* data_out,
+                             size_t data_out_length,
+                             const int16_t* __restrict coefficients,
+                             size_t coefficients_length,
+                             int factor,
+                             size_t delay) {
+  return WebRtcSpl_CpuHasAvx2()
+             ? WebRtcSpl_DownsampleFastAvx2(
+                   data_in, data_in_length, data_out, data_out_length,
+                   coefficients, coefficients_length, factor, delay)
+             : WebRtcSpl_DownsampleFastC(
+                   data_in, data_in_length, data_out, data_out_length,
+                   coefficients, coefficients_length, factor, delay);
+}
+
+const MaxAbsValueW16 WebRtcSpl_MaxAbsValueW16 = MaxAbsValueW16X86;
+const MaxAbsValueW32 WebRtcSpl_MaxAbsValueW32 = WebRtcSpl_MaxAbsValueW32C;
+const MaxValueW16 WebRtcSpl_MaxValueW16 = WebRtcSpl_MaxValueW16C;
+const MaxValueW32 WebRtcSpl_MaxValueW32 = WebRtcSpl_MaxValueW32C;
+const MinValueW16 WebRtcSpl_MinValueW16 = WebRtcSpl_MinValueW16C;
+const MinValueW32 WebRtcSpl_MinValueW32 = WebRtcSpl_MinValueW32C;
+const CrossCorrelation WebRtcSpl_CrossCorrelation = CrossCorrelationX86;
+const DownsampleFast WebRtcSpl_DownsampleFast = DownsampleFastX86;
+const ScaleAndAddVectorsWithRound WebRtcSpl_ScaleAndAddVectorsWithRound =
+    WebRtcSpl_ScaleAndAddVectorsWithRoundC;
+
 #else
 
 const MaxAbsValueW16 WebRtcSpl_MaxAbsValueW16 = WebRtcSpl_MaxAbsValueW16C;
@@ -0,0 +1,170 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "common_video/include/decoded_frame_buffer_pool.h"
+
+#include <string.h>
+
+#include <iterator>
+
+#include "rtc_base/checks.h"
+#include "rtc_base/logging.h"
+
+namespace webrtc {
+namespace {
+
+// Same alignment as used by I420Buffer.
+constexpr size_t kBufferAlignment = 64;
+
+}  // namespace
+
+DecodedFrameBufferPool::Buffer::Buffer(size_t size)
+    : data_(static_cast<uint8_t*>(AlignedMalloc(size, kBufferAlignment))),
+      size_(size) {}
+
+DecodedFrameBufferPool::DecodedFrameBufferPool(bool zero_initialize,
+                                               size_t max_number_of_buffers,
+                                               size_t max_total_bytes)
+    : zero_initialize_(zero_initialize),
+      max_total_bytes_(max_total_bytes),
+      max_number_of_buffers_(max_number_of_buffers) {}
+
+DecodedFrameBufferPool::~DecodedFrameBufferPool() = default;
+
+rtc::scoped_refptr<DecodedFrameBufferPool::Buffer>
+DecodedFrameBufferPool::GetBuffer(size_t size) {
+  RTC_DCHECK_GT(size, 0);
+#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+  // Limit size of 8k YUV highdef frame
+  size_t size_limit = 7680 * 4320 * 3 / 2 * 2;
+  if (size > size_limit)
+    return nullptr;
+#endif
+
+  MutexLock lock(&mutex_);
+  auto it = buffers_.find(size);
+  if (it != buffers_.end()) {
+    for (const rtc::scoped_refptr<Buffer>& buffer : it->second) {
+      if (buffer->HasOneRef()) {
+        return buffer;
+      }
+    }
+  }
+
+  while (num_buffers_ + 1 > max_number_of_buffers_ ||
+         total_bytes_ + size > max_total_bytes_) {
+    if (!DeleteFreeBuffer(size)) {
+      RTC_LOG(LS_WARNING) << "DecodedFrameBufferPool is full with "
+                          << num_buffers_ << " buffers of " << total_bytes_
+                          << " bytes in total.";
+      return nullptr;
+    }
+  }
+
+  rtc::scoped_refptr<Buffer> buffer(new Buffer(size));
+  if (zero_initialize_) {
+    memset(buffer->data(), 0, size);
+  }
+  buffers_[size].push_back(buffer);
+  ++num_buffers_;
+  total_bytes_ += size;
+  ++num_allocations_;
+  return buffer;
+}
+
+bool DecodedFrameBufferPool::DeleteFreeBuffer(size_t size) {
+  for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+    if (it->first == size) {
+      continue;
+    }
+    std::vector<rtc::scoped_refptr<Buffer>>& buffers = it->second;
+    for (auto buffer = buffers.begin(); buffer != buffers.end(); ++buffer) {
+      if ((*buffer)->HasOneRef()) {
+        buffers.erase(buffer);
+        --num_buffers_;
+        total_bytes_ -= it->first;
+        if (buffers.empty()) {
+          buffers_.erase(it);
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool DecodedFrameBufferPool::Resize(size_t max_number_of_buffers) {
+  MutexLock lock(&mutex_);
+  size_t used_buffers_count = 0;
+  for (const auto& it : buffers_) {
+    for (const rtc::scoped_refptr<Buffer>& buffer : it.second) {
+      if (!buffer->HasOneRef()) {
+        ++used_buffers_count;
+      }
+    }
+  }
+  if (used_buffers_count > max_number_of_buffers) {
+    return false;
+  }
+  max_number_of_buffers_ = max_number_of_buffers;
+
+  for (auto it = buffers_.begin();
+       it != buffers_.end() && num_buffers_ > max_number_of_buffers_;) {
+    std::vector<rtc::scoped_refptr<Buffer>>& buffers = it->second;
+    for (auto buffer = buffers.begin();
+         buffer != buffers.end() && num_buffers_ > max_number_of_buffers_;) {
+      if ((*buffer)->HasOneRef()) {
+        buffer = buffers.erase(buffer);
+        --num_buffers_;
+        total_bytes_ -= it->first;
+      } else {
+        ++buffer;
+      }
+    }
+    it = buffers.empty() ? buffers_.erase(it) : std::next(it);
+  }
+  return true;
+}
+
+void DecodedFrameBufferPool::Release() {
+  MutexLock lock(&mutex_);
+  buffers_.clear();
+  num_buffers_ = 0;
+  total_bytes_ = 0;
+}
+
+int DecodedFrameBufferPool::GetNumBuffersInUse() const {
+  MutexLock lock(&mutex_);
+  int num_buffers_in_use = 0;
+  for (const auto& it : buffers_) {
+    for (const rtc::scoped_refptr<Buffer>& buffer : it.second) {
+      if (!buffer->HasOneRef())
+        ++num_buffers_in_use;
+    }
+  }
+  return num_buffers_in_use;
+}
+
+size_t DecodedFrameBufferPool::GetNumBuffers() const {
+  MutexLock lock(&mutex_);
+  return num_buffers_;
+}
+
+size_t DecodedFrameBufferPool::GetTotalBytes() const {
+  MutexLock lock(&mutex_);
+  return total_bytes_;
+}
+
+int DecodedFrameBufferPool::GetNumAllocations() const {
+  MutexLock lock(&mutex_);
+  return num_allocations_;
+}
+
+}  // namespace webrtc
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "common_video/include/decoded_frame_buffer_pool.h"
+
+#include <stdint.h>
+
+#include <limits>
+
+#include "api/scoped_refptr.h"
+#include "test/gtest.h"
+
+namespace webrtc {
+namespace {
+
+constexpr size_t kUnlimited = std::numeric_limits<size_t>::max();
+
+// Same layout as vpx_codec_frame_buffer and aom_codec_frame_buffer_t.
+struct FakeCodecFrameBuffer {
+  uint8_t* data;
+  size_t size;
+  void* priv;
+};
+
+}  // namespace
+
+TEST(TestDecodedFrameBufferPool, SimpleBufferReuse) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false, kUnlimited,
+                              kUnlimited);
+  auto buffer = pool.GetBuffer(1000);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(1000u, buffer->size());
+  const uint8_t* data = buffer->data();
+  EXPECT_EQ(1, pool.GetNumBuffersInUse());
+  buffer = nullptr;
+  EXPECT_EQ(0, pool.GetNumBuffersInUse());
+
+  buffer = pool.GetBuffer(1000);
+  EXPECT_EQ(data, buffer->data());
+  EXPECT_EQ(1, pool.GetNumAllocations());
+}
+
+TEST(TestDecodedFrameBufferPool, ZeroInitializesNewBuffers) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/true, kUnlimited,
+                              kUnlimited);
+  auto buffer = pool.GetBuffer(100);
+  ASSERT_TRUE(buffer);
+  for (size_t i = 0; i < buffer->size(); ++i) {
+    EXPECT_EQ(0, buffer->data()[i]);
+  }
+}
+
+TEST(TestDecodedFrameBufferPool, KeepsFreeBuffersOfEachSize) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false, kUnlimited,
+                              kUnlimited);
+  // Alternate between two sizes, as when decoding two spatial layers.
+  for (int i = 0; i < 10; ++i) {
+    auto small = pool.GetBuffer(100);
+    auto large = pool.GetBuffer(400);
+    ASSERT_TRUE(small);
+    ASSERT_TRUE(large);
+  }
+  EXPECT_EQ(2, pool.GetNumAllocations());
+  EXPECT_EQ(2u, pool.GetNumBuffers());
+  EXPECT_EQ(500u, pool.GetTotalBytes());
+}
+
+TEST(TestDecodedFrameBufferPool, DeletesFreeBuffersOfOtherSizesWhenFull) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false,
+                              /*max_number_of_buffers=*/2, kUnlimited);
+  auto first = pool.GetBuffer(100);
+  auto second = pool.GetBuffer(100);
+  first = nullptr;
+  // The free buffer of the old size makes room for one of the new size.
+  auto third = pool.GetBuffer(200);
+  ASSERT_TRUE(third);
+  EXPECT_EQ(2u, pool.GetNumBuffers());
+  EXPECT_EQ(300u, pool.GetTotalBytes());
+  // All buffers are in use.
+  EXPECT_FALSE(pool.GetBuffer(200));
+}
+
+TEST(TestDecodedFrameBufferPool, RespectsMaxTotalBytes) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false, kUnlimited,
+                              /*max_total_bytes=*/1000);
+  auto first = pool.GetBuffer(600);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(pool.GetBuffer(600));
+  auto second = pool.GetBuffer(400);
+  EXPECT_TRUE(second);
+}
+
+TEST(TestDecodedFrameBufferPool, Resize) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false, kUnlimited,
+                              kUnlimited);
+  auto first = pool.GetBuffer(100);
+  auto second = pool.GetBuffer(100);
+  auto third = pool.GetBuffer(200);
+  EXPECT_FALSE(pool.Resize(2));
+  second = nullptr;
+  third = nullptr;
+  EXPECT_TRUE(pool.Resize(1));
+  EXPECT_EQ(1u, pool.GetNumBuffers());
+  EXPECT_EQ(100u, pool.GetTotalBytes());
+  EXPECT_FALSE(pool.GetBuffer(100));
+}
+
+TEST(TestDecodedFrameBufferPool, BufferValidAfterRelease) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/true, kUnlimited,
+                              kUnlimited);
+  auto buffer = pool.GetBuffer(100);
+  pool.Release();
+  EXPECT_EQ(0u, pool.GetNumBuffers());
+  EXPECT_EQ(0, buffer->data()[99]);
+  auto other = pool.GetBuffer(100);
+  EXPECT_NE(buffer->data(), other->data());
+}
+
+TEST(TestDecodedFrameBufferPool, CodecCallbacksHandOverReference) {
+  DecodedFrameBufferPool pool(/*zero_initialize=*/false, kUnlimited,
+                              kUnlimited);
+  FakeCodecFrameBuffer fb = {};
+  ASSERT_EQ(0, DecodedFrameBufferPool::GetCodecFrameBuffer(&pool, 100, &fb));
+  ASSERT_NE(nullptr, fb.priv);
+  EXPECT_EQ(100u, fb.size);
+  EXPECT_EQ(1, pool.GetNumBuffersInUse());
+
+  // A decoded image referencing the buffer keeps it alive after the decoder
+  // has released it.
+  rtc::scoped_refptr<DecodedFrameBufferPool::Buffer> image_buffer(
+      static_cast<DecodedFrameBufferPool::Buffer*>(fb.priv));
+  EXPECT_TRUE(image_buffer->Contains(fb.data + 50));
+  EXPECT_EQ(0, DecodedFrameBufferPool::ReleaseCodecFrameBuffer(&pool, &fb));
+  EXPECT_EQ(nullptr, fb.priv);
+  EXPECT_EQ(1, pool.GetNumBuffersInUse());
+  // Releasing twice is harmless.
+  EXPECT_EQ(0, DecodedFrameBufferPool::ReleaseCodecFrameBuffer(&pool, &fb));
+  image_buffer = nullptr;
+  EXPECT_EQ(0, pool.GetNumBuffersInUse());
+}
+
+}  // namespace webrtc
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef COMMON_VIDEO_INCLUDE_DECODED_FRAME_BUFFER_POOL_H_
+#define COMMON_VIDEO_INCLUDE_DECODED_FRAME_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "api/ref_counted_base.h"
+#include "api/scoped_refptr.h"
+#include "rtc_base/memory/aligned_malloc.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread_annotations.h"
+
+namespace webrtc {
+
+// Pool of memory buffers that software decoders decode directly into, so that
+// the decoded image can be handed to the application without a copy. This is
+// the codec independent counterpart of Vp9FrameBufferPool: the decoder library
+// requests buffers through GetCodecFrameBuffer() and returns them through
+// ReleaseCodecFrameBuffer(), and decoded images reference their buffer (e.g.
+// via |fb_priv|) which the application keeps alive with a scoped_refptr for as
+// long as the frame is in use.
+//
+// Free buffers are kept in one free-list per buffer size, which in practice
+// means one per resolution, so that decoders alternating between resolutions
+// (e.g. spatial layers) keep recycling buffers. Free buffers of other sizes are
+// only deleted when a new buffer would exceed |max_number_of_buffers| or
+// |max_total_bytes|. When neither limit can be respected, no buffer is
+// returned.
+//
+// Pseudo example usage with libaom:
+//    DecodedFrameBufferPool pool(/*zero_initialize=*/true, 150, 1 << 30);
+//    aom_codec_set_frame_buffer_functions(
+//        ctx,
+//        DecodedFrameBufferPool::GetCodecFrameBuffer<aom_codec_frame_buffer_t>,
+//        DecodedFrameBufferPool::ReleaseCodecFrameBuffer<
+//            aom_codec_frame_buffer_t>,
+//        &pool);
+//    ...
+//    aom_image_t* img = aom_codec_get_frame(ctx, &iter);
+//    rtc::scoped_refptr<DecodedFrameBufferPool::Buffer> buffer =
+//        static_cast<DecodedFrameBufferPool::Buffer*>(img->fb_priv);
+class DecodedFrameBufferPool {
+ public:
+  class Buffer final : public rtc::RefCountedNonVirtual<Buffer> {
+   public:
+    explicit Buffer(size_t size);
+
+    uint8_t* data() { return data_.get(); }
+    const uint8_t* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+    // Returns true if |pointer| points into this buffer.
+    bool Contains(const uint8_t* pointer) const {
+      return pointer >= data_.get() && pointer < data_.get() + size_;
+    }
+
+    using rtc::RefCountedNonVirtual<Buffer>::HasOneRef;
+
+   private:
+    const std::unique_ptr<uint8_t, AlignedFreeDeleter> data_;
+    const size_t size_;
+  };
+
+  // If |zero_initialize| is true, newly allocated buffers are zeroed, as
+  // required by e.g. libvpx and libaom. Recycled buffers are not cleared.
+  DecodedFrameBufferPool(bool zero_initialize,
+                         size_t max_number_of_buffers,
+                         size_t max_total_bytes);
+  DecodedFrameBufferPool(const DecodedFrameBufferPool&) = delete;
+  DecodedFrameBufferPool& operator=(const DecodedFrameBufferPool&) = delete;
+  ~DecodedFrameBufferPool();
+
+  // Returns a buffer of |size| bytes, recycling a free buffer of the same size
+  // or allocating a new one. Returns null if the buffer would exceed the limits
+  // of the pool even after deleting all free buffers of other sizes. The buffer
+  // becomes free again when no longer referenced from the outside.
+  rtc::scoped_refptr<Buffer> GetBuffer(size_t size);
+
+  // Changes the max number of buffers in the pool. Returns false if more
+  // buffers than that are in use, otherwise deletes free buffers until the
+  // pool is within the new limit and returns true.
+  bool Resize(size_t max_number_of_buffers);
+
+  // Deletes all free buffers and stops tracking the buffers in use, which are
+  // deleted when no longer referenced.
+  void Release();
+
+  // Number of buffers that are referenced from outside the pool.
+  int GetNumBuffersInUse() const;
+  // Number of buffers, free or in use, and their total size in bytes.
+  size_t GetNumBuffers() const;
+  size_t GetTotalBytes() const;
+  // Number of buffers allocated since the pool was created.
+  int GetNumAllocations() const;
+
+  // Frame buffer callbacks with the signature used by libvpx
+  // (vpx_codec_frame_buffer) and libaom (aom_codec_frame_buffer_t), with
+  // |user_priv| pointing to the pool. The buffer is handed over to the decoder
+  // in |fb->priv| together with one reference, which is dropped again by
+  // ReleaseCodecFrameBuffer(). Returns 0 on success and -1 on failure.
+  template <typename CodecFrameBuffer>
+  static int GetCodecFrameBuffer(void* user_priv,
+                                 size_t min_size,
+                                 CodecFrameBuffer* fb) {
+    DecodedFrameBufferPool* pool =
+        static_cast<DecodedFrameBufferPool*>(user_priv);
+    rtc::scoped_refptr<Buffer> buffer = pool->GetBuffer(min_size);
+    if (!buffer) {
+      return -1;
+    }
+    fb->data = buffer->data();
+    fb->size = buffer->size();
+    fb->priv = static_cast<void*>(buffer.release());
+    return 0;
+  }
+  template <typename CodecFrameBuffer>
+  static int ReleaseCodecFrameBuffer(void* /*user_priv*/,
+                                     CodecFrameBuffer* fb) {
+    Buffer* buffer = static_cast<Buffer*>(fb->priv);
+    if (buffer != nullptr) {
+      buffer->Release();
+      // Protects against the decoder releasing the same buffer twice.
+      fb->priv = nullptr;
+    }
+    return 0;
+  }
+
+ private:
+  // Deletes one free buffer with a size other than |size|. Returns false if
+  // there is none.
+  bool DeleteFreeBuffer(size_t size) RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const bool zero_initialize_;
+  const size_t max_total_bytes_;
+  mutable Mutex mutex_;
+  size_t max_number_of_buffers_ RTC_GUARDED_BY(mutex_);
+  // All buffers, free or in use, by size.
+  std::map<size_t, std::vector<rtc::scoped_refptr<Buffer>>> buffers_
+      RTC_GUARDED_BY(mutex_);
+  size_t num_buffers_ RTC_GUARDED_BY(mutex_) = 0;
+  size_t total_bytes_ RTC_GUARDED_BY(mutex_) = 0;
+  int num_allocations_ RTC_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace webrtc
+
+#endif  // COMMON_VIDEO_INCLUDE_DECODED_FRAME_BUFFER_POOL_H_
@@ -21,6 +21,20 @@
 
 namespace rtc {
 
+namespace {
+
+bool SameWants(const VideoSinkWants& a, const VideoSinkWants& b) {
+  return a.rotation_applied == b.rotation_applied &&
+         a.black_frames == b.black_frames &&
+         a.max_pixel_count == b.max_pixel_count &&
+         a.target_pixel_count == b.target_pixel_count &&
+         a.max_framerate_fps == b.max_framerate_fps &&
+         a.resolution_alignment == b.resolution_alignment &&
+         a.resolutions == b.resolutions;
+}
+
+}  // namespace
+
 VideoBroadcaster::VideoBroadcaster() = default;
 VideoBroadcaster::~VideoBroadcaster() = default;
 
@@ -29,20 +43,33 @@ void VideoBroadcaster::AddOrUpdateSink(
     const VideoSinkWants& wants) {
   RTC_DCHECK(sink != nullptr);
   webrtc::MutexLock lock(&sinks_and_wants_lock_);
-  if (!FindSinkPair(sink)) {
+  bool groups_changed = false;
+  const SinkPair* sink_pair = FindSinkPair(sink);
+  if (!sink_pair) {
     // |Sink| is a new sink, which didn't receive previous frame.
     previous_frame_sent_to_all_sinks_ = false;
+    groups_changed = AddToWantsGroup(wants);
+  } else if (!SameWants(sink_pair->wants, wants)) {
+    groups_changed = RemoveFromWantsGroup(sink_pair->wants);
+    groups_changed |= AddToWantsGroup(wants);
   }
   VideoSourceBase::AddOrUpdateSink(sink, wants);
-  UpdateWants();
+  if (groups_changed) {
+    UpdateWants();
+  }
 }
 
 void VideoBroadcaster::RemoveSink(
     VideoSinkInterface<webrtc::VideoFrame>* sink) {
   RTC_DCHECK(sink != nullptr);
   webrtc::MutexLock lock(&sinks_and_wants_lock_);
+  const SinkPair* sink_pair = FindSinkPair(sink);
+  const bool groups_changed =
+      sink_pair && RemoveFromWantsGroup(sink_pair->wants);
   VideoSourceBase::RemoveSink(sink);
-  UpdateWants();
+  if (groups_changed) {
+    UpdateWants();
+  }
 }
 
 bool VideoBroadcaster::frame_wanted() const {
@@ -58,6 +85,9 @@ VideoSinkWants VideoBroadcaster::wants() const {
 void VideoBroadcaster::OnFrame(const webrtc::VideoFrame& frame) {
   webrtc::MutexLock lock(&sinks_and_wants_lock_);
   bool current_frame_was_discarded = false;
+  // Created for the first sink that needs them and shared by the others.
+  absl::optional<webrtc::VideoFrame> black_frame;
+  absl::optional<webrtc::VideoFrame> frame_without_update_rect;
   for (auto& sink_pair : sink_pairs()) {
     if (sink_pair.wants.rotation_applied &&
         frame.rotation() != webrtc::kVideoRotation_0) {
@@ -71,21 +101,24 @@ void VideoBroadcaster::OnFrame(const webrtc::VideoFrame& frame) {
       continue;
     }
     if (sink_pair.wants.black_frames) {
-      webrtc::VideoFrame black_frame =
-          webrtc::VideoFrame::Builder()
-              .set_video_frame_buffer(
-                  GetBlackFrameBuffer(frame.width(), frame.height()))
-              .set_rotation(frame.rotation())
-              .set_timestamp_us(frame.timestamp_us())
-              .set_id(frame.id())
-              .build();
-      sink_pair.sink->OnFrame(black_frame);
+      if (!black_frame) {
+        black_frame = webrtc::VideoFrame::Builder()
+                          .set_video_frame_buffer(GetBlackFrameBuffer(
+                              frame.width(), frame.height()))
+                          .set_rotation(frame.rotation())
+                          .set_timestamp_us(frame.timestamp_us())
+                          .set_id(frame.id())
+                          .build();
+      }
+      sink_pair.sink->OnFrame(*black_frame);
     } else if (!previous_frame_sent_to_all_sinks_ && frame.has_update_rect()) {
       // Since last frame was not sent to some sinks, no reliable update
       // information is available, so we need to clear the update rect.
-      webrtc::VideoFrame copy = frame;
-      copy.clear_update_rect();
-      sink_pair.sink->OnFrame(copy);
+      if (!frame_without_update_rect) {
+        frame_without_update_rect = frame;
+        frame_without_update_rect->clear_update_rect();
+      }
+      sink_pair.sink->OnFrame(*frame_without_update_rect);
     } else {
       sink_pair.sink->OnFrame(frame);
     }
@@ -100,34 +133,61 @@ void VideoBroadcaster::OnDiscardedFrame() {
   }
 }
 
+bool VideoBroadcaster::AddToWantsGroup(const VideoSinkWants& wants) {
+  for (WantsGroup& group : wants_groups_) {
+    if (SameWants(group.wants, wants)) {
+      ++group.num_sinks;
+      return false;
+    }
+  }
+  wants_groups_.push_back(WantsGroup{wants, 1});
+  return true;
+}
+
+bool VideoBroadcaster::RemoveFromWantsGroup(const VideoSinkWants& wants) {
+  for (auto it = wants_groups_.begin(); it != wants_groups_.end(); ++it) {
+    if (SameWants(it->wants, wants)) {
+      if (--it->num_sinks > 0) {
+        return false;
+      }
+      wants_groups_.erase(it);
+      return true;
+    }
+  }
+  RTC_NOTREACHED();
+  return false;
+}
+
 void VideoBroadcaster::UpdateWants() {
   VideoSinkWants wants;
   wants.rotation_applied = false;
   wants.resolution_alignment = 1;
-  for (auto& sink : sink_pairs()) {
-    // wants.rotation_applied == ANY(sink.wants.rotation_applied)
-    if (sink.wants.rotation_applied) {
+  // Sinks with identical wants don't change the result, so it's enough to
+  // look at one sink per group.
+  for (const WantsGroup& group : wants_groups_) {
+    // wants.rotation_applied == ANY(group.wants.rotation_applied)
+    if (group.wants.rotation_applied) {
       wants.rotation_applied = true;
     }
-    // wants.max_pixel_count == MIN(sink.wants.max_pixel_count)
-    if (sink.wants.max_pixel_count < wants.max_pixel_count) {
-      wants.max_pixel_count = sink.wants.max_pixel_count;
+    // wants.max_pixel_count == MIN(group.wants.max_pixel_count)
+    if (group.wants.max_pixel_count < wants.max_pixel_count) {
+      wants.max_pixel_count = group.wants.max_pixel_count;
     }
     // Select the minimum requested target_pixel_count, if any, of all sinks so
     // that we don't over utilize the resources for any one.
     // TODO(sprang): Consider using the median instead, since the limit can be
     // expressed by max_pixel_count.
-    if (sink.wants.target_pixel_count &&
+    if (group.wants.target_pixel_count &&
         (!wants.target_pixel_count ||
-         (*sink.wants.target_pixel_count < *wants.target_pixel_count))) {
-      wants.target_pixel_count = sink.wants.target_pixel_count;
+         (*group.wants.target_pixel_count < *wants.target_pixel_count))) {
+      wants.target_pixel_count = group.wants.target_pixel_count;
     }
     // Select the minimum for the requested max framerates.
-    if (sink.wants.max_framerate_fps < wants.max_framerate_fps) {
-      wants.max_framerate_fps = sink.wants.max_framerate_fps;
+    if (group.wants.max_framerate_fps < wants.max_framerate_fps) {
+      wants.max_framerate_fps = group.wants.max_framerate_fps;
     }
     wants.resolution_alignment = cricket::LeastCommonMultiple(
-        wants.resolution_alignment, sink.wants.resolution_alignment);
+        wants.resolution_alignment, group.wants.resolution_alignment);
   }
 
   if (wants.target_pixel_count &&
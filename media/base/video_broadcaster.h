@@ -11,6 +11,8 @@
 #ifndef MEDIA_BASE_VIDEO_BROADCASTER_H_
 #define MEDIA_BASE_VIDEO_BROADCASTER_H_
 
+#include <vector>
+
 #include "api/scoped_refptr.h"
 #include "api/sequence_checker.h"
 #include "api/video/video_frame_buffer.h"
@@ -26,6 +28,11 @@ namespace rtc {
 // rtc::VideoSinkInterface. The class is threadsafe; methods may be called on
 // any thread. This is needed because VideoStreamEncoder calls AddOrUpdateSink
 // both on the worker thread and on the encoder task queue.
+//
+// Sinks with identical VideoSinkWants share a group, and the combined wants
+// are only recomputed, over the groups, when a group is added or removed.
+// Black frames and frames with a cleared update rect are created once per
+// frame and shared by all sinks that need them.
 class VideoBroadcaster : public VideoSourceBase,
                          public VideoSinkInterface<webrtc::VideoFrame> {
  public:
@@ -51,6 +58,19 @@ class VideoBroadcaster : public VideoSourceBase,
   void OnDiscardedFrame() override;
 
  protected:
+  // Sinks with the same |wants|.
+  struct WantsGroup {
+    VideoSinkWants wants;
+    int num_sinks;
+  };
+
+  // Adds a sink to the group for |wants|. Returns true if the group is new.
+  bool AddToWantsGroup(const VideoSinkWants& wants)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(sinks_and_wants_lock_);
+  // Removes a sink from the group for |wants|. Returns true if the group is
+  // removed since it has no sinks left.
+  bool RemoveFromWantsGroup(const VideoSinkWants& wants)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(sinks_and_wants_lock_);
   void UpdateWants() RTC_EXCLUSIVE_LOCKS_REQUIRED(sinks_and_wants_lock_);
   const rtc::scoped_refptr<webrtc::VideoFrameBuffer>& GetBlackFrameBuffer(
       int width,
@@ -59,6 +79,7 @@ class VideoBroadcaster : public VideoSourceBase,
   mutable webrtc::Mutex sinks_and_wants_lock_;
 
   VideoSinkWants current_wants_ RTC_GUARDED_BY(sinks_and_wants_lock_);
+  std::vector<WantsGroup> wants_groups_ RTC_GUARDED_BY(sinks_and_wants_lock_);
   rtc::scoped_refptr<webrtc::VideoFrameBuffer> black_frame_buffer_;
   bool previous_frame_sent_to_all_sinks_ RTC_GUARDED_BY(sinks_and_wants_lock_) =
       true;
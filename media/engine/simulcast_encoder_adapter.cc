@@ -20,6 +20,7 @@
 
 #include "absl/algorithm/container.h"
 #include "api/scoped_refptr.h"
+#include "api/task_queue/default_task_queue_factory.h"
 #include "api/video/i420_buffer.h"
 #include "api/video/video_codec_constants.h"
 #include "api/video/video_frame_buffer.h"
@@ -32,6 +33,7 @@
 #include "modules/video_coding/utility/simulcast_rate_allocator.h"
 #include "rtc_base/atomic_ops.h"
 #include "rtc_base/checks.h"
+#include "rtc_base/event.h"
 #include "rtc_base/experiments/rate_control_settings.h"
 #include "rtc_base/logging.h"
 #include "system_wrappers/include/field_trial.h"
@@ -175,7 +177,10 @@ SimulcastEncoderAdapter::StreamContext::StreamContext(
       width_(width),
       height_(height),
       is_keyframe_needed_(false),
-      is_paused_(is_paused) {
+      is_paused_(is_paused),
+      hold_callbacks_(false),
+      scaled_buffer_pool_(std::make_unique<VideoFrameBufferPool>()),
+      needs_full_update_rect_(true) {
   if (parent_) {
     encoder_context_->encoder().RegisterEncodeCompleteCallback(this);
   }
@@ -189,7 +194,11 @@ SimulcastEncoderAdapter::StreamContext::StreamContext(StreamContext&& rhs)
       width_(rhs.width_),
       height_(rhs.height_),
       is_keyframe_needed_(rhs.is_keyframe_needed_),
-      is_paused_(rhs.is_paused_) {
+      is_paused_(rhs.is_paused_),
+      hold_callbacks_(rhs.hold_callbacks_),
+      pending_callbacks_(std::move(rhs.pending_callbacks_)),
+      scaled_buffer_pool_(std::move(rhs.scaled_buffer_pool_)),
+      needs_full_update_rect_(rhs.needs_full_update_rect_) {
   if (parent_) {
     encoder_context_->encoder().RegisterEncodeCompleteCallback(this);
   }
@@ -232,6 +241,13 @@ SimulcastEncoderAdapter::StreamContext::OnEncodedImage(
     const EncodedImage& encoded_image,
     const CodecSpecificInfo* codec_specific_info) {
   RTC_CHECK(parent_);  // If null, this method should never be called.
+  if (hold_callbacks_) {
+    PendingCallback pending;
+    pending.encoded_image = encoded_image;
+    pending.codec_specific_info = *codec_specific_info;
+    pending_callbacks_.push_back(std::move(pending));
+    return Result(Result::OK, encoded_image.Timestamp());
+  }
   return parent_->OnEncodedImage(stream_idx_, encoded_image,
                                  codec_specific_info);
 }
@@ -239,9 +255,36 @@ SimulcastEncoderAdapter::StreamContext::OnEncodedImage(
 void SimulcastEncoderAdapter::StreamContext::OnDroppedFrame(
     DropReason /*reason*/) {
   RTC_CHECK(parent_);  // If null, this method should never be called.
+  if (hold_callbacks_) {
+    pending_callbacks_.emplace_back();
+    return;
+  }
   parent_->OnDroppedFrame(stream_idx_);
 }
 
+void SimulcastEncoderAdapter::StreamContext::DeliverPendingCallbacks() {
+  RTC_DCHECK(!hold_callbacks_);
+  for (const PendingCallback& pending : pending_callbacks_) {
+    if (pending.encoded_image) {
+      parent_->OnEncodedImage(stream_idx_, *pending.encoded_image,
+                              &pending.codec_specific_info);
+    } else {
+      parent_->OnDroppedFrame(stream_idx_);
+    }
+  }
+  pending_callbacks_.clear();
+}
+
+SimulcastEncoderAdapter::LayerToEncode::LayerToEncode(
+    StreamContext* layer,
+    std::vector<VideoFrameType> frame_types)
+    : layer(layer), frame_types(std::move(frame_types)) {}
+
+SimulcastEncoderAdapter::LayerToEncode::LayerToEncode(LayerToEncode&&) =
+    default;
+
+SimulcastEncoderAdapter::LayerToEncode::~LayerToEncode() = default;
+
 SimulcastEncoderAdapter::SimulcastEncoderAdapter(VideoEncoderFactory* factory,
                                                  const SdpVideoFormat& format)
     : SimulcastEncoderAdapter(factory, nullptr, format) {}
@@ -261,7 +304,11 @@ SimulcastEncoderAdapter::SimulcastEncoderAdapter(
       boost_base_layer_quality_(RateControlSettings::ParseFromFieldTrials()
                                     .Vp8BoostBaseLayerQuality()),
       prefer_temporal_support_on_base_layer_(field_trial::IsEnabled(
-          "WebRTC-Video-PreferTemporalSupportOnBaseLayer")) {
+          "WebRTC-Video-PreferTemporalSupportOnBaseLayer")),
+      parallel_encode_(field_trial::IsEnabled(
+          "WebRTC-SimulcastEncoderAdapter-ParallelEncode")),
+      task_queue_factory_(parallel_encode_ ? CreateDefaultTaskQueueFactory()
+                                           : nullptr) {
   RTC_DCHECK(primary_factory);
 
   // The adapter is typically created on the worker thread, but operated on
@@ -412,8 +459,11 @@ int SimulcastEncoderAdapter::InitEncode(
 
     // Intercept frame encode complete callback only for upper streams, where
     // we need to set a correct stream index. Set |parent| to nullptr for the
-    // lowest stream to bypass the callback.
-    SimulcastEncoderAdapter* parent = stream_idx > 0 ? this : nullptr;
+    // lowest stream to bypass the callback, unless the layers are encoded in
+    // parallel, in which case all the callbacks are needed to deliver the
+    // encoded images in layer order.
+    SimulcastEncoderAdapter* parent =
+        stream_idx > 0 || parallel_encode_ ? this : nullptr;
 
     bool is_paused = stream_start_bitrate_kbps[stream_idx] == 0;
     stream_contexts_.emplace_back(
@@ -425,6 +475,14 @@ int SimulcastEncoderAdapter::InitEncode(
   // To save memory, don't store encoders that we don't use.
   DestroyStoredEncoders();
 
+  if (parallel_encode_) {
+    while (encode_queues_.size() + 1 < stream_contexts_.size()) {
+      encode_queues_.push_back(std::make_unique<rtc::TaskQueue>(
+          task_queue_factory_->CreateTaskQueue(
+              "SimulcastEncodeQueue", TaskQueueFactory::Priority::NORMAL)));
+    }
+  }
+
   rtc::AtomicOps::ReleaseStore(&inited_, 1);
   return WEBRTC_VIDEO_CODEC_OK;
 }
@@ -484,14 +542,11 @@ int SimulcastEncoderAdapter::Encode(
     }
   }
 
-  // Temporary thay may hold the result of texture to i420 buffer conversion.
-  rtc::scoped_refptr<VideoFrameBuffer> src_buffer;
-  int src_width = input_image.width();
-  int src_height = input_image.height();
-
+  std::vector<LayerToEncode> layers_to_encode;
   for (auto& layer : stream_contexts_) {
     // Don't encode frames in resolutions that we don't intend to send.
     if (layer.is_paused()) {
+      layer.set_needs_full_update_rect(true);
       continue;
     }
 
@@ -510,12 +565,54 @@ int SimulcastEncoderAdapter::Encode(
       layer.OnKeyframe(frame_timestamp);
     } else {
       if (layer.ShouldDropFrame(frame_timestamp)) {
+        layer.set_needs_full_update_rect(true);
         continue;
       }
       std::fill(stream_frame_types.begin(), stream_frame_types.end(),
                 VideoFrameType::kVideoFrameDelta);
     }
+    layers_to_encode.emplace_back(&layer, std::move(stream_frame_types));
+  }
+
+  int ret = ScaleLayerFrames(input_image, &layers_to_encode);
+  if (ret != WEBRTC_VIDEO_CODEC_OK) {
+    return ret;
+  }
+
+  if (parallel_encode_ && !bypass_mode_) {
+    return EncodeLayersInParallel(input_image, &layers_to_encode);
+  }
+
+  for (auto& layer_to_encode : layers_to_encode) {
+    ret = EncodeLayer(input_image, layer_to_encode);
+    if (ret != WEBRTC_VIDEO_CODEC_OK) {
+      return ret;
+    }
+  }
+
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int SimulcastEncoderAdapter::ScaleLayerFrames(
+    const VideoFrame& input_image,
+    std::vector<LayerToEncode>* layers) {
+  // Scale the largest layers first, so that the smaller layers can be scaled
+  // from them rather than from the input, which is cheaper and uses the
+  // 2:1 kernels of libyuv for the usual 1/2 and 1/4 layer resolutions.
+  std::vector<LayerToEncode*> layers_by_size;
+  for (auto& layer_to_encode : *layers) {
+    layers_by_size.push_back(&layer_to_encode);
+  }
+  std::stable_sort(layers_by_size.begin(), layers_by_size.end(),
+                   [](const LayerToEncode* a, const LayerToEncode* b) {
+                     return a->layer->width() * a->layer->height() >
+                            b->layer->width() * b->layer->height();
+                   });
 
+  // Frames which smaller layers may be scaled from.
+  std::vector<const VideoFrame*> scale_sources = {&input_image};
+  for (LayerToEncode* layer_to_encode : layers_by_size) {
+    StreamContext& layer = *layer_to_encode->layer;
     // If scaling isn't required, because the input resolution
     // matches the destination or the input image is empty (e.g.
     // a keyframe request for encoders with internal camera
@@ -526,39 +623,136 @@ int SimulcastEncoderAdapter::Encode(
     // correctly sample/scale the source texture.
     // TODO(perkj): ensure that works going forward, and figure out how this
     // affects webrtc:5683.
-    if ((layer.width() == src_width && layer.height() == src_height) ||
+    if ((layer.width() == input_image.width() &&
+         layer.height() == input_image.height()) ||
         (input_image.video_frame_buffer()->type() ==
              VideoFrameBuffer::Type::kNative &&
          layer.encoder().GetEncoderInfo().supports_native_handle)) {
-      int ret = layer.encoder().Encode(input_image, &stream_frame_types);
-      if (ret != WEBRTC_VIDEO_CODEC_OK) {
-        return ret;
+      layer.set_needs_full_update_rect(false);
+      continue;
+    }
+
+    // The sources are ordered by decreasing size, so the last one which is
+    // large enough is the cheapest to scale from.
+    const VideoFrame* source = scale_sources.front();
+    for (const VideoFrame* candidate : scale_sources) {
+      if (candidate->width() >= layer.width() &&
+          candidate->height() >= layer.height()) {
+        source = candidate;
       }
+    }
+
+    rtc::scoped_refptr<VideoFrameBuffer> src_buffer =
+        source->video_frame_buffer();
+    rtc::scoped_refptr<VideoFrameBuffer> dst_buffer;
+    if (src_buffer->type() == VideoFrameBuffer::Type::kI420) {
+      rtc::scoped_refptr<I420Buffer> buffer =
+          layer.scaled_buffer_pool().CreateI420Buffer(layer.width(),
+                                                      layer.height());
+      buffer->ScaleFrom(*src_buffer->GetI420());
+      dst_buffer = buffer;
+    } else if (src_buffer->type() == VideoFrameBuffer::Type::kNV12) {
+      rtc::scoped_refptr<NV12Buffer> buffer =
+          layer.scaled_buffer_pool().CreateNV12Buffer(layer.width(),
+                                                      layer.height());
+      buffer->CropAndScaleFrom(*src_buffer->GetNV12(), 0, 0,
+                               src_buffer->width(), src_buffer->height());
+      dst_buffer = buffer;
     } else {
-      if (src_buffer == nullptr) {
-        src_buffer = input_image.video_frame_buffer();
-      }
-      rtc::scoped_refptr<VideoFrameBuffer> dst_buffer =
-          src_buffer->Scale(layer.width(), layer.height());
-      if (!dst_buffer) {
-        RTC_LOG(LS_ERROR) << "Failed to scale video frame";
-        return WEBRTC_VIDEO_CODEC_ENCODER_FAILURE;
-      }
+      dst_buffer = src_buffer->Scale(layer.width(), layer.height());
+    }
+    if (!dst_buffer) {
+      RTC_LOG(LS_ERROR) << "Failed to scale video frame";
+      return WEBRTC_VIDEO_CODEC_ENCODER_FAILURE;
+    }
 
-      // UpdateRect is not propagated to lower simulcast layers currently.
-      // TODO(ilnik): Consider scaling UpdateRect together with the buffer.
-      VideoFrame frame(input_image);
-      frame.set_video_frame_buffer(dst_buffer);
-      frame.set_rotation(webrtc::kVideoRotation_0);
+    VideoFrame frame(input_image);
+    frame.set_video_frame_buffer(dst_buffer);
+    frame.set_rotation(webrtc::kVideoRotation_0);
+    // The update rect of the input is relative to the previous input frame,
+    // so it is only valid for layers which encoded that frame as well.
+    if (input_image.has_update_rect() && !layer.needs_full_update_rect()) {
+      frame.set_update_rect(source->update_rect().ScaleWithFrame(
+          source->width(), source->height(), 0, 0, source->width(),
+          source->height(), frame.width(), frame.height()));
+    } else {
       frame.set_update_rect(
           VideoFrame::UpdateRect{0, 0, frame.width(), frame.height()});
-      int ret = layer.encoder().Encode(frame, &stream_frame_types);
+    }
+    layer.set_needs_full_update_rect(false);
+    layer_to_encode->scaled_frame = std::move(frame);
+
+    const VideoFrameBuffer::Type dst_type = dst_buffer->type();
+    if (dst_type == VideoFrameBuffer::Type::kI420 ||
+        dst_type == VideoFrameBuffer::Type::kNV12) {
+      scale_sources.push_back(&*layer_to_encode->scaled_frame);
+    }
+  }
+  return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int SimulcastEncoderAdapter::EncodeLayer(const VideoFrame& input_image,
+                                         LayerToEncode& layer_to_encode) {
+  return layer_to_encode.layer->encoder().Encode(
+      layer_to_encode.scaled_frame ? *layer_to_encode.scaled_frame
+                                   : input_image,
+      &layer_to_encode.frame_types);
+}
+
+int SimulcastEncoderAdapter::EncodeLayersInParallel(
+    const VideoFrame& input_image,
+    std::vector<LayerToEncode>* layers) {
+  // Encoders of native buffers may be bound to the calling thread, and there
+  // is nothing to gain with a single layer.
+  bool has_native_frame = false;
+  for (const auto& layer_to_encode : *layers) {
+    const VideoFrame& frame = layer_to_encode.scaled_frame
+                                  ? *layer_to_encode.scaled_frame
+                                  : input_image;
+    has_native_frame |= frame.video_frame_buffer()->type() ==
+                        VideoFrameBuffer::Type::kNative;
+  }
+  if (layers->size() <= 1 || has_native_frame) {
+    for (auto& layer_to_encode : *layers) {
+      int ret = EncodeLayer(input_image, layer_to_encode);
       if (ret != WEBRTC_VIDEO_CODEC_OK) {
         return ret;
       }
     }
+    return WEBRTC_VIDEO_CODEC_OK;
   }
 
+  RTC_DCHECK_LE(layers->size(), encode_queues_.size() + 1);
+  std::vector<int> results(layers->size(), WEBRTC_VIDEO_CODEC_OK);
+  std::vector<std::unique_ptr<rtc::Event>> done(layers->size() - 1);
+  // The callbacks of the layer encoders are held until all layers are
+  // encoded, so that they are delivered on the encoder queue.
+  for (auto& layer_to_encode : *layers) {
+    layer_to_encode.layer->set_hold_callbacks(true);
+  }
+  for (size_t i = 1; i < layers->size(); ++i) {
+    done[i - 1] = std::make_unique<rtc::Event>();
+    encode_queues_[i - 1]->PostTask(
+        [&input_image, &layer_to_encode = (*layers)[i], &result = results[i],
+         event = done[i - 1].get()] {
+          result = EncodeLayer(input_image, layer_to_encode);
+          event->Set();
+        });
+  }
+  results[0] = EncodeLayer(input_image, (*layers)[0]);
+  for (auto& event : done) {
+    event->Wait(rtc::Event::kForever);
+  }
+
+  for (auto& layer_to_encode : *layers) {
+    layer_to_encode.layer->set_hold_callbacks(false);
+    layer_to_encode.layer->DeliverPendingCallbacks();
+  }
+  for (int result : results) {
+    if (result != WEBRTC_VIDEO_CODEC_OK) {
+      return result;
+    }
+  }
   return WEBRTC_VIDEO_CODEC_OK;
 }
 
@@ -566,7 +760,8 @@ int SimulcastEncoderAdapter::RegisterEncodeCompleteCallback(
     EncodedImageCallback* callback) {
   RTC_DCHECK_RUN_ON(&encoder_queue_);
   encoded_complete_callback_ = callback;
-  if (!stream_contexts_.empty() && stream_contexts_.front().stream_idx() == 0) {
+  if (!stream_contexts_.empty() && stream_contexts_.front().stream_idx() == 0 &&
+      (bypass_mode_ || !parallel_encode_)) {
     // Bypass frame encode complete callback for the lowest layer since there is
     // no need to override frame's spatial index.
     stream_contexts_.front().encoder().RegisterEncodeCompleteCallback(callback);
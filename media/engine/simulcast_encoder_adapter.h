@@ -22,15 +22,18 @@
 #include "absl/types/optional.h"
 #include "api/fec_controller_override.h"
 #include "api/sequence_checker.h"
+#include "api/task_queue/task_queue_factory.h"
 #include "api/video_codecs/sdp_video_format.h"
 #include "api/video_codecs/video_encoder.h"
 #include "api/video_codecs/video_encoder_factory.h"
+#include "common_video/include/video_frame_buffer_pool.h"
 #include "modules/video_coding/include/video_codec_interface.h"
 #include "modules/video_coding/utility/framerate_controller.h"
 #include "rtc_base/atomic_ops.h"
 #include "rtc_base/experiments/encoder_info_settings.h"
 #include "rtc_base/system/no_unique_address.h"
 #include "rtc_base/system/rtc_export.h"
+#include "rtc_base/task_queue.h"
 
 namespace webrtc {
 
@@ -38,6 +41,18 @@ namespace webrtc {
 // webrtc::VideoEncoder instances with the given VideoEncoderFactory.
 // The object is created and destroyed on the worker thread, but all public
 // interfaces should be called from the encoder task queue.
+//
+// With the "WebRTC-SimulcastEncoderAdapter-ParallelEncode" field trial, the
+// layers of a frame are encoded concurrently, and Encode() returns once all of
+// them are done. The first layer is encoded on the encoder task queue and each
+// other layer on an internal task queue of its own. The Encode() calls of the
+// layer encoders therefore run on those queues, while all their other methods
+// are called on the encoder task queue. The calls to one layer encoder never
+// overlap, but its Encode() must not assume that it runs on the encoder task
+// queue. The callbacks of the layer encoders are held while the layers are
+// encoded, and then delivered in layer order on the encoder task queue.
+// Frames with native buffers are always encoded sequentially on the encoder
+// task queue.
 class RTC_EXPORT SimulcastEncoderAdapter : public VideoEncoder {
  public:
   // TODO(bugs.webrtc.org/11000): Remove when downstream usage is gone.
@@ -123,7 +138,29 @@ class RTC_EXPORT SimulcastEncoderAdapter : public VideoEncoder {
     void OnKeyframe(Timestamp timestamp);
     bool ShouldDropFrame(Timestamp timestamp);
 
+    // While set, encoded images and dropped frames are stored instead of
+    // being forwarded to the parent, until DeliverPendingCallbacks() is
+    // called.
+    void set_hold_callbacks(bool hold) { hold_callbacks_ = hold; }
+    void DeliverPendingCallbacks();
+
+    // Pool for the buffers the input is scaled into for this layer.
+    VideoFrameBufferPool& scaled_buffer_pool() { return *scaled_buffer_pool_; }
+    // True if the update rect of the next frame can't be derived from the
+    // update rect of the input, because the previous input frame wasn't
+    // passed to the encoder of this layer.
+    bool needs_full_update_rect() const { return needs_full_update_rect_; }
+    void set_needs_full_update_rect(bool needs_full_update_rect) {
+      needs_full_update_rect_ = needs_full_update_rect;
+    }
+
    private:
+    // An encoded image, or a dropped frame if |encoded_image| is unset.
+    struct PendingCallback {
+      absl::optional<EncodedImage> encoded_image;
+      CodecSpecificInfo codec_specific_info;
+    };
+
     SimulcastEncoderAdapter* const parent_;
     std::unique_ptr<EncoderContext> encoder_context_;
     std::unique_ptr<FramerateController> framerate_controller_;
@@ -132,6 +169,23 @@ class RTC_EXPORT SimulcastEncoderAdapter : public VideoEncoder {
     const uint16_t height_;
     bool is_keyframe_needed_;
     bool is_paused_;
+    bool hold_callbacks_;
+    std::vector<PendingCallback> pending_callbacks_;
+    std::unique_ptr<VideoFrameBufferPool> scaled_buffer_pool_;
+    bool needs_full_update_rect_;
+  };
+
+  // A layer to be encoded, with the input frame scaled to its resolution.
+  struct LayerToEncode {
+    LayerToEncode(StreamContext* layer,
+                  std::vector<VideoFrameType> frame_types);
+    LayerToEncode(LayerToEncode&&);
+    ~LayerToEncode();
+
+    StreamContext* layer;
+    std::vector<VideoFrameType> frame_types;
+    // Unset if the input frame is passed on directly.
+    absl::optional<VideoFrame> scaled_frame;
   };
 
   bool Initialized() const;
@@ -154,6 +208,20 @@ class RTC_EXPORT SimulcastEncoderAdapter : public VideoEncoder {
 
   void OnDroppedFrame(size_t stream_idx);
 
+  // Scales |input_image| to the resolution of every layer in |layers| that
+  // can't be passed the input directly. Each layer is scaled from the smallest
+  // already scaled frame that is at least as large, into a pooled buffer, and
+  // the update rect of |input_image| is scaled along with it.
+  int ScaleLayerFrames(const VideoFrame& input_image,
+                       std::vector<LayerToEncode>* layers);
+  // Encodes the scaled frame of |layer_to_encode|, or |input_image| if none.
+  static int EncodeLayer(const VideoFrame& input_image,
+                         LayerToEncode& layer_to_encode);
+  // Encodes the given layers concurrently, one of them on the calling thread,
+  // and returns the first error in layer order, if any.
+  int EncodeLayersInParallel(const VideoFrame& input_image,
+                             std::vector<LayerToEncode>* layers);
+
   void OverrideFromFieldTrial(VideoEncoder::EncoderInfo* info) const;
 
   volatile int inited_;  // Accessed atomically.
@@ -178,6 +246,12 @@ class RTC_EXPORT SimulcastEncoderAdapter : public VideoEncoder {
   const bool prefer_temporal_support_on_base_layer_;
 
   const SimulcastEncoderAdapterEncoderInfoSettings encoder_info_override_;
+
+  const bool parallel_encode_;
+  // Only created if |parallel_encode_| is set. One task queue is used per
+  // layer, except for the first layer which is encoded on the encoder queue.
+  const std::unique_ptr<TaskQueueFactory> task_queue_factory_;
+  std::vector<std::unique_ptr<rtc::TaskQueue>> encode_queues_;
 };
 
 }  // namespace webrtc
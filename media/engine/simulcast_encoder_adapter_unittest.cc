@@ -10,6 +10,7 @@
 
 #include "media/engine/simulcast_encoder_adapter.h"
 
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <vector>
@@ -18,6 +19,7 @@
 #include "api/test/simulcast_test_fixture.h"
 #include "api/test/video/function_video_decoder_factory.h"
 #include "api/test/video/function_video_encoder_factory.h"
+#include "api/video/i420_buffer.h"
 #include "api/video/video_codec_constants.h"
 #include "api/video_codecs/sdp_video_format.h"
 #include "api/video_codecs/video_encoder.h"
@@ -27,8 +29,12 @@
 #include "media/engine/internal_encoder_factory.h"
 #include "modules/video_coding/codecs/vp8/include/vp8.h"
 #include "modules/video_coding/include/video_codec_interface.h"
+#include "modules/video_coding/utility/simulcast_rate_allocator.h"
 #include "modules/video_coding/utility/simulcast_test_fixture_impl.h"
 #include "rtc_base/checks.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/platform_thread_types.h"
+#include "rtc_base/time_utils.h"
 #include "test/field_trial.h"
 #include "test/gmock.h"
 #include "test/gtest.h"
@@ -160,6 +166,183 @@ TEST(SimulcastEncoderAdapterSimulcastTest, TestDecodeWidthHeightSet) {
   fixture->TestDecodeWidthHeightSet();
 }
 
+TEST(SimulcastEncoderAdapterSimulcastTest, TestSendAllStreamsParallelEncode) {
+  ScopedFieldTrials field_trials(
+      "WebRTC-SimulcastEncoderAdapter-ParallelEncode/Enabled/");
+  InternalEncoderFactory internal_encoder_factory;
+  auto fixture = CreateSpecificSimulcastTestFixture(&internal_encoder_factory);
+  fixture->TestSendAllStreams();
+}
+
+TEST(SimulcastEncoderAdapterSimulcastTest,
+     TestKeyFrameRequestsOnAllStreamsParallelEncode) {
+  ScopedFieldTrials field_trials(
+      "WebRTC-SimulcastEncoderAdapter-ParallelEncode/Enabled/");
+  InternalEncoderFactory internal_encoder_factory;
+  auto fixture = CreateSpecificSimulcastTestFixture(&internal_encoder_factory);
+  fixture->TestKeyFrameRequestsOnAllStreams();
+}
+
+namespace {
+
+// Records the simulcast index of every encoded image.
+class SimulcastIndexRecorder : public EncodedImageCallback {
+ public:
+  Result OnEncodedImage(const EncodedImage& encoded_image,
+                        const CodecSpecificInfo* codec_specific_info) override {
+    simulcast_indices_.push_back(encoded_image.SpatialIndex().value_or(0));
+    return Result(Result::OK, encoded_image.Timestamp());
+  }
+
+  std::vector<int> simulcast_indices_;
+};
+
+// Configures |num_streams| VP8 simulcast streams, each with half the width and
+// height of the next one.
+VideoCodec CreateVp8SimulcastCodec(int width, int height, int num_streams) {
+  VideoCodec codec;
+  codec.codecType = kVideoCodecVP8;
+  codec.width = width;
+  codec.height = height;
+  codec.maxFramerate = 30;
+  codec.numberOfSimulcastStreams = num_streams;
+  codec.qpMax = 56;
+  *codec.VP8() = VideoEncoder::GetDefaultVp8Settings();
+  uint32_t total_bitrate_kbps = 0;
+  for (int i = 0; i < num_streams; ++i) {
+    const int shift = num_streams - 1 - i;
+    SpatialLayer& stream = codec.simulcastStream[i];
+    stream.width = width >> shift;
+    stream.height = height >> shift;
+    stream.maxFramerate = 30;
+    stream.numberOfTemporalLayers = 1;
+    stream.maxBitrate = 2500 >> shift;
+    stream.targetBitrate = 2000 >> shift;
+    stream.minBitrate = 100;
+    stream.qpMax = 56;
+    stream.active = true;
+    total_bitrate_kbps += stream.targetBitrate;
+  }
+  codec.startBitrate = total_bitrate_kbps;
+  codec.maxBitrate = total_bitrate_kbps;
+  return codec;
+}
+
+// Fills |buffer| with a pattern which moves with |frame_index|.
+void FillMovingPattern(int frame_index, I420Buffer* buffer) {
+  for (int y = 0; y < buffer->height(); ++y) {
+    for (int x = 0; x < buffer->width(); ++x) {
+      buffer->MutableDataY()[y * buffer->StrideY() + x] =
+          static_cast<uint8_t>((x * x + y * 3 + frame_index * 7) >> 2);
+    }
+  }
+  for (int y = 0; y < buffer->ChromaHeight(); ++y) {
+    for (int x = 0; x < buffer->ChromaWidth(); ++x) {
+      buffer->MutableDataU()[y * buffer->StrideU() + x] =
+          static_cast<uint8_t>(x + frame_index);
+      buffer->MutableDataV()[y * buffer->StrideV() + x] =
+          static_cast<uint8_t>(y - frame_index);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(SimulcastEncoderAdapterParallelEncodeTest,
+     DeliversEncodedImagesInLayerOrder) {
+  ScopedFieldTrials field_trials(
+      "WebRTC-SimulcastEncoderAdapter-ParallelEncode/Enabled/");
+  InternalEncoderFactory internal_encoder_factory;
+  SimulcastEncoderAdapter adapter(&internal_encoder_factory,
+                                  SdpVideoFormat(cricket::kVp8CodecName));
+  const VideoCodec codec = CreateVp8SimulcastCodec(640, 360, 3);
+  SimulcastIndexRecorder recorder;
+  ASSERT_EQ(0, adapter.InitEncode(&codec, kSettings));
+  adapter.RegisterEncodeCompleteCallback(&recorder);
+  SimulcastRateAllocator rate_allocator(codec);
+  adapter.SetRates(VideoEncoder::RateControlParameters(
+      rate_allocator.Allocate(
+          VideoBitrateAllocationParameters(codec.startBitrate * 1000, 30)),
+      30.0));
+
+  rtc::scoped_refptr<I420Buffer> buffer = I420Buffer::Create(640, 360);
+  constexpr int kNumFrames = 10;
+  for (int i = 0; i < kNumFrames; ++i) {
+    FillMovingPattern(i, buffer.get());
+    VideoFrame frame = VideoFrame::Builder()
+                           .set_video_frame_buffer(buffer)
+                           .set_timestamp_rtp(3000 * (i + 1))
+                           .build();
+    std::vector<VideoFrameType> frame_types(
+        3, i == 0 ? VideoFrameType::kVideoFrameKey
+                  : VideoFrameType::kVideoFrameDelta);
+    recorder.simulcast_indices_.clear();
+    EXPECT_EQ(0, adapter.Encode(frame, &frame_types));
+    EXPECT_THAT(recorder.simulcast_indices_, ::testing::ElementsAre(0, 1, 2));
+  }
+  adapter.Release();
+}
+
+// Measures the time spent in Encode() for 1080p input with libvpx VP8 and
+// one to three simulcast layers, with sequential and parallel layer encoding.
+// Four layers, as sometimes used for 4K input, are not covered since the codec
+// settings are limited to kMaxSimulcastStreams.
+TEST(SimulcastEncoderAdapterParallelEncodeTest, DISABLED_EncodeLatency) {
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kNumFrames = 300;
+  const VideoEncoder::Settings settings(kCapabilities, /*number_of_cores=*/4,
+                                        /*max_payload_size=*/1200);
+  rtc::scoped_refptr<I420Buffer> buffer = I420Buffer::Create(kWidth, kHeight);
+
+  for (int num_streams = 1; num_streams <= kMaxSimulcastStreams;
+       ++num_streams) {
+    for (bool parallel : {false, true}) {
+      ScopedFieldTrials field_trials(
+          parallel ? "WebRTC-SimulcastEncoderAdapter-ParallelEncode/Enabled/"
+                   : "");
+      InternalEncoderFactory internal_encoder_factory;
+      SimulcastEncoderAdapter adapter(&internal_encoder_factory,
+                                      SdpVideoFormat(cricket::kVp8CodecName));
+      const VideoCodec codec =
+          CreateVp8SimulcastCodec(kWidth, kHeight, num_streams);
+      SimulcastIndexRecorder recorder;
+      ASSERT_EQ(0, adapter.InitEncode(&codec, settings));
+      adapter.RegisterEncodeCompleteCallback(&recorder);
+      SimulcastRateAllocator rate_allocator(codec);
+      adapter.SetRates(VideoEncoder::RateControlParameters(
+          rate_allocator.Allocate(
+              VideoBitrateAllocationParameters(codec.startBitrate * 1000, 30)),
+          30.0));
+
+      int64_t total_encode_time_us = 0;
+      int64_t max_encode_time_us = 0;
+      for (int i = 0; i < kNumFrames; ++i) {
+        FillMovingPattern(i, buffer.get());
+        VideoFrame frame = VideoFrame::Builder()
+                               .set_video_frame_buffer(buffer)
+                               .set_timestamp_rtp(3000 * (i + 1))
+                               .build();
+        std::vector<VideoFrameType> frame_types(
+            num_streams, i == 0 ? VideoFrameType::kVideoFrameKey
+                                : VideoFrameType::kVideoFrameDelta);
+        const int64_t start_us = rtc::TimeMicros();
+        EXPECT_EQ(0, adapter.Encode(frame, &frame_types));
+        const int64_t encode_time_us = rtc::TimeMicros() - start_us;
+        total_encode_time_us += encode_time_us;
+        max_encode_time_us = std::max(max_encode_time_us, encode_time_us);
+      }
+      adapter.Release();
+
+      RTC_LOG(LS_INFO) << num_streams << " layer(s), "
+                       << (parallel ? "parallel" : "sequential")
+                       << " encode: mean "
+                       << total_encode_time_us / kNumFrames << " us, max "
+                       << max_encode_time_us << " us per frame.";
+    }
+  }
+}
+
 class MockVideoEncoder;
 
 class MockVideoEncoderFactory : public VideoEncoderFactory {
@@ -258,6 +441,11 @@ class MockVideoEncoder : public VideoEncoder {
     callback_->OnEncodedImage(image, &codec_specific_info);
   }
 
+  void SendDroppedFrame() {
+    callback_->OnDroppedFrame(
+        EncodedImageCallback::DropReason::kDroppedByEncoder);
+  }
+
   void set_supports_native_handle(bool enabled) {
     supports_native_handle_ = enabled;
   }
@@ -1095,6 +1283,109 @@ TEST_F(TestSimulcastEncoderAdapterFake, TestFailureReturnCodesFromEncodeCalls) {
             adapter_->Encode(input_frame, &frame_types));
 }
 
+TEST_F(TestSimulcastEncoderAdapterFake, ScalesLayersIntoPooledBuffers) {
+  SimulcastTestFixtureImpl::DefaultSettings(
+      &codec_, static_cast<const int*>(kTestTemporalLayerProfile),
+      kVideoCodecVP8);
+  codec_.numberOfSimulcastStreams = 3;
+  // High start bitrate, so all streams are enabled.
+  codec_.startBitrate = 3000;
+  EXPECT_EQ(0, adapter_->InitEncode(&codec_, kSettings));
+  adapter_->RegisterEncodeCompleteCallback(this);
+  ASSERT_EQ(3u, helper_->factory()->encoders().size());
+
+  rtc::scoped_refptr<I420Buffer> input_buffer =
+      I420Buffer::Create(codec_.width, codec_.height);
+  input_buffer->InitializeData();
+  std::vector<VideoFrameType> frame_types(3, VideoFrameType::kVideoFrameKey);
+  std::vector<const VideoFrameBuffer*> scaled_buffers(3);
+  for (int i = 0; i < 2; ++i) {
+    VideoFrame input_frame = VideoFrame::Builder()
+                                 .set_video_frame_buffer(input_buffer)
+                                 .set_timestamp_rtp(3000 * i)
+                                 .build();
+    for (int stream = 0; stream < 2; ++stream) {
+      EXPECT_CALL(*helper_->factory()->encoders()[stream], Encode)
+          .WillOnce([&, stream, i](const VideoFrame& frame,
+                                   const std::vector<VideoFrameType>*) {
+            EXPECT_EQ(frame.video_frame_buffer()->type(),
+                      VideoFrameBuffer::Type::kI420);
+            EXPECT_EQ(frame.width(), codec_.simulcastStream[stream].width);
+            EXPECT_EQ(frame.height(), codec_.simulcastStream[stream].height);
+            // Since the buffers are released by the encoder, they are reused
+            // for the next frame.
+            if (i > 0) {
+              EXPECT_EQ(scaled_buffers[stream],
+                        frame.video_frame_buffer().get());
+            }
+            scaled_buffers[stream] = frame.video_frame_buffer().get();
+            return 0;
+          });
+    }
+    EXPECT_CALL(*helper_->factory()->encoders()[2],
+                Encode(::testing::Ref(input_frame), _))
+        .Times(1);
+    EXPECT_EQ(0, adapter_->Encode(input_frame, &frame_types));
+  }
+}
+
+TEST_F(TestSimulcastEncoderAdapterFake, PropagatesUpdateRectToScaledLayers) {
+  SimulcastTestFixtureImpl::DefaultSettings(
+      &codec_, static_cast<const int*>(kTestTemporalLayerProfile),
+      kVideoCodecVP8);
+  codec_.numberOfSimulcastStreams = 3;
+  // High start bitrate, so all streams are enabled.
+  codec_.startBitrate = 3000;
+  EXPECT_EQ(0, adapter_->InitEncode(&codec_, kSettings));
+  adapter_->RegisterEncodeCompleteCallback(this);
+  ASSERT_EQ(3u, helper_->factory()->encoders().size());
+
+  rtc::scoped_refptr<I420Buffer> input_buffer =
+      I420Buffer::Create(codec_.width, codec_.height);
+  input_buffer->InitializeData();
+  const VideoFrame::UpdateRect kUpdateRect{64, 32, 128, 64};
+  std::vector<VideoFrame::UpdateRect> update_rects(3);
+  for (int stream = 0; stream < 3; ++stream) {
+    EXPECT_CALL(*helper_->factory()->encoders()[stream], Encode)
+        .WillRepeatedly([&, stream](const VideoFrame& frame,
+                                    const std::vector<VideoFrameType>*) {
+          update_rects[stream] = frame.update_rect();
+          return 0;
+        });
+  }
+
+  std::vector<VideoFrameType> frame_types(3, VideoFrameType::kVideoFrameKey);
+  VideoFrame input_frame = VideoFrame::Builder()
+                               .set_video_frame_buffer(input_buffer)
+                               .set_timestamp_rtp(0)
+                               .set_update_rect(kUpdateRect)
+                               .build();
+  // The first frame is fully updated, since nothing was encoded before it.
+  EXPECT_EQ(0, adapter_->Encode(input_frame, &frame_types));
+  EXPECT_EQ(update_rects[0],
+            (VideoFrame::UpdateRect{0, 0, codec_.simulcastStream[0].width,
+                                    codec_.simulcastStream[0].height}));
+
+  // Following frames have the update rect scaled down through the layers.
+  frame_types.assign(3, VideoFrameType::kVideoFrameDelta);
+  input_frame.set_timestamp(3000);
+  EXPECT_EQ(0, adapter_->Encode(input_frame, &frame_types));
+  EXPECT_EQ(update_rects[2], kUpdateRect);
+  const VideoFrame::UpdateRect middle_update_rect = kUpdateRect.ScaleWithFrame(
+      codec_.width, codec_.height, 0, 0, codec_.width, codec_.height,
+      codec_.simulcastStream[1].width, codec_.simulcastStream[1].height);
+  EXPECT_EQ(update_rects[1], middle_update_rect);
+  EXPECT_EQ(update_rects[0],
+            middle_update_rect.ScaleWithFrame(
+                codec_.simulcastStream[1].width,
+                codec_.simulcastStream[1].height, 0, 0,
+                codec_.simulcastStream[1].width,
+                codec_.simulcastStream[1].height,
+                codec_.simulcastStream[0].width,
+                codec_.simulcastStream[0].height));
+  EXPECT_LT(update_rects[0].width, codec_.simulcastStream[0].width);
+}
+
 TEST_F(TestSimulcastEncoderAdapterFake, TestInitFailureCleansUpEncoders) {
   SimulcastTestFixtureImpl::DefaultSettings(
       &codec_, static_cast<const int*>(kTestTemporalLayerProfile),
@@ -1683,5 +1974,65 @@ TEST_F(TestSimulcastEncoderAdapterFake,
   EXPECT_NE(helper_->factory()->encoders()[0], prev_encoder);
 }
 
+TEST_F(TestSimulcastEncoderAdapterFake,
+       ParallelEncodeDeliversCallbacksOnEncoderQueue) {
+  test::ScopedFieldTrials field_trials(
+      "WebRTC-SimulcastEncoderAdapter-ParallelEncode/Enabled/");
+  ReSetUp();
+  SetupCodec();
+  adapter_->SetRates(VideoEncoder::RateControlParameters(
+      rate_allocator_->Allocate(VideoBitrateAllocationParameters(1200000, 30)),
+      30.0));
+
+  // Records the simulcast index of the encoded images and the thread they are
+  // delivered on.
+  class ThreadRecorder : public EncodedImageCallback {
+   public:
+    Result OnEncodedImage(
+        const EncodedImage& encoded_image,
+        const CodecSpecificInfo* codec_specific_info) override {
+      simulcast_indices.push_back(encoded_image.SpatialIndex().value_or(-1));
+      threads.push_back(rtc::CurrentThreadRef());
+      return Result(Result::OK, encoded_image.Timestamp());
+    }
+
+    std::vector<int> simulcast_indices;
+    std::vector<rtc::PlatformThreadRef> threads;
+  } recorder;
+  adapter_->RegisterEncodeCompleteCallback(&recorder);
+
+  std::vector<MockVideoEncoder*> encoders = helper_->factory()->encoders();
+  ASSERT_EQ(3u, encoders.size());
+  // The middle layer drops its frame, the others return an image from within
+  // Encode(), on the thread the layer is encoded on.
+  for (size_t i = 0; i < encoders.size(); ++i) {
+    MockVideoEncoder* encoder = encoders[i];
+    EXPECT_CALL(*encoder, Encode(_, _))
+        .WillOnce([encoder, i](const VideoFrame& frame,
+                               const std::vector<VideoFrameType>*) {
+          if (i == 1) {
+            encoder->SendDroppedFrame();
+          } else {
+            encoder->SendEncodedImage(frame.width(), frame.height());
+          }
+          return WEBRTC_VIDEO_CODEC_OK;
+        });
+  }
+
+  rtc::scoped_refptr<VideoFrameBuffer> buffer(
+      I420Buffer::Create(codec_.width, codec_.height));
+  VideoFrame input_frame = VideoFrame::Builder()
+                               .set_video_frame_buffer(buffer)
+                               .set_timestamp_rtp(100)
+                               .build();
+  std::vector<VideoFrameType> frame_types(3, VideoFrameType::kVideoFrameKey);
+  EXPECT_EQ(0, adapter_->Encode(input_frame, &frame_types));
+
+  EXPECT_THAT(recorder.simulcast_indices, ::testing::ElementsAre(0, 2));
+  for (const rtc::PlatformThreadRef& thread : recorder.threads) {
+    EXPECT_TRUE(rtc::IsThreadRefEqual(thread, rtc::CurrentThreadRef()));
+  }
+}
+
 }  // namespace test
 }  // namespace webrtc
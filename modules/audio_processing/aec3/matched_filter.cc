@@ -28,8 +28,21 @@
 #include "modules/audio_processing/logging/apm_data_dumper.h"
 #include "rtc_base/checks.h"
 #include "rtc_base/logging.h"
+#include "system_wrappers/include/cpu_features_wrapper.h"
 
 namespace webrtc {
+namespace {
+
+bool IsAvx512Available() {
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  return GetCPUInfo(kAVX512F) != 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
 namespace aec3 {
 
 #if defined(WEBRTC_HAS_NEON)
@@ -312,6 +325,8 @@ MatchedFilter::MatchedFilter(ApmDataDumper* data_dumper,
                              float matching_filter_threshold)
     : data_dumper_(data_dumper),
       optimization_(optimization),
+      use_avx512_(optimization == Aec3Optimization::kAvx2 &&
+                  IsAvx512Available()),
       sub_block_size_(sub_block_size),
       filter_intra_lag_shift_(alignment_shift_sub_blocks * sub_block_size_),
       filters_(
@@ -371,9 +386,15 @@ void MatchedFilter::Update(const DownsampledRenderBuffer& render_buffer,
                                      &filters_updated, &error_sum);
         break;
       case Aec3Optimization::kAvx2:
-        aec3::MatchedFilterCore_AVX2(x_start_index, x2_sum_threshold, smoothing,
-                                     render_buffer.buffer, y, filters_[n],
-                                     &filters_updated, &error_sum);
+        if (use_avx512_) {
+          aec3::MatchedFilterCore_AVX512(
+              x_start_index, x2_sum_threshold, smoothing, render_buffer.buffer,
+              y, filters_[n], &filters_updated, &error_sum);
+        } else {
+          aec3::MatchedFilterCore_AVX2(
+              x_start_index, x2_sum_threshold, smoothing, render_buffer.buffer,
+              y, filters_[n], &filters_updated, &error_sum);
+        }
         break;
 #endif
 #if defined(WEBRTC_HAS_NEON)
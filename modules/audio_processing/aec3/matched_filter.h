@@ -62,6 +62,16 @@ void MatchedFilterCore_AVX2(size_t x_start_index,
                             bool* filters_updated,
                             float* error_sum);
 
+// Filter core for the matched filter that is optimized for AVX-512.
+void MatchedFilterCore_AVX512(size_t x_start_index,
+                              float x2_sum_threshold,
+                              float smoothing,
+                              rtc::ArrayView<const float> x,
+                              rtc::ArrayView<const float> y,
+                              rtc::ArrayView<float> h,
+                              bool* filters_updated,
+                              float* error_sum);
+
 #endif
 
 // Filter core for the matched filter.
@@ -136,6 +146,9 @@ class MatchedFilter {
  private:
   ApmDataDumper* const data_dumper_;
   const Aec3Optimization optimization_;
+  // The AVX-512 filter core is used in place of the AVX2 one when the CPU
+  // supports it.
+  const bool use_avx512_;
   const size_t sub_block_size_;
   const size_t filter_intra_lag_shift_;
   std::vector<std::vector<float>> filters_;
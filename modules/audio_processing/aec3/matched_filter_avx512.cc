@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "modules/audio_processing/aec3/matched_filter.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "rtc_base/checks.h"
+
+namespace webrtc {
+namespace aec3 {
+
+void MatchedFilterCore_AVX512(size_t x_start_index,
+                              float x2_sum_threshold,
+                              float smoothing,
+                              rtc::ArrayView<const float> x,
+                              rtc::ArrayView<const float> y,
+                              rtc::ArrayView<float> h,
+                              bool* filters_updated,
+                              float* error_sum) {
+  const int h_size = static_cast<int>(h.size());
+  const int x_size = static_cast<int>(x.size());
+
+  // Process for all samples in the sub-block.
+  for (size_t i = 0; i < y.size(); ++i) {
+    // Apply the matched filter as filter * x, and compute x * x.
+
+    RTC_DCHECK_GT(x_size, x_start_index);
+    const float* x_p = &x[x_start_index];
+    const float* h_p = &h[0];
+
+    // Initialize values for the accumulation.
+    __m512 s_512 = _mm512_setzero_ps();
+    __m512 x2_sum_512 = _mm512_setzero_ps();
+
+    // Compute loop chunk sizes until, and after, the wraparound of the circular
+    // buffer for x.
+    const int chunk1 =
+        std::min(h_size, static_cast<int>(x_size - x_start_index));
+
+    // Perform the loop in two chunks.
+    const int chunk2 = h_size - chunk1;
+    for (int limit : {chunk1, chunk2}) {
+      // Perform 512 bit vector operations.
+      const int limit_by_16 = limit >> 4;
+      for (int k = limit_by_16; k > 0; --k, h_p += 16, x_p += 16) {
+        // Load the data into 512 bit vectors.
+        __m512 x_k = _mm512_loadu_ps(x_p);
+        __m512 h_k = _mm512_loadu_ps(h_p);
+        // Compute and accumulate x * x and h * x.
+        x2_sum_512 = _mm512_fmadd_ps(x_k, x_k, x2_sum_512);
+        s_512 = _mm512_fmadd_ps(h_k, x_k, s_512);
+      }
+
+      // Handle any remaining items using masked loads, where the masked out
+      // lanes are zero and hence do not contribute to the sums.
+      const int remainder = limit - limit_by_16 * 16;
+      if (remainder > 0) {
+        const __mmask16 mask = static_cast<__mmask16>((1u << remainder) - 1);
+        __m512 x_k = _mm512_maskz_loadu_ps(mask, x_p);
+        __m512 h_k = _mm512_maskz_loadu_ps(mask, h_p);
+        x2_sum_512 = _mm512_fmadd_ps(x_k, x_k, x2_sum_512);
+        s_512 = _mm512_fmadd_ps(h_k, x_k, s_512);
+        h_p += remainder;
+      }
+
+      x_p = &x[0];
+    }
+
+    // Sum components together.
+    const float x2_sum = _mm512_reduce_add_ps(x2_sum_512);
+    const float s = _mm512_reduce_add_ps(s_512);
+
+    // Compute the matched filter error.
+    float e = y[i] - s;
+    const bool saturation = y[i] >= 32000.f || y[i] <= -32000.f;
+    (*error_sum) += e * e;
+
+    // Update the matched filter estimate in an NLMS manner.
+    if (x2_sum > x2_sum_threshold && !saturation) {
+      RTC_DCHECK_LT(0.f, x2_sum);
+      const float alpha = smoothing * e / x2_sum;
+      const __m512 alpha_512 = _mm512_set1_ps(alpha);
+
+      // filter = filter + smoothing * (y - filter * x) * x / x * x.
+      float* h_p = &h[0];
+      x_p = &x[x_start_index];
+
+      // Perform the loop in two chunks.
+      for (int limit : {chunk1, chunk2}) {
+        // Perform 512 bit vector operations.
+        const int limit_by_16 = limit >> 4;
+        for (int k = limit_by_16; k > 0; --k, h_p += 16, x_p += 16) {
+          // Load the data into 512 bit vectors.
+          __m512 h_k = _mm512_loadu_ps(h_p);
+          __m512 x_k = _mm512_loadu_ps(x_p);
+          // Compute h = h + alpha * x.
+          h_k = _mm512_fmadd_ps(x_k, alpha_512, h_k);
+
+          // Store the result.
+          _mm512_storeu_ps(h_p, h_k);
+        }
+
+        // Handle any remaining items using masked loads and stores.
+        const int remainder = limit - limit_by_16 * 16;
+        if (remainder > 0) {
+          const __mmask16 mask = static_cast<__mmask16>((1u << remainder) - 1);
+          __m512 h_k = _mm512_maskz_loadu_ps(mask, h_p);
+          __m512 x_k = _mm512_maskz_loadu_ps(mask, x_p);
+          h_k = _mm512_fmadd_ps(x_k, alpha_512, h_k);
+          _mm512_mask_storeu_ps(h_p, mask, h_k);
+          h_p += remainder;
+        }
+
+        x_p = &x[0];
+      }
+
+      *filters_updated = true;
+    }
+
+    x_start_index = x_start_index > 0 ? x_start_index - 1 : x_size - 1;
+  }
+}
+
+}  // namespace aec3
+}  // namespace webrtc
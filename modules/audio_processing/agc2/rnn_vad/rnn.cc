@@ -10,6 +10,8 @@
 
 #include "modules/audio_processing/agc2/rnn_vad/rnn.h"
 
+#include <algorithm>
+
 #include "rtc_base/checks.h"
 #include "third_party/rnnoise/src/rnn_vad_weights.h"
 
@@ -87,5 +89,71 @@ float RnnVad::ComputeVadProbability(
   return output_.data()[0];
 }
 
+RnnVadBatch::RnnVadBatch(int num_instances,
+                         const AvailableCpuFeatures& cpu_features)
+    : num_instances_(num_instances),
+      input_(kInputLayerInputSize,
+             kInputLayerOutputSize,
+             kInputDenseBias,
+             kInputDenseWeights,
+             ActivationFunction::kTansigApproximated,
+             cpu_features,
+             /*layer_name=*/"FC1"),
+      hidden_(kInputLayerOutputSize,
+              kHiddenLayerOutputSize,
+              kHiddenGruBias,
+              kHiddenGruWeights,
+              kHiddenGruRecurrentWeights,
+              cpu_features,
+              /*layer_name=*/"GRU1"),
+      output_(kHiddenLayerOutputSize,
+              kOutputLayerOutputSize,
+              kOutputDenseBias,
+              kOutputDenseWeights,
+              ActivationFunction::kSigmoidApproximated,
+              // The output layer is just 24x1. The unoptimized code is faster.
+              NoAvailableCpuFeatures(),
+              /*layer_name=*/"FC2"),
+      input_output_(num_instances * kInputLayerOutputSize),
+      hidden_states_(num_instances * kHiddenLayerOutputSize, 0.f) {
+  RTC_DCHECK_GT(num_instances_, 0);
+  RTC_DCHECK_EQ(output_.size(), 1);
+}
+
+RnnVadBatch::~RnnVadBatch() = default;
+
+void RnnVadBatch::Reset() {
+  std::fill(hidden_states_.begin(), hidden_states_.end(), 0.f);
+}
+
+void RnnVadBatch::Reset(int instance) {
+  RTC_DCHECK_GE(instance, 0);
+  RTC_DCHECK_LT(instance, num_instances_);
+  auto state = hidden_states_.begin() + instance * kHiddenLayerOutputSize;
+  std::fill(state, state + kHiddenLayerOutputSize, 0.f);
+}
+
+void RnnVadBatch::ComputeVadProbabilities(
+    rtc::ArrayView<const float> feature_vectors,
+    rtc::ArrayView<const bool> is_silence,
+    rtc::ArrayView<float> vad_probabilities) {
+  RTC_DCHECK_EQ(feature_vectors.size(), num_instances_ * kFeatureVectorSize);
+  RTC_DCHECK_EQ(is_silence.size(), num_instances_);
+  RTC_DCHECK_EQ(vad_probabilities.size(), num_instances_);
+  // Silent instances are evaluated together with the others to keep the batch
+  // dense; their state and output are overwritten below, which is equivalent
+  // to the early return in `RnnVad::ComputeVadProbability()`.
+  input_.ComputeOutputBatch(num_instances_, feature_vectors, input_output_);
+  hidden_.ComputeOutputBatch(num_instances_, input_output_, hidden_states_);
+  output_.ComputeOutputBatch(num_instances_, hidden_states_,
+                             vad_probabilities);
+  for (int k = 0; k < num_instances_; ++k) {
+    if (is_silence[k]) {
+      Reset(k);
+      vad_probabilities[k] = 0.f;
+    }
+  }
+}
+
 }  // namespace rnn_vad
 }  // namespace webrtc
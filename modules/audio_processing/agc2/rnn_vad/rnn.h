@@ -47,6 +47,40 @@ class RnnVad {
   FullyConnectedLayer output_;
 };
 
+// Evaluates the RNN VAD for a batch of independent instances (e.g., channels or
+// streams) at once. Produces the same output as one `RnnVad` per instance, but
+// every layer is evaluated for all the instances before moving to the next one
+// so that the weights are fetched once per batch instead of once per instance.
+class RnnVadBatch {
+ public:
+  RnnVadBatch(int num_instances, const AvailableCpuFeatures& cpu_features);
+  RnnVadBatch(const RnnVadBatch&) = delete;
+  RnnVadBatch& operator=(const RnnVadBatch&) = delete;
+  ~RnnVadBatch();
+
+  int num_instances() const { return num_instances_; }
+
+  // Resets all the instances.
+  void Reset();
+  // Resets the instance with index `instance`.
+  void Reset(int instance);
+  // Observes `num_instances()` feature vectors stored contiguously in
+  // `feature_vectors` and the corresponding `is_silence` flags, updates the RNN
+  // and writes the current voice probability of each instance into
+  // `vad_probabilities`.
+  void ComputeVadProbabilities(rtc::ArrayView<const float> feature_vectors,
+                               rtc::ArrayView<const bool> is_silence,
+                               rtc::ArrayView<float> vad_probabilities);
+
+ private:
+  const int num_instances_;
+  const FullyConnectedLayer input_;
+  const GatedRecurrentLayer hidden_;
+  const FullyConnectedLayer output_;
+  std::vector<float> input_output_;
+  std::vector<float> hidden_states_;
+};
+
 }  // namespace rnn_vad
 }  // namespace webrtc
 
@@ -92,12 +92,25 @@ FullyConnectedLayer::FullyConnectedLayer(
 FullyConnectedLayer::~FullyConnectedLayer() = default;
 
 void FullyConnectedLayer::ComputeOutput(rtc::ArrayView<const float> input) {
-  RTC_DCHECK_EQ(input.size(), input_size_);
+  ComputeOutputBatch(/*num_instances=*/1, input,
+                     {output_.data(), static_cast<size_t>(output_size_)});
+}
+
+void FullyConnectedLayer::ComputeOutputBatch(
+    int num_instances,
+    rtc::ArrayView<const float> inputs,
+    rtc::ArrayView<float> outputs) const {
+  RTC_DCHECK_EQ(inputs.size(), num_instances * input_size_);
+  RTC_DCHECK_EQ(outputs.size(), num_instances * output_size_);
   rtc::ArrayView<const float> weights(weights_);
   for (int o = 0; o < output_size_; ++o) {
-    output_[o] = activation_function_(
-        bias_[o] + vector_math_.DotProduct(
-                       input, weights.subview(o * input_size_, input_size_)));
+    const auto weights_o = weights.subview(o * input_size_, input_size_);
+    for (int k = 0; k < num_instances; ++k) {
+      outputs[k * output_size_ + o] = activation_function_(
+          bias_[o] +
+          vector_math_.DotProduct(
+              inputs.subview(k * input_size_, input_size_), weights_o));
+    }
   }
 }
 
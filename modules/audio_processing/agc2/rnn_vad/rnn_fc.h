@@ -54,6 +54,13 @@ class FullyConnectedLayer {
 
   // Computes the fully-connected layer output.
   void ComputeOutput(rtc::ArrayView<const float> input);
+  // Computes the fully-connected layer output for `num_instances` independent
+  // input vectors stored contiguously in `inputs` and writes the results
+  // contiguously in `outputs`. Each weight vector is applied to all the inputs
+  // before moving on to the next one.
+  void ComputeOutputBatch(int num_instances,
+                          rtc::ArrayView<const float> inputs,
+                          rtc::ArrayView<float> outputs) const;
 
  private:
   const int input_size_;
@@ -10,6 +10,8 @@
 
 #include "modules/audio_processing/agc2/rnn_vad/rnn_gru.h"
 
+#include <algorithm>
+
 #include "rtc_base/checks.h"
 #include "rtc_base/numerics/safe_conversions.h"
 #include "third_party/rnnoise/src/rnn_activations.h"
@@ -43,7 +45,8 @@ std::vector<float> PreprocessGruTensor(rtc::ArrayView<const int8_t> tensor_src,
   return tensor_dst;
 }
 
-// Computes the output for the update or the reset gate.
+// Computes the output for the update or the reset gate for `num_instances`
+// independent instances.
 // Operation: `g = sigmoid(W^T∙i + R^T∙s + b)` where
 // - `g`: output gate vector
 // - `W`: weights matrix
@@ -53,30 +56,38 @@ std::vector<float> PreprocessGruTensor(rtc::ArrayView<const int8_t> tensor_src,
 // - `b`: bias vector
 void ComputeUpdateResetGate(int input_size,
                             int output_size,
+                            int num_instances,
                             const VectorMath& vector_math,
-                            rtc::ArrayView<const float> input,
-                            rtc::ArrayView<const float> state,
+                            rtc::ArrayView<const float> inputs,
+                            rtc::ArrayView<const float> states,
                             rtc::ArrayView<const float> bias,
                             rtc::ArrayView<const float> weights,
                             rtc::ArrayView<const float> recurrent_weights,
-                            rtc::ArrayView<float> gate) {
-  RTC_DCHECK_EQ(input.size(), input_size);
-  RTC_DCHECK_EQ(state.size(), output_size);
+                            rtc::ArrayView<float> gates) {
+  RTC_DCHECK_EQ(inputs.size(), num_instances * input_size);
+  RTC_DCHECK_EQ(states.size(), num_instances * output_size);
   RTC_DCHECK_EQ(bias.size(), output_size);
   RTC_DCHECK_EQ(weights.size(), input_size * output_size);
   RTC_DCHECK_EQ(recurrent_weights.size(), output_size * output_size);
-  RTC_DCHECK_GE(gate.size(), output_size);  // `gate` is over-allocated.
+  // `gates` is over-allocated.
+  RTC_DCHECK_GE(gates.size(), num_instances * output_size);
   for (int o = 0; o < output_size; ++o) {
-    float x = bias[o];
-    x += vector_math.DotProduct(input,
-                                weights.subview(o * input_size, input_size));
-    x += vector_math.DotProduct(
-        state, recurrent_weights.subview(o * output_size, output_size));
-    gate[o] = ::rnnoise::SigmoidApproximated(x);
+    const auto weights_o = weights.subview(o * input_size, input_size);
+    const auto recurrent_weights_o =
+        recurrent_weights.subview(o * output_size, output_size);
+    for (int k = 0; k < num_instances; ++k) {
+      float x = bias[o];
+      x += vector_math.DotProduct(inputs.subview(k * input_size, input_size),
+                                  weights_o);
+      x += vector_math.DotProduct(states.subview(k * output_size, output_size),
+                                  recurrent_weights_o);
+      gates[k * output_size + o] = ::rnnoise::SigmoidApproximated(x);
+    }
   }
 }
 
-// Computes the output for the state gate.
+// Computes the output for the state gate for `num_instances` independent
+// instances.
 // Operation: `s' = u .* s + (1 - u) .* ReLU(W^T∙i + R^T∙(s .* r) + b)` where
 // - `s'`: output state gate vector
 // - `s`: previous state gate vector
@@ -89,33 +100,43 @@ void ComputeUpdateResetGate(int input_size,
 // - `.*` element-wise product
 void ComputeStateGate(int input_size,
                       int output_size,
+                      int num_instances,
                       const VectorMath& vector_math,
-                      rtc::ArrayView<const float> input,
+                      rtc::ArrayView<const float> inputs,
                       rtc::ArrayView<const float> update,
                       rtc::ArrayView<const float> reset,
                       rtc::ArrayView<const float> bias,
                       rtc::ArrayView<const float> weights,
                       rtc::ArrayView<const float> recurrent_weights,
-                      rtc::ArrayView<float> state) {
-  RTC_DCHECK_EQ(input.size(), input_size);
-  RTC_DCHECK_GE(update.size(), output_size);  // `update` is over-allocated.
-  RTC_DCHECK_GE(reset.size(), output_size);   // `reset` is over-allocated.
+                      rtc::ArrayView<float> states) {
+  RTC_DCHECK_EQ(inputs.size(), num_instances * input_size);
+  // `update` and `reset` are over-allocated.
+  RTC_DCHECK_GE(update.size(), num_instances * output_size);
+  RTC_DCHECK_GE(reset.size(), num_instances * output_size);
   RTC_DCHECK_EQ(bias.size(), output_size);
   RTC_DCHECK_EQ(weights.size(), input_size * output_size);
   RTC_DCHECK_EQ(recurrent_weights.size(), output_size * output_size);
-  RTC_DCHECK_EQ(state.size(), output_size);
-  std::array<float, kGruLayerMaxUnits> reset_x_state;
-  for (int o = 0; o < output_size; ++o) {
-    reset_x_state[o] = state[o] * reset[o];
+  RTC_DCHECK_EQ(states.size(), num_instances * output_size);
+  RTC_DCHECK_LE(num_instances, kGruLayerMaxBatchTileSize);
+  std::array<float, kGruLayerMaxUnits * kGruLayerMaxBatchTileSize>
+      reset_x_state;
+  for (int i = 0; i < num_instances * output_size; ++i) {
+    reset_x_state[i] = states[i] * reset[i];
   }
   for (int o = 0; o < output_size; ++o) {
-    float x = bias[o];
-    x += vector_math.DotProduct(input,
-                                weights.subview(o * input_size, input_size));
-    x += vector_math.DotProduct(
-        {reset_x_state.data(), static_cast<size_t>(output_size)},
-        recurrent_weights.subview(o * output_size, output_size));
-    state[o] = update[o] * state[o] + (1.f - update[o]) * std::max(0.f, x);
+    const auto weights_o = weights.subview(o * input_size, input_size);
+    const auto recurrent_weights_o =
+        recurrent_weights.subview(o * output_size, output_size);
+    for (int k = 0; k < num_instances; ++k) {
+      const int j = k * output_size + o;
+      float x = bias[o];
+      x += vector_math.DotProduct(inputs.subview(k * input_size, input_size),
+                                  weights_o);
+      x += vector_math.DotProduct(
+          {&reset_x_state[k * output_size], static_cast<size_t>(output_size)},
+          recurrent_weights_o);
+      states[j] = update[j] * states[j] + (1.f - update[j]) * std::max(0.f, x);
+    }
   }
 }
 
@@ -158,7 +179,16 @@ void GatedRecurrentLayer::Reset() {
 }
 
 void GatedRecurrentLayer::ComputeOutput(rtc::ArrayView<const float> input) {
-  RTC_DCHECK_EQ(input.size(), input_size_);
+  ComputeOutputBatch(/*num_instances=*/1, input,
+                     {state_.data(), static_cast<size_t>(output_size_)});
+}
+
+void GatedRecurrentLayer::ComputeOutputBatch(
+    int num_instances,
+    rtc::ArrayView<const float> inputs,
+    rtc::ArrayView<float> states) const {
+  RTC_DCHECK_EQ(inputs.size(), num_instances * input_size_);
+  RTC_DCHECK_EQ(states.size(), num_instances * output_size_);
 
   // The tensors below are organized as a sequence of flattened tensors for the
   // `update`, `reset` and `state` gates.
@@ -169,29 +199,41 @@ void GatedRecurrentLayer::ComputeOutput(rtc::ArrayView<const float> input) {
   const int stride_weights = input_size_ * output_size_;
   const int stride_recurrent_weights = output_size_ * output_size_;
 
-  rtc::ArrayView<float> state(state_.data(), output_size_);
-
-  // Update gate.
-  std::array<float, kGruLayerMaxUnits> update;
-  ComputeUpdateResetGate(
-      input_size_, output_size_, vector_math_, input, state,
-      bias.subview(0, output_size_), weights.subview(0, stride_weights),
-      recurrent_weights.subview(0, stride_recurrent_weights), update);
-  // Reset gate.
-  std::array<float, kGruLayerMaxUnits> reset;
-  ComputeUpdateResetGate(input_size_, output_size_, vector_math_, input, state,
-                         bias.subview(output_size_, output_size_),
-                         weights.subview(stride_weights, stride_weights),
-                         recurrent_weights.subview(stride_recurrent_weights,
-                                                   stride_recurrent_weights),
-                         reset);
-  // State gate.
-  ComputeStateGate(input_size_, output_size_, vector_math_, input, update,
-                   reset, bias.subview(2 * output_size_, output_size_),
-                   weights.subview(2 * stride_weights, stride_weights),
-                   recurrent_weights.subview(2 * stride_recurrent_weights,
-                                             stride_recurrent_weights),
-                   state);
+  // Process the instances in tiles so that the gate buffers fit on the stack.
+  for (int first = 0; first < num_instances;
+       first += kGruLayerMaxBatchTileSize) {
+    const int tile_size =
+        std::min(kGruLayerMaxBatchTileSize, num_instances - first);
+    auto tile_inputs =
+        inputs.subview(first * input_size_, tile_size * input_size_);
+    auto tile_states =
+        states.subview(first * output_size_, tile_size * output_size_);
+
+    // Update gate.
+    std::array<float, kGruLayerMaxUnits * kGruLayerMaxBatchTileSize> update;
+    ComputeUpdateResetGate(
+        input_size_, output_size_, tile_size, vector_math_, tile_inputs,
+        tile_states, bias.subview(0, output_size_),
+        weights.subview(0, stride_weights),
+        recurrent_weights.subview(0, stride_recurrent_weights), update);
+    // Reset gate.
+    std::array<float, kGruLayerMaxUnits * kGruLayerMaxBatchTileSize> reset;
+    ComputeUpdateResetGate(
+        input_size_, output_size_, tile_size, vector_math_, tile_inputs,
+        tile_states, bias.subview(output_size_, output_size_),
+        weights.subview(stride_weights, stride_weights),
+        recurrent_weights.subview(stride_recurrent_weights,
+                                  stride_recurrent_weights),
+        reset);
+    // State gate.
+    ComputeStateGate(input_size_, output_size_, tile_size, vector_math_,
+                     tile_inputs, update, reset,
+                     bias.subview(2 * output_size_, output_size_),
+                     weights.subview(2 * stride_weights, stride_weights),
+                     recurrent_weights.subview(2 * stride_recurrent_weights,
+                                               stride_recurrent_weights),
+                     tile_states);
+  }
 }
 
 }  // namespace rnn_vad
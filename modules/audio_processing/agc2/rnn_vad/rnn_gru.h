@@ -24,6 +24,9 @@ namespace rnn_vad {
 
 // Maximum number of units for a GRU layer.
 constexpr int kGruLayerMaxUnits = 24;
+// Maximum number of instances processed at once by
+// `GatedRecurrentLayer::ComputeOutputBatch()`; larger batches are split.
+constexpr int kGruLayerMaxBatchTileSize = 8;
 
 // Recurrent layer with gated recurrent units (GRUs) with sigmoid and ReLU as
 // activation functions for the update/reset and output gates respectively.
@@ -52,6 +55,13 @@ class GatedRecurrentLayer {
   void Reset();
   // Computes the recurrent layer output and updates the status.
   void ComputeOutput(rtc::ArrayView<const float> input);
+  // Computes the recurrent layer output for `num_instances` independent input
+  // vectors stored contiguously in `inputs`. The state of each instance is
+  // read from and written to `states`, which holds `num_instances` contiguous
+  // state vectors; the internal state is not used.
+  void ComputeOutputBatch(int num_instances,
+                          rtc::ArrayView<const float> inputs,
+                          rtc::ArrayView<float> states) const;
 
  private:
   const int input_size_;
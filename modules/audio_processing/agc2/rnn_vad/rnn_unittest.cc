@@ -10,9 +10,15 @@
 
 #include "modules/audio_processing/agc2/rnn_vad/rnn.h"
 
+#include <array>
+#include <memory>
+#include <vector>
+
 #include "api/array_view.h"
 #include "modules/audio_processing/agc2/cpu_features.h"
 #include "modules/audio_processing/agc2/rnn_vad/common.h"
+#include "modules/audio_processing/test/performance_timer.h"
+#include "rtc_base/logging.h"
 #include "test/gtest.h"
 
 namespace webrtc {
@@ -65,6 +71,113 @@ TEST(RnnVadTest, CheckRnnVadSilence) {
   EXPECT_EQ(pre, post);
 }
 
+// Returns a copy of `kFeatures` in which every value is scaled by `gain`.
+std::array<float, kFeatureVectorSize> GetScaledFeatures(float gain) {
+  std::array<float, kFeatureVectorSize> features;
+  for (int i = 0; i < kFeatureVectorSize; ++i) {
+    features[i] = gain * kFeatures[i];
+  }
+  return features;
+}
+
+// Checks that a batch of instances produces the same output as one `RnnVad`
+// per instance, including when some of the instances observe silence.
+TEST(RnnVadTest, CheckRnnVadBatchMatchesRnnVad) {
+  // More instances than `kGruLayerMaxBatchTileSize` to test tiling.
+  constexpr int kNumInstances = 11;
+  const AvailableCpuFeatures cpu_features = GetAvailableCpuFeatures();
+  std::vector<std::unique_ptr<RnnVad>> rnn_vads;
+  for (int k = 0; k < kNumInstances; ++k) {
+    rnn_vads.push_back(std::make_unique<RnnVad>(cpu_features));
+  }
+  RnnVadBatch rnn_vad_batch(kNumInstances, cpu_features);
+
+  std::vector<float> feature_vectors(kNumInstances * kFeatureVectorSize);
+  std::array<bool, kNumInstances> is_silence;
+  std::array<float, kNumInstances> vad_probabilities;
+  for (int i = 0; i < 20; ++i) {
+    SCOPED_TRACE(i);
+    for (int k = 0; k < kNumInstances; ++k) {
+      const auto features = GetScaledFeatures(0.1f * (1 + (i + k) % 13));
+      std::copy(features.begin(), features.end(),
+                feature_vectors.begin() + k * kFeatureVectorSize);
+      is_silence[k] = (i + 2 * k) % 7 == 0;
+    }
+    rnn_vad_batch.ComputeVadProbabilities(feature_vectors, is_silence,
+                                          vad_probabilities);
+    for (int k = 0; k < kNumInstances; ++k) {
+      SCOPED_TRACE(k);
+      const float expected = rnn_vads[k]->ComputeVadProbability(
+          rtc::ArrayView<const float, kFeatureVectorSize>(
+              &feature_vectors[k * kFeatureVectorSize], kFeatureVectorSize),
+          is_silence[k]);
+      EXPECT_EQ(expected, vad_probabilities[k]);
+    }
+  }
+}
+
+// Throughput test for `RnnVadBatch` compared to one `RnnVad` per instance.
+// Keep disabled and only enable locally to measure performance by running
+// this unit test adding "--logs".
+TEST(RnnVadTest, DISABLED_RnnVadBatchThroughput) {
+  const AvailableCpuFeatures cpu_features = GetAvailableCpuFeatures();
+  constexpr int kNumFrames = 1000;
+  constexpr int kNumTests = 10;
+  for (int num_instances : {1, 8, 64, 256}) {
+    std::vector<float> feature_vectors;
+    for (int k = 0; k < num_instances; ++k) {
+      const auto features = GetScaledFeatures(0.1f * (1 + k % 13));
+      feature_vectors.insert(feature_vectors.end(), features.begin(),
+                             features.end());
+    }
+    std::unique_ptr<bool[]> is_silence(new bool[num_instances]());
+    std::vector<float> vad_probabilities(num_instances);
+
+    std::vector<std::unique_ptr<RnnVad>> rnn_vads;
+    for (int k = 0; k < num_instances; ++k) {
+      rnn_vads.push_back(std::make_unique<RnnVad>(cpu_features));
+    }
+    ::webrtc::test::PerformanceTimer single_timer(kNumTests);
+    for (int t = 0; t < kNumTests; ++t) {
+      single_timer.StartTimer();
+      for (int i = 0; i < kNumFrames; ++i) {
+        for (int k = 0; k < num_instances; ++k) {
+          vad_probabilities[k] = rnn_vads[k]->ComputeVadProbability(
+              rtc::ArrayView<const float, kFeatureVectorSize>(
+                  &feature_vectors[k * kFeatureVectorSize],
+                  kFeatureVectorSize),
+              /*is_silence=*/false);
+        }
+      }
+      single_timer.StopTimer();
+    }
+
+    RnnVadBatch rnn_vad_batch(num_instances, cpu_features);
+    ::webrtc::test::PerformanceTimer batch_timer(kNumTests);
+    for (int t = 0; t < kNumTests; ++t) {
+      batch_timer.StartTimer();
+      for (int i = 0; i < kNumFrames; ++i) {
+        rnn_vad_batch.ComputeVadProbabilities(
+            feature_vectors,
+            {is_silence.get(), static_cast<size_t>(num_instances)},
+            vad_probabilities);
+      }
+      batch_timer.StopTimer();
+    }
+
+    // Frames per second on a single core, counting one frame per instance.
+    const double num_processed_frames =
+        static_cast<double>(kNumFrames) * num_instances;
+    RTC_LOG(LS_INFO) << "instances: " << num_instances << " | RnnVad: "
+                     << (1e6 * num_processed_frames /
+                         single_timer.GetDurationAverage())
+                     << " frames/s | RnnVadBatch: "
+                     << (1e6 * num_processed_frames /
+                         batch_timer.GetDurationAverage())
+                     << " frames/s";
+  }
+}
+
 }  // namespace
 }  // namespace rnn_vad
 }  // namespace webrtc
@@ -959,13 +959,14 @@ void AudioProcessingImpl::QueueBandedRenderAudio(AudioBuffer* audio) {
     RTC_DCHECK(aecm_render_signal_queue_);
     // Insert the samples into the queue.
     if (!aecm_render_signal_queue_->Insert(&aecm_render_queue_buffer_)) {
-      // The data queue is full and needs to be emptied.
-      EmptyQueuedRenderAudio();
-
-      // Retry the insert (should always work).
-      bool result =
-          aecm_render_signal_queue_->Insert(&aecm_render_queue_buffer_);
-      RTC_DCHECK(result);
+      // The data queue is full and needs to be emptied. If the capture side is
+      // busy, the frame is dropped rather than waiting for the capture lock.
+      if (TryEmptyQueuedRenderAudio()) {
+        // Retry the insert (should always work).
+        bool result =
+            aecm_render_signal_queue_->Insert(&aecm_render_queue_buffer_);
+        RTC_DCHECK(result);
+      }
     }
   }
 
@@ -973,12 +974,14 @@ void AudioProcessingImpl::QueueBandedRenderAudio(AudioBuffer* audio) {
     GainControlImpl::PackRenderAudioBuffer(*audio, &agc_render_queue_buffer_);
     // Insert the samples into the queue.
     if (!agc_render_signal_queue_->Insert(&agc_render_queue_buffer_)) {
-      // The data queue is full and needs to be emptied.
-      EmptyQueuedRenderAudio();
-
-      // Retry the insert (should always work).
-      bool result = agc_render_signal_queue_->Insert(&agc_render_queue_buffer_);
-      RTC_DCHECK(result);
+      // The data queue is full and needs to be emptied. If the capture side is
+      // busy, the frame is dropped rather than waiting for the capture lock.
+      if (TryEmptyQueuedRenderAudio()) {
+        // Retry the insert (should always work).
+        bool result =
+            agc_render_signal_queue_->Insert(&agc_render_queue_buffer_);
+        RTC_DCHECK(result);
+      }
     }
   }
 }
@@ -988,12 +991,13 @@ void AudioProcessingImpl::QueueNonbandedRenderAudio(AudioBuffer* audio) {
 
   // Insert the samples into the queue.
   if (!red_render_signal_queue_->Insert(&red_render_queue_buffer_)) {
-    // The data queue is full and needs to be emptied.
-    EmptyQueuedRenderAudio();
-
-    // Retry the insert (should always work).
-    bool result = red_render_signal_queue_->Insert(&red_render_queue_buffer_);
-    RTC_DCHECK(result);
+    // The data queue is full and needs to be emptied. If the capture side is
+    // busy, the frame is dropped rather than waiting for the capture lock.
+    if (TryEmptyQueuedRenderAudio()) {
+      // Retry the insert (should always work).
+      bool result = red_render_signal_queue_->Insert(&red_render_queue_buffer_);
+      RTC_DCHECK(result);
+    }
   }
 }
 
@@ -1046,9 +1050,17 @@ void AudioProcessingImpl::AllocateRenderQueue() {
   }
 }
 
-void AudioProcessingImpl::EmptyQueuedRenderAudio() {
-  MutexLock lock_capture(&mutex_capture_);
+bool AudioProcessingImpl::TryEmptyQueuedRenderAudio() {
+  // The render queues only fill up when the capture side has not consumed them
+  // for kMaxNumFramesToBuffer frames. Blocking on the capture lock here would
+  // make the render thread wait for the capture thread, so the queues are only
+  // drained if the lock is free.
+  if (!mutex_capture_.TryLock()) {
+    return false;
+  }
   EmptyQueuedRenderAudioLocked();
+  mutex_capture_.Unlock();
+  return true;
 }
 
 void AudioProcessingImpl::EmptyQueuedRenderAudioLocked() {
@@ -290,7 +290,9 @@ class AudioProcessingImpl : public AudioProcessing {
   void HandleRenderRuntimeSettings()
       RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_render_);
 
-  void EmptyQueuedRenderAudio() RTC_LOCKS_EXCLUDED(mutex_capture_);
+  // Empties the render queues from the render thread if the capture lock is
+  // free. Returns false, without blocking, if the capture side is busy.
+  bool TryEmptyQueuedRenderAudio() RTC_LOCKS_EXCLUDED(mutex_capture_);
   void EmptyQueuedRenderAudioLocked()
       RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_capture_);
   void AllocateRenderQueue()
@@ -9,6 +9,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -17,9 +18,11 @@
 #include "modules/audio_processing/test/audio_processing_builder_for_testing.h"
 #include "modules/audio_processing/test/test_utils.h"
 #include "rtc_base/event.h"
+#include "rtc_base/logging.h"
 #include "rtc_base/platform_thread.h"
 #include "rtc_base/random.h"
 #include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/time_utils.h"
 #include "system_wrappers/include/sleep.h"
 #include "test/gtest.h"
 
@@ -1004,8 +1007,109 @@ void RenderProcessor::ApplyRuntimeSettingScheme() {
                frame_data_.input_number_of_channels);
 }
 
+// Capture post-processor which, when armed, stalls the capture thread inside
+// ProcessStream(), i.e., while the capture lock is held, until it is released
+// or a time-out expires.
+class StallingCapturePostProcessor : public CustomProcessing {
+ public:
+  static constexpr int kStallTimeOutMs = 10000;
+
+  void Initialize(int sample_rate_hz, int num_channels) override {}
+  void Process(AudioBuffer* audio) override {
+    if (armed_.exchange(false)) {
+      stalled_.Set();
+      timed_out_ = !release_.Wait(kStallTimeOutMs);
+    }
+  }
+  std::string ToString() const override {
+    return "StallingCapturePostProcessor";
+  }
+  void SetRuntimeSetting(AudioProcessing::RuntimeSetting setting) override {}
+
+  void Arm() { armed_ = true; }
+  void WaitUntilStalled() { stalled_.Wait(rtc::Event::kForever); }
+  void Release() { release_.Set(); }
+  bool timed_out() const { return timed_out_; }
+
+ private:
+  std::atomic<bool> armed_{false};
+  std::atomic<bool> timed_out_{false};
+  rtc::Event stalled_;
+  rtc::Event release_;
+};
+
 }  // anonymous namespace
 
+// Verifies that the render side keeps running with a bounded call latency
+// while the capture thread is stalled with the capture lock held, also once
+// the render-to-capture queues are full.
+TEST(AudioProcessingImplRenderLatencyTest, RenderDoesNotWaitForStalledCapture) {
+  constexpr int kSampleRateHz = 48000;
+  constexpr int kNumChannels = 1;
+  // More frames than the render queues can hold.
+  constexpr int kNumRenderFrames = 300;
+  const StreamConfig stream_config(kSampleRateHz, kNumChannels,
+                                   /*has_keyboard=*/false);
+
+  auto capture_post_processor =
+      std::make_unique<StallingCapturePostProcessor>();
+  StallingCapturePostProcessor* stalling_processor =
+      capture_post_processor.get();
+  AudioProcessing::Config config;
+  config.gain_controller1.enabled = true;
+  config.gain_controller1.mode =
+      AudioProcessing::Config::GainController1::kAdaptiveDigital;
+  config.residual_echo_detector.enabled = true;
+  rtc::scoped_refptr<AudioProcessing> apm =
+      AudioProcessingBuilderForTesting()
+          .SetCapturePostProcessing(std::move(capture_post_processor))
+          .Create();
+  apm->ApplyConfig(config);
+
+  std::vector<float> frame(stream_config.num_frames(), 0.1f);
+  float* channels[] = {frame.data()};
+  ASSERT_EQ(AudioProcessing::kNoError,
+            apm->ProcessReverseStream(channels, stream_config, stream_config,
+                                      channels));
+  ASSERT_EQ(AudioProcessing::kNoError,
+            apm->ProcessStream(channels, stream_config, stream_config,
+                               channels));
+
+  // Stall the capture thread inside ProcessStream().
+  stalling_processor->Arm();
+  rtc::PlatformThread capture_thread = rtc::PlatformThread::SpawnJoinable(
+      [&] {
+        std::vector<float> capture_frame(stream_config.num_frames(), 0.1f);
+        float* capture_channels[] = {capture_frame.data()};
+        apm->ProcessStream(capture_channels, stream_config, stream_config,
+                           capture_channels);
+      },
+      "capture");
+  stalling_processor->WaitUntilStalled();
+
+  std::vector<int64_t> render_call_durations_us;
+  for (int i = 0; i < kNumRenderFrames; ++i) {
+    const int64_t start_us = rtc::TimeMicros();
+    EXPECT_EQ(AudioProcessing::kNoError,
+              apm->ProcessReverseStream(channels, stream_config, stream_config,
+                                        channels));
+    render_call_durations_us.push_back(rtc::TimeMicros() - start_us);
+  }
+  stalling_processor->Release();
+  capture_thread.Finalize();
+
+  // With the capture lock held for the whole render loop, any render call
+  // waiting for it would only have returned after the stall timed out.
+  EXPECT_FALSE(stalling_processor->timed_out());
+
+  std::sort(render_call_durations_us.begin(), render_call_durations_us.end());
+  RTC_LOG(LS_INFO) << "Render call latency while capture is stalled (us): p50 "
+                   << render_call_durations_us[kNumRenderFrames / 2]
+                   << ", p99 "
+                   << render_call_durations_us[kNumRenderFrames * 99 / 100]
+                   << ", max " << render_call_durations_us.back();
+}
+
 TEST_P(AudioProcessingImplLockTest, LockTest) {
   // Run test and verify that it did not time out.
   ASSERT_TRUE(RunTest());
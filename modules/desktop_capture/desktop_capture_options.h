@@ -97,6 +97,14 @@ class RTC_EXPORT DesktopCaptureOptions {
     detect_updated_region_ = detect_updated_region;
   }
 
+  // Maximum number of threads used to compare frames when
+  // detect_updated_region() is set. Only large frames are split between
+  // several threads.
+  int num_differ_threads() const { return num_differ_threads_; }
+  void set_num_differ_threads(int num_differ_threads) {
+    num_differ_threads_ = num_differ_threads;
+  }
+
 #if defined(WEBRTC_WIN)
   // Enumerating windows owned by the current process on Windows has some
   // complications due to |GetWindowText*()| APIs potentially causing a
@@ -191,6 +199,7 @@ class RTC_EXPORT DesktopCaptureOptions {
 #endif
   bool disable_effects_ = true;
   bool detect_updated_region_ = false;
+  int num_differ_threads_ = 1;
 #if defined(WEBRTC_USE_PIPEWIRE)
   bool allow_pipewire_ = false;
 #endif
@@ -68,7 +68,8 @@ std::unique_ptr<DesktopCapturer> DesktopCapturer::CreateWindowCapturer(
 
   std::unique_ptr<DesktopCapturer> capturer = CreateRawWindowCapturer(options);
   if (capturer && options.detect_updated_region()) {
-    capturer.reset(new DesktopCapturerDifferWrapper(std::move(capturer)));
+    capturer.reset(new DesktopCapturerDifferWrapper(
+        std::move(capturer), options.num_differ_threads()));
   }
 
   return capturer;
@@ -86,7 +87,8 @@ std::unique_ptr<DesktopCapturer> DesktopCapturer::CreateScreenCapturer(
 
   std::unique_ptr<DesktopCapturer> capturer = CreateRawScreenCapturer(options);
   if (capturer && options.detect_updated_region()) {
-    capturer.reset(new DesktopCapturerDifferWrapper(std::move(capturer)));
+    capturer.reset(new DesktopCapturerDifferWrapper(
+        std::move(capturer), options.num_differ_threads()));
   }
 
   return capturer;
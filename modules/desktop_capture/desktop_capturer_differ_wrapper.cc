@@ -13,7 +13,9 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "modules/desktop_capture/desktop_geometry.h"
 #include "modules/desktop_capture/desktop_region.h"
@@ -142,12 +144,52 @@ void CompareFrames(const DesktopFrame& old_frame,
              output);
 }
 
+// Returns |region| with each rectangle extended to the kBlockSize grid.
+DesktopRegion AlignToBlocks(const DesktopRegion& region) {
+  DesktopRegion result;
+  for (DesktopRegion::Iterator it(region); !it.IsAtEnd(); it.Advance()) {
+    const DesktopRect& rect = it.rect();
+    result.AddRect(DesktopRect::MakeLTRB(
+        rect.left() / kBlockSize * kBlockSize,
+        rect.top() / kBlockSize * kBlockSize,
+        (rect.right() + kBlockSize - 1) / kBlockSize * kBlockSize,
+        (rect.bottom() + kBlockSize - 1) / kBlockSize * kBlockSize));
+  }
+  return result;
+}
+
+// Compares the part of |hints| within |stripe| in |old_frame| and |new_frame|,
+// and outputs dirty regions into |output|.
+void CompareStripe(const DesktopFrame& old_frame,
+                   const DesktopFrame& new_frame,
+                   const DesktopRegion& hints,
+                   const DesktopRect& stripe,
+                   DesktopRegion* const output) {
+  for (DesktopRegion::Iterator it(hints); !it.IsAtEnd(); it.Advance()) {
+    DesktopRect rect = it.rect();
+    rect.IntersectWith(stripe);
+    if (!rect.is_empty()) {
+      CompareFrames(old_frame, new_frame, rect, output);
+    }
+  }
+}
+
 }  // namespace
 
+constexpr int DesktopCapturerDifferWrapper::kMinPixelsPerThread;
+
 DesktopCapturerDifferWrapper::DesktopCapturerDifferWrapper(
     std::unique_ptr<DesktopCapturer> base_capturer)
-    : base_capturer_(std::move(base_capturer)) {
+    : DesktopCapturerDifferWrapper(std::move(base_capturer), 1) {}
+
+DesktopCapturerDifferWrapper::DesktopCapturerDifferWrapper(
+    std::unique_ptr<DesktopCapturer> base_capturer,
+    int num_threads)
+    : base_capturer_(std::move(base_capturer)),
+      num_threads_(num_threads),
+      diff_pool_("DesktopDiffThread") {
   RTC_DCHECK(base_capturer_);
+  RTC_DCHECK_GE(num_threads_, 1);
 }
 
 DesktopCapturerDifferWrapper::~DesktopCapturerDifferWrapper() {}
@@ -207,10 +249,7 @@ void DesktopCapturerDifferWrapper::OnCaptureResult(
   if (last_frame_) {
     DesktopRegion hints;
     hints.Swap(frame->mutable_updated_region());
-    for (DesktopRegion::Iterator it(hints); !it.IsAtEnd(); it.Advance()) {
-      CompareFrames(*last_frame_, *frame, it.rect(),
-                    frame->mutable_updated_region());
-    }
+    DetectUpdatedRegion(hints, frame.get());
   } else {
     frame->mutable_updated_region()->SetRect(
         DesktopRect::MakeSize(frame->size()));
@@ -223,4 +262,44 @@ void DesktopCapturerDifferWrapper::OnCaptureResult(
   callback_->OnCaptureResult(result, std::move(frame));
 }
 
+void DesktopCapturerDifferWrapper::DetectUpdatedRegion(
+    const DesktopRegion& hints,
+    DesktopFrame* frame) {
+  const DesktopRegion aligned_hints = AlignToBlocks(hints);
+  int64_t pixels = 0;
+  for (DesktopRegion::Iterator it(aligned_hints); !it.IsAtEnd();
+       it.Advance()) {
+    pixels += it.rect().width() * it.rect().height();
+  }
+  const int block_rows = (frame->size().height() + kBlockSize - 1) / kBlockSize;
+  const int num_stripes = static_cast<int>(std::min<int64_t>(
+      {num_threads_, std::max<int64_t>(pixels / kMinPixelsPerThread, 1),
+       block_rows}));
+
+  DesktopRegion* const output = frame->mutable_updated_region();
+  if (num_stripes == 1) {
+    CompareStripe(*last_frame_, *frame, aligned_hints,
+                  DesktopRect::MakeSize(frame->size()), output);
+  } else {
+    // Stripes start at block boundaries, so that blocks stay aligned.
+    std::vector<DesktopRegion> stripe_outputs(num_stripes);
+    std::vector<DesktopRect> stripes;
+    for (int i = 0; i < num_stripes; i++) {
+      stripes.push_back(DesktopRect::MakeLTRB(
+          0, block_rows * i / num_stripes * kBlockSize, frame->size().width(),
+          std::min(block_rows * (i + 1) / num_stripes * kBlockSize,
+                   frame->size().height())));
+    }
+    diff_pool_.Run(num_stripes, [&](int i) {
+      CompareStripe(*last_frame_, *frame, aligned_hints, stripes[i],
+                    &stripe_outputs[i]);
+    });
+    for (const DesktopRegion& stripe_output : stripe_outputs) {
+      output->AddRegion(stripe_output);
+    }
+  }
+  // Blocks outside of |hints| are not updated.
+  output->IntersectWith(hints);
+}
+
 }  // namespace webrtc
@@ -17,8 +17,10 @@
 #include "modules/desktop_capture/desktop_capturer.h"
 #include "modules/desktop_capture/desktop_frame.h"
 #include "modules/desktop_capture/desktop_geometry.h"
+#include "modules/desktop_capture/desktop_region.h"
 #include "modules/desktop_capture/shared_desktop_frame.h"
 #include "modules/desktop_capture/shared_memory.h"
+#include "rtc_base/fork_join_pool.h"
 #include "rtc_base/system/rtc_export.h"
 
 namespace webrtc {
@@ -31,6 +33,11 @@ namespace webrtc {
 //
 // This class marks entire frame as updated if the frame size or frame stride
 // has been changed.
+//
+// The updated region hints are rounded out to whole blocks before comparing,
+// so that each block is compared with full width vector instructions, and the
+// result is clipped back to the hints. Large frames can be compared on several
+// threads, each handling a horizontal stripe of the frame.
 class RTC_EXPORT DesktopCapturerDifferWrapper
     : public DesktopCapturer,
       public DesktopCapturer::Callback {
@@ -40,6 +47,14 @@ class RTC_EXPORT DesktopCapturerDifferWrapper
   explicit DesktopCapturerDifferWrapper(
       std::unique_ptr<DesktopCapturer> base_capturer);
 
+  // Same as above, but compares frames on up to |num_threads| threads, using
+  // one thread per |kMinPixelsPerThread| pixels to compare. The calling thread
+  // is one of them.
+  DesktopCapturerDifferWrapper(std::unique_ptr<DesktopCapturer> base_capturer,
+                               int num_threads);
+
+  static constexpr int kMinPixelsPerThread = 1024 * 1024;
+
   ~DesktopCapturerDifferWrapper() override;
 
   // DesktopCapturer interface.
@@ -58,9 +73,16 @@ class RTC_EXPORT DesktopCapturerDifferWrapper
   void OnCaptureResult(Result result,
                        std::unique_ptr<DesktopFrame> frame) override;
 
+  // Compares |hints| in |last_frame_| and |frame|, and outputs the updated
+  // regions into |frame|->mutable_updated_region().
+  void DetectUpdatedRegion(const DesktopRegion& hints, DesktopFrame* frame);
+
   const std::unique_ptr<DesktopCapturer> base_capturer_;
+  const int num_threads_;
   DesktopCapturer::Callback* callback_;
   std::unique_ptr<SharedDesktopFrame> last_frame_;
+  // Compares the stripes of large frames.
+  ForkJoinPool diff_pool_;
 };
 
 }  // namespace webrtc
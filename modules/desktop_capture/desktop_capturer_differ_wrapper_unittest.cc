@@ -10,16 +10,22 @@
 
 #include "modules/desktop_capture/desktop_capturer_differ_wrapper.h"
 
+#include <stdio.h>
+#include <string.h>
+
+#include <cmath>
 #include <initializer_list>
 #include <memory>
 #include <utility>
 #include <vector>
 
+#include "modules/desktop_capture/desktop_frame_generator.h"
 #include "modules/desktop_capture/desktop_geometry.h"
 #include "modules/desktop_capture/desktop_region.h"
 #include "modules/desktop_capture/differ_block.h"
 #include "modules/desktop_capture/fake_desktop_capturer.h"
 #include "modules/desktop_capture/mock_desktop_capturer_callback.h"
+#include "modules/desktop_capture/shared_desktop_frame.h"
 #include "rtc_base/random.h"
 #include "rtc_base/time_utils.h"
 #include "system_wrappers/include/cpu_features_wrapper.h"
@@ -153,7 +159,8 @@ void ExecuteCapturer(DesktopCapturerDifferWrapper* capturer,
 void ExecuteDifferWrapperTest(bool with_hints,
                               bool enlarge_updated_region,
                               bool random_updated_region,
-                              bool check_result) {
+                              bool check_result,
+                              int num_threads = 1) {
   const bool updated_region_should_exactly_match =
       with_hints && !enlarge_updated_region && !random_updated_region;
   BlackWhiteDesktopFramePainter frame_painter;
@@ -161,7 +168,7 @@ void ExecuteDifferWrapperTest(bool with_hints,
   frame_generator.set_desktop_frame_painter(&frame_painter);
   std::unique_ptr<FakeDesktopCapturer> fake(new FakeDesktopCapturer());
   fake->set_frame_generator(&frame_generator);
-  DesktopCapturerDifferWrapper capturer(std::move(fake));
+  DesktopCapturerDifferWrapper capturer(std::move(fake), num_threads);
   MockDesktopCapturerCallback callback;
   frame_generator.set_provide_updated_region_hints(with_hints);
   frame_generator.set_enlarge_updated_region(enlarge_updated_region);
@@ -222,6 +229,50 @@ void ExecuteDifferWrapperTest(bool with_hints,
   }
 }
 
+// Alternates between two frames which differ in |changed_rect|, without
+// updated region hints, as most capturers do.
+class AlternatingFrameGenerator : public DesktopFrameGenerator {
+ public:
+  AlternatingFrameGenerator(DesktopSize size, DesktopRect changed_rect) {
+    std::unique_ptr<DesktopFrame> frames[2] = {
+        std::make_unique<BasicDesktopFrame>(size),
+        std::make_unique<BasicDesktopFrame>(size)};
+    for (int y = 0; y < size.height(); y++) {
+      for (int x = 0; x < size.width(); x++) {
+        uint32_t pixel = static_cast<uint32_t>(x * 7 + y * 13);
+        memcpy(frames[0]->GetFrameDataAtPos(DesktopVector(x, y)), &pixel,
+               sizeof(pixel));
+        if (changed_rect.Contains(DesktopVector(x, y))) {
+          pixel = ~pixel;
+        }
+        memcpy(frames[1]->GetFrameDataAtPos(DesktopVector(x, y)), &pixel,
+               sizeof(pixel));
+      }
+    }
+    frames_[0] = SharedDesktopFrame::Wrap(std::move(frames[0]));
+    frames_[1] = SharedDesktopFrame::Wrap(std::move(frames[1]));
+  }
+
+  std::unique_ptr<DesktopFrame> GetNextFrame(
+      SharedMemoryFactory* factory) override {
+    std::unique_ptr<DesktopFrame> frame = frames_[next_frame_]->Share();
+    frame->mutable_updated_region()->SetRect(
+        DesktopRect::MakeSize(frame->size()));
+    next_frame_ = 1 - next_frame_;
+    return frame;
+  }
+
+ private:
+  std::unique_ptr<SharedDesktopFrame> frames_[2];
+  int next_frame_ = 0;
+};
+
+class DiscardingCallback : public DesktopCapturer::Callback {
+ public:
+  void OnCaptureResult(DesktopCapturer::Result result,
+                       std::unique_ptr<DesktopFrame> frame) override {}
+};
+
 }  // namespace
 
 TEST(DesktopCapturerDifferWrapperTest, CaptureWithoutHints) {
@@ -244,6 +295,14 @@ TEST(DesktopCapturerDifferWrapperTest, CaptureWithEnlargedAndRandomHints) {
   ExecuteDifferWrapperTest(true, true, true, true);
 }
 
+TEST(DesktopCapturerDifferWrapperTest, CaptureWithoutHintsOnThreads) {
+  ExecuteDifferWrapperTest(false, false, false, true, 4);
+}
+
+TEST(DesktopCapturerDifferWrapperTest, CaptureWithRandomHintsOnThreads) {
+  ExecuteDifferWrapperTest(true, false, true, true, 4);
+}
+
 // When hints are provided, DesktopCapturerDifferWrapper has a slightly better
 // performance in current configuration, but not so significant. Following is
 // one run result.
@@ -288,4 +347,38 @@ TEST(DesktopCapturerDifferWrapperTest,
   ASSERT_LE(rtc::TimeMillis() - started, 15000);
 }
 
+// Prints the time to detect the updated region of 4K frames with 1%, 10% and
+// 100% of their area changed, on one thread and on four.
+TEST(DesktopCapturerDifferWrapperTest, DISABLED_Compare4KFramesPerf) {
+  constexpr int kNumFrames = 100;
+  const DesktopSize kSize(3840, 2160);
+  for (int percent : {1, 10, 100}) {
+    // A centered rectangle of |percent| of the frame area.
+    const double scale = std::sqrt(percent / 100.0);
+    const int width = static_cast<int>(kSize.width() * scale);
+    const int height = static_cast<int>(kSize.height() * scale);
+    const DesktopRect changed_rect = DesktopRect::MakeXYWH(
+        (kSize.width() - width) / 2, (kSize.height() - height) / 2, width,
+        height);
+    for (int num_threads : {1, 4}) {
+      AlternatingFrameGenerator frame_generator(kSize, changed_rect);
+      std::unique_ptr<FakeDesktopCapturer> fake(new FakeDesktopCapturer());
+      fake->set_frame_generator(&frame_generator);
+      DesktopCapturerDifferWrapper capturer(std::move(fake), num_threads);
+      DiscardingCallback callback;
+      capturer.Start(&callback);
+      // The first frame is marked as updated without comparing.
+      capturer.CaptureFrame();
+      const int64_t start_us = rtc::TimeMicros();
+      for (int i = 0; i < kNumFrames; i++) {
+        capturer.CaptureFrame();
+      }
+      printf("4K, %3d%% changed, %d thread(s): %.3f ms per frame\n", percent,
+             num_threads,
+             static_cast<double>(rtc::TimeMicros() - start_us) / kNumFrames /
+                 rtc::kNumMicrosecsPerMillisec);
+    }
+  }
+}
+
 }  // namespace webrtc
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "modules/desktop_capture/differ_block_avx2.h"
+
+#include <immintrin.h>
+
+namespace webrtc {
+
+extern bool BlockDifference_AVX2_W32(const uint8_t* image1,
+                                     const uint8_t* image2,
+                                     int height,
+                                     int stride) {
+  for (int i = 0; i < height; i++) {
+    // A row of the block is 32 pixels of 4 bytes, i.e. four 256 bit vectors.
+    const __m256i* i1 = reinterpret_cast<const __m256i*>(image1);
+    const __m256i* i2 = reinterpret_cast<const __m256i*>(image2);
+    __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(i1),
+                                    _mm256_loadu_si256(i2));
+    diff = _mm256_or_si256(
+        diff, _mm256_xor_si256(_mm256_loadu_si256(i1 + 1),
+                               _mm256_loadu_si256(i2 + 1)));
+    diff = _mm256_or_si256(
+        diff, _mm256_xor_si256(_mm256_loadu_si256(i1 + 2),
+                               _mm256_loadu_si256(i2 + 2)));
+    diff = _mm256_or_si256(
+        diff, _mm256_xor_si256(_mm256_loadu_si256(i1 + 3),
+                               _mm256_loadu_si256(i2 + 3)));
+    if (!_mm256_testz_si256(diff, diff)) {
+      return true;
+    }
+    image1 += stride;
+    image2 += stride;
+  }
+  return false;
+}
+
+}  // namespace webrtc
@@ -0,0 +1,29 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+// This header file is used only by differ_block.cc. It defines the AVX2
+// routines for finding block difference.
+
+#ifndef MODULES_DESKTOP_CAPTURE_DIFFER_BLOCK_AVX2_H_
+#define MODULES_DESKTOP_CAPTURE_DIFFER_BLOCK_AVX2_H_
+
+#include <stdint.h>
+
+namespace webrtc {
+
+// Find block difference of width 32 and height |height|.
+extern bool BlockDifference_AVX2_W32(const uint8_t* image1,
+                                     const uint8_t* image2,
+                                     int height,
+                                     int stride);
+
+}  // namespace webrtc
+
+#endif  // MODULES_DESKTOP_CAPTURE_DIFFER_BLOCK_AVX2_H_
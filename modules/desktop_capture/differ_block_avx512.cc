@@ -0,0 +1,37 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "modules/desktop_capture/differ_block_avx512.h"
+
+#include <immintrin.h>
+
+namespace webrtc {
+
+extern bool BlockDifference_AVX512_W32(const uint8_t* image1,
+                                       const uint8_t* image2,
+                                       int height,
+                                       int stride) {
+  for (int i = 0; i < height; i++) {
+    // A row of the block is 32 pixels of 4 bytes, i.e. two 512 bit vectors.
+    const __m512i diff = _mm512_or_si512(
+        _mm512_xor_si512(_mm512_loadu_si512(image1),
+                         _mm512_loadu_si512(image2)),
+        _mm512_xor_si512(_mm512_loadu_si512(image1 + 64),
+                         _mm512_loadu_si512(image2 + 64)));
+    if (_mm512_test_epi32_mask(diff, diff) != 0) {
+      return true;
+    }
+    image1 += stride;
+    image2 += stride;
+  }
+  return false;
+}
+
+}  // namespace webrtc
@@ -86,4 +86,22 @@ TEST(BlockDifferenceTestFirst, BlockDifference) {
   }
 }
 
+TEST(BlockDifferenceTestEveryByte, BlockDifference) {
+  uint8_t* block1;
+  uint8_t* block2;
+  PrepareBuffers(block1, block2);
+  const int stride = kBlockSize * kBytesPerPixel;
+
+  // Whichever implementation is used on this CPU finds a difference in any
+  // byte of the rows it compares, and none below them.
+  for (int height = 1; height <= kBlockSize; ++height) {
+    for (int i = 0; i < kSizeOfBlock; ++i) {
+      block2[i] += 1;
+      EXPECT_EQ(i < height * stride,
+                BlockDifference(block1, block2, height, stride));
+      block2[i] -= 1;
+    }
+  }
+}
+
 }  // namespace webrtc
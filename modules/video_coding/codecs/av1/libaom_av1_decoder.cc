@@ -19,10 +19,13 @@
 #include "api/video/i420_buffer.h"
 #include "api/video_codecs/video_codec.h"
 #include "api/video_codecs/video_decoder.h"
+#include "common_video/include/decoded_frame_buffer_pool.h"
+#include "common_video/include/video_frame_buffer.h"
 #include "common_video/include/video_frame_buffer_pool.h"
 #include "modules/video_coding/include/video_error_codes.h"
 #include "rtc_base/logging.h"
 #include "third_party/libaom/source/libaom/aom/aom_decoder.h"
+#include "third_party/libaom/source/libaom/aom/aom_frame_buffer.h"
 #include "third_party/libaom/source/libaom/aom/aomdx.h"
 #include "third_party/libyuv/include/libyuv/convert.h"
 
@@ -31,10 +34,14 @@ namespace {
 
 constexpr int kConfigLowBitDepth = 1;  // 8-bits per luma/chroma sample.
 constexpr int kDecFlags = 0;           // 0 signals no post processing.
+// AV1 keeps up to 8 reference frames; the rest of the buffers are held by
+// decoded frames not yet rendered.
+constexpr size_t kMaxNumDecodedBuffers = 150;
+constexpr size_t kMaxDecodedBytes = 1024 * 1024 * 1024;
 
 class LibaomAv1Decoder final : public VideoDecoder {
  public:
-  LibaomAv1Decoder();
+  explicit LibaomAv1Decoder(LibaomAv1DecoderBufferStats* stats);
   LibaomAv1Decoder(const LibaomAv1Decoder&) = delete;
   LibaomAv1Decoder& operator=(const LibaomAv1Decoder&) = delete;
   ~LibaomAv1Decoder();
@@ -57,18 +64,34 @@ class LibaomAv1Decoder final : public VideoDecoder {
   const char* ImplementationName() const override;
 
  private:
+  // Returns the decoded image as a frame buffer that references the memory
+  // libaom decoded into, or a copy of it if the image is not backed by
+  // |frame_buffer_pool_|. Returns null if no buffer is available.
+  rtc::scoped_refptr<VideoFrameBuffer> WrapOrCopyDecodedImage(
+      const aom_image_t& decoded_image);
+
   aom_codec_ctx_t context_;
   bool inited_;
-  // Pool of memory buffers to store decoded image data for application access.
+  // Pool of memory buffers that libaom decodes into. Decoded frames reference
+  // these buffers directly, without a copy.
+  DecodedFrameBufferPool frame_buffer_pool_;
+  // Pool of memory buffers to copy decoded image data into for application
+  // access, when the image does not reside in |frame_buffer_pool_|.
   VideoFrameBufferPool buffer_pool_;
   DecodedImageCallback* decode_complete_callback_;
+  // Updated after each decoded frame if not null.
+  LibaomAv1DecoderBufferStats* const stats_;
 };
 
-LibaomAv1Decoder::LibaomAv1Decoder()
+LibaomAv1Decoder::LibaomAv1Decoder(LibaomAv1DecoderBufferStats* stats)
     : context_(),  // Force value initialization instead of default one.
       inited_(false),
-      buffer_pool_(false, /*max_number_of_buffers=*/150),
-      decode_complete_callback_(nullptr) {}
+      frame_buffer_pool_(/*zero_initialize=*/true,
+                         kMaxNumDecodedBuffers,
+                         kMaxDecodedBytes),
+      buffer_pool_(false, kMaxNumDecodedBuffers),
+      decode_complete_callback_(nullptr),
+      stats_(stats) {}
 
 LibaomAv1Decoder::~LibaomAv1Decoder() {
   Release();
@@ -89,6 +112,24 @@ int32_t LibaomAv1Decoder::InitDecode(const VideoCodec* codec_settings,
                         << " on aom_codec_dec_init.";
     return WEBRTC_VIDEO_CODEC_ERROR;
   }
+  // Let libaom decode into |frame_buffer_pool_|. If this fails, libaom uses its
+  // internal buffers and decoded images are copied.
+  if (aom_codec_set_frame_buffer_functions(
+          &context_,
+          &DecodedFrameBufferPool::GetCodecFrameBuffer<
+              aom_codec_frame_buffer_t>,
+          &DecodedFrameBufferPool::ReleaseCodecFrameBuffer<
+              aom_codec_frame_buffer_t>,
+          &frame_buffer_pool_) != AOM_CODEC_OK) {
+    RTC_LOG(LS_WARNING) << "LibaomAv1Decoder::InitDecode failed to set frame "
+                           "buffer functions.";
+  }
+  if (codec_settings && codec_settings->buffer_pool_size) {
+    if (!frame_buffer_pool_.Resize(*codec_settings->buffer_pool_size) ||
+        !buffer_pool_.Resize(*codec_settings->buffer_pool_size)) {
+      return WEBRTC_VIDEO_CODEC_ERROR;
+    }
+  }
   inited_ = true;
   return WEBRTC_VIDEO_CODEC_OK;
 }
@@ -137,9 +178,8 @@ int32_t LibaomAv1Decoder::Decode(const EncodedImage& encoded_image,
       return WEBRTC_VIDEO_CODEC_ERROR;
     }
 
-    // Allocate memory for decoded frame.
-    rtc::scoped_refptr<I420Buffer> buffer =
-        buffer_pool_.CreateI420Buffer(decoded_image->d_w, decoded_image->d_h);
+    rtc::scoped_refptr<VideoFrameBuffer> buffer =
+        WrapOrCopyDecodedImage(*decoded_image);
     if (!buffer.get()) {
       // Pool has too many pending frames.
       RTC_LOG(LS_WARNING) << "LibaomAv1Decoder::Decode returned due to lack of"
@@ -147,14 +187,6 @@ int32_t LibaomAv1Decoder::Decode(const EncodedImage& encoded_image,
       return WEBRTC_VIDEO_CODEC_ERROR;
     }
 
-    // Copy decoded_image to decoded_frame.
-    libyuv::I420Copy(
-        decoded_image->planes[AOM_PLANE_Y], decoded_image->stride[AOM_PLANE_Y],
-        decoded_image->planes[AOM_PLANE_U], decoded_image->stride[AOM_PLANE_U],
-        decoded_image->planes[AOM_PLANE_V], decoded_image->stride[AOM_PLANE_V],
-        buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(),
-        buffer->StrideU(), buffer->MutableDataV(), buffer->StrideV(),
-        decoded_image->d_w, decoded_image->d_h);
     VideoFrame decoded_frame = VideoFrame::Builder()
                                    .set_video_frame_buffer(buffer)
                                    .set_timestamp_rtp(encoded_image.Timestamp())
@@ -162,12 +194,55 @@ int32_t LibaomAv1Decoder::Decode(const EncodedImage& encoded_image,
                                    .set_color_space(encoded_image.ColorSpace())
                                    .build();
 
+    if (stats_) {
+      stats_->num_allocations = frame_buffer_pool_.GetNumAllocations();
+    }
     decode_complete_callback_->Decoded(decoded_frame, absl::nullopt,
                                        absl::nullopt);
   }
   return WEBRTC_VIDEO_CODEC_OK;
 }
 
+rtc::scoped_refptr<VideoFrameBuffer> LibaomAv1Decoder::WrapOrCopyDecodedImage(
+    const aom_image_t& decoded_image) {
+  // |fb_priv| is the pool buffer holding the image data, reference counted so
+  // that it stays valid after libaom releases it. Images produced by libaom
+  // itself, e.g. with film grain applied, may not reside in that buffer.
+  rtc::scoped_refptr<DecodedFrameBufferPool::Buffer> image_buffer =
+      static_cast<DecodedFrameBufferPool::Buffer*>(decoded_image.fb_priv);
+  if (image_buffer &&
+      image_buffer->Contains(decoded_image.planes[AOM_PLANE_Y]) &&
+      image_buffer->Contains(decoded_image.planes[AOM_PLANE_U]) &&
+      image_buffer->Contains(decoded_image.planes[AOM_PLANE_V])) {
+    return WrapI420Buffer(
+        decoded_image.d_w, decoded_image.d_h,
+        decoded_image.planes[AOM_PLANE_Y], decoded_image.stride[AOM_PLANE_Y],
+        decoded_image.planes[AOM_PLANE_U], decoded_image.stride[AOM_PLANE_U],
+        decoded_image.planes[AOM_PLANE_V], decoded_image.stride[AOM_PLANE_V],
+        // Keeps |image_buffer| from being recycled while the frame is in use.
+        [image_buffer] {});
+  }
+
+  rtc::scoped_refptr<I420Buffer> buffer =
+      buffer_pool_.CreateI420Buffer(decoded_image.d_w, decoded_image.d_h);
+  if (!buffer.get()) {
+    return nullptr;
+  }
+  if (stats_) {
+    stats_->bytes_copied += buffer->StrideY() * buffer->height() +
+                            buffer->StrideU() * buffer->ChromaHeight() +
+                            buffer->StrideV() * buffer->ChromaHeight();
+  }
+  libyuv::I420Copy(
+      decoded_image.planes[AOM_PLANE_Y], decoded_image.stride[AOM_PLANE_Y],
+      decoded_image.planes[AOM_PLANE_U], decoded_image.stride[AOM_PLANE_U],
+      decoded_image.planes[AOM_PLANE_V], decoded_image.stride[AOM_PLANE_V],
+      buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(),
+      buffer->StrideU(), buffer->MutableDataV(), buffer->StrideV(),
+      decoded_image.d_w, decoded_image.d_h);
+  return buffer;
+}
+
 int32_t LibaomAv1Decoder::RegisterDecodeCompleteCallback(
     DecodedImageCallback* decode_complete_callback) {
   decode_complete_callback_ = decode_complete_callback;
@@ -178,6 +253,7 @@ int32_t LibaomAv1Decoder::Release() {
   if (aom_codec_destroy(&context_) != AOM_CODEC_OK) {
     return WEBRTC_VIDEO_CODEC_MEMORY;
   }
+  frame_buffer_pool_.Release();
   buffer_pool_.Release();
   inited_ = false;
   return WEBRTC_VIDEO_CODEC_OK;
@@ -199,7 +275,12 @@ const char* LibaomAv1Decoder::ImplementationName() const {
 const bool kIsLibaomAv1DecoderSupported = true;
 
 std::unique_ptr<VideoDecoder> CreateLibaomAv1Decoder() {
-  return std::make_unique<LibaomAv1Decoder>();
+  return std::make_unique<LibaomAv1Decoder>(/*stats=*/nullptr);
+}
+
+std::unique_ptr<VideoDecoder> CreateLibaomAv1DecoderForTesting(
+    LibaomAv1DecoderBufferStats* stats) {
+  return std::make_unique<LibaomAv1Decoder>(stats);
 }
 
 }  // namespace webrtc
@@ -10,6 +10,8 @@
 #ifndef MODULES_VIDEO_CODING_CODECS_AV1_LIBAOM_AV1_DECODER_H_
 #define MODULES_VIDEO_CODING_CODECS_AV1_LIBAOM_AV1_DECODER_H_
 
+#include <stdint.h>
+
 #include <memory>
 
 #include "absl/base/attributes.h"
@@ -21,6 +23,21 @@ ABSL_CONST_INIT extern const bool kIsLibaomAv1DecoderSupported;
 
 std::unique_ptr<VideoDecoder> CreateLibaomAv1Decoder();
 
+// How the frames decoded so far were backed by memory, for tests and
+// benchmarks.
+struct LibaomAv1DecoderBufferStats {
+  // Number of buffers allocated by the pool libaom decodes into.
+  int num_allocations = 0;
+  // Number of bytes of decoded images that were not backed by that pool and
+  // had to be copied.
+  int64_t bytes_copied = 0;
+};
+
+// Same as CreateLibaomAv1Decoder(), and updates |*stats| after each decoded
+// frame. |stats| must outlive the decoder.
+std::unique_ptr<VideoDecoder> CreateLibaomAv1DecoderForTesting(
+    LibaomAv1DecoderBufferStats* stats);
+
 }  // namespace webrtc
 
 #endif  // MODULES_VIDEO_CODING_CODECS_AV1_LIBAOM_AV1_DECODER_H_
@@ -21,4 +21,9 @@ std::unique_ptr<VideoDecoder> CreateLibaomAv1Decoder() {
   return nullptr;
 }
 
+std::unique_ptr<VideoDecoder> CreateLibaomAv1DecoderForTesting(
+    LibaomAv1DecoderBufferStats* /*stats*/) {
+  return nullptr;
+}
+
 }  // namespace webrtc
@@ -30,8 +30,10 @@
 #include "modules/video_coding/svc/create_scalability_structure.h"
 #include "modules/video_coding/svc/scalable_video_controller.h"
 #include "modules/video_coding/svc/scalable_video_controller_no_layering.h"
+#include "modules/video_coding/utility/update_rect_active_map.h"
 #include "rtc_base/checks.h"
 #include "rtc_base/logging.h"
+#include "system_wrappers/include/field_trial.h"
 #include "third_party/libaom/source/libaom/aom/aom_codec.h"
 #include "third_party/libaom/source/libaom/aom/aom_encoder.h"
 #include "third_party/libaom/source/libaom/aom/aomcx.h"
@@ -105,6 +107,9 @@ class LibaomAv1Encoder final : public VideoEncoder {
   // Configures the encoder which buffers next frame updates and can reference.
   void SetSvcRefFrameConfig(
       const ScalableVideoController::LayerFrameConfig& layer_frame);
+  // Lets libaom skip the blocks outside of the update rects of the frames
+  // since the last encoded one, for single layer screenshare.
+  void SetActiveMap(bool keyframe);
 
   std::unique_ptr<ScalableVideoController> svc_controller_;
   bool inited_;
@@ -114,6 +119,9 @@ class LibaomAv1Encoder final : public VideoEncoder {
   aom_codec_ctx_t ctx_;
   aom_codec_enc_cfg_t cfg_;
   EncodedImageCallback* encoded_image_callback_;
+  const bool use_active_map_;
+  UpdateRectActiveMap active_map_;
+  bool active_map_set_;
 };
 
 int32_t VerifyCodecSettings(const VideoCodec& codec_settings) {
@@ -144,7 +152,10 @@ int32_t VerifyCodecSettings(const VideoCodec& codec_settings) {
 LibaomAv1Encoder::LibaomAv1Encoder()
     : inited_(false),
       frame_for_encode_(nullptr),
-      encoded_image_callback_(nullptr) {}
+      encoded_image_callback_(nullptr),
+      use_active_map_(
+          field_trial::IsEnabled("WebRTC-Av1ActiveMapFromUpdateRect")),
+      active_map_set_(false) {}
 
 LibaomAv1Encoder::~LibaomAv1Encoder() {
   Release();
@@ -238,6 +249,8 @@ int LibaomAv1Encoder::InitEncode(const VideoCodec* codec_settings,
     return WEBRTC_VIDEO_CODEC_ERROR;
   }
   inited_ = true;
+  active_map_.Reset();
+  active_map_set_ = false;
 
   // Set control parameters
   ret = aom_codec_control(
@@ -575,6 +588,11 @@ int32_t LibaomAv1Encoder::Encode(
     return WEBRTC_VIDEO_CODEC_ERROR;
   }
 
+  if (use_active_map_) {
+    active_map_.Update(frame);
+    SetActiveMap(layer_frames.front().IsKeyframe());
+  }
+
   // Convert input frame to I420, if needed.
   VideoFrame prepped_input_frame = frame;
   if (prepped_input_frame.video_frame_buffer()->type() !=
@@ -710,6 +728,7 @@ int32_t LibaomAv1Encoder::Encode(
 
     // Deliver encoded image data.
     if (encoded_image.size() > 0) {
+      active_map_.OnFrameEncoded();
       CodecSpecificInfo codec_specific_info;
       codec_specific_info.codecType = kVideoCodecAV1;
       codec_specific_info.end_of_picture = end_of_picture;
@@ -740,6 +759,30 @@ int32_t LibaomAv1Encoder::Encode(
   return WEBRTC_VIDEO_CODEC_OK;
 }
 
+void LibaomAv1Encoder::SetActiveMap(bool keyframe) {
+  // Skipping blocks relies on the frame referencing the previous one.
+  const bool skip_blocks =
+      encoder_settings_.mode == VideoCodecMode::kScreensharing &&
+      !SvcEnabled() && !keyframe && active_map_.HasInactiveBlocks();
+  if (!skip_blocks && !active_map_set_) {
+    return;
+  }
+  aom_active_map_t active_map;
+  // A null map makes all blocks active.
+  active_map.active_map = skip_blocks ? active_map_.map() : nullptr;
+  active_map.rows = active_map_.rows();
+  active_map.cols = active_map_.cols();
+  aom_codec_err_t ret =
+      aom_codec_control(&ctx_, AOME_SET_ACTIVEMAP, &active_map);
+  if (ret != AOM_CODEC_OK) {
+    RTC_LOG(LS_WARNING) << "LibaomAv1Encoder::Encode returned " << ret
+                        << " on control AOME_SET_ACTIVEMAP.";
+    active_map_set_ = false;
+    return;
+  }
+  active_map_set_ = skip_blocks;
+}
+
 void LibaomAv1Encoder::SetRates(const RateControlParameters& parameters) {
   if (!inited_) {
     RTC_LOG(LS_WARNING) << "SetRates() while encoder is not initialized";
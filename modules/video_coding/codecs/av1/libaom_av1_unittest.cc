@@ -10,7 +10,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
 #include <map>
 #include <memory>
 #include <ostream>
@@ -20,6 +25,8 @@
 #include "absl/types/optional.h"
 #include "api/units/data_size.h"
 #include "api/units/time_delta.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame.h"
 #include "api/video_codecs/video_codec.h"
 #include "api/video_codecs/video_encoder.h"
 #include "modules/video_coding/codecs/av1/libaom_av1_decoder.h"
@@ -30,6 +37,9 @@
 #include "modules/video_coding/svc/create_scalability_structure.h"
 #include "modules/video_coding/svc/scalable_video_controller.h"
 #include "modules/video_coding/svc/scalable_video_controller_no_layering.h"
+#include "modules/video_coding/utility/update_rect_active_map.h"
+#include "rtc_base/time_utils.h"
+#include "test/field_trial.h"
 #include "test/gmock.h"
 #include "test/gtest.h"
 
@@ -154,6 +164,193 @@ TEST(LibaomAv1Test, EncodeDecode) {
   EXPECT_EQ(decoder.num_output_frames(), decoder.decoded_frame_ids().size());
 }
 
+// Encodes screenshare frames that change everywhere while their update rects
+// only cover the top left block, and checks that libaom copies the blocks
+// outside of the update rects once they are no longer kept active.
+TEST(LibaomAv1Test, ActiveMapSkipsBlocksOutsideOfUpdateRects) {
+  test::ScopedFieldTrials field_trials(
+      "WebRTC-Av1ActiveMapFromUpdateRect/Enabled/");
+  constexpr int kBlockSize = UpdateRectActiveMap::kBlockSize;
+  constexpr int kRows = (kHeight + kBlockSize - 1) / kBlockSize;
+  constexpr int kCols = (kWidth + kBlockSize - 1) / kBlockSize;
+  constexpr int kNumFrames = UpdateRectActiveMap::kActiveFramesAfterUpdate + 4;
+  std::unique_ptr<VideoEncoder> encoder = CreateLibaomAv1Encoder();
+  VideoCodec codec_settings = DefaultCodecSettings();
+  codec_settings.mode = VideoCodecMode::kScreensharing;
+  ASSERT_EQ(encoder->InitEncode(&codec_settings, DefaultEncoderSettings()),
+            WEBRTC_VIDEO_CODEC_OK);
+
+  class EncodedImages : public EncodedImageCallback {
+   public:
+    Result OnEncodedImage(
+        const EncodedImage& encoded_image,
+        const CodecSpecificInfo* /*codec_specific_info*/) override {
+      images.push_back(encoded_image);
+      return Result(Result::OK);
+    }
+
+    std::vector<EncodedImage> images;
+  } encoded_images;
+  encoder->RegisterEncodeCompleteCallback(&encoded_images);
+
+  for (int i = 0; i < kNumFrames; ++i) {
+    // A flat frame that is brighter than the previous one.
+    rtc::scoped_refptr<I420Buffer> buffer = I420Buffer::Create(kWidth, kHeight);
+    I420Buffer::SetBlack(buffer.get());
+    for (int y = 0; y < kHeight; ++y) {
+      memset(buffer->MutableDataY() + y * buffer->StrideY(), 16 + 8 * i,
+             kWidth);
+    }
+    absl::optional<VideoFrame::UpdateRect> update_rect;
+    if (i > 0) {
+      update_rect = VideoFrame::UpdateRect{0, 0, kBlockSize, kBlockSize};
+    }
+    std::vector<VideoFrameType> frame_types = {
+        i == 0 ? VideoFrameType::kVideoFrameKey
+               : VideoFrameType::kVideoFrameDelta};
+    ASSERT_EQ(encoder->Encode(VideoFrame::Builder()
+                                  .set_video_frame_buffer(buffer)
+                                  .set_timestamp_rtp(i * 90000 / kFramerate)
+                                  .set_update_rect(update_rect)
+                                  .build(),
+                              &frame_types),
+              WEBRTC_VIDEO_CODEC_OK);
+  }
+  ASSERT_THAT(encoded_images.images, SizeIs(kNumFrames));
+
+  class DecodedFrames : public DecodedImageCallback {
+   public:
+    int32_t Decoded(VideoFrame& decoded_image) override {
+      frames.push_back(decoded_image.video_frame_buffer()->ToI420());
+      return 0;
+    }
+    void Decoded(VideoFrame& decoded_image,
+                 absl::optional<int32_t> /*decode_time_ms*/,
+                 absl::optional<uint8_t> /*qp*/) override {
+      Decoded(decoded_image);
+    }
+
+    std::vector<rtc::scoped_refptr<I420BufferInterface>> frames;
+  } decoded_frames;
+  std::unique_ptr<VideoDecoder> decoder = CreateLibaomAv1Decoder();
+  ASSERT_EQ(decoder->InitDecode(/*codec_settings=*/nullptr,
+                                /*number_of_cores=*/1),
+            WEBRTC_VIDEO_CODEC_OK);
+  decoder->RegisterDecodeCompleteCallback(&decoded_frames);
+  for (const EncodedImage& encoded_image : encoded_images.images) {
+    ASSERT_EQ(decoder->Decode(encoded_image, /*missing_frames=*/false,
+                              /*render_time_ms=*/0),
+              WEBRTC_VIDEO_CODEC_OK);
+  }
+  ASSERT_THAT(decoded_frames.frames, SizeIs(kNumFrames));
+
+  // Number of blocks which luma changed between frames |i - 1| and |i|.
+  auto changed_blocks = [&](int i) {
+    const I420BufferInterface& previous = *decoded_frames.frames[i - 1];
+    const I420BufferInterface& current = *decoded_frames.frames[i];
+    int changed = 0;
+    for (int row = 0; row < kRows; ++row) {
+      for (int col = 0; col < kCols; ++col) {
+        int diff = 0;
+        for (int y = row * kBlockSize;
+             y < std::min((row + 1) * kBlockSize, kHeight); ++y) {
+          for (int x = col * kBlockSize;
+               x < std::min((col + 1) * kBlockSize, kWidth); ++x) {
+            diff += std::abs(previous.DataY()[y * previous.StrideY() + x] -
+                             current.DataY()[y * current.StrideY() + x]);
+          }
+        }
+        // Allows for small changes by the loop filters.
+        if (diff > kBlockSize * kBlockSize) {
+          ++changed;
+        }
+      }
+    }
+    return changed;
+  };
+
+  // The blocks of the key frame are kept active for a few frames.
+  EXPECT_EQ(changed_blocks(1), kRows * kCols);
+  // Then only the updated block and one refreshed row are encoded.
+  for (int i = UpdateRectActiveMap::kActiveFramesAfterUpdate + 1;
+       i < kNumFrames; ++i) {
+    EXPECT_LE(changed_blocks(i), 1 + kCols) << "frame " << i;
+  }
+}
+
+// Decodes 720p frames while holding on to the last few decoded frames, as a
+// renderer would, and reports the buffers allocated and the bytes copied per
+// decoded frame, as counted by the decoder's buffer pools, and the time spent
+// per decoded frame.
+TEST(LibaomAv1Test, DISABLED_DecodedFrameBufferReuse) {
+  constexpr int kNumFrames = 300;
+  constexpr size_t kFramesInFlight = 5;
+  // Buffers are only allocated for the frames libaom holds as references or
+  // is decoding, and for those held by the application, so the number of
+  // allocations must not grow with the number of frames.
+  constexpr int kMaxAllocations = 24;
+  std::unique_ptr<VideoEncoder> encoder = CreateLibaomAv1Encoder();
+  VideoCodec codec_settings = DefaultCodecSettings();
+  codec_settings.width = 1280;
+  codec_settings.height = 720;
+  codec_settings.maxBitrate = 2000;
+  ASSERT_EQ(encoder->InitEncode(&codec_settings, DefaultEncoderSettings()),
+            WEBRTC_VIDEO_CODEC_OK);
+  std::vector<EncodedVideoFrameProducer::EncodedFrame> encoded_frames =
+      EncodedVideoFrameProducer(*encoder)
+          .SetNumInputFrames(kNumFrames)
+          .SetResolution({1280, 720})
+          .Encode();
+  ASSERT_THAT(encoded_frames, Not(IsEmpty()));
+
+  class HoldingCallback : public DecodedImageCallback {
+   public:
+    int32_t Decoded(VideoFrame& decoded_image) override {
+      Decoded(decoded_image, absl::nullopt, absl::nullopt);
+      return 0;
+    }
+    void Decoded(VideoFrame& decoded_image,
+                 absl::optional<int32_t> /*decode_time_ms*/,
+                 absl::optional<uint8_t> /*qp*/) override {
+      frames_in_flight.push_back(decoded_image);
+      if (frames_in_flight.size() > kFramesInFlight) {
+        frames_in_flight.pop_front();
+      }
+      ++num_decoded;
+    }
+
+    std::deque<VideoFrame> frames_in_flight;
+    int num_decoded = 0;
+  } callback;
+
+  LibaomAv1DecoderBufferStats stats;
+  std::unique_ptr<VideoDecoder> decoder =
+      CreateLibaomAv1DecoderForTesting(&stats);
+  ASSERT_EQ(decoder->InitDecode(/*codec_settings=*/nullptr,
+                                /*number_of_cores=*/1),
+            WEBRTC_VIDEO_CODEC_OK);
+  decoder->RegisterDecodeCompleteCallback(&callback);
+  const int64_t start_us = rtc::TimeMicros();
+  for (const auto& frame : encoded_frames) {
+    ASSERT_EQ(decoder->Decode(frame.encoded_image, /*missing_frames=*/false,
+                              /*render_time_ms=*/0),
+              WEBRTC_VIDEO_CODEC_OK);
+  }
+  const int64_t elapsed_us = rtc::TimeMicros() - start_us;
+  ASSERT_GT(callback.num_decoded, 0);
+  printf("%d frames decoded, %.3f buffer allocations and %.0f bytes copied "
+         "per frame, %.2f ms per frame.\n",
+         callback.num_decoded,
+         static_cast<double>(stats.num_allocations) / callback.num_decoded,
+         static_cast<double>(stats.bytes_copied) / callback.num_decoded,
+         elapsed_us / 1000.0 / callback.num_decoded);
+  EXPECT_LE(stats.num_allocations, kMaxAllocations);
+  // Without film grain all images are decoded into the pool.
+  EXPECT_EQ(stats.bytes_copied, 0);
+  callback.frames_in_flight.clear();
+  decoder->Release();
+}
+
 struct LayerId {
   friend bool operator==(const LayerId& lhs, const LayerId& rhs) {
     return std::tie(lhs.spatial_id, lhs.temporal_id) ==
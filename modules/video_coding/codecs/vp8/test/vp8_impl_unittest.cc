@@ -244,6 +244,46 @@ TEST_F(TestVp8Impl, EncodeI420FrameAfterNv12Frame) {
             encoder_->Encode(NextInputFrame(), nullptr));
 }
 
+// Measures capture to encode time for a synthetic 720p NV12 source, with the
+// frames either passed to the encoder as is or first converted to I420, as
+// happens in pipelines which are not NV12 aware.
+TEST_F(TestVp8Impl, DISABLED_Nv12CaptureToEncodeBenchmark) {
+  constexpr int kBenchmarkWidth = 1280;
+  constexpr int kBenchmarkHeight = 720;
+  constexpr int kNumFrames = 300;
+  codec_settings_.width = kBenchmarkWidth;
+  codec_settings_.height = kBenchmarkHeight;
+  codec_settings_.startBitrate = 1500;
+  codec_settings_.maxBitrate = 2500;
+
+  for (bool convert_to_i420 : {true, false}) {
+    EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK, encoder_->Release());
+    EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK,
+              encoder_->InitEncode(&codec_settings_, kSettings));
+    input_frame_generator_ = test::CreateSquareFrameGenerator(
+        kBenchmarkWidth, kBenchmarkHeight,
+        test::FrameGeneratorInterface::OutputType::kNV12, absl::nullopt);
+
+    int64_t total_time_us = 0;
+    for (int i = 0; i < kNumFrames; ++i) {
+      VideoFrame input_frame = NextInputFrame();
+      const int64_t start_us = rtc::TimeMicros();
+      if (convert_to_i420) {
+        input_frame.set_video_frame_buffer(
+            input_frame.video_frame_buffer()->ToI420());
+      }
+      EncodedImage encoded_frame;
+      CodecSpecificInfo codec_specific_info;
+      EncodeAndWaitForFrame(input_frame, &encoded_frame, &codec_specific_info,
+                            /*keyframe=*/i == 0);
+      total_time_us += rtc::TimeMicros() - start_us;
+    }
+    printf("NV12 %s: %.1f us per frame.\n",
+           convert_to_i420 ? "converted to I420" : "encoded natively",
+           static_cast<double>(total_time_us) / kNumFrames);
+  }
+}
+
 TEST_F(TestVp8Impl, InitDecode) {
   EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK, decoder_->Release());
   EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK,
@@ -240,7 +240,11 @@ LibvpxVp9Encoder::LibvpxVp9Encoder(const cricket::VideoCodec& codec,
                             "Disabled")),
       performance_flags_(ParsePerformanceFlagsFromTrials(trials)),
       num_steady_state_frames_(0),
-      config_changed_(true) {
+      config_changed_(true),
+      use_active_map_(
+          absl::StartsWith(trials.Lookup("WebRTC-Vp9ActiveMapFromUpdateRect"),
+                           "Enabled")),
+      active_map_set_(false) {
   codec_ = {};
   memset(&svc_params_, 0, sizeof(vpx_svc_extra_cfg_t));
 }
@@ -485,6 +489,8 @@ int LibvpxVp9Encoder::InitEncode(const VideoCodec* inst,
 
   force_key_frame_ = true;
   pics_since_key_ = 0;
+  active_map_.Reset();
+  active_map_set_ = false;
 
   num_spatial_layers_ = inst->VP9().numberOfSpatialLayers;
   RTC_DCHECK_GT(num_spatial_layers_, 0);
@@ -880,6 +886,11 @@ int LibvpxVp9Encoder::Encode(const VideoFrame& input_image,
     // All spatial layers are disabled, return without encoding anything.
     return WEBRTC_VIDEO_CODEC_OK;
   }
+  if (use_active_map_) {
+    // Accumulated before any frame drop, since the next encoded frame has to
+    // include the areas updated in dropped frames.
+    active_map_.Update(input_image);
+  }
 
   // We only support one stream at the moment.
   if (frame_types && !frame_types->empty()) {
@@ -1135,6 +1146,9 @@ int LibvpxVp9Encoder::Encode(const VideoFrame& input_image,
                          .GetTargetRate())
           : codec_.maxFramerate;
   uint32_t duration = static_cast<uint32_t>(90000 / target_framerate_fps);
+  if (use_active_map_) {
+    SetActiveMap();
+  }
   const vpx_codec_err_t rv = libvpx_->codec_encode(
       encoder_, raw_, timestamp_, duration, flags, VPX_DL_REALTIME);
   if (rv != VPX_CODEC_OK) {
@@ -1155,6 +1169,30 @@ int LibvpxVp9Encoder::Encode(const VideoFrame& input_image,
   return WEBRTC_VIDEO_CODEC_OK;
 }
 
+void LibvpxVp9Encoder::SetActiveMap() {
+  // Skipping blocks relies on the frame referencing the previous one.
+  const bool skip_blocks = codec_.mode == VideoCodecMode::kScreensharing &&
+                           num_spatial_layers_ == 1 &&
+                           num_temporal_layers_ == 1 && !force_key_frame_ &&
+                           active_map_.HasInactiveBlocks();
+  if (!skip_blocks && !active_map_set_) {
+    return;
+  }
+  vpx_active_map_t active_map;
+  // A null map makes all blocks active.
+  active_map.active_map = skip_blocks ? active_map_.map() : nullptr;
+  active_map.rows = active_map_.rows();
+  active_map.cols = active_map_.cols();
+  if (libvpx_->codec_control(encoder_, VP8E_SET_ACTIVEMAP, &active_map) !=
+      VPX_CODEC_OK) {
+    RTC_LOG(LS_WARNING) << "Failed to set active map of " << active_map.cols
+                        << "x" << active_map.rows << " blocks.";
+    active_map_set_ = false;
+    return;
+  }
+  active_map_set_ = skip_blocks;
+}
+
 bool LibvpxVp9Encoder::PopulateCodecSpecific(CodecSpecificInfo* codec_specific,
                                              absl::optional<int>* spatial_idx,
                                              const vpx_codec_cx_pkt& pkt,
@@ -1564,6 +1602,7 @@ void LibvpxVp9Encoder::GetEncodedLayerFrame(const vpx_codec_cx_pkt* pkt) {
     // Ignore dropped frame.
     return;
   }
+  active_map_.OnFrameEncoded();
 
   vpx_svc_layer_id_t layer_id = {0};
   libvpx_->codec_control(encoder_, VP9E_GET_SVC_LAYER_ID, &layer_id);
@@ -28,6 +28,7 @@
 #include "modules/video_coding/codecs/vp9/vp9_frame_buffer_pool.h"
 #include "modules/video_coding/svc/scalable_video_controller.h"
 #include "modules/video_coding/utility/framerate_controller.h"
+#include "modules/video_coding/utility/update_rect_active_map.h"
 #include "rtc_base/experiments/encoder_info_settings.h"
 #include "vpx/vp8cx.h"
 
@@ -90,6 +91,10 @@ class LibvpxVp9Encoder : public VP9Encoder {
 
   void DeliverBufferedFrame(bool end_of_picture);
 
+  // Lets libvpx skip the blocks outside of the update rects of the frames
+  // since the last encoded one, for single layer screenshare.
+  void SetActiveMap();
+
   bool DropFrame(uint8_t spatial_idx, uint32_t rtp_timestamp);
 
   // Determine maximum target for Intra frames
@@ -238,6 +243,10 @@ class LibvpxVp9Encoder : public VP9Encoder {
   // Only set config when this flag is set.
   bool config_changed_;
 
+  const bool use_active_map_;
+  UpdateRectActiveMap active_map_;
+  bool active_map_set_;
+
   const LibvpxVp9EncoderInfoSettings encoder_info_override_;
 };
 
@@ -8,7 +8,10 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <algorithm>
+
 #include "absl/memory/memory.h"
+#include "absl/types/optional.h"
 #include "api/test/create_frame_generator.h"
 #include "api/test/frame_generator_interface.h"
 #include "api/test/mock_video_encoder.h"
@@ -25,6 +28,7 @@
 #include "modules/video_coding/codecs/vp9/include/vp9.h"
 #include "modules/video_coding/codecs/vp9/libvpx_vp9_encoder.h"
 #include "modules/video_coding/codecs/vp9/svc_config.h"
+#include "modules/video_coding/utility/update_rect_active_map.h"
 #include "rtc_base/strings/string_builder.h"
 #include "test/explicit_key_value_config.h"
 #include "test/field_trial.h"
@@ -2468,4 +2472,114 @@ TEST(Vp9SpeedSettingsTrialsTest, PerLayerFlagsWithSvc) {
   }
 }
 
+TEST(Vp9ActiveMapTest, SkipsBlocksOutsideOfUpdateRects) {
+  test::ExplicitKeyValueConfig trials(
+      "WebRTC-Vp9ActiveMapFromUpdateRect/Enabled/");
+
+  // Keep a raw pointer for EXPECT calls and the like. Ownership is otherwise
+  // passed on to LibvpxVp9Encoder.
+  auto* const vpx = new NiceMock<MockLibvpxInterface>();
+  LibvpxVp9Encoder encoder(cricket::VideoCodec(),
+                           absl::WrapUnique<LibvpxInterface>(vpx), trials);
+
+  VideoCodec settings = DefaultCodecSettings();
+  settings.mode = VideoCodecMode::kScreensharing;
+  ConfigureSvc(settings, /*num_spatial_layers=*/1);
+  vpx_image_t img;
+
+  ON_CALL(*vpx, img_wrap).WillByDefault(GetWrapImageFunction(&img));
+  ON_CALL(*vpx, codec_enc_config_default)
+      .WillByDefault(DoAll(WithArg<1>([](vpx_codec_enc_cfg_t* cfg) {
+                             memset(cfg, 0, sizeof(vpx_codec_enc_cfg_t));
+                           }),
+                           Return(VPX_CODEC_OK)));
+  ON_CALL(*vpx, codec_encode).WillByDefault(Return(VPX_CODEC_OK));
+
+  // Capture the callback into the vp9 wrapper.
+  vpx_codec_priv_output_cx_pkt_cb_pair_t callback_pointer = {};
+  EXPECT_CALL(*vpx, codec_control(_, VP9E_REGISTER_CX_CALLBACK, A<void*>()))
+      .WillOnce(WithArg<2>([&](void* cbp) {
+        callback_pointer =
+            *reinterpret_cast<vpx_codec_priv_output_cx_pkt_cb_pair_t*>(cbp);
+        return VPX_CODEC_OK;
+      }));
+
+  // Copies of the active maps set, nullopt for a null map.
+  constexpr unsigned int kRows = (kHeight + 15) / 16;
+  constexpr unsigned int kCols = (kWidth + 15) / 16;
+  std::vector<absl::optional<std::vector<uint8_t>>> active_maps;
+  ON_CALL(*vpx, codec_control(_, VP8E_SET_ACTIVEMAP, A<vpx_active_map*>()))
+      .WillByDefault(WithArg<2>([&](vpx_active_map* active_map) {
+        EXPECT_EQ(active_map->rows, kRows);
+        EXPECT_EQ(active_map->cols, kCols);
+        if (active_map->active_map) {
+          active_maps.emplace_back(std::vector<uint8_t>(
+              active_map->active_map,
+              active_map->active_map + kRows * kCols));
+        } else {
+          active_maps.emplace_back(absl::nullopt);
+        }
+        return VPX_CODEC_OK;
+      }));
+
+  EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK, encoder.InitEncode(&settings, kSettings));
+
+  NiceMock<MockEncodedImageCallback> callback;
+  ON_CALL(callback, OnEncodedImage)
+      .WillByDefault(Return(
+          EncodedImageCallback::Result(EncodedImageCallback::Result::OK)));
+  encoder.RegisterEncodeCompleteCallback(&callback);
+  auto frame_generator = test::CreateSquareFrameGenerator(
+      kWidth, kHeight, test::FrameGeneratorInterface::OutputType::kI420, 10);
+
+  uint8_t data[1] = {0};
+  vpx_codec_cx_pkt encoded_data = {};
+  encoded_data.data.frame.buf = &data;
+  encoded_data.data.frame.sz = 1;
+  // First frame is keyframe.
+  encoded_data.data.frame.flags = VPX_FRAME_IS_KEY;
+
+  uint32_t rtp_timestamp = 0;
+  auto encode = [&](absl::optional<VideoFrame::UpdateRect> update_rect) {
+    VideoFrame frame =
+        VideoFrame::Builder()
+            .set_video_frame_buffer(frame_generator->NextFrame().buffer)
+            .set_timestamp_rtp(rtp_timestamp)
+            .set_update_rect(update_rect)
+            .build();
+    // At half the max framerate, so that no frame is dropped.
+    rtp_timestamp += 2 * kVideoPayloadTypeFrequency / settings.maxFramerate;
+    EXPECT_EQ(WEBRTC_VIDEO_CODEC_OK, encoder.Encode(frame, nullptr));
+    callback_pointer.output_cx_pkt(&encoded_data, callback_pointer.user_priv);
+    encoded_data.data.frame.flags = 0;  // Following frames are delta frames.
+  };
+
+  // All blocks of the key frame are kept active for a few frames.
+  encode(absl::nullopt);
+  for (int i = 0; i < UpdateRectActiveMap::kActiveFramesAfterUpdate; ++i) {
+    encode(VideoFrame::UpdateRect{0, 0, 0, 0});
+  }
+  EXPECT_THAT(active_maps, IsEmpty());
+
+  // Then only the updated block and one refreshed row are active.
+  encode(VideoFrame::UpdateRect{0, 0, 16, 16});
+  ASSERT_THAT(active_maps, SizeIs(1));
+  ASSERT_TRUE(active_maps[0]);
+  EXPECT_EQ((*active_maps[0])[0], 1);
+  EXPECT_EQ((*active_maps[0])[1], 0);
+  EXPECT_EQ(std::count(active_maps[0]->begin(), active_maps[0]->end(), 1),
+            static_cast<int>(1 + kCols));
+
+  // The updated block is kept active in the next frame.
+  encode(VideoFrame::UpdateRect{0, 0, 0, 0});
+  ASSERT_THAT(active_maps, SizeIs(2));
+  ASSERT_TRUE(active_maps[1]);
+  EXPECT_EQ((*active_maps[1])[0], 1);
+
+  // A frame without update rect is entirely active again.
+  encode(absl::nullopt);
+  ASSERT_THAT(active_maps, SizeIs(3));
+  EXPECT_FALSE(active_maps[2]);
+}
+
 }  // namespace webrtc
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "modules/video_coding/utility/update_rect_active_map.h"
+
+namespace webrtc {
+
+constexpr int UpdateRectActiveMap::kBlockSize;
+constexpr int UpdateRectActiveMap::kActiveFramesAfterUpdate;
+
+UpdateRectActiveMap::UpdateRectActiveMap() = default;
+UpdateRectActiveMap::~UpdateRectActiveMap() = default;
+
+void UpdateRectActiveMap::Update(const VideoFrame& frame) {
+  if (frame.width() != width_ || frame.height() != height_) {
+    width_ = frame.width();
+    height_ = frame.height();
+    rows_ = (height_ + kBlockSize - 1) / kBlockSize;
+    cols_ = (width_ + kBlockSize - 1) / kBlockSize;
+    map_.resize(rows_ * cols_);
+    frames_since_update_.assign(rows_ * cols_, 0);
+    refreshed_row_ = 0;
+    full_update_ = true;
+  }
+  if (!frame.has_update_rect()) {
+    full_update_ = true;
+  }
+  if (!full_update_) {
+    VideoFrame::UpdateRect update_rect = frame.update_rect();
+    update_rect.Intersect(VideoFrame::UpdateRect{0, 0, width_, height_});
+    update_rect_.Union(update_rect);
+  }
+  BuildMap();
+}
+
+bool UpdateRectActiveMap::HasInactiveBlocks() const {
+  return active_blocks_ < rows_ * cols_;
+}
+
+void UpdateRectActiveMap::OnFrameEncoded() {
+  for (int row = 0; row < rows_; ++row) {
+    for (int col = 0; col < cols_; ++col) {
+      uint8_t& frames = frames_since_update_[row * cols_ + col];
+      if (IsUpdated(row, col)) {
+        frames = 0;
+      } else if (frames < kActiveFramesAfterUpdate) {
+        ++frames;
+      }
+    }
+  }
+  if (rows_ > 0) {
+    refreshed_row_ = (refreshed_row_ + 1) % rows_;
+  }
+  full_update_ = false;
+  update_rect_.MakeEmptyUpdate();
+}
+
+void UpdateRectActiveMap::Reset() {
+  full_update_ = true;
+}
+
+bool UpdateRectActiveMap::IsUpdated(int row, int col) const {
+  if (full_update_) {
+    return true;
+  }
+  if (update_rect_.IsEmpty()) {
+    return false;
+  }
+  const int first_row = update_rect_.offset_y / kBlockSize;
+  const int last_row =
+      (update_rect_.offset_y + update_rect_.height - 1) / kBlockSize;
+  const int first_col = update_rect_.offset_x / kBlockSize;
+  const int last_col =
+      (update_rect_.offset_x + update_rect_.width - 1) / kBlockSize;
+  return row >= first_row && row <= last_row && col >= first_col &&
+         col <= last_col;
+}
+
+void UpdateRectActiveMap::BuildMap() {
+  active_blocks_ = 0;
+  for (int row = 0; row < rows_; ++row) {
+    for (int col = 0; col < cols_; ++col) {
+      const int index = row * cols_ + col;
+      const bool active =
+          row == refreshed_row_ || IsUpdated(row, col) ||
+          frames_since_update_[index] < kActiveFramesAfterUpdate;
+      map_[index] = active ? 1 : 0;
+      active_blocks_ += active ? 1 : 0;
+    }
+  }
+}
+
+}  // namespace webrtc
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef MODULES_VIDEO_CODING_UTILITY_UPDATE_RECT_ACTIVE_MAP_H_
+#define MODULES_VIDEO_CODING_UTILITY_UPDATE_RECT_ACTIVE_MAP_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "api/video/video_frame.h"
+
+namespace webrtc {
+
+// Builds the active map of libvpx (VP8E_SET_ACTIVEMAP) and libaom
+// (AOME_SET_ACTIVEMAP) from VideoFrame::update_rect(). The map has one entry
+// per kBlockSize x kBlockSize block of the frame, 1 if the block has to be
+// encoded and 0 if it is unchanged and can be coded as skipped, i.e. copied
+// from the previous frame.
+//
+// Update rects are accumulated until OnFrameEncoded() is called, so that areas
+// updated in frames dropped by the encoder are still encoded in the next one.
+// Updated blocks stay active for |kActiveFramesAfterUpdate| encoded frames,
+// so that the encoder lowers their QP after the update instead of freezing
+// them at the QP of the update. One row of blocks is also refreshed in every
+// encoded frame, which refreshes the whole frame every |rows()| frames.
+// Skipping is only valid if the next frame references the previous encoded
+// frame, so this shouldn't be used with temporal or spatial layers.
+class UpdateRectActiveMap {
+ public:
+  static constexpr int kBlockSize = 16;
+  static constexpr int kActiveFramesAfterUpdate = 8;
+
+  UpdateRectActiveMap();
+  ~UpdateRectActiveMap();
+
+  // Adds the area updated in |frame| to the area to encode. Frames without an
+  // update rect, or with a different size than the previous frame, are
+  // entirely updated.
+  void Update(const VideoFrame& frame);
+
+  // Returns true if some blocks can be skipped in the next encoded frame. If
+  // so, the map is valid until the next call to Update().
+  bool HasInactiveBlocks() const;
+
+  // Clears the accumulated update rect and moves on to the next refreshed
+  // row, once a frame has been encoded.
+  void OnFrameEncoded();
+  // Makes the next frame entirely updated, e.g. for key frames.
+  void Reset();
+
+  uint8_t* map() { return map_.data(); }
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+
+ private:
+  bool IsUpdated(int row, int col) const;
+  void BuildMap();
+
+  int width_ = 0;
+  int height_ = 0;
+  int rows_ = 0;
+  int cols_ = 0;
+  bool full_update_ = true;
+  VideoFrame::UpdateRect update_rect_ = {0, 0, 0, 0};
+  int refreshed_row_ = 0;
+  int active_blocks_ = 0;
+  std::vector<uint8_t> map_;
+  // Encoded frames since each block was updated, up to
+  // |kActiveFramesAfterUpdate|.
+  std::vector<uint8_t> frames_since_update_;
+};
+
+}  // namespace webrtc
+
+#endif  // MODULES_VIDEO_CODING_UTILITY_UPDATE_RECT_ACTIVE_MAP_H_
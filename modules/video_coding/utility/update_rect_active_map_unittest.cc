@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "modules/video_coding/utility/update_rect_active_map.h"
+
+#include <vector>
+
+#include "api/video/i420_buffer.h"
+#include "test/gmock.h"
+#include "test/gtest.h"
+
+namespace webrtc {
+namespace {
+
+using ::testing::Each;
+
+constexpr int kWidth = 100;
+constexpr int kHeight = 40;
+
+VideoFrame CreateFrame(int width,
+                       int height,
+                       const VideoFrame::UpdateRect& update_rect) {
+  return VideoFrame::Builder()
+      .set_video_frame_buffer(I420Buffer::Create(width, height))
+      .set_update_rect(update_rect)
+      .build();
+}
+
+int CountActiveBlocks(UpdateRectActiveMap* active_map) {
+  int count = 0;
+  for (int i = 0; i < active_map->rows() * active_map->cols(); ++i) {
+    count += active_map->map()[i];
+  }
+  return count;
+}
+
+// Encodes a full frame, then frames without updates until its blocks are no
+// longer kept active. Row 0 is refreshed in the next frame.
+void EncodeFullFrameAndSettle(UpdateRectActiveMap* active_map) {
+  active_map->Update(CreateFrame(kWidth, kHeight, {0, 0, kWidth, kHeight}));
+  active_map->OnFrameEncoded();
+  for (int i = 0; i < UpdateRectActiveMap::kActiveFramesAfterUpdate; ++i) {
+    active_map->Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+    active_map->OnFrameEncoded();
+  }
+}
+
+}  // namespace
+
+TEST(UpdateRectActiveMap, FirstFrameIsFullyActive) {
+  UpdateRectActiveMap active_map;
+  active_map.Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+  EXPECT_EQ(active_map.rows(), 3);
+  EXPECT_EQ(active_map.cols(), 7);
+  EXPECT_FALSE(active_map.HasInactiveBlocks());
+  EXPECT_EQ(CountActiveBlocks(&active_map), 21);
+}
+
+TEST(UpdateRectActiveMap, MarksBlocksOfUpdateRect) {
+  UpdateRectActiveMap active_map;
+  EncodeFullFrameAndSettle(&active_map);
+
+  // Covers columns 1 and 2 of row 1.
+  active_map.Update(CreateFrame(kWidth, kHeight, {20, 16, 20, 10}));
+  EXPECT_TRUE(active_map.HasInactiveBlocks());
+  // The update and the refreshed row 0.
+  EXPECT_EQ(CountActiveBlocks(&active_map), 2 + 7);
+  EXPECT_EQ(active_map.map()[1 * 7 + 0], 0);
+  EXPECT_EQ(active_map.map()[1 * 7 + 1], 1);
+  EXPECT_EQ(active_map.map()[1 * 7 + 2], 1);
+  EXPECT_EQ(active_map.map()[1 * 7 + 3], 0);
+}
+
+TEST(UpdateRectActiveMap, KeepsUpdatedBlocksActive) {
+  UpdateRectActiveMap active_map;
+  EncodeFullFrameAndSettle(&active_map);
+
+  // Covers column 0 of row 1.
+  active_map.Update(CreateFrame(kWidth, kHeight, {0, 16, 1, 1}));
+  active_map.OnFrameEncoded();
+  for (int i = 0; i < UpdateRectActiveMap::kActiveFramesAfterUpdate; ++i) {
+    active_map.Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+    EXPECT_EQ(active_map.map()[1 * 7 + 0], 1);
+    active_map.OnFrameEncoded();
+  }
+
+  // Row 0 is refreshed in this frame, not row 1.
+  active_map.Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+  EXPECT_EQ(active_map.map()[1 * 7 + 0], 0);
+}
+
+TEST(UpdateRectActiveMap, RefreshesOneRowPerFrame) {
+  UpdateRectActiveMap active_map;
+  EncodeFullFrameAndSettle(&active_map);
+
+  std::vector<int> refreshes(3 * 7);
+  for (int i = 0; i < 3; ++i) {
+    active_map.Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+    EXPECT_TRUE(active_map.HasInactiveBlocks());
+    EXPECT_EQ(CountActiveBlocks(&active_map), 7);
+    for (int j = 0; j < 3 * 7; ++j) {
+      refreshes[j] += active_map.map()[j];
+    }
+    active_map.OnFrameEncoded();
+  }
+  // Each block has been refreshed once.
+  EXPECT_THAT(refreshes, Each(1));
+}
+
+TEST(UpdateRectActiveMap, AccumulatesUntilFrameIsEncoded) {
+  UpdateRectActiveMap active_map;
+  EncodeFullFrameAndSettle(&active_map);
+
+  active_map.Update(CreateFrame(kWidth, kHeight, {0, 32, 1, 1}));
+  // The previous frame was dropped by the encoder.
+  active_map.Update(CreateFrame(kWidth, kHeight, {99, 32, 1, 1}));
+  // The bounding box of both updates covers row 2, and row 0 is refreshed.
+  EXPECT_EQ(CountActiveBlocks(&active_map), 2 * 7);
+  EXPECT_EQ(active_map.map()[1 * 7 + 0], 0);
+
+  // Both updates are kept active after the frame is encoded.
+  active_map.OnFrameEncoded();
+  active_map.Update(CreateFrame(kWidth, kHeight, {0, 0, 0, 0}));
+  EXPECT_EQ(active_map.map()[2 * 7 + 0], 1);
+  EXPECT_EQ(active_map.map()[2 * 7 + 6], 1);
+}
+
+TEST(UpdateRectActiveMap, SizeChangeAndResetActivateAllBlocks) {
+  UpdateRectActiveMap active_map;
+  EncodeFullFrameAndSettle(&active_map);
+
+  active_map.Update(CreateFrame(2 * kWidth, kHeight, {0, 0, 0, 0}));
+  EXPECT_FALSE(active_map.HasInactiveBlocks());
+  active_map.OnFrameEncoded();
+
+  active_map.Reset();
+  active_map.Update(CreateFrame(2 * kWidth, kHeight, {0, 0, 0, 0}));
+  EXPECT_FALSE(active_map.HasInactiveBlocks());
+}
+
+}  // namespace webrtc
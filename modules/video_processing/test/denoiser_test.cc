@@ -21,16 +21,51 @@
 #include "modules/video_processing/util/denoiser_filter.h"
 #include "modules/video_processing/util/skin_detection.h"
 #include "modules/video_processing/video_denoiser.h"
+#include "rtc_base/random.h"
+#include "rtc_base/system/arch.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/cpu_features_wrapper.h"
+#include "system_wrappers/include/cpu_info.h"
 #include "test/frame_utils.h"
 #include "test/gtest.h"
 #include "test/testsupport/file_utils.h"
 
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+#include "modules/video_processing/util/denoiser_filter_avx2.h"
+#include "modules/video_processing/util/denoiser_filter_sse2.h"
+#endif
+
 namespace webrtc {
+namespace {
 
-TEST(VideoDenoiserTest, Variance) {
+// Creates a frame with a gradient background, a square that moves with
+// |frame_index| and some noise.
+rtc::scoped_refptr<I420Buffer> CreateNoisyFrame(int width,
+                                                int height,
+                                                int frame_index,
+                                                Random* random) {
+  rtc::scoped_refptr<I420Buffer> buffer = I420Buffer::Create(width, height);
+  const int square_x = (frame_index * 8) % (width / 2);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      int value = (x + y) % 200 + 20;
+      if (x >= square_x && x < square_x + width / 4 && y >= height / 4 &&
+          y < height / 2) {
+        value = 230;
+      }
+      buffer->MutableDataY()[y * buffer->StrideY() + x] =
+          value + random->Rand(-5, 5);
+    }
+  }
+  const int chroma_height = (height + 1) / 2;
+  memset(buffer->MutableDataU(), 128, buffer->StrideU() * chroma_height);
+  memset(buffer->MutableDataV(), 128, buffer->StrideV() * chroma_height);
+  return buffer;
+}
+
+// Checks that |df_simd| computes the same variance as the C filter.
+void ExpectVarianceMatchesC(DenoiserFilter* df_simd) {
   std::unique_ptr<DenoiserFilter> df_c(DenoiserFilter::Create(false, nullptr));
-  std::unique_ptr<DenoiserFilter> df_sse_neon(
-      DenoiserFilter::Create(true, nullptr));
   uint8_t src[16 * 16], dst[16 * 16];
   uint32_t sum = 0, sse = 0, var;
   for (int i = 0; i < 16; ++i) {
@@ -48,15 +83,14 @@ TEST(VideoDenoiserTest, Variance) {
   var = sse - ((sum * sum) >> 7);
   memset(dst, 0, 16 * 16);
   EXPECT_EQ(var, df_c->Variance16x8(src, 16, dst, 16, &sse));
-  EXPECT_EQ(var, df_sse_neon->Variance16x8(src, 16, dst, 16, &sse));
+  EXPECT_EQ(var, df_simd->Variance16x8(src, 16, dst, 16, &sse));
 }
 
-TEST(VideoDenoiserTest, MbDenoise) {
+// Checks that |df_simd| filters blocks like the C filter.
+void ExpectMbDenoiseMatchesC(DenoiserFilter* df_simd) {
   std::unique_ptr<DenoiserFilter> df_c(DenoiserFilter::Create(false, nullptr));
-  std::unique_ptr<DenoiserFilter> df_sse_neon(
-      DenoiserFilter::Create(true, nullptr));
   uint8_t running_src[16 * 16], src[16 * 16];
-  uint8_t dst[16 * 16], dst_sse_neon[16 * 16];
+  uint8_t dst[16 * 16], dst_simd[16 * 16];
 
   // Test case: |diff| <= |3 + shift_inc1|
   for (int i = 0; i < 16; ++i) {
@@ -67,9 +101,9 @@ TEST(VideoDenoiserTest, MbDenoise) {
   }
   memset(dst, 0, 16 * 16);
   df_c->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
-  memset(dst_sse_neon, 0, 16 * 16);
-  df_sse_neon->MbDenoise(running_src, 16, dst_sse_neon, 16, src, 16, 0, 1);
-  EXPECT_EQ(0, memcmp(dst, dst_sse_neon, 16 * 16));
+  memset(dst_simd, 0, 16 * 16);
+  df_simd->MbDenoise(running_src, 16, dst_simd, 16, src, 16, 0, 1);
+  EXPECT_EQ(0, memcmp(dst, dst_simd, 16 * 16));
 
   // Test case: |diff| >= |4 + shift_inc1|
   for (int i = 0; i < 16; ++i) {
@@ -80,9 +114,9 @@ TEST(VideoDenoiserTest, MbDenoise) {
   }
   memset(dst, 0, 16 * 16);
   df_c->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
-  memset(dst_sse_neon, 0, 16 * 16);
-  df_sse_neon->MbDenoise(running_src, 16, dst_sse_neon, 16, src, 16, 0, 1);
-  EXPECT_EQ(0, memcmp(dst, dst_sse_neon, 16 * 16));
+  memset(dst_simd, 0, 16 * 16);
+  df_simd->MbDenoise(running_src, 16, dst_simd, 16, src, 16, 0, 1);
+  EXPECT_EQ(0, memcmp(dst, dst_simd, 16 * 16));
 
   // Test case: |diff| >= 8
   for (int i = 0; i < 16; ++i) {
@@ -93,9 +127,9 @@ TEST(VideoDenoiserTest, MbDenoise) {
   }
   memset(dst, 0, 16 * 16);
   df_c->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
-  memset(dst_sse_neon, 0, 16 * 16);
-  df_sse_neon->MbDenoise(running_src, 16, dst_sse_neon, 16, src, 16, 0, 1);
-  EXPECT_EQ(0, memcmp(dst, dst_sse_neon, 16 * 16));
+  memset(dst_simd, 0, 16 * 16);
+  df_simd->MbDenoise(running_src, 16, dst_simd, 16, src, 16, 0, 1);
+  EXPECT_EQ(0, memcmp(dst, dst_simd, 16 * 16));
 
   // Test case: |diff| > 15
   for (int i = 0; i < 16; ++i) {
@@ -108,10 +142,48 @@ TEST(VideoDenoiserTest, MbDenoise) {
   DenoiserDecision decision =
       df_c->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
   EXPECT_EQ(COPY_BLOCK, decision);
-  decision = df_sse_neon->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
+  decision = df_simd->MbDenoise(running_src, 16, dst, 16, src, 16, 0, 1);
   EXPECT_EQ(COPY_BLOCK, decision);
 }
 
+// Returns the SSE2 filter on x86 and the NEON one where available, even if
+// DenoiserFilter::Create() would pick another one.
+std::unique_ptr<DenoiserFilter> CreateSse2OrNeonFilter() {
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+  return std::make_unique<DenoiserFilterSSE2>();
+#else
+  return DenoiserFilter::Create(true, nullptr);
+#endif
+}
+
+}  // namespace
+
+TEST(VideoDenoiserTest, Variance) {
+  ExpectVarianceMatchesC(CreateSse2OrNeonFilter().get());
+}
+
+TEST(VideoDenoiserTest, MbDenoise) {
+  ExpectMbDenoiseMatchesC(CreateSse2OrNeonFilter().get());
+}
+
+#if defined(WEBRTC_ARCH_X86_FAMILY)
+TEST(VideoDenoiserTest, VarianceAVX2) {
+  if (!GetCPUInfo(kAVX2)) {
+    GTEST_SKIP() << "AVX2 is not supported.";
+  }
+  DenoiserFilterAVX2 df_avx2;
+  ExpectVarianceMatchesC(&df_avx2);
+}
+
+TEST(VideoDenoiserTest, MbDenoiseAVX2) {
+  if (!GetCPUInfo(kAVX2)) {
+    GTEST_SKIP() << "AVX2 is not supported.";
+  }
+  DenoiserFilterAVX2 df_avx2;
+  ExpectMbDenoiseMatchesC(&df_avx2);
+}
+#endif
+
 TEST(VideoDenoiserTest, Denoiser) {
   const int kWidth = 352;
   const int kHeight = 288;
@@ -124,7 +196,7 @@ TEST(VideoDenoiserTest, Denoiser) {
 
   // Create pure C denoiser.
   VideoDenoiser denoiser_c(false);
-  // Create SSE or NEON denoiser.
+  // Create SIMD denoiser.
   VideoDenoiser denoiser_sse_neon(true);
 
   for (;;) {
@@ -138,11 +210,80 @@ TEST(VideoDenoiserTest, Denoiser) {
     rtc::scoped_refptr<I420BufferInterface> denoised_frame_sse_neon(
         denoiser_sse_neon.DenoiseFrame(video_frame_buffer, false));
 
-    // Denoising results should be the same for C and SSE/NEON denoiser.
+    // Denoising results should be the same for C and SIMD denoiser.
     ASSERT_TRUE(
         test::FrameBufsEqual(denoised_frame_c, denoised_frame_sse_neon));
   }
   ASSERT_NE(0, feof(source_file)) << "Error reading source file";
 }
 
+TEST(VideoDenoiserTest, MultiThreadedAndInPlaceMatchSingleThreaded) {
+  // Not a multiple of 16 in either dimension, and large enough for three
+  // bands.
+  const int kWidth = 1288;
+  const int kHeight = 728;
+  Random random(0x1234);
+  VideoDenoiser denoiser(true);
+  VideoDenoiser denoiser_multi_threaded(true, /*num_threads=*/4);
+  VideoDenoiser denoiser_in_place(true, /*num_threads=*/4);
+
+  for (int i = 0; i < 10; ++i) {
+    rtc::scoped_refptr<I420Buffer> frame =
+        CreateNoisyFrame(kWidth, kHeight, i, &random);
+    rtc::scoped_refptr<I420BufferInterface> denoised_frame(
+        denoiser.DenoiseFrame(frame, true));
+    rtc::scoped_refptr<I420BufferInterface> denoised_frame_multi_threaded(
+        denoiser_multi_threaded.DenoiseFrame(frame, true));
+    rtc::scoped_refptr<I420BufferInterface> denoised_frame_in_place(
+        denoiser_in_place.DenoiseFrameInPlace(I420Buffer::Copy(*frame), true));
+
+    ASSERT_TRUE(
+        test::FrameBufsEqual(denoised_frame, denoised_frame_multi_threaded));
+    ASSERT_TRUE(test::FrameBufsEqual(denoised_frame, denoised_frame_in_place));
+  }
+}
+
+// Prints the average time to denoise a frame at different resolutions, on one
+// thread and on one thread per core, into a new buffer and in place.
+TEST(VideoDenoiserTest, DISABLED_DenoiseFramePerformance) {
+  const int kNumFrames = 30;
+  const struct {
+    int width;
+    int height;
+  } kResolutions[] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  const int num_cores = CpuInfo::DetectNumberOfCores();
+
+  for (const auto& resolution : kResolutions) {
+    Random random(0x1234);
+    // Alternate between two frames, so that each frame differs from the
+    // previous one.
+    rtc::scoped_refptr<I420Buffer> frames[] = {
+        CreateNoisyFrame(resolution.width, resolution.height, 0, &random),
+        CreateNoisyFrame(resolution.width, resolution.height, 1, &random)};
+    for (int num_threads : {1, num_cores}) {
+      for (bool in_place : {false, true}) {
+        VideoDenoiser denoiser(true, num_threads);
+        int64_t total_us = 0;
+        for (int i = 0; i < kNumFrames; ++i) {
+          rtc::scoped_refptr<I420Buffer> frame =
+              in_place ? I420Buffer::Copy(*frames[i % 2]) : frames[i % 2];
+          const int64_t start_us = rtc::TimeMicros();
+          if (in_place) {
+            denoiser.DenoiseFrameInPlace(frame, true);
+          } else {
+            denoiser.DenoiseFrame(frame, true);
+          }
+          // The first frame only initializes the denoiser.
+          if (i > 0) {
+            total_us += rtc::TimeMicros() - start_us;
+          }
+        }
+        printf("%dx%d, %d thread(s)%s: %.1f us per frame\n", resolution.width,
+               resolution.height, num_threads, in_place ? ", in place" : "",
+               static_cast<double>(total_us) / (kNumFrames - 1));
+      }
+    }
+  }
+}
+
 }  // namespace webrtc
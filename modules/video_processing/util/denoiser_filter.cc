@@ -16,6 +16,7 @@
 #include "system_wrappers/include/cpu_features_wrapper.h"
 
 #if defined(WEBRTC_ARCH_X86_FAMILY)
+#include "modules/video_processing/util/denoiser_filter_avx2.h"
 #include "modules/video_processing/util/denoiser_filter_sse2.h"
 #elif defined(WEBRTC_HAS_NEON)
 #include "modules/video_processing/util/denoiser_filter_neon.h"
@@ -37,16 +38,20 @@ std::unique_ptr<DenoiserFilter> DenoiserFilter::Create(
   if (runtime_cpu_detection) {
 // If we know the minimum architecture at compile time, avoid CPU detection.
 #if defined(WEBRTC_ARCH_X86_FAMILY)
+    if (GetCPUInfo(kAVX2)) {
+      filter.reset(new DenoiserFilterAVX2());
+    } else {
 #if defined(__SSE2__)
-    filter.reset(new DenoiserFilterSSE2());
-#else
-    // x86 CPU detection required.
-    if (GetCPUInfo(kSSE2)) {
       filter.reset(new DenoiserFilterSSE2());
-    } else {
-      filter.reset(new DenoiserFilterC());
-    }
+#else
+      // x86 CPU detection required.
+      if (GetCPUInfo(kSSE2)) {
+        filter.reset(new DenoiserFilterSSE2());
+      } else {
+        filter.reset(new DenoiserFilterC());
+      }
 #endif
+    }
 #elif defined(WEBRTC_HAS_NEON)
     filter.reset(new DenoiserFilterNEON());
     if (cpu_type != nullptr)
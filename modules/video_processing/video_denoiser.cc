@@ -13,7 +13,11 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <algorithm>
+#include <utility>
+
 #include "api/video/i420_buffer.h"
+#include "rtc_base/checks.h"
 #include "third_party/libyuv/include/libyuv/planar_functions.h"
 
 namespace webrtc {
@@ -63,11 +67,22 @@ static void ShowRect(const std::unique_ptr<DenoiserFilter>& filter,
 }
 #endif
 
+constexpr int VideoDenoiser::kMinBlocksPerThread;
+
 VideoDenoiser::VideoDenoiser(bool runtime_cpu_detection)
+    : VideoDenoiser(runtime_cpu_detection, 1) {}
+
+VideoDenoiser::VideoDenoiser(bool runtime_cpu_detection, int num_threads)
     : width_(0),
       height_(0),
       filter_(DenoiserFilter::Create(runtime_cpu_detection, &cpu_type_)),
-      ne_(new NoiseEstimation()) {}
+      ne_(new NoiseEstimation()),
+      num_threads_(num_threads),
+      band_pool_("VideoDenoiserThread") {
+  RTC_DCHECK_GT(num_threads, 0);
+}
+
+VideoDenoiser::~VideoDenoiser() = default;
 
 void VideoDenoiser::DenoiserReset(
     rtc::scoped_refptr<I420BufferInterface> frame) {
@@ -83,6 +98,24 @@ void VideoDenoiser::DenoiserReset(
   x_density_.reset(new uint8_t[mb_cols_]);
   y_density_.reset(new uint8_t[mb_rows_]);
   moving_object_.reset(new uint8_t[mb_cols_ * mb_rows_]);
+  filtered_y_.reset();
+
+  // Split the frame into bands of whole macroblock rows.
+  const int num_bands =
+      std::max(1, std::min({num_threads_, mb_rows_,
+                            mb_rows_ * mb_cols_ / kMinBlocksPerThread}));
+  bands_.clear();
+  bands_.resize(num_bands);
+  for (int i = 0; i < num_bands; ++i) {
+    bands_[i].mb_row_begin = mb_rows_ * i / num_bands;
+    bands_[i].mb_row_end = mb_rows_ * (i + 1) / num_bands;
+    bands_[i].x_density.resize(mb_cols_);
+  }
+}
+
+void VideoDenoiser::ForEachBand(std::function<void(Band*)> job) {
+  band_pool_.Run(static_cast<int>(bands_.size()),
+                 [this, &job](int i) { job(&bands_[i]); });
 }
 
 int VideoDenoiser::PositionCheck(int mb_row, int mb_col, int noise_level) {
@@ -161,30 +194,59 @@ bool VideoDenoiser::IsTrailingBlock(const std::unique_ptr<uint8_t[]>& d_status,
   return ret;
 }
 
-void VideoDenoiser::CopySrcOnMOB(const uint8_t* y_src,
+bool VideoDenoiser::IsSrcBlock(int mb_row, int mb_col) {
+  const int mb_index = mb_row * mb_cols_ + mb_col;
+  return mb_filter_decision_[mb_index] != FILTER_BLOCK ||
+         IsTrailingBlock(moving_edge_, mb_row, mb_col) ||
+         (x_density_[mb_col] * y_density_[mb_row] && moving_object_[mb_index]);
+}
+
+void VideoDenoiser::CopySrcOnMOB(const Band& band,
+                                 const uint8_t* y_src,
                                  int stride_src,
                                  uint8_t* y_dst,
                                  int stride_dst) {
   // Loop over to copy src block if the block is marked as moving object block
   // or if the block may cause trailing artifacts.
-  for (int mb_row = 0; mb_row < mb_rows_; ++mb_row) {
-    const int mb_index_base = mb_row * mb_cols_;
+  for (int mb_row = band.mb_row_begin; mb_row < band.mb_row_end; ++mb_row) {
     const uint8_t* mb_src_base = y_src + (mb_row << 4) * stride_src;
     uint8_t* mb_dst_base = y_dst + (mb_row << 4) * stride_dst;
     for (int mb_col = 0; mb_col < mb_cols_; ++mb_col) {
-      const int mb_index = mb_index_base + mb_col;
       const uint32_t offset_col = mb_col << 4;
-      const uint8_t* mb_src = mb_src_base + offset_col;
-      uint8_t* mb_dst = mb_dst_base + offset_col;
-      // Check if the block is a moving object block or may cause a trailing
-      // artifacts.
-      if (mb_filter_decision_[mb_index] != FILTER_BLOCK ||
-          IsTrailingBlock(moving_edge_, mb_row, mb_col) ||
-          (x_density_[mb_col] * y_density_[mb_row] &&
-           moving_object_[mb_row * mb_cols_ + mb_col])) {
+      if (IsSrcBlock(mb_row, mb_col)) {
         // Copy y source.
-        libyuv::CopyPlane(mb_src, stride_src, mb_dst, stride_dst, 16, 16);
+        libyuv::CopyPlane(mb_src_base + offset_col, stride_src,
+                          mb_dst_base + offset_col, stride_dst, 16, 16);
+      }
+    }
+  }
+}
+
+void VideoDenoiser::CopyFilteredOnStatic(const Band& band,
+                                         const uint8_t* y_filtered,
+                                         int stride_filtered,
+                                         uint8_t* y_dst,
+                                         int stride_dst) {
+  for (int mb_row = band.mb_row_begin; mb_row < band.mb_row_end; ++mb_row) {
+    const uint8_t* mb_filtered_base =
+        y_filtered + (mb_row << 4) * stride_filtered;
+    uint8_t* mb_dst_base = y_dst + (mb_row << 4) * stride_dst;
+    // Adjacent filtered blocks are copied together, since most blocks of a
+    // static scene are filtered.
+    int mb_col = 0;
+    while (mb_col < mb_cols_) {
+      if (IsSrcBlock(mb_row, mb_col)) {
+        ++mb_col;
+        continue;
       }
+      const int run_begin = mb_col;
+      while (mb_col < mb_cols_ && !IsSrcBlock(mb_row, mb_col)) {
+        ++mb_col;
+      }
+      const uint32_t offset_col = run_begin << 4;
+      libyuv::CopyPlane(mb_filtered_base + offset_col, stride_filtered,
+                        mb_dst_base + offset_col, stride_dst,
+                        (mb_col - run_begin) << 4, 16);
     }
   }
 }
@@ -209,38 +271,22 @@ void VideoDenoiser::CopyLumaOnMargin(const uint8_t* y_src,
   }
 }
 
-rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
-    rtc::scoped_refptr<I420BufferInterface> frame,
-    bool noise_estimation_enabled) {
-  // If previous width and height are different from current frame's, need to
-  // reallocate the buffers and no denoising for the current frame.
-  if (!prev_buffer_ || width_ != frame->width() || height_ != frame->height()) {
-    DenoiserReset(frame);
-    prev_buffer_ = frame;
-    return frame;
-  }
-
-  // Set buffer pointers.
-  const uint8_t* y_src = frame->DataY();
-  int stride_y_src = frame->StrideY();
-  rtc::scoped_refptr<I420Buffer> dst =
-      buffer_pool_.CreateI420Buffer(width_, height_);
-
-  uint8_t* y_dst = dst->MutableDataY();
-  int stride_y_dst = dst->StrideY();
-
+void VideoDenoiser::FilterBand(Band* band,
+                               const uint8_t* y_src,
+                               int stride_y_src,
+                               uint8_t* y_dst,
+                               int stride_y_dst,
+                               uint8_t noise_level) {
   const uint8_t* y_dst_prev = prev_buffer_->DataY();
   int stride_prev = prev_buffer_->StrideY();
 
-  memset(x_density_.get(), 0, mb_cols_);
-  memset(y_density_.get(), 0, mb_rows_);
-  memset(moving_object_.get(), 1, mb_cols_ * mb_rows_);
+  std::fill(band->x_density.begin(), band->x_density.end(), 0);
+  band->noise_samples.clear();
 
-  uint8_t noise_level = noise_estimation_enabled ? ne_->GetNoiseLevel() : 0;
   int thr_var_base = 16 * 16 * 2;
   // Loop over blocks to accumulate/extract noise level and update x/y_density
   // factors for moving object detection.
-  for (int mb_row = 0; mb_row < mb_rows_; ++mb_row) {
+  for (int mb_row = band->mb_row_begin; mb_row < band->mb_row_end; ++mb_row) {
     const int mb_index_base = mb_row * mb_cols_;
     const uint8_t* mb_src_base = y_src + (mb_row << 4) * stride_y_src;
     uint8_t* mb_dst_base = y_dst + (mb_row << 4) * stride_y_dst;
@@ -255,7 +301,8 @@ rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
       uint8_t* mb_dst = mb_dst_base + offset_col;
       const uint8_t* mb_dst_prev = mb_dst_prev_base + offset_col;
 
-      // TODO(jackychen): Need SSE2/NEON opt.
+      // Only every NOISE_SUBSAMPLE_INTERVAL-th block is summed, so this isn't
+      // worth a SIMD version.
       int luma = 0;
       if (ne_enable) {
         for (int i = 4; i < 12; ++i) {
@@ -279,8 +326,9 @@ rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
           // The variance used in noise estimation is based on the src block in
           // time t (mb_src) and filtered block in time t-1 (mb_dist_prev).
           uint32_t noise_var = filter_->Variance16x8(
-              mb_dst_prev, stride_y_dst, mb_src, stride_y_src, &sse_t);
-          ne_->GetNoise(mb_index, noise_var, luma);
+              mb_dst_prev, stride_prev, mb_src, stride_y_src, &sse_t);
+          band->noise_samples.push_back(
+              NoiseSample{mb_index, noise_var, static_cast<uint32_t>(luma)});
         }
         moving_edge_[mb_index] = 0;  // Not a moving edge block.
       } else {
@@ -294,7 +342,7 @@ rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
             ne_->ResetConsecLowVar(mb_index);
           }
           moving_edge_[mb_index] = 1;  // Mark as moving edge block.
-          x_density_[mb_col] += (pos_factor < 3);
+          band->x_density[mb_col] += (pos_factor < 3);
           y_density_[mb_row] += (pos_factor < 3);
         } else {
           moving_edge_[mb_index] = 0;
@@ -303,16 +351,67 @@ rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
             // in time t (mb_src) and filtered block in time t-1 (mb_dist_prev).
             uint32_t noise_var = filter_->Variance16x8(
                 mb_dst_prev, stride_prev, mb_src, stride_y_src, &sse_t);
-            ne_->GetNoise(mb_index, noise_var, luma);
+            band->noise_samples.push_back(
+                NoiseSample{mb_index, noise_var, static_cast<uint32_t>(luma)});
           }
         }
       }
     }  // End of for loop
   }    // End of for loop
+}
+
+void VideoDenoiser::DenoiseLuma(const I420BufferInterface& frame,
+                                uint8_t* y_dst,
+                                int stride_dst,
+                                bool noise_estimation_enabled) {
+  memset(x_density_.get(), 0, mb_cols_);
+  memset(y_density_.get(), 0, mb_rows_);
+  memset(moving_object_.get(), 1, mb_cols_ * mb_rows_);
+
+  uint8_t noise_level = noise_estimation_enabled ? ne_->GetNoiseLevel() : 0;
+  ForEachBand([&](Band* band) {
+    FilterBand(band, frame.DataY(), frame.StrideY(), y_dst, stride_dst,
+               noise_level);
+  });
+  // Bands are merged in order, which gives the same result as filtering the
+  // whole frame on one thread.
+  for (const Band& band : bands_) {
+    for (int mb_col = 0; mb_col < mb_cols_; ++mb_col) {
+      x_density_[mb_col] += band.x_density[mb_col];
+    }
+    for (const NoiseSample& sample : band.noise_samples) {
+      ne_->GetNoise(sample.mb_index, sample.var, sample.luma);
+    }
+  }
 
   ReduceFalseDetection(moving_edge_, &moving_object_, noise_level);
+}
 
-  CopySrcOnMOB(y_src, stride_y_src, y_dst, stride_y_dst);
+rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
+    rtc::scoped_refptr<I420BufferInterface> frame,
+    bool noise_estimation_enabled) {
+  // If previous width and height are different from current frame's, need to
+  // reallocate the buffers and no denoising for the current frame.
+  if (!prev_buffer_ || width_ != frame->width() || height_ != frame->height()) {
+    DenoiserReset(frame);
+    prev_buffer_ = frame;
+    return frame;
+  }
+
+  // Set buffer pointers.
+  const uint8_t* y_src = frame->DataY();
+  int stride_y_src = frame->StrideY();
+  rtc::scoped_refptr<I420Buffer> dst =
+      buffer_pool_.CreateI420Buffer(width_, height_);
+
+  uint8_t* y_dst = dst->MutableDataY();
+  int stride_y_dst = dst->StrideY();
+
+  DenoiseLuma(*frame, y_dst, stride_y_dst, noise_estimation_enabled);
+
+  ForEachBand([&](Band* band) {
+    CopySrcOnMOB(*band, y_src, stride_y_src, y_dst, stride_y_dst);
+  });
 
   // When frame width/height not divisible by 16, copy the margin to
   // denoised_frame.
@@ -336,4 +435,41 @@ rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrame(
   return dst;
 }
 
+rtc::scoped_refptr<I420BufferInterface> VideoDenoiser::DenoiseFrameInPlace(
+    rtc::scoped_refptr<I420Buffer> frame,
+    bool noise_estimation_enabled) {
+  if (!prev_buffer_ || width_ != frame->width() || height_ != frame->height()) {
+    DenoiserReset(frame);
+    prev_buffer_ = frame;
+    return frame;
+  }
+
+  // The input blocks are still needed after filtering, so the luma plane is
+  // filtered into |filtered_y_| and only the blocks that stay filtered are
+  // copied back. The margins and the chroma planes are left as they are.
+  const int stride_filtered = mb_cols_ << 4;
+  if (!filtered_y_) {
+    filtered_y_.reset(new uint8_t[stride_filtered * (mb_rows_ << 4)]);
+  }
+  DenoiseLuma(*frame, filtered_y_.get(), stride_filtered,
+              noise_estimation_enabled);
+
+  uint8_t* y_dst = frame->MutableDataY();
+  int stride_y_dst = frame->StrideY();
+  ForEachBand([&](Band* band) {
+    CopyFilteredOnStatic(*band, filtered_y_.get(), stride_filtered, y_dst,
+                         stride_y_dst);
+  });
+
+#if DISPLAY || DISPLAYNEON
+  // Show rectangular region
+  ShowRect(filter_, moving_edge_, moving_object_, x_density_, y_density_,
+           frame->DataU(), frame->StrideU(), frame->DataV(), frame->StrideV(),
+           frame->MutableDataU(), frame->StrideU(), frame->MutableDataV(),
+           frame->StrideV(), mb_rows_, mb_cols_);
+#endif
+  prev_buffer_ = frame;
+  return frame;
+}
+
 }  // namespace webrtc
@@ -11,28 +11,80 @@
 #ifndef MODULES_VIDEO_PROCESSING_VIDEO_DENOISER_H_
 #define MODULES_VIDEO_PROCESSING_VIDEO_DENOISER_H_
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "api/scoped_refptr.h"
+#include "api/video/i420_buffer.h"
 #include "api/video/video_frame_buffer.h"
 #include "common_video/include/video_frame_buffer_pool.h"
 #include "modules/video_processing/util/denoiser_filter.h"
 #include "modules/video_processing/util/noise_estimation.h"
 #include "modules/video_processing/util/skin_detection.h"
+#include "rtc_base/fork_join_pool.h"
 
 namespace webrtc {
 
 class VideoDenoiser {
  public:
+  // Frames are split into bands of macroblock rows that are denoised in
+  // parallel, with at least |kMinBlocksPerThread| macroblocks per band.
+  static constexpr int kMinBlocksPerThread = 1024;
+
   explicit VideoDenoiser(bool runtime_cpu_detection);
+  // Denoises on up to |num_threads| threads, including the calling one.
+  VideoDenoiser(bool runtime_cpu_detection, int num_threads);
+  ~VideoDenoiser();
 
   rtc::scoped_refptr<I420BufferInterface> DenoiseFrame(
       rtc::scoped_refptr<I420BufferInterface> frame,
       bool noise_estimation_enabled);
 
+  // Same as DenoiseFrame(), but writes the denoised luma plane into |frame|
+  // instead of into a new buffer, which also saves copying the chroma planes.
+  // |frame| is kept as reference for the next frame, so it must not be
+  // modified after this call.
+  rtc::scoped_refptr<I420BufferInterface> DenoiseFrameInPlace(
+      rtc::scoped_refptr<I420Buffer> frame,
+      bool noise_estimation_enabled);
+
  private:
+  // Input to NoiseEstimation::GetNoise() collected by a band, which is
+  // applied after all bands have been processed.
+  struct NoiseSample {
+    int mb_index;
+    uint32_t var;
+    uint32_t luma;
+  };
+  struct Band {
+    int mb_row_begin;
+    int mb_row_end;
+    // Moving edge blocks per column within the band.
+    std::vector<uint8_t> x_density;
+    std::vector<NoiseSample> noise_samples;
+  };
+
   void DenoiserReset(rtc::scoped_refptr<I420BufferInterface> frame);
 
+  // Filters the luma plane of |frame| into |y_dst| and detects moving objects.
+  void DenoiseLuma(const I420BufferInterface& frame,
+                   uint8_t* y_dst,
+                   int stride_dst,
+                   bool noise_estimation_enabled);
+
+  // Filters the blocks of |band| into |y_dst|, and updates the block status
+  // and the noise samples of |band|.
+  void FilterBand(Band* band,
+                  const uint8_t* y_src,
+                  int stride_src,
+                  uint8_t* y_dst,
+                  int stride_dst,
+                  uint8_t noise_level);
+
+  // Runs |job| for every band, on |band_pool_|.
+  void ForEachBand(std::function<void(Band*)> job);
+
   // Check the mb position, return 1: close to the frame center (between 1/8
   // and 7/8 of width/height), 3: close to the border (out of 1/16 and 15/16
   // of width/height), 2: in between.
@@ -49,12 +101,25 @@ class VideoDenoiser {
                        int mb_row,
                        int mb_col);
 
+  // Returns whether the input block is used instead of the filtered one,
+  // since it's a moving object block (MOB) or may cause trailing artifacts.
+  bool IsSrcBlock(int mb_row, int mb_col);
+
   // Copy input blocks to dst buffer on moving object blocks (MOB).
-  void CopySrcOnMOB(const uint8_t* y_src,
+  void CopySrcOnMOB(const Band& band,
+                    const uint8_t* y_src,
                     int stride_src,
                     uint8_t* y_dst,
                     int stride_dst);
 
+  // Copy filtered blocks to the frame denoised in place, the inverse of
+  // CopySrcOnMOB().
+  void CopyFilteredOnStatic(const Band& band,
+                            const uint8_t* y_filtered,
+                            int stride_filtered,
+                            uint8_t* y_dst,
+                            int stride_dst);
+
   // Copy luma margin blocks when frame width/height not divisible by 16.
   void CopyLumaOnMargin(const uint8_t* y_src,
                         int stride_src,
@@ -79,6 +144,11 @@ class VideoDenoiser {
   std::unique_ptr<DenoiserDecision[]> mb_filter_decision_;
   VideoFrameBufferPool buffer_pool_;
   rtc::scoped_refptr<I420BufferInterface> prev_buffer_;
+  // Luma plane that frames denoised in place are filtered into.
+  std::unique_ptr<uint8_t[]> filtered_y_;
+  const int num_threads_;
+  std::vector<Band> bands_;
+  ForkJoinPool band_pool_;
 };
 
 }  // namespace webrtc
@@ -10,6 +10,8 @@
 
 #include "p2p/base/basic_ice_controller.h"
 
+#include "p2p/base/insertion_sort.h"
+
 namespace {
 
 // The minimum improvement in RTT that justifies a switch.
@@ -53,6 +55,10 @@ int CompareCandidatePairsByNetworkPreference(
   return a_and_b_equal;
 }
 
+// A stable sort compares each connection about log2(n) times; an insertion
+// sort that moves the connections more often than this gives up.
+const size_t kMaxSortMovesPerConnection = 8;
+
 }  // namespace
 
 namespace cricket {
@@ -527,16 +533,19 @@ BasicIceController::SortAndSwitchConnection(IceControllerEvent reason) {
   // that amongst equal preference, writable connections, this will choose the
   // one whose estimated latency is lowest.  So it is the only one that we
   // need to consider switching to.
-  // TODO(honghaiz): Don't sort;  Just use std::max_element in the right places.
-  absl::c_stable_sort(
-      connections_, [this](const Connection* a, const Connection* b) {
-        int cmp = CompareConnections(a, b, absl::nullopt, nullptr);
-        if (cmp != 0) {
-          return cmp > 0;
-        }
-        // Otherwise, sort based on latency estimate.
-        return a->rtt() < b->rtt();
-      });
+  auto less = [this](const Connection* a, const Connection* b) {
+    int cmp = CompareConnections(a, b, absl::nullopt, nullptr);
+    if (cmp != 0) {
+      return cmp > 0;
+    }
+    // Otherwise, sort based on latency estimate.
+    return a->rtt() < b->rtt();
+  };
+  // The connections are re-sorted after every change to any of them, so
+  // usually only the changed ones are out of place and the insertion sort
+  // repositions them in linear time. When many of them changed, e.g. after a
+  // network change, it falls back to a stable sort, which gives the same order.
+  StableSortByInsertion(&connections_, less, kMaxSortMovesPerConnection);
 
   RTC_LOG(LS_VERBOSE) << "Sorting " << connections_.size()
                       << " available connections";
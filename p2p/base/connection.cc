@@ -249,9 +249,9 @@ void ConnectionRequest::Prepare(StunMessage* request) {
   if (connection_->ShouldSendGoogPing(request)) {
     request->SetType(GOOG_PING_REQUEST);
     request->ClearAttributes();
-    request->AddMessageIntegrity32(connection_->remote_candidate().password());
+    request->AddMessageIntegrity32(connection_->remote_integrity_key());
   } else {
-    request->AddMessageIntegrity(connection_->remote_candidate().password());
+    request->AddMessageIntegrity(connection_->remote_integrity_key());
     request->AddFingerprint();
   }
 }
@@ -460,9 +460,13 @@ void Connection::OnReadPacket(const char* data,
     // This is a data packet, pass it along.
     last_data_received_ = rtc::TimeMillis();
     UpdateReceiving(last_data_received_);
-    recv_rate_tracker_.AddSamples(size);
+    recv_rate_tracker_.AddSamplesAtTime(last_data_received_, size);
     stats_.packets_received++;
-    SignalReadPacket(this, data, size, packet_time_us);
+    if (received_packet_callback_) {
+      received_packet_callback_(this, data, size, packet_time_us);
+    } else {
+      SignalReadPacket(this, data, size, packet_time_us);
+    }
 
     // If timed out sending writability checks, start up again
     if (!pruned_ && (write_state_ == STATE_WRITE_TIMEOUT)) {
@@ -480,7 +484,7 @@ void Connection::OnReadPacket(const char* data,
     // If this is a STUN response, then update the writable bit.
     // Log at LS_INFO if we receive a ping on an unwritable connection.
     rtc::LoggingSeverity sev = (!writable() ? rtc::LS_INFO : rtc::LS_VERBOSE);
-    msg->ValidateMessageIntegrity(remote_candidate().password());
+    msg->ValidateMessageIntegrity(remote_integrity_key());
     switch (msg->type()) {
       case STUN_BINDING_REQUEST:
         RTC_LOG_V(sev) << ToString() << ": Received "
@@ -534,6 +538,16 @@ void Connection::OnReadPacket(const char* data,
   }
 }
 
+void Connection::RegisterReceivedPacketCallback(
+    ReceivedPacketCallback callback) {
+  RTC_DCHECK(!received_packet_callback_);
+  received_packet_callback_ = std::move(callback);
+}
+
+void Connection::DeregisterReceivedPacketCallback() {
+  received_packet_callback_ = nullptr;
+}
+
 void Connection::HandleStunBindingOrGoogPingRequest(IceMessage* msg) {
   // This connection should now be receiving.
   ReceivedPing(msg->transaction_id());
@@ -683,7 +697,7 @@ void Connection::SendStunBindingResponse(const StunMessage* request) {
     }
   }
 
-  response.AddMessageIntegrity(local_candidate().password());
+  response.AddMessageIntegrity(port_->integrity_key());
   response.AddFingerprint();
 
   SendResponseMessage(response);
@@ -696,7 +710,7 @@ void Connection::SendGoogPingResponse(const StunMessage* request) {
   StunMessage response;
   response.SetType(GOOG_PING_RESPONSE);
   response.SetTransactionID(request->transaction_id());
-  response.AddMessageIntegrity32(local_candidate().password());
+  response.AddMessageIntegrity32(port_->integrity_key());
   SendResponseMessage(response);
 }
 
@@ -1181,6 +1195,11 @@ void Connection::HandleRoleConflictFromPeer() {
   port_->SignalRoleConflict(port_);
 }
 
+const StunIntegrityKey& Connection::remote_integrity_key() {
+  remote_integrity_key_.SetKey(remote_candidate_.password());
+  return remote_integrity_key_;
+}
+
 void Connection::MaybeSetRemoteIceParametersAndGeneration(
     const IceParameters& ice_params,
     int generation) {
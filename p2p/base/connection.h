@@ -11,6 +11,7 @@
 #ifndef P2P_BASE_CONNECTION_H_
 #define P2P_BASE_CONNECTION_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -160,6 +161,14 @@ class Connection : public CandidatePairInterface,
 
   sigslot::signal4<Connection*, const char*, size_t, int64_t> SignalReadPacket;
 
+  // Received data packets are passed to |callback| instead of SignalReadPacket,
+  // which saves the signal dispatch for every packet. The callback must be
+  // deregistered before whatever it refers to is destroyed.
+  using ReceivedPacketCallback =
+      std::function<void(Connection*, const char*, size_t, int64_t)>;
+  void RegisterReceivedPacketCallback(ReceivedPacketCallback callback);
+  void DeregisterReceivedPacketCallback();
+
   sigslot::signal1<Connection*> SignalReadyToSend;
 
   // Called when a packet is received on this connection.
@@ -383,6 +392,8 @@ class Connection : public CandidatePairInterface,
   int64_t last_send_data_ = 0;
 
  private:
+  ReceivedPacketCallback received_packet_callback_;
+
   // Update the local candidate based on the mapped address attribute.
   // If the local candidate changed, fires SignalStateChange.
   void MaybeUpdateLocalCandidate(ConnectionRequest* request,
@@ -396,6 +407,10 @@ class Connection : public CandidatePairInterface,
   // to last message ack:ed STUN_BINDING_REQUEST.
   bool ShouldSendGoogPing(const StunMessage* message);
 
+  // Returns the key for signing and validating messages with the password of
+  // the remote candidate.
+  const StunIntegrityKey& remote_integrity_key();
+
   WriteState write_state_;
   bool receiving_;
   bool connected_;
@@ -458,6 +473,8 @@ class Connection : public CandidatePairInterface,
   // that is about to be sent.
   absl::optional<bool> remote_support_goog_ping_;
   std::unique_ptr<StunMessage> cached_stun_binding_;
+  // Recomputed by remote_integrity_key() when the remote password changes.
+  StunIntegrityKey remote_integrity_key_;
 
   const IceFieldTrials* field_trials_;
   rtc::EventBasedExponentialMovingAverage rtt_estimate_;
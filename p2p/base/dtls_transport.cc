@@ -195,6 +195,15 @@ rtc::scoped_refptr<rtc::RTCCertificate> DtlsTransport::GetLocalCertificate()
   return local_certificate_;
 }
 
+void DtlsTransport::SetDtlsSessionCache(rtc::DtlsSessionCache* session_cache) {
+  session_cache_ = session_cache;
+}
+
+void DtlsTransport::SetHandshakeTaskQueue(
+    webrtc::TaskQueueBase* handshake_task_queue) {
+  handshake_task_queue_ = handshake_task_queue;
+}
+
 bool DtlsTransport::SetDtlsRole(rtc::SSLRole role) {
   if (dtls_) {
     RTC_DCHECK(dtls_role_);
@@ -341,6 +350,8 @@ bool DtlsTransport::SetupDtls() {
   dtls_->SetIdentity(local_certificate_->identity()->Clone());
   dtls_->SetMode(rtc::SSL_MODE_DTLS);
   dtls_->SetMaxProtocolVersion(ssl_max_version_);
+  dtls_->SetDtlsSessionCache(session_cache_);
+  dtls_->SetHandshakeTaskQueue(handshake_task_queue_);
   dtls_->SetServerRole(*dtls_role_);
   dtls_->SignalEvent.connect(this, &DtlsTransport::OnDtlsEvent);
   dtls_->SignalSSLHandshakeError.connect(this,
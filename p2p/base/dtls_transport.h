@@ -129,6 +129,14 @@ class DtlsTransport : public DtlsTransportInternal {
       const rtc::scoped_refptr<rtc::RTCCertificate>& certificate) override;
   rtc::scoped_refptr<rtc::RTCCertificate> GetLocalCertificate() const override;
 
+  // Sets the cache of DTLS sessions shared with other transports, which lets
+  // the handshake resume an earlier session with the same peer, and the task
+  // queue on which the private key operations of the handshake run. Both are
+  // optional, not owned and must outlive the transport. They take effect with
+  // the next call to SetRemoteFingerprint.
+  void SetDtlsSessionCache(rtc::DtlsSessionCache* session_cache);
+  void SetHandshakeTaskQueue(webrtc::TaskQueueBase* handshake_task_queue);
+
   // SetRemoteFingerprint must be called after SetLocalCertificate, and any
   // other methods like SetDtlsRole. It's what triggers the actual DTLS setup.
   // TODO(deadbeef): Rename to "Start" like in ORTC?
@@ -238,6 +246,8 @@ class DtlsTransport : public DtlsTransportInternal {
   const rtc::SSLProtocolVersion ssl_max_version_;
   rtc::Buffer remote_fingerprint_value_;
   std::string remote_fingerprint_algorithm_;
+  rtc::DtlsSessionCache* session_cache_ = nullptr;
+  webrtc::TaskQueueBase* handshake_task_queue_ = nullptr;
 
   // Cached DTLS ClientHello packet that was received before we started the
   // DTLS handshake. This could happen if the hello was received before the
@@ -0,0 +1,53 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef P2P_BASE_INSERTION_SORT_H_
+#define P2P_BASE_INSERTION_SORT_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace cricket {
+
+// Sorts |items| into the same order as std::stable_sort with |less|. The
+// items are sorted by insertion, which takes linear time if only a few of
+// them are out of place. If that needs more than |max_moves_per_item| moves
+// per item, it gives up and falls back to std::stable_sort. Returns false if
+// the fallback was used.
+template <typename T, typename Less>
+bool StableSortByInsertion(std::vector<T>* items,
+                           Less less,
+                           size_t max_moves_per_item) {
+  const size_t max_moves = max_moves_per_item * items->size();
+  size_t moves = 0;
+  for (size_t i = 1; i < items->size(); ++i) {
+    T item = std::move((*items)[i]);
+    size_t j = i;
+    // Never moves an item past an equivalent one, like a stable sort.
+    for (; j > 0 && less(item, (*items)[j - 1]); --j) {
+      (*items)[j] = std::move((*items)[j - 1]);
+    }
+    (*items)[j] = std::move(item);
+    moves += i - j;
+    if (moves > max_moves) {
+      // The items before |i| are sorted, the stable sort keeps their order.
+      std::stable_sort(items->begin(), items->end(), less);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace cricket
+
+#endif  // P2P_BASE_INSERTION_SORT_H_
@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "p2p/base/insertion_sort.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "test/gtest.h"
+
+namespace cricket {
+namespace {
+
+// Items with equal keys are equivalent, |id| tells them apart.
+struct Item {
+  int key;
+  int id;
+
+  bool operator==(const Item& other) const {
+    return key == other.key && id == other.id;
+  }
+};
+
+bool LessByKey(const Item& a, const Item& b) {
+  return a.key < b.key;
+}
+
+std::vector<Item> MakeItems(const std::vector<int>& keys) {
+  std::vector<Item> items;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    items.push_back({keys[i], static_cast<int>(i)});
+  }
+  return items;
+}
+
+std::vector<Item> StableSorted(std::vector<Item> items) {
+  std::stable_sort(items.begin(), items.end(), LessByKey);
+  return items;
+}
+
+}  // namespace
+
+TEST(InsertionSortTest, SortsEmptyAndSingleItem) {
+  std::vector<Item> items;
+  EXPECT_TRUE(StableSortByInsertion(&items, LessByKey, 0));
+  EXPECT_TRUE(items.empty());
+
+  items = MakeItems({1});
+  EXPECT_TRUE(StableSortByInsertion(&items, LessByKey, 0));
+  EXPECT_EQ(MakeItems({1}), items);
+}
+
+TEST(InsertionSortTest, RepositionsFewItemsByInsertion) {
+  // One item moved to the front, one to the back, equal keys around them.
+  std::vector<Item> items = MakeItems({5, 1, 2, 2, 3, 3, 4, 0, 6, 7});
+  std::vector<Item> expected = StableSorted(items);
+  EXPECT_TRUE(StableSortByInsertion(&items, LessByKey, 2));
+  EXPECT_EQ(expected, items);
+
+  // Sorting again doesn't move anything.
+  EXPECT_TRUE(StableSortByInsertion(&items, LessByKey, 0));
+  EXPECT_EQ(expected, items);
+}
+
+TEST(InsertionSortTest, KeepsOrderOfEquivalentItems) {
+  std::vector<Item> items = MakeItems({1, 0, 1, 0, 1, 0});
+  std::vector<Item> expected = StableSorted(items);
+  EXPECT_TRUE(StableSortByInsertion(&items, LessByKey, 8));
+  EXPECT_EQ(expected, items);
+}
+
+TEST(InsertionSortTest, FallsBackToStableSortWhenManyItemsMoved) {
+  std::vector<Item> items = MakeItems({9, 8, 7, 6, 5, 5, 4, 3, 2, 1, 0, 0});
+  std::vector<Item> expected = StableSorted(items);
+  EXPECT_FALSE(StableSortByInsertion(&items, LessByKey, 1));
+  EXPECT_EQ(expected, items);
+}
+
+TEST(InsertionSortTest, MatchesStableSortOnRandomInput) {
+  std::mt19937 random(1234);
+  for (int iteration = 0; iteration < 200; ++iteration) {
+    std::vector<int> keys(random() % 100);
+    for (int& key : keys) {
+      // Few distinct keys, so that many items are equivalent.
+      key = random() % 10;
+    }
+    // Sort a prefix, so that both paths are taken.
+    std::sort(keys.begin(), keys.begin() + random() % (keys.size() + 1));
+    std::vector<Item> items = MakeItems(keys);
+    std::vector<Item> expected = StableSorted(items);
+    StableSortByInsertion(&items, LessByKey, random() % 16);
+    EXPECT_EQ(expected, items);
+  }
+}
+
+}  // namespace cricket
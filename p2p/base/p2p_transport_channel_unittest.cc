@@ -14,9 +14,12 @@
 #include <memory>
 #include <utility>
 
+#include "api/crypto/crypto_options.h"
 #include "api/test/mock_async_dns_resolver.h"
 #include "p2p/base/basic_ice_controller.h"
+#include "p2p/base/basic_packet_socket_factory.h"
 #include "p2p/base/connection.h"
+#include "p2p/base/dtls_transport.h"
 #include "p2p/base/fake_port_allocator.h"
 #include "p2p/base/ice_transport_internal.h"
 #include "p2p/base/mock_async_resolver.h"
@@ -4696,6 +4699,148 @@ TEST_F(P2PTransportChannelPingTest, TestMaxOutstandingPingsFieldTrial) {
   EXPECT_EQ(nullptr, ch.FindNextPingableConnection());
 }
 
+// Measures the cost of handling ping responses, each of which re-sorts the
+// connections, and of looking up the connections by address, with a full mesh
+// of 500 candidate pairs.
+TEST_F(P2PTransportChannelPingTest, DISABLED_PingManyCandidatePairsBenchmark) {
+  const int kNumCandidatePairs = 500;
+  const int kNumRounds = 20;
+  FakePortAllocator pa(rtc::Thread::Current(), nullptr);
+  P2PTransportChannel ch("many pairs", 1, &pa);
+  PrepareChannel(&ch);
+  ch.MaybeStartGathering();
+  std::vector<rtc::SocketAddress> addresses;
+  for (int i = 0; i < kNumCandidatePairs; ++i) {
+    addresses.emplace_back("10.0." + std::to_string(i / 250) + "." +
+                               std::to_string(i % 250 + 1),
+                           1000 + i);
+    ch.AddRemoteCandidate(CreateUdpCandidate(
+        LOCAL_PORT_TYPE, addresses.back().ipaddr().ToString(),
+        addresses.back().port(), i + 1));
+  }
+  ASSERT_TRUE(WaitForConnectionTo(&ch, addresses.back().ipaddr().ToString(),
+                                  addresses.back().port()));
+  Port* port = GetPort(&ch);
+  std::vector<Connection*> connections;
+  for (const rtc::SocketAddress& address : addresses) {
+    connections.push_back(port->GetConnection(address));
+    ASSERT_TRUE(connections.back());
+  }
+
+  int64_t start_us = rtc::TimeMicros();
+  for (int round = 0; round < kNumRounds; ++round) {
+    for (int i = 0; i < kNumCandidatePairs; ++i) {
+      Connection* conn = connections[(i * 7 + round) % kNumCandidatePairs];
+      conn->ReceivedPingResponse(LOW_RTT + (i * 13 + round) % 100, "id");
+      // Runs the sort triggered by the response.
+      rtc::Thread::Current()->ProcessMessages(0);
+    }
+  }
+  int64_t elapsed_us = rtc::TimeMicros() - start_us;
+  printf("ping responses: %.0f/s\n",
+         kNumRounds * kNumCandidatePairs * 1e6 / elapsed_us);
+
+  const int kNumLookups = 1000000;
+  start_us = rtc::TimeMicros();
+  for (int i = 0; i < kNumLookups; ++i) {
+    ASSERT_TRUE(port->GetConnection(addresses[i % kNumCandidatePairs]));
+  }
+  elapsed_us = rtc::TimeMicros() - start_us;
+  printf("connection lookups: %.0f/s\n", kNumLookups * 1e6 / elapsed_us);
+}
+
+// Keeps track of the UDP sockets it creates, so that tests can inject packets
+// as if they were received by them.
+class RecordingPacketSocketFactory : public rtc::BasicPacketSocketFactory {
+ public:
+  explicit RecordingPacketSocketFactory(rtc::Thread* thread)
+      : rtc::BasicPacketSocketFactory(thread) {}
+
+  rtc::AsyncPacketSocket* CreateUdpSocket(const rtc::SocketAddress& address,
+                                          uint16_t min_port,
+                                          uint16_t max_port) override {
+    rtc::AsyncPacketSocket* socket =
+        rtc::BasicPacketSocketFactory::CreateUdpSocket(address, min_port,
+                                                       max_port);
+    if (socket) {
+      udp_sockets_.push_back(socket);
+    }
+    return socket;
+  }
+
+  const std::vector<rtc::AsyncPacketSocket*>& udp_sockets() const {
+    return udp_sockets_;
+  }
+
+ private:
+  std::vector<rtc::AsyncPacketSocket*> udp_sockets_;
+};
+
+class PacketCounter : public sigslot::has_slots<> {
+ public:
+  void OnReadPacket(rtc::PacketTransportInternal* transport,
+                    const char* data,
+                    size_t size,
+                    const int64_t& packet_time_us,
+                    int flags) {
+    ++packets_;
+  }
+  int packets() const { return packets_; }
+
+ private:
+  int packets_ = 0;
+};
+
+// Measures the receive path of RTP packets on the selected connection, from
+// the UDP socket up to the (non-DTLS) DtlsTransport on top of the channel,
+// which RtpTransport listens to.
+TEST_F(P2PTransportChannelPingTest, DISABLED_ReceivePacketBenchmark) {
+  const int kNumPackets = 1000000;
+  RecordingPacketSocketFactory factory(rtc::Thread::Current());
+  FakePortAllocator pa(rtc::Thread::Current(), &factory);
+  P2PTransportChannel ch("receive", 1, &pa);
+  PrepareChannel(&ch);
+  ch.MaybeStartGathering();
+  ch.AddRemoteCandidate(CreateUdpCandidate(LOCAL_PORT_TYPE, "1.1.1.1", 1, 1));
+  Connection* conn = WaitForConnectionTo(&ch, "1.1.1.1", 1);
+  ASSERT_TRUE(conn != nullptr);
+  conn->ReceivedPingResponse(LOW_RTT, "id");
+  EXPECT_EQ_WAIT(conn, ch.selected_connection(), kDefaultTimeout);
+  ASSERT_EQ(1u, factory.udp_sockets().size());
+  rtc::AsyncPacketSocket* socket = factory.udp_sockets()[0];
+
+  DtlsTransport dtls(&ch, webrtc::CryptoOptions(), nullptr);
+  PacketCounter counter;
+  dtls.SignalReadPacket.connect(&counter, &PacketCounter::OnReadPacket);
+
+  // An RTP header followed by some payload.
+  char packet[1000] = {static_cast<char>(0x80), 111};
+  // Addresses of received packets are not resolved from hostnames.
+  const rtc::SocketAddress remote_address(
+      conn->remote_candidate().address().ipaddr(), 1);
+  int64_t start_us = rtc::TimeMicros();
+  for (int i = 0; i < kNumPackets; ++i) {
+    socket->SignalReadPacket(socket, packet, sizeof(packet), remote_address,
+                             start_us);
+  }
+  int64_t elapsed_us = rtc::TimeMicros() - start_us;
+  EXPECT_EQ(kNumPackets, counter.packets());
+  printf("receive path: %.1f ns/packet\n", elapsed_us * 1000.0 / kNumPackets);
+
+  // Every received packet's address is converted from a sockaddr first.
+  sockaddr_storage storage;
+  remote_address.ToSockAddrStorage(&storage);
+  rtc::SocketAddress converted;
+  start_us = rtc::TimeMicros();
+  for (int i = 0; i < kNumPackets; ++i) {
+    rtc::SocketAddressFromSockAddrStorage(storage, &converted);
+  }
+  elapsed_us = rtc::TimeMicros() - start_us;
+  EXPECT_EQ(remote_address, converted);
+  printf("address conversion: %.1f ns/packet\n",
+         elapsed_us * 1000.0 / kNumPackets);
+}
+
 class P2PTransportChannelMostLikelyToWorkFirstTest
     : public P2PTransportChannelPingTest {
  public:
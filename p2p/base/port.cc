@@ -241,11 +241,17 @@ const std::vector<Candidate>& Port::Candidates() const {
 }
 
 Connection* Port::GetConnection(const rtc::SocketAddress& remote_addr) {
+  // Received packets usually come from the address of the previous one, which
+  // is cheaper to compare than to hash.
+  if (last_found_connection_ && last_found_connection_->first == remote_addr)
+    return last_found_connection_->second;
   AddressMap::const_iterator iter = connections_.find(remote_addr);
-  if (iter != connections_.end())
+  if (iter != connections_.end()) {
+    last_found_connection_ = &*iter;
     return iter->second;
-  else
+  } else {
     return NULL;
+  }
 }
 
 void Port::AddAddress(const rtc::SocketAddress& address,
@@ -424,42 +430,46 @@ bool Port::GetStunMessage(const char* data,
                           const rtc::SocketAddress& addr,
                           std::unique_ptr<IceMessage>* out_msg,
                           std::string* out_username) {
-  // NOTE: This could clearly be optimized to avoid allocating any memory.
-  //       However, at the data rates we'll be looking at on the client side,
-  //       this probably isn't worth worrying about.
   RTC_DCHECK(out_msg != NULL);
   RTC_DCHECK(out_username != NULL);
   out_username->clear();
 
+  // Index the attributes in place first, so that packets that are not STUN
+  // are dropped without allocating any memory.
+  StunMessageView view;
+  if (!view.Parse(data, size)) {
+    return false;
+  }
+
   // Don't bother parsing the packet if we can tell it's not STUN.
   // In ICE mode, all STUN packets will have a valid fingerprint.
   // Except GOOG_PING_REQUEST/RESPONSE that does not send fingerprint.
   int types[] = {GOOG_PING_REQUEST, GOOG_PING_RESPONSE,
                  GOOG_PING_ERROR_RESPONSE};
   if (!StunMessage::IsStunMethod(types, data, size) &&
-      !StunMessage::ValidateFingerprint(data, size)) {
+      !view.fingerprint_valid()) {
     return false;
   }
 
-  // Parse the request message.  If the packet is not a complete and correct
-  // STUN message, then ignore it.
+  // If the packet is not a complete and correct STUN message, then ignore
+  // it. Requests are checked on the view, and answered from the header if
+  // they fail, so their attributes are only read once they pass.
   std::unique_ptr<IceMessage> stun_msg(new IceMessage());
-  rtc::ByteBufferReader buf(data, size);
-  if (!stun_msg->Read(&buf) || (buf.Length() > 0)) {
+  if (!view.ReadHeader(stun_msg.get())) {
+    return false;
+  }
+  const bool is_request =
+      view.type() == STUN_BINDING_REQUEST || view.type() == GOOG_PING_REQUEST;
+  if (!is_request && !view.ReadInto(stun_msg.get())) {
     return false;
   }
 
-  // Get list of attributes in the "comprehension-required" range that were not
-  // comprehended. If one or more is found, the behavior differs based on the
-  // type of the incoming message; see below.
-  std::vector<uint16_t> unknown_attributes =
-      stun_msg->GetNonComprehendedAttributes();
-
-  if (stun_msg->type() == STUN_BINDING_REQUEST) {
+  if (view.type() == STUN_BINDING_REQUEST) {
     // Check for the presence of USERNAME and MESSAGE-INTEGRITY (if ICE) first.
     // If not present, fail with a 400 Bad Request.
-    if (!stun_msg->GetByteString(STUN_ATTR_USERNAME) ||
-        !stun_msg->GetByteString(STUN_ATTR_MESSAGE_INTEGRITY)) {
+    absl::optional<absl::string_view> username =
+        view.GetByteString(STUN_ATTR_USERNAME);
+    if (!username || !view.HasAttribute(STUN_ATTR_MESSAGE_INTEGRITY)) {
       RTC_LOG(LS_ERROR) << ToString() << ": Received "
                         << StunMethodToString(stun_msg->type())
                         << " without username/M-I from: "
@@ -470,9 +480,9 @@ bool Port::GetStunMessage(const char* data,
     }
 
     // If the username is bad or unknown, fail with a 401 Unauthorized.
-    std::string local_ufrag;
-    std::string remote_ufrag;
-    if (!ParseStunUsername(stun_msg.get(), &local_ufrag, &remote_ufrag) ||
+    absl::string_view local_ufrag;
+    absl::string_view remote_ufrag;
+    if (!ParseStunUsername(*username, &local_ufrag, &remote_ufrag) ||
         local_ufrag != username_fragment()) {
       RTC_LOG(LS_ERROR) << ToString() << ": Received "
                         << StunMethodToString(stun_msg->type())
@@ -484,7 +494,7 @@ bool Port::GetStunMessage(const char* data,
     }
 
     // If ICE, and the MESSAGE-INTEGRITY is bad, fail with a 401 Unauthorized
-    if (stun_msg->ValidateMessageIntegrity(password_) !=
+    if (view.ValidateMessageIntegrity(integrity_key()) !=
         StunMessage::IntegrityStatus::kIntegrityOk) {
       RTC_LOG(LS_ERROR) << ToString() << ": Received "
                         << StunMethodToString(stun_msg->type())
@@ -497,13 +507,15 @@ bool Port::GetStunMessage(const char* data,
 
     // If a request contains unknown comprehension-required attributes, reply
     // with an error. See RFC5389 section 7.3.1.
+    std::vector<uint16_t> unknown_attributes =
+        view.GetNonComprehendedAttributes(*stun_msg);
     if (!unknown_attributes.empty()) {
       SendUnknownAttributesErrorResponse(stun_msg.get(), addr,
                                          unknown_attributes);
       return true;
     }
 
-    out_username->assign(remote_ufrag);
+    out_username->assign(remote_ufrag.data(), remote_ufrag.size());
   } else if ((stun_msg->type() == STUN_BINDING_RESPONSE) ||
              (stun_msg->type() == STUN_BINDING_ERROR_RESPONSE)) {
     if (stun_msg->type() == STUN_BINDING_ERROR_RESPONSE) {
@@ -526,7 +538,7 @@ bool Port::GetStunMessage(const char* data,
     // If a response contains unknown comprehension-required attributes, it's
     // simply discarded and the transaction is considered failed. See RFC5389
     // sections 7.3.3 and 7.3.4.
-    if (!unknown_attributes.empty()) {
+    if (!stun_msg->GetNonComprehendedAttributes().empty()) {
       RTC_LOG(LS_ERROR) << ToString()
                         << ": Discarding STUN response due to unknown "
                            "comprehension-required attribute";
@@ -542,7 +554,7 @@ bool Port::GetStunMessage(const char* data,
 
     // If an indication contains unknown comprehension-required attributes,[]
     // it's simply discarded. See RFC5389 section 7.3.2.
-    if (!unknown_attributes.empty()) {
+    if (!stun_msg->GetNonComprehendedAttributes().empty()) {
       RTC_LOG(LS_ERROR) << ToString()
                         << ": Discarding STUN indication due to "
                            "unknown comprehension-required attribute";
@@ -551,7 +563,7 @@ bool Port::GetStunMessage(const char* data,
     // No stun attributes will be verified, if it's stun indication message.
     // Returning from end of the this method.
   } else if (stun_msg->type() == GOOG_PING_REQUEST) {
-    if (stun_msg->ValidateMessageIntegrity(password_) !=
+    if (view.ValidateMessageIntegrity(integrity_key()) !=
         StunMessage::IntegrityStatus::kIntegrityOk) {
       RTC_LOG(LS_ERROR) << ToString() << ": Received "
                         << StunMethodToString(stun_msg->type())
@@ -580,11 +592,21 @@ bool Port::GetStunMessage(const char* data,
     return true;
   }
 
+  // The request passed the checks, and gets the result of the M-I check.
+  if (is_request && !view.ReadInto(stun_msg.get())) {
+    return false;
+  }
+
   // Return the STUN message found.
   *out_msg = std::move(stun_msg);
   return true;
 }
 
+const StunIntegrityKey& Port::integrity_key() {
+  integrity_key_.SetKey(password_);
+  return integrity_key_;
+}
+
 bool Port::IsCompatibleAddress(const rtc::SocketAddress& addr) {
   // Get a representative IP for the Network this port is configured to use.
   rtc::IPAddress ip = network_->GetBestIP();
@@ -618,9 +640,6 @@ void Port::set_timeout_delay(int delay) {
 bool Port::ParseStunUsername(const StunMessage* stun_msg,
                              std::string* local_ufrag,
                              std::string* remote_ufrag) const {
-  // The packet must include a username that either begins or ends with our
-  // fragment.  It should begin with our fragment if it is a request and it
-  // should end with our fragment if it is a response.
   local_ufrag->clear();
   remote_ufrag->clear();
   const StunByteStringAttribute* username_attr =
@@ -628,15 +647,32 @@ bool Port::ParseStunUsername(const StunMessage* stun_msg,
   if (username_attr == NULL)
     return false;
 
+  absl::string_view local;
+  absl::string_view remote;
+  if (!ParseStunUsername(
+          absl::string_view(username_attr->bytes(), username_attr->length()),
+          &local, &remote)) {
+    return false;
+  }
+  local_ufrag->assign(local.data(), local.size());
+  remote_ufrag->assign(remote.data(), remote.size());
+  return true;
+}
+
+bool Port::ParseStunUsername(absl::string_view username,
+                             absl::string_view* local_ufrag,
+                             absl::string_view* remote_ufrag) {
+  // The packet must include a username that either begins or ends with our
+  // fragment.  It should begin with our fragment if it is a request and it
+  // should end with our fragment if it is a response.
   // RFRAG:LFRAG
-  const std::string username = username_attr->GetString();
   size_t colon_pos = username.find(':');
-  if (colon_pos == std::string::npos) {
+  if (colon_pos == absl::string_view::npos) {
     return false;
   }
 
   *local_ufrag = username.substr(0, colon_pos);
-  *remote_ufrag = username.substr(colon_pos + 1, username.size());
+  *remote_ufrag = username.substr(colon_pos + 1);
   return true;
 }
 
@@ -751,9 +787,9 @@ void Port::SendBindingErrorResponse(StunMessage* request,
       error_code != STUN_ERROR_UNAUTHORIZED &&
       request->type() != GOOG_PING_REQUEST) {
     if (request->type() == STUN_BINDING_REQUEST) {
-      response.AddMessageIntegrity(password_);
+      response.AddMessageIntegrity(integrity_key());
     } else {
-      response.AddMessageIntegrity32(password_);
+      response.AddMessageIntegrity32(integrity_key());
     }
   }
 
@@ -797,7 +833,7 @@ void Port::SendUnknownAttributesErrorResponse(
   }
   response.AddAttribute(std::move(unknown_attr));
 
-  response.AddMessageIntegrity(password_);
+  response.AddMessageIntegrity(integrity_key());
   response.AddFingerprint();
 
   // Send the response message.
@@ -895,6 +931,9 @@ void Port::OnConnectionDestroyed(Connection* conn) {
   AddressMap::iterator iter =
       connections_.find(conn->remote_candidate().address());
   RTC_DCHECK(iter != connections_.end());
+  if (last_found_connection_ == &*iter) {
+    last_found_connection_ = nullptr;
+  }
   connections_.erase(iter);
   HandleConnectionDestroyed(conn);
 
@@ -15,9 +15,11 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "api/candidate.h"
 #include "api/packet_socket_factory.h"
@@ -277,9 +279,18 @@ class Port : public PortInterface,
   void SubscribePortDestroyed(
       std::function<void(PortInterface*)> callback) override;
   void SendPortDestroyed(Port* port);
+  struct SocketAddressHash {
+    size_t operator()(const rtc::SocketAddress& addr) const {
+      return addr.Hash();
+    }
+  };
   // Returns a map containing all of the connections of this port, keyed by the
-  // remote address.
-  typedef std::map<rtc::SocketAddress, Connection*> AddressMap;
+  // remote address. Connections are looked up for every received packet, so
+  // the map is hashed; its iteration order is unspecified.
+  typedef std::unordered_map<rtc::SocketAddress,
+                             Connection*,
+                             SocketAddressHash>
+      AddressMap;
   const AddressMap& connections() { return connections_; }
 
   // Returns the connection to the given address or NULL if none exists.
@@ -338,6 +349,10 @@ class Port : public PortInterface,
   bool ParseStunUsername(const StunMessage* stun_msg,
                          std::string* local_username,
                          std::string* remote_username) const;
+  // Splits |username| as above into views of it.
+  static bool ParseStunUsername(absl::string_view username,
+                                absl::string_view* local_username,
+                                absl::string_view* remote_username);
   void CreateStunUsername(const std::string& remote_username,
                           std::string* stun_username_attr_str) const;
 
@@ -444,6 +459,8 @@ class Port : public PortInterface,
   void OnNetworkTypeChanged(const rtc::Network* network);
   void ScheduleDelayedDestructionIfDead();
   void DestroyIfDead();
+  // Returns the key for signing and validating messages with |password_|.
+  const StunIntegrityKey& integrity_key();
 
   rtc::Thread* const thread_;
   rtc::PacketSocketFactory* const factory_;
@@ -465,8 +482,13 @@ class Port : public PortInterface,
   // username_fragment().
   std::string ice_username_fragment_;
   std::string password_;
+  // Recomputed by integrity_key() when |password_| changes.
+  StunIntegrityKey integrity_key_;
   std::vector<Candidate> candidates_;
   AddressMap connections_;
+  // The entry of |connections_| that GetConnection() found last. Entries
+  // don't move when the map is rehashed.
+  const AddressMap::value_type* last_found_connection_ = nullptr;
   int timeout_delay_;
   bool enable_port_packets_;
   IceRole ice_role_;
@@ -406,7 +406,8 @@ class PortTest : public ::testing::Test, public sigslot::has_slots<> {
         username_(rtc::CreateRandomString(ICE_UFRAG_LENGTH)),
         password_(rtc::CreateRandomString(ICE_PWD_LENGTH)),
         role_conflict_(false),
-        ports_destroyed_(0) {}
+        ports_destroyed_(0),
+        signaled_packets_(0) {}
 
  protected:
   std::string password() { return password_; }
@@ -785,6 +786,17 @@ class PortTest : public ::testing::Test, public sigslot::has_slots<> {
   void OnDestroyed(PortInterface* port) { ++ports_destroyed_; }
   int ports_destroyed() const { return ports_destroyed_; }
 
+  void CountSignaledPackets(Connection* conn) {
+    conn->SignalReadPacket.connect(this, &PortTest::OnReadPacket);
+  }
+  void OnReadPacket(Connection* conn,
+                    const char* data,
+                    size_t size,
+                    int64_t packet_time_us) {
+    ++signaled_packets_;
+  }
+  int signaled_packets() const { return signaled_packets_; }
+
   rtc::BasicPacketSocketFactory* nat_socket_factory1() {
     return &nat_socket_factory1_;
   }
@@ -811,6 +823,7 @@ class PortTest : public ::testing::Test, public sigslot::has_slots<> {
   std::string password_;
   bool role_conflict_;
   int ports_destroyed_;
+  int signaled_packets_;
 };
 
 void PortTest::TestConnectivity(const char* name1,
@@ -1301,6 +1314,53 @@ TEST_F(PortTest, TestConnectionDead) {
   EXPECT_TRUE_WAIT(ch1.conn() == nullptr, kDefaultTimeout);
 }
 
+// Test that received data packets are passed to the received packet callback
+// instead of SignalReadPacket, and that connections are looked up correctly
+// after the last one that was looked up is destroyed.
+TEST_F(PortTest, TestReceivedPacketCallback) {
+  TestChannel ch1(CreateUdpPort(kLocalAddr1));
+  TestChannel ch2(CreateUdpPort(kLocalAddr2));
+  ch1.Start();
+  ch2.Start();
+  ASSERT_EQ_WAIT(1, ch1.complete_count(), kDefaultTimeout);
+  ASSERT_EQ_WAIT(1, ch2.complete_count(), kDefaultTimeout);
+
+  Candidate remote_candidate = GetCandidate(ch2.port());
+  ch1.CreateConnection(remote_candidate);
+  Connection* conn = ch1.conn();
+  ASSERT_NE(conn, nullptr);
+  EXPECT_EQ(conn, ch1.port()->GetConnection(remote_candidate.address()));
+
+  CountSignaledPackets(conn);
+
+  // An RTP packet, which doesn't parse as STUN.
+  const char kData[] = {static_cast<char>(0x80), 0, 0, 1, 0, 0, 0, 0};
+  int callback_packets = 0;
+  conn->RegisterReceivedPacketCallback(
+      [&](Connection* connection, const char* data, size_t size,
+          int64_t packet_time_us) {
+        EXPECT_EQ(conn, connection);
+        EXPECT_EQ(sizeof(kData), size);
+        ++callback_packets;
+      });
+  conn->OnReadPacket(kData, sizeof(kData), /* packet_time_us */ -1);
+  EXPECT_EQ(1, callback_packets);
+  EXPECT_EQ(0, signaled_packets());
+
+  conn->DeregisterReceivedPacketCallback();
+  conn->OnReadPacket(kData, sizeof(kData), /* packet_time_us */ -1);
+  EXPECT_EQ(1, callback_packets);
+  EXPECT_EQ(1, signaled_packets());
+
+  ch1.Stop();
+  EXPECT_TRUE_WAIT(ch1.conn() == nullptr, kDefaultTimeout);
+  EXPECT_EQ(nullptr, ch1.port()->GetConnection(remote_candidate.address()));
+  ch1.CreateConnection(remote_candidate);
+  ASSERT_NE(ch1.conn(), nullptr);
+  EXPECT_EQ(ch1.conn(),
+            ch1.port()->GetConnection(remote_candidate.address()));
+}
+
 TEST_F(PortTest, TestConnectionDeadWithDeadConnectionTimeout) {
   TestChannel ch1(CreateUdpPort(kLocalAddr1));
   TestChannel ch2(CreateUdpPort(kLocalAddr2));
@@ -2093,8 +2153,11 @@ TEST_F(PortTest, TestHandleStunMessage) {
   WriteStunMessage(*in_msg, buf.get());
   EXPECT_TRUE(port->GetStunMessage(buf->Data(), buf->Length(), addr, &out_msg,
                                    &username));
-  EXPECT_TRUE(out_msg.get() != NULL);
+  ASSERT_TRUE(out_msg.get() != NULL);
   EXPECT_EQ("lfrag", username);
+  // The request carries the result of the M-I check.
+  EXPECT_TRUE(out_msg->IntegrityOk());
+  EXPECT_EQ("rpass", out_msg->password());
 
   // BINDING-RESPONSE without username, with MESSAGE-INTEGRITY and FINGERPRINT.
   in_msg = CreateStunMessage(STUN_BINDING_RESPONSE);
@@ -2228,6 +2291,73 @@ TEST_F(PortTest, TestHandleStunMessageBadMessageIntegrity) {
   // Change this test to pass in data via Connection::OnReadPacket instead.
 }
 
+// Test that a request with a bad M-I is dropped without an error response if
+// one of its attributes is malformed.
+TEST_F(PortTest, TestHandleStunMessageMalformedAttribute) {
+  auto port = CreateTestPort(kLocalAddr2, "rfrag", "rpass");
+
+  std::unique_ptr<IceMessage> in_msg, out_msg;
+  auto buf = std::make_unique<ByteBufferWriter>();
+  rtc::SocketAddress addr(kLocalAddr1);
+  std::string username;
+
+  // GOOG_PING_REQUEST with an invalid MESSAGE-INTEGRITY-32 and an
+  // XOR-MAPPED-ADDRESS of unknown address family.
+  in_msg = CreateStunMessage(GOOG_PING_REQUEST);
+  in_msg->AddAttribute(std::make_unique<StunXorAddressAttribute>(
+      STUN_ATTR_XOR_MAPPED_ADDRESS, kLocalAddr2));
+  in_msg->AddMessageIntegrity32("invalid");
+  WriteStunMessage(*in_msg, buf.get());
+  std::string packet(buf->Data(), buf->Length());
+  // The family is the second byte of the value of the first attribute.
+  packet[kStunHeaderSize + 5] = 0x7f;
+  EXPECT_FALSE(port->GetStunMessage(packet.data(), packet.size(), addr,
+                                    &out_msg, &username));
+  EXPECT_TRUE(out_msg.get() == NULL);
+  EXPECT_TRUE(port->last_stun_msg() == NULL);
+
+  // The same request with a valid address family is answered with an error.
+  EXPECT_TRUE(port->GetStunMessage(buf->Data(), buf->Length(), addr, &out_msg,
+                                   &username));
+  EXPECT_TRUE(out_msg.get() == NULL);
+  EXPECT_EQ(STUN_ERROR_UNAUTHORIZED, port->last_stun_error_code());
+}
+
+// Test that requests are validated with the new password after an ICE restart.
+TEST_F(PortTest, TestHandleStunMessageAfterPasswordChange) {
+  auto port = CreateTestPort(kLocalAddr2, "rfrag", "rpass");
+
+  std::unique_ptr<IceMessage> in_msg, out_msg;
+  auto buf = std::make_unique<ByteBufferWriter>();
+  rtc::SocketAddress addr(kLocalAddr1);
+  std::string username;
+
+  in_msg = CreateStunMessageWithUsername(STUN_BINDING_REQUEST, "rfrag:lfrag");
+  in_msg->AddMessageIntegrity("rpass");
+  in_msg->AddFingerprint();
+  WriteStunMessage(*in_msg, buf.get());
+  EXPECT_TRUE(port->GetStunMessage(buf->Data(), buf->Length(), addr, &out_msg,
+                                   &username));
+  EXPECT_TRUE(out_msg.get() != NULL);
+
+  port->SetIceParameters(1, "rfrag", "rpass2");
+  out_msg = nullptr;
+  EXPECT_TRUE(port->GetStunMessage(buf->Data(), buf->Length(), addr, &out_msg,
+                                   &username));
+  EXPECT_TRUE(out_msg.get() == NULL);
+  EXPECT_EQ(STUN_ERROR_UNAUTHORIZED, port->last_stun_error_code());
+
+  in_msg = CreateStunMessageWithUsername(STUN_BINDING_REQUEST, "rfrag:lfrag");
+  in_msg->AddMessageIntegrity("rpass2");
+  in_msg->AddFingerprint();
+  buf = std::make_unique<ByteBufferWriter>();
+  WriteStunMessage(*in_msg, buf.get());
+  EXPECT_TRUE(port->GetStunMessage(buf->Data(), buf->Length(), addr, &out_msg,
+                                   &username));
+  EXPECT_TRUE(out_msg.get() != NULL);
+  EXPECT_EQ("lfrag", username);
+}
+
 // Test handling STUN messages with missing or malformed FINGERPRINT.
 TEST_F(PortTest, TestHandleStunMessageBadFingerprint) {
   // Our port will act as the "remote" port.
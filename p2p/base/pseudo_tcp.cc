@@ -74,6 +74,9 @@ const uint32_t JINGLE_HEADER_SIZE = 64;  // when relay framing is in use
 // Default size for receive and send buffer.
 const uint32_t DEFAULT_RCV_BUF_SIZE = 60 * 1024;
 const uint32_t DEFAULT_SND_BUF_SIZE = 90 * 1024;
+// Initial allocation for receive and send buffer, which grow up to their size
+// as data is received or queued.
+const uint32_t INITIAL_BUF_ALLOCATION = 8 * 1024;
 
 //////////////////////////////////////////////////////////////////////
 // Global Constants and Functions
@@ -115,6 +118,8 @@ const uint32_t DEF_ACK_DELAY = 100;  // 100 milliseconds
 
 const uint8_t FLAG_CTL = 0x02;
 const uint8_t FLAG_RST = 0x04;
+// Set on ACK segments that carry SACK blocks as payload.
+const uint8_t FLAG_SACK = 0x08;
 
 const uint8_t CTL_CONNECT = 0;
 
@@ -123,6 +128,12 @@ const uint8_t TCP_OPT_EOL = 0;        // End of list.
 const uint8_t TCP_OPT_NOOP = 1;       // No-op.
 const uint8_t TCP_OPT_MSS = 2;        // Maximum segment size.
 const uint8_t TCP_OPT_WND_SCALE = 3;  // Window scale factor.
+const uint8_t TCP_OPT_SACK_PERMITTED = 4;  // Selective acknowledgements.
+
+// A SACK block is the pair of sequence numbers of the left and right edge of
+// a contiguous range of data received out of order.
+const uint32_t SACK_BLOCK_SIZE = 8;
+const uint32_t MAX_SACK_BLOCKS = 4;
 
 const long DEFAULT_TIMEOUT =
     4000;  // If there are no pending clocks, wake up every 4 seconds
@@ -252,9 +263,13 @@ PseudoTcp::PseudoTcp(IPseudoTcpNotify* notify, uint32_t conv)
   m_rx_rto = DEF_RTO;
   m_rx_srtt = m_rx_rttvar = 0;
 
+  m_sack_enabled = false;
+  m_sack_high = m_sack_rexmit_nxt = 0;
+
   m_use_nagling = true;
   m_ack_delay = DEF_ACK_DELAY;
   m_support_wnd_scale = true;
+  m_support_sack = true;
 }
 
 PseudoTcp::~PseudoTcp() {}
@@ -309,6 +324,14 @@ void PseudoTcp::NotifyClock(uint32_t now) {
       // nInFlight << "  m_mss: " << m_mss;
       m_cwnd = m_mss;
 
+      // The peer may have discarded data that it selectively acknowledged
+      // (RFC 2018, section 8).
+      for (SSegment& sseg : m_slist) {
+        sseg.bSacked = false;
+      }
+      m_sack_high = 0;
+      m_sack_rexmit_nxt = m_slist.front().seq + m_slist.front().len;
+
       // Back off retransmit timer.  Note: the limit is lower when connecting.
       uint32_t rto_limit = (m_state < TCP_ESTABLISHED) ? DEF_RTO : MAX_RTO;
       m_rx_rto = std::min(rto_limit, m_rx_rto * 2);
@@ -510,26 +533,37 @@ IPseudoTcpNotify::WriteResult PseudoTcp::packet(uint32_t seq,
 
   uint32_t now = Now();
 
-  std::unique_ptr<uint8_t[]> buffer(new uint8_t[MAX_PACKET]);
-  long_to_bytes(m_conv, buffer.get());
-  long_to_bytes(seq, buffer.get() + 4);
-  long_to_bytes(m_rcv_nxt, buffer.get() + 8);
+  const size_t max_size =
+      HEADER_SIZE + std::max(len, MAX_SACK_BLOCKS * SACK_BLOCK_SIZE);
+  if (m_packet_buf.size() < max_size) {
+    m_packet_buf.resize(max_size);
+  }
+  uint8_t* const buffer = m_packet_buf.data();
+  long_to_bytes(m_conv, buffer);
+  long_to_bytes(seq, buffer + 4);
+  long_to_bytes(m_rcv_nxt, buffer + 8);
   buffer[12] = 0;
   buffer[13] = flags;
   short_to_bytes(static_cast<uint16_t>(m_rcv_wnd >> m_rwnd_scale),
-                 buffer.get() + 14);
+                 buffer + 14);
 
   // Timestamp computations
-  long_to_bytes(now, buffer.get() + 16);
-  long_to_bytes(m_ts_recent, buffer.get() + 20);
+  long_to_bytes(now, buffer + 16);
+  long_to_bytes(m_ts_recent, buffer + 20);
   m_ts_lastack = m_rcv_nxt;
 
+  uint32_t sack_len = 0;
   if (len) {
     size_t bytes_read = 0;
     bool result =
-        m_sbuf.ReadOffset(buffer.get() + HEADER_SIZE, len, offset, &bytes_read);
+        m_sbuf.ReadOffset(buffer + HEADER_SIZE, len, offset, &bytes_read);
     RTC_DCHECK(result);
     RTC_DCHECK(static_cast<uint32_t>(bytes_read) == len);
+  } else if (m_sack_enabled) {
+    sack_len = writeSackBlocks(buffer + HEADER_SIZE);
+    if (sack_len) {
+      buffer[13] |= FLAG_SACK;
+    }
   }
 
 #if _DEBUGMSG >= _DBG_VERBOSE
@@ -542,8 +576,9 @@ IPseudoTcpNotify::WriteResult PseudoTcp::packet(uint32_t seq,
                    << ">";
 #endif  // _DEBUGMSG
 
-  IPseudoTcpNotify::WriteResult wres = m_notify->TcpWritePacket(
-      this, reinterpret_cast<char*>(buffer.get()), len + HEADER_SIZE);
+  IPseudoTcpNotify::WriteResult wres =
+      m_notify->TcpWritePacket(this, reinterpret_cast<char*>(buffer),
+                               len + sack_len + HEADER_SIZE);
   // Note: When len is 0, this is an ACK packet.  We don't read the return value
   // for those, and thus we won't retry.  So go ahead and treat the packet as a
   // success (basically simulate as if it were dropped), which will prevent our
@@ -659,6 +694,14 @@ bool PseudoTcp::process(Segment& seg) {
     return false;
   }
 
+  // SACK blocks are not part of the data stream.
+  if (seg.flags & FLAG_SACK) {
+    if (m_sack_enabled) {
+      processSackBlocks(seg.data, seg.len);
+    }
+    seg.len = 0;
+  }
+
   // Check for control data
   bool bConnect = false;
   if (seg.flags & FLAG_CTL) {
@@ -759,9 +802,18 @@ bool PseudoTcp::process(Segment& seg) {
 #if _DEBUGMSG >= _DBG_NORMAL
         RTC_LOG(LS_INFO) << "recovery retransmit";
 #endif  // _DEBUGMSG
-        if (!transmit(m_slist.begin(), now)) {
-          closedown(ECONNABORTED);
-          return false;
+        SList::iterator rexmit = m_slist.begin();
+        if (m_sack_enabled && rexmit->seq < m_sack_rexmit_nxt) {
+          // Already retransmitted in this recovery, so continue with the
+          // next hole reported by the peer, if any.
+          rexmit = nextSackHole();
+        }
+        if (rexmit != m_slist.end()) {
+          if (!transmit(rexmit, now)) {
+            closedown(ECONNABORTED);
+            return false;
+          }
+          m_sack_rexmit_nxt = rexmit->seq + rexmit->len;
         }
         m_cwnd += m_mss - std::min(nAcked, m_cwnd);
       }
@@ -793,6 +845,7 @@ bool PseudoTcp::process(Segment& seg) {
           closedown(ECONNABORTED);
           return false;
         }
+        m_sack_rexmit_nxt = m_slist.front().seq + m_slist.front().len;
         m_recover = m_snd_nxt;
         uint32_t nInFlight = m_snd_nxt - m_snd_una;
         m_ssthresh = std::max(nInFlight / 2, 2 * m_mss);
@@ -800,7 +853,19 @@ bool PseudoTcp::process(Segment& seg) {
         // << nInFlight << "  m_mss: " << m_mss;
         m_cwnd = m_ssthresh + 3 * m_mss;
       } else if (m_dup_acks > 3) {
-        m_cwnd += m_mss;
+        // With SACK, the segment that left the network is replaced by the
+        // next lost one rather than by new data.
+        SList::iterator rexmit =
+            m_sack_enabled ? nextSackHole() : m_slist.end();
+        if (rexmit != m_slist.end()) {
+          if (!transmit(rexmit, now)) {
+            closedown(ECONNABORTED);
+            return false;
+          }
+          m_sack_rexmit_nxt = rexmit->seq + rexmit->len;
+        } else {
+          m_cwnd += m_mss;
+        }
       }
     } else {
       m_dup_acks = 0;
@@ -1043,6 +1108,61 @@ bool PseudoTcp::transmit(const SList::iterator& seg, uint32_t now) {
   return true;
 }
 
+uint32_t PseudoTcp::writeSackBlocks(uint8_t* buf) const {
+  // |m_rlist| is ordered by sequence number, so the blocks closest to
+  // |m_rcv_nxt| are reported if there are more than fit. Those are the ones
+  // the sender needs to repair the stream.
+  uint32_t num_blocks = 0;
+  RList::const_iterator it = m_rlist.begin();
+  while (it != m_rlist.end() && num_blocks < MAX_SACK_BLOCKS) {
+    uint32_t left = it->seq;
+    uint32_t right = it->seq + it->len;
+    // Merge overlapping and adjacent segments.
+    for (++it; it != m_rlist.end() && it->seq <= right; ++it) {
+      right = std::max(right, it->seq + it->len);
+    }
+    long_to_bytes(left, buf + num_blocks * SACK_BLOCK_SIZE);
+    long_to_bytes(right, buf + num_blocks * SACK_BLOCK_SIZE + 4);
+    ++num_blocks;
+  }
+  return num_blocks * SACK_BLOCK_SIZE;
+}
+
+void PseudoTcp::processSackBlocks(const char* data, uint32_t len) {
+  len = std::min(len, MAX_SACK_BLOCKS * SACK_BLOCK_SIZE);
+  for (uint32_t i = 0; i + SACK_BLOCK_SIZE <= len; i += SACK_BLOCK_SIZE) {
+    uint32_t left = bytes_to_long(data + i);
+    uint32_t right = bytes_to_long(data + i + 4);
+    // Ignore blocks outside of the data in flight.
+    if ((left >= right) || (left < m_snd_una) || (right > m_snd_nxt)) {
+      continue;
+    }
+    m_sack_high = std::max(m_sack_high, right);
+    for (SSegment& sseg : m_slist) {
+      if (sseg.seq >= right) {
+        break;
+      }
+      if ((sseg.seq >= left) && (sseg.seq + sseg.len <= right)) {
+        sseg.bSacked = true;
+      }
+    }
+  }
+}
+
+PseudoTcp::SList::iterator PseudoTcp::nextSackHole() {
+  for (SList::iterator it = m_slist.begin(); it != m_slist.end(); ++it) {
+    // Only segments followed by selectively acknowledged data are known to
+    // be lost.
+    if ((it->xmit == 0) || (it->seq >= m_sack_high)) {
+      break;
+    }
+    if (!it->bSacked && (it->seq >= m_sack_rexmit_nxt)) {
+      return it;
+    }
+  }
+  return m_slist.end();
+}
+
 void PseudoTcp::attemptSend(SendFlags sflags) {
   uint32_t now = Now();
 
@@ -1173,6 +1293,14 @@ void PseudoTcp::disableWindowScale() {
   m_support_wnd_scale = false;
 }
 
+void PseudoTcp::disableSack() {
+  m_support_sack = false;
+}
+
+size_t PseudoTcp::bufferMemoryUsage() const {
+  return m_rbuf.GetAllocated() + m_sbuf.GetAllocated();
+}
+
 void PseudoTcp::queueConnectMessage() {
   rtc::ByteBufferWriter buf;
 
@@ -1182,6 +1310,10 @@ void PseudoTcp::queueConnectMessage() {
     buf.WriteUInt8(1);
     buf.WriteUInt8(m_rwnd_scale);
   }
+  if (m_support_sack) {
+    buf.WriteUInt8(TCP_OPT_SACK_PERMITTED);
+    buf.WriteUInt8(0);
+  }
   m_snd_wnd = static_cast<uint32_t>(buf.Length());
   queue(buf.Data(), static_cast<uint32_t>(buf.Length()), true);
 }
@@ -1230,6 +1362,11 @@ void PseudoTcp::parseOptions(const char* data, uint32_t len) {
       m_swnd_scale = 0;
     }
   }
+
+  // Peers that don't support selective acknowledgements ignore the option.
+  m_sack_enabled =
+      m_support_sack && (options_specified.find(TCP_OPT_SACK_PERMITTED) !=
+                         options_specified.end());
 }
 
 void PseudoTcp::applyOption(char kind, const char* data, uint32_t len) {
@@ -1285,8 +1422,9 @@ void PseudoTcp::resizeReceiveBuffer(uint32_t new_size) {
 }
 
 PseudoTcp::LockedFifoBuffer::LockedFifoBuffer(size_t size)
-    : buffer_(new char[size]),
-      buffer_length_(size),
+    : buffer_(new char[std::min<size_t>(size, INITIAL_BUF_ALLOCATION)]),
+      buffer_length_(std::min<size_t>(size, INITIAL_BUF_ALLOCATION)),
+      capacity_(size),
       data_length_(0),
       read_position_(0) {}
 
@@ -1297,12 +1435,18 @@ size_t PseudoTcp::LockedFifoBuffer::GetBuffered() const {
   return data_length_;
 }
 
+size_t PseudoTcp::LockedFifoBuffer::GetAllocated() const {
+  webrtc::MutexLock lock(&mutex_);
+  return buffer_length_;
+}
+
 bool PseudoTcp::LockedFifoBuffer::SetCapacity(size_t size) {
   webrtc::MutexLock lock(&mutex_);
   if (data_length_ > size)
     return false;
 
-  if (size != buffer_length_) {
+  // Growing is deferred until the space is needed.
+  if (size < buffer_length_) {
     char* buffer = new char[size];
     const size_t copy = data_length_;
     const size_t tail_copy = std::min(copy, buffer_length_ - read_position_);
@@ -1312,6 +1456,7 @@ bool PseudoTcp::LockedFifoBuffer::SetCapacity(size_t size) {
     read_position_ = 0;
     buffer_length_ = size;
   }
+  capacity_ = size;
 
   return true;
 }
@@ -1376,13 +1521,16 @@ void PseudoTcp::LockedFifoBuffer::ConsumeReadData(size_t size) {
 
 void PseudoTcp::LockedFifoBuffer::ConsumeWriteBuffer(size_t size) {
   webrtc::MutexLock lock(&mutex_);
-  RTC_DCHECK(size <= buffer_length_ - data_length_);
+  RTC_DCHECK(size <= capacity_ - data_length_);
+  if (data_length_ + size > buffer_length_) {
+    GrowLocked(data_length_ + size);
+  }
   data_length_ += size;
 }
 
 bool PseudoTcp::LockedFifoBuffer::GetWriteRemaining(size_t* size) const {
   webrtc::MutexLock lock(&mutex_);
-  *size = buffer_length_ - data_length_;
+  *size = capacity_ - data_length_;
   return true;
 }
 
@@ -1411,13 +1559,16 @@ bool PseudoTcp::LockedFifoBuffer::WriteOffsetLocked(const void* buffer,
                                                     size_t bytes,
                                                     size_t offset,
                                                     size_t* bytes_written) {
-  if (data_length_ + offset >= buffer_length_)
+  if (data_length_ + offset >= capacity_)
     return false;
 
-  const size_t available = buffer_length_ - data_length_ - offset;
+  const size_t available = capacity_ - data_length_ - offset;
+  const size_t copy = std::min(bytes, available);
+  if (data_length_ + offset + copy > buffer_length_) {
+    GrowLocked(data_length_ + offset + copy);
+  }
   const size_t write_position =
       (read_position_ + data_length_ + offset) % buffer_length_;
-  const size_t copy = std::min(bytes, available);
   const size_t tail_copy = std::min(copy, buffer_length_ - write_position);
   const char* const p = static_cast<const char*>(buffer);
   memcpy(&buffer_[write_position], p, tail_copy);
@@ -1429,4 +1580,19 @@ bool PseudoTcp::LockedFifoBuffer::WriteOffsetLocked(const void* buffer,
   return true;
 }
 
+void PseudoTcp::LockedFifoBuffer::GrowLocked(size_t size) {
+  RTC_DCHECK_LE(size, capacity_);
+  const size_t length =
+      std::min(capacity_, std::max(size, 2 * buffer_length_));
+  char* buffer = new char[length];
+  // Copy the whole buffer rather than only the readable data, since data
+  // received out of order is stored past it.
+  const size_t tail_copy = buffer_length_ - read_position_;
+  memcpy(buffer, &buffer_[read_position_], tail_copy);
+  memcpy(buffer + tail_copy, &buffer_[0], read_position_);
+  buffer_.reset(buffer);
+  read_position_ = 0;
+  buffer_length_ = length;
+}
+
 }  // namespace cricket
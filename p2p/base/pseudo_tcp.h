@@ -16,6 +16,7 @@
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "rtc_base/synchronization/mutex.h"
 #include "rtc_base/system/rtc_export.h"
@@ -130,11 +131,13 @@ class RTC_EXPORT PseudoTcp {
 
   struct SSegment {
     SSegment(uint32_t s, uint32_t l, bool c)
-        : seq(s), len(l), /*tstamp(0),*/ xmit(0), bCtrl(c) {}
+        : seq(s), len(l), /*tstamp(0),*/ xmit(0), bCtrl(c), bSacked(false) {}
     uint32_t seq, len;
     // uint32_t tstamp;
     uint8_t xmit;
     bool bCtrl;
+    // Whether the peer has selectively acknowledged this segment.
+    bool bSacked;
   };
   typedef std::list<SSegment> SList;
 
@@ -152,6 +155,8 @@ class RTC_EXPORT PseudoTcp {
   // |offset| is the offset to read from |m_sbuf|.
   // |len| is the number of bytes to read from |m_sbuf| as payload. If this
   // value is 0 then this is an ACK packet, otherwise this packet has payload.
+  // ACK packets carry SACK blocks instead if SACK has been negotiated and
+  // segments were received out of order.
   IPseudoTcpNotify::WriteResult packet(uint32_t seq,
                                        uint8_t flags,
                                        uint32_t offset,
@@ -167,6 +172,15 @@ class RTC_EXPORT PseudoTcp {
   bool process(Segment& seg);
   bool transmit(const SList::iterator& seg, uint32_t now);
 
+  // Writes SACK blocks for the out-of-order segments in |m_rlist| to |buf|,
+  // which has room for MAX_SACK_BLOCKS. Returns the number of bytes written.
+  uint32_t writeSackBlocks(uint8_t* buf) const;
+  // Marks the segments covered by the SACK blocks in |data| as received.
+  void processSackBlocks(const char* data, uint32_t len);
+  // Returns the first segment at or after |m_sack_rexmit_nxt| that the peer
+  // has not received although it received later data, or |m_slist.end()|.
+  SList::iterator nextSackHole();
+
   void adjustMTU();
 
  protected:
@@ -177,6 +191,14 @@ class RTC_EXPORT PseudoTcp {
   // support for testing backward compatibility.
   void disableWindowScale();
 
+  // This method is only used in tests, to disable selective acknowledgement
+  // support for testing backward compatibility.
+  void disableSack();
+
+  // This method is used in test only to query the memory allocated for the
+  // send and receive buffers.
+  size_t bufferMemoryUsage() const;
+
  private:
   // Queue the connect message with TCP options.
   void queueConnectMessage();
@@ -197,12 +219,16 @@ class RTC_EXPORT PseudoTcp {
   // window scale factor |m_swnd_scale| accordingly.
   void resizeReceiveBuffer(uint32_t new_size);
 
+  // A ring buffer with a capacity of |size| bytes. Memory is allocated as
+  // data is written, so that the buffer only grows as large as the window
+  // that is actually used.
   class LockedFifoBuffer final {
    public:
     explicit LockedFifoBuffer(size_t size);
     ~LockedFifoBuffer();
 
     size_t GetBuffered() const;
+    size_t GetAllocated() const;
     bool SetCapacity(size_t size);
     bool ReadOffset(void* buffer,
                     size_t bytes,
@@ -229,11 +255,16 @@ class RTC_EXPORT PseudoTcp {
                            size_t offset,
                            size_t* bytes_written)
         RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+    // Grows the allocated buffer to hold at least |size| bytes, starting at
+    // the read position.
+    void GrowLocked(size_t size) RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
     // the allocated buffer
     std::unique_ptr<char[]> buffer_ RTC_GUARDED_BY(mutex_);
     // size of the allocated buffer
     size_t buffer_length_ RTC_GUARDED_BY(mutex_);
+    // maximum size of the buffer
+    size_t capacity_ RTC_GUARDED_BY(mutex_);
     // amount of readable data in the buffer
     size_t data_length_ RTC_GUARDED_BY(mutex_);
     // offset to the readable data
@@ -264,6 +295,16 @@ class RTC_EXPORT PseudoTcp {
   uint8_t m_swnd_scale;  // Window scale factor.
   LockedFifoBuffer m_sbuf;
 
+  // Selective acknowledgements (RFC 2018), used if both sides support them.
+  bool m_sack_enabled;
+  // Highest sequence number selectively acknowledged by the peer, and the
+  // sequence number up to which holes have been retransmitted in the current
+  // recovery.
+  uint32_t m_sack_high, m_sack_rexmit_nxt;
+
+  // Reused for building outgoing packets.
+  std::vector<uint8_t> m_packet_buf;
+
   // Maximum segment size, estimated protocol level, largest segment sent
   uint32_t m_mss, m_msslevel, m_largest, m_mtu_advise;
   // Retransmit timer
@@ -288,6 +329,10 @@ class RTC_EXPORT PseudoTcp {
   // This is used by unit tests to test backward compatibility of
   // PseudoTcp implementations that don't support window scaling.
   bool m_support_wnd_scale;
+
+  // This is used by unit tests to test backward compatibility of
+  // PseudoTcp implementations that don't support selective acknowledgements.
+  bool m_support_sack;
 };
 
 }  // namespace cricket
@@ -10,21 +10,32 @@
 
 #include "p2p/base/pseudo_tcp.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include <algorithm>
 #include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include "rtc_base/async_packet_socket.h"
+#include "rtc_base/async_udp_socket.h"
+#include "rtc_base/byte_order.h"
 #include "rtc_base/gunit.h"
 #include "rtc_base/helpers.h"
 #include "rtc_base/location.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/memory_stream.h"
 #include "rtc_base/message_handler.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/third_party/sigslot/sigslot.h"
 #include "rtc_base/thread.h"
 #include "rtc_base/time_utils.h"
+#include "rtc_base/virtual_socket_server.h"
 #include "test/gtest.h"
 
 using cricket::PseudoTcp;
@@ -41,6 +52,10 @@ class PseudoTcpForTest : public cricket::PseudoTcp {
   bool isReceiveBufferFull() const { return PseudoTcp::isReceiveBufferFull(); }
 
   void disableWindowScale() { PseudoTcp::disableWindowScale(); }
+
+  void disableSack() { PseudoTcp::disableSack(); }
+
+  size_t bufferMemoryUsage() const { return PseudoTcp::bufferMemoryUsage(); }
 };
 
 class PseudoTcpTestBase : public ::testing::Test,
@@ -101,6 +116,8 @@ class PseudoTcpTestBase : public ::testing::Test,
   }
   void DisableRemoteWindowScale() { remote_.disableWindowScale(); }
   void DisableLocalWindowScale() { local_.disableWindowScale(); }
+  void DisableRemoteSack() { remote_.disableSack(); }
+  void DisableLocalSack() { local_.disableSack(); }
 
  protected:
   int Connect() {
@@ -747,6 +764,38 @@ TEST_F(PseudoTcpTest, TestSendBothUseLargeWindowScale) {
   TestTransfer(10000000);
 }
 
+// Test that buffers are only allocated as they are used, so that a large
+// window doesn't cost memory up front.
+TEST_F(PseudoTcpTest, TestBuffersAllocatedOnDemand) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetRemoteOptRcvBuf(1000000);
+  SetLocalOptRcvBuf(1000000);
+  EXPECT_LT(local_.bufferMemoryUsage(), 100000u);
+  EXPECT_LT(remote_.bufferMemoryUsage(), 100000u);
+  TestTransfer(1000000);
+}
+
+// Test packet loss with a sender that doesn't support selective
+// acknowledgements.
+TEST_F(PseudoTcpTest, TestSendWithLossLocalNoSack) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetLoss(10);
+  DisableLocalSack();
+  TestTransfer(100000);
+}
+
+// Test packet loss with a receiver that doesn't support selective
+// acknowledgements.
+TEST_F(PseudoTcpTest, TestSendWithLossRemoteNoSack) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  SetLoss(10);
+  DisableRemoteSack();
+  TestTransfer(100000);
+}
+
 // Test using a small receive buffer.
 TEST_F(PseudoTcpTest, TestSendSmallReceiveBuffer) {
   SetLocalMtu(1500);
@@ -869,6 +918,156 @@ TEST_F(PseudoTcpTestReceiveWindow, TestSetReceiveWindowSize) {
   EXPECT_EQ(100000u, EstimateReceiveWindowSize());
 }
 
+// Sends the packets over a VirtualSocketServer network with the given loss
+// rate, with selective acknowledgements enabled or disabled on both sides.
+class PseudoTcpTestVirtualNetwork
+    : public PseudoTcpTest,
+      public ::testing::WithParamInterface<std::tuple<int, bool>>,
+      public sigslot::has_slots<> {
+ public:
+  PseudoTcpTestVirtualNetwork() : thread_(&vss_) {
+    local_socket_.reset(rtc::AsyncUDPSocket::Create(
+        &vss_, rtc::SocketAddress("127.0.0.1", 0)));
+    remote_socket_.reset(rtc::AsyncUDPSocket::Create(
+        &vss_, rtc::SocketAddress("127.0.0.1", 0)));
+    local_socket_->SignalReadPacket.connect(
+        this, &PseudoTcpTestVirtualNetwork::OnReadPacket);
+    remote_socket_->SignalReadPacket.connect(
+        this, &PseudoTcpTestVirtualNetwork::OnReadPacket);
+  }
+
+ protected:
+  WriteResult TcpWritePacket(PseudoTcp* tcp,
+                             const char* buffer,
+                             size_t len) override {
+    rtc::AsyncPacketSocket* socket =
+        (tcp == &local_) ? local_socket_.get() : remote_socket_.get();
+    rtc::AsyncPacketSocket* peer_socket =
+        (tcp == &local_) ? remote_socket_.get() : local_socket_.get();
+    socket->SendTo(buffer, len, peer_socket->GetLocalAddress(),
+                   rtc::PacketOptions());
+    return WR_SUCCESS;
+  }
+
+  void OnReadPacket(rtc::AsyncPacketSocket* socket,
+                    const char* data,
+                    size_t len,
+                    const rtc::SocketAddress& remote_addr,
+                    const int64_t& packet_time_us) {
+    if (socket == local_socket_.get()) {
+      local_.NotifyPacket(data, len);
+      UpdateLocalClock();
+    } else {
+      remote_.NotifyPacket(data, len);
+      UpdateRemoteClock();
+    }
+  }
+
+  rtc::VirtualSocketServer vss_;
+  rtc::AutoSocketServerThread thread_;
+  std::unique_ptr<rtc::AsyncPacketSocket> local_socket_;
+  std::unique_ptr<rtc::AsyncPacketSocket> remote_socket_;
+};
+
+// Benchmarks the throughput under random packet loss with a 20 ms RTT.
+TEST_P(PseudoTcpTestVirtualNetwork, DISABLED_ThroughputWithLoss) {
+  const int kTransferSize = 500000;
+  const int loss_percent = std::get<0>(GetParam());
+  const bool sack = std::get<1>(GetParam());
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  if (!sack) {
+    DisableLocalSack();
+    DisableRemoteSack();
+  }
+  vss_.set_delay_mean(10);
+  vss_.UpdateDelayDistribution();
+  vss_.set_drop_probability(loss_percent / 100.0);
+
+  int64_t start_ms = rtc::TimeMillis();
+  TestTransfer(kTransferSize);
+  int64_t elapsed_ms = std::max<int64_t>(rtc::TimeMillis() - start_ms, 1);
+  printf("Loss %d%%, SACK %s: %d bytes in %d ms (%d kbps)\n", loss_percent,
+         sack ? "on" : "off", kTransferSize, static_cast<int>(elapsed_ms),
+         static_cast<int>(kTransferSize * 8 / elapsed_ms));
+}
+
+INSTANTIATE_TEST_SUITE_P(PseudoTcpTest,
+                         PseudoTcpTestVirtualNetwork,
+                         ::testing::Combine(::testing::Values(0, 1, 5),
+                                            ::testing::Bool()));
+
+// Drops chosen data segments from |local_| the first time they are sent, and
+// records the segments sent by |local_| and the SACK blocks sent by |remote_|.
+class PseudoTcpTestSelectiveAck : public PseudoTcpTest {
+ public:
+  // Flags of the segment header, as defined in pseudo_tcp.cc.
+  static constexpr uint8_t kFlagCtl = 0x02;
+  static constexpr uint8_t kFlagSack = 0x08;
+  static constexpr size_t kHeaderSize = 24;
+  static constexpr size_t kSackBlockSize = 8;
+
+  // Drops the |index|th data segment sent by |local_|, counting from 0.
+  void DropDataSegment(int index) { segments_to_drop_.insert(index); }
+
+ protected:
+  WriteResult TcpWritePacket(PseudoTcp* tcp,
+                             const char* buffer,
+                             size_t len) override {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer);
+    const uint8_t flags = data[13];
+    if (tcp == &local_ && len > kHeaderSize && !(flags & kFlagCtl)) {
+      const uint32_t seq = rtc::GetBE32(data + 4);
+      if (++transmissions_[seq] > 1) {
+        retransmitted_.insert(seq);
+      } else if (segments_to_drop_.count(num_data_segments_++) > 0) {
+        dropped_.insert(seq);
+        dropped_ends_.insert(seq + static_cast<uint32_t>(len - kHeaderSize));
+        return WR_SUCCESS;
+      }
+    }
+    if (tcp == &remote_ && (flags & kFlagSack)) {
+      EXPECT_EQ((len - kHeaderSize) % kSackBlockSize, 0u);
+      const uint32_t ack = rtc::GetBE32(data + 8);
+      for (size_t offset = kHeaderSize; offset + kSackBlockSize <= len;
+           offset += kSackBlockSize) {
+        const uint32_t left = rtc::GetBE32(data + offset);
+        // SACK blocks only cover data above the cumulative ACK.
+        EXPECT_GT(left, ack);
+        EXPECT_GT(rtc::GetBE32(data + offset + 4), left);
+        sack_left_edges_.insert(left);
+      }
+    }
+    return PseudoTcpTest::TcpWritePacket(tcp, buffer, len);
+  }
+
+  std::set<int> segments_to_drop_;
+  int num_data_segments_ = 0;
+  std::map<uint32_t, int> transmissions_;
+  // Sequence numbers of the dropped segments and of the bytes following them.
+  std::set<uint32_t> dropped_;
+  std::set<uint32_t> dropped_ends_;
+  std::set<uint32_t> retransmitted_;
+  std::set<uint32_t> sack_left_edges_;
+};
+
+// Test that with segments lost in the middle of the transfer, the receiver
+// reports the data beyond each hole with SACK blocks and the sender only
+// retransmits the lost segments.
+TEST_F(PseudoTcpTestSelectiveAck, RetransmitsOnlyHoles) {
+  SetLocalMtu(1500);
+  SetRemoteMtu(1500);
+  for (int index : {20, 23, 40}) {
+    DropDataSegment(index);
+  }
+  TestTransfer(100000);
+  ASSERT_EQ(dropped_.size(), 3u);
+  for (uint32_t end : dropped_ends_) {
+    EXPECT_EQ(sack_left_edges_.count(end), 1u);
+  }
+  EXPECT_EQ(retransmitted_, dropped_);
+}
+
 /* Test sending data with mismatched MTUs. We should detect this and reduce
 // our packet size accordingly.
 // TODO(?): This doesn't actually work right now. The current code
@@ -0,0 +1,157 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "p2p/base/sharded_turn_server.h"
+
+#include <utility>
+
+#include "p2p/base/basic_packet_socket_factory.h"
+#include "rtc_base/async_udp_socket.h"
+#include "rtc_base/checks.h"
+#include "rtc_base/logging.h"
+
+namespace cricket {
+
+namespace {
+
+const int kListenBacklog = 5;
+
+}  // namespace
+
+ShardedTurnServer::ShardedTurnServer(int num_shards, const Config& config) {
+  RTC_DCHECK_GT(num_shards, 0);
+  shards_.resize(num_shards);
+  for (Shard& shard : shards_) {
+    shard.thread = rtc::Thread::CreateWithSocketServer();
+    shard.thread->SetName("TurnServerShard", nullptr);
+    shard.thread->Start();
+    shard.thread->Invoke<void>(RTC_FROM_HERE, [&shard, &config] {
+      shard.server = std::make_unique<TurnServer>(shard.thread.get());
+      shard.server->set_realm(config.realm);
+      shard.server->set_software(config.software);
+      shard.server->set_auth_hook(config.auth_hook);
+      shard.server->set_enable_otu_nonce(config.enable_otu_nonce);
+      shard.server->set_reject_private_addresses(
+          config.reject_private_addresses);
+      shard.server->set_enable_permission_checks(
+          config.enable_permission_checks);
+    });
+  }
+}
+
+ShardedTurnServer::~ShardedTurnServer() {
+  RTC_DCHECK_RUN_ON(&sequence_checker_);
+  for (Shard& shard : shards_) {
+    shard.thread->Invoke<void>(RTC_FROM_HERE,
+                               [&shard] { shard.server = nullptr; });
+    shard.thread->Stop();
+  }
+}
+
+bool ShardedTurnServer::AddInternalSocket(const rtc::SocketAddress& address,
+                                          ProtocolType proto,
+                                          rtc::SocketAddress* bound_address) {
+  RTC_DCHECK_RUN_ON(&sequence_checker_);
+  if (proto != PROTO_UDP && proto != PROTO_TCP) {
+    RTC_LOG(LS_ERROR) << "Unsupported protocol for a sharded TURN server: "
+                      << proto;
+    return false;
+  }
+  rtc::SocketAddress shard_address = address;
+  for (Shard& shard : shards_) {
+    bool added = shard.thread->Invoke<bool>(RTC_FROM_HERE, [&] {
+      rtc::AsyncSocket* socket = CreateSocket(
+          &shard, shard_address,
+          proto == PROTO_UDP ? SOCK_DGRAM : SOCK_STREAM);
+      if (!socket) {
+        return false;
+      }
+      // The other shards share the port picked by the first one.
+      shard_address = socket->GetLocalAddress();
+      if (proto == PROTO_UDP) {
+        shard.server->AddInternalSocket(new rtc::AsyncUDPSocket(socket),
+                                        proto);
+        return true;
+      }
+      if (socket->Listen(kListenBacklog) < 0) {
+        RTC_LOG(LS_ERROR) << "Listen() failed with error "
+                          << socket->GetError();
+        delete socket;
+        return false;
+      }
+      shard.server->AddInternalServerSocket(socket, proto);
+      return true;
+    });
+    if (!added) {
+      return false;
+    }
+  }
+  if (bound_address) {
+    *bound_address = shard_address;
+  }
+  return true;
+}
+
+void ShardedTurnServer::SetExternalAddress(const rtc::SocketAddress& address) {
+  RTC_DCHECK_RUN_ON(&sequence_checker_);
+  for (Shard& shard : shards_) {
+    shard.thread->Invoke<void>(RTC_FROM_HERE, [&shard, &address] {
+      shard.server->SetExternalSocketFactory(
+          new rtc::BasicPacketSocketFactory(shard.thread.get()), address);
+    });
+  }
+}
+
+size_t ShardedTurnServer::GetNumAllocations() const {
+  size_t num_allocations = 0;
+  for (size_t shard_allocations : GetNumAllocationsPerShard()) {
+    num_allocations += shard_allocations;
+  }
+  return num_allocations;
+}
+
+std::vector<size_t> ShardedTurnServer::GetNumAllocationsPerShard() const {
+  RTC_DCHECK_RUN_ON(&sequence_checker_);
+  std::vector<size_t> num_allocations;
+  for (const Shard& shard : shards_) {
+    num_allocations.push_back(shard.thread->Invoke<size_t>(
+        RTC_FROM_HERE,
+        [&shard] { return shard.server->allocations().size(); }));
+  }
+  return num_allocations;
+}
+
+rtc::AsyncSocket* ShardedTurnServer::CreateSocket(
+    Shard* shard,
+    const rtc::SocketAddress& address,
+    int type) {
+  RTC_DCHECK_RUN_ON(shard->thread.get());
+  std::unique_ptr<rtc::AsyncSocket> socket(
+      shard->thread->socketserver()->CreateAsyncSocket(address.family(),
+                                                        type));
+  if (!socket) {
+    return nullptr;
+  }
+  // Only needed when several shards bind to the address.
+  if (shards_.size() > 1 &&
+      socket->SetOption(rtc::Socket::OPT_REUSEPORT, 1) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to enable SO_REUSEPORT, error "
+                      << socket->GetError();
+    return nullptr;
+  }
+  if (socket->Bind(address) < 0) {
+    RTC_LOG(LS_ERROR) << "Bind() to " << address.ToSensitiveString()
+                      << " failed with error " << socket->GetError();
+    return nullptr;
+  }
+  return socket.release();
+}
+
+}  // namespace cricket
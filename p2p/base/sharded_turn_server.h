@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef P2P_BASE_SHARDED_TURN_SERVER_H_
+#define P2P_BASE_SHARDED_TURN_SERVER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/sequence_checker.h"
+#include "p2p/base/port_interface.h"
+#include "p2p/base/turn_server.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/thread.h"
+
+namespace cricket {
+
+// Runs a TURN server on several threads. Each shard is a regular TurnServer
+// with its own thread, internal sockets and allocations. The internal sockets
+// of all shards are bound to the same addresses with SO_REUSEPORT, so that
+// the kernel distributes the clients over the shards by the hash of their
+// 5-tuple. All packets of a client, and of the peers of its allocation, are
+// therefore handled by the same shard, and the shards don't share any state.
+//
+// Since a client is served by the same shard only as long as the set of
+// sockets bound to the address doesn't change, all internal sockets should be
+// added before the server starts serving clients.
+class ShardedTurnServer {
+ public:
+  struct Config {
+    std::string realm;
+    std::string software;
+    // Not owned. Called on the threads of all shards, so it must be thread
+    // safe.
+    TurnAuthInterface* auth_hook = nullptr;
+    bool enable_otu_nonce = false;
+    bool reject_private_addresses = false;
+    bool enable_permission_checks = true;
+  };
+
+  ShardedTurnServer(int num_shards, const Config& config);
+  ShardedTurnServer(const ShardedTurnServer&) = delete;
+  ShardedTurnServer& operator=(const ShardedTurnServer&) = delete;
+  ~ShardedTurnServer();
+
+  // Starts listening for clients on |address| on all shards. |proto| must be
+  // PROTO_UDP or PROTO_TCP. If the port of |address| is 0, the port picked
+  // by the first shard is used by all of them. On success, returns true and
+  // stores the bound address in |bound_address|, if not null.
+  bool AddInternalSocket(const rtc::SocketAddress& address,
+                         ProtocolType proto,
+                         rtc::SocketAddress* bound_address);
+  // Creates the relay sockets of the allocations on |address|.
+  void SetExternalAddress(const rtc::SocketAddress& address);
+
+  int num_shards() const { return static_cast<int>(shards_.size()); }
+  // Returns the number of allocations of all shards.
+  size_t GetNumAllocations() const;
+  // Returns the number of allocations of each shard.
+  std::vector<size_t> GetNumAllocationsPerShard() const;
+
+ private:
+  struct Shard {
+    std::unique_ptr<rtc::Thread> thread;
+    std::unique_ptr<TurnServer> server;
+  };
+
+  // Creates a socket bound to |address| with SO_REUSEPORT on |shard|'s
+  // thread.
+  rtc::AsyncSocket* CreateSocket(Shard* shard,
+                                 const rtc::SocketAddress& address,
+                                 int type);
+
+  webrtc::SequenceChecker sequence_checker_;
+  std::vector<Shard> shards_;
+};
+
+}  // namespace cricket
+
+#endif  // P2P_BASE_SHARDED_TURN_SERVER_H_
@@ -0,0 +1,369 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "p2p/base/sharded_turn_server.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/transport/stun.h"
+#include "rtc_base/async_udp_socket.h"
+#include "rtc_base/byte_buffer.h"
+#include "rtc_base/event.h"
+#include "rtc_base/gunit.h"
+#include "rtc_base/helpers.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/cpu_info.h"
+#include "test/gmock.h"
+#include "test/gtest.h"
+
+namespace cricket {
+namespace {
+
+using ::testing::Each;
+using ::testing::Gt;
+
+constexpr int kTimeoutMs = 5000;
+constexpr int kChannelId = 0x4000;
+constexpr char kRealm[] = "example.org";
+constexpr char kUsername[] = "user";
+constexpr char kPassword[] = "password";
+
+const rtc::SocketAddress kLoopbackAddress("127.0.0.1", 0);
+
+class TestAuth : public TurnAuthInterface {
+ public:
+  bool GetKey(const std::string& username,
+              const std::string& realm,
+              std::string* key) override {
+    return ComputeStunCredentialHash(username, realm, kPassword, key);
+  }
+};
+
+// Receives the packets relayed to a peer, and sends them back to the relay
+// address they came from.
+class EchoPeer : public sigslot::has_slots<> {
+ public:
+  explicit EchoPeer(rtc::Thread* thread) : thread_(thread) {
+    thread_->Invoke<void>(RTC_FROM_HERE, [this] {
+      socket_.reset(rtc::AsyncUDPSocket::Create(thread_->socketserver(),
+                                                kLoopbackAddress));
+      socket_->SignalReadPacket.connect(this, &EchoPeer::OnReadPacket);
+    });
+  }
+  ~EchoPeer() override {
+    thread_->Invoke<void>(RTC_FROM_HERE, [this] { socket_ = nullptr; });
+  }
+
+  rtc::SocketAddress address() const {
+    return thread_->Invoke<rtc::SocketAddress>(
+        RTC_FROM_HERE, [this] { return socket_->GetLocalAddress(); });
+  }
+  int received_packets() const { return received_packets_; }
+  size_t last_packet_size() const { return last_packet_size_; }
+
+ private:
+  void OnReadPacket(rtc::AsyncPacketSocket* socket,
+                    const char* data,
+                    size_t size,
+                    const rtc::SocketAddress& addr,
+                    const int64_t& /* packet_time_us */) {
+    ++received_packets_;
+    last_packet_size_ = size;
+    socket_->SendTo(data, size, addr, rtc::PacketOptions());
+  }
+
+  rtc::Thread* const thread_;
+  std::unique_ptr<rtc::AsyncUDPSocket> socket_;
+  std::atomic<int> received_packets_{0};
+  std::atomic<size_t> last_packet_size_{0};
+};
+
+// Load generator: a minimal TURN client that allocates a relay address, binds
+// a channel to a peer and sends ChannelData through it.
+class TurnLoadClient : public sigslot::has_slots<> {
+ public:
+  TurnLoadClient(rtc::Thread* thread, const rtc::SocketAddress& server_address)
+      : thread_(thread), server_address_(server_address) {}
+  ~TurnLoadClient() override {
+    thread_->Invoke<void>(RTC_FROM_HERE, [this] { socket_ = nullptr; });
+  }
+
+  // Starts allocating a relay address and binding |kChannelId| to |peer|.
+  // |ready()| is signaled once the channel is bound.
+  void Start(const rtc::SocketAddress& peer) {
+    thread_->PostTask(RTC_FROM_HERE, [this, peer] {
+      peer_ = peer;
+      socket_.reset(rtc::AsyncUDPSocket::Create(thread_->socketserver(),
+                                                kLoopbackAddress));
+      socket_->SignalReadPacket.connect(this, &TurnLoadClient::OnReadPacket);
+      SendAllocateRequest();
+    });
+  }
+
+  // Sends |num_packets| ChannelData messages with |payload_size| bytes of
+  // application data. If |pad| is true, the messages are padded to a multiple
+  // of 4 bytes, as over TCP.
+  void SendData(int num_packets, size_t payload_size, bool pad = false) {
+    thread_->PostTask(RTC_FROM_HERE, [=] {
+      rtc::ByteBufferWriter buf;
+      buf.WriteUInt16(kChannelId);
+      buf.WriteUInt16(static_cast<uint16_t>(payload_size));
+      buf.WriteString(std::string(payload_size, 'x'));
+      if (pad) {
+        buf.WriteString(std::string((4 - payload_size % 4) % 4, '\0'));
+      }
+      for (int i = 0; i < num_packets; ++i) {
+        socket_->SendTo(buf.Data(), buf.Length(), server_address_,
+                        rtc::PacketOptions());
+      }
+    });
+  }
+
+  rtc::Event& ready() { return ready_; }
+  int received_packets() const { return received_packets_; }
+
+ private:
+  void SendAllocateRequest() {
+    TurnMessage request;
+    request.SetType(STUN_ALLOCATE_REQUEST);
+    request.AddAttribute(std::make_unique<StunUInt32Attribute>(
+        STUN_ATTR_REQUESTED_TRANSPORT, IPPROTO_UDP << 24));
+    SendRequest(&request);
+  }
+
+  void SendChannelBindRequest() {
+    TurnMessage request;
+    request.SetType(TURN_CHANNEL_BIND_REQUEST);
+    request.AddAttribute(std::make_unique<StunUInt32Attribute>(
+        STUN_ATTR_CHANNEL_NUMBER, kChannelId << 16));
+    request.AddAttribute(std::make_unique<StunXorAddressAttribute>(
+        STUN_ATTR_XOR_PEER_ADDRESS, peer_));
+    SendRequest(&request);
+  }
+
+  void SendRequest(TurnMessage* request) {
+    request->SetTransactionID(
+        rtc::CreateRandomString(kStunTransactionIdLength));
+    if (!nonce_.empty()) {
+      request->AddAttribute(std::make_unique<StunByteStringAttribute>(
+          STUN_ATTR_USERNAME, kUsername));
+      request->AddAttribute(
+          std::make_unique<StunByteStringAttribute>(STUN_ATTR_REALM, kRealm));
+      request->AddAttribute(
+          std::make_unique<StunByteStringAttribute>(STUN_ATTR_NONCE, nonce_));
+      request->AddMessageIntegrity(key_);
+    }
+    rtc::ByteBufferWriter buf;
+    request->Write(&buf);
+    socket_->SendTo(buf.Data(), buf.Length(), server_address_,
+                    rtc::PacketOptions());
+  }
+
+  void OnReadPacket(rtc::AsyncPacketSocket* socket,
+                    const char* data,
+                    size_t size,
+                    const rtc::SocketAddress& addr,
+                    const int64_t& /* packet_time_us */) {
+    if (size >= 4 && (rtc::GetBE16(data) & 0xC000) == 0x4000) {
+      ++received_packets_;
+      return;
+    }
+    TurnMessage response;
+    rtc::ByteBufferReader buf(data, size);
+    if (!response.Read(&buf)) {
+      return;
+    }
+    switch (response.type()) {
+      case STUN_ALLOCATE_ERROR_RESPONSE: {
+        const StunByteStringAttribute* nonce_attr =
+            response.GetByteString(STUN_ATTR_NONCE);
+        if (!nonce_.empty() || !nonce_attr) {
+          return;
+        }
+        nonce_ = nonce_attr->GetString();
+        ComputeStunCredentialHash(kUsername, kRealm, kPassword, &key_);
+        SendAllocateRequest();
+        break;
+      }
+      case STUN_ALLOCATE_RESPONSE:
+        SendChannelBindRequest();
+        break;
+      case TURN_CHANNEL_BIND_RESPONSE:
+        ready_.Set();
+        break;
+    }
+  }
+
+  rtc::Thread* const thread_;
+  const rtc::SocketAddress server_address_;
+  std::unique_ptr<rtc::AsyncUDPSocket> socket_;
+  rtc::SocketAddress peer_;
+  std::string nonce_;
+  std::string key_;
+  rtc::Event ready_;
+  std::atomic<int> received_packets_{0};
+};
+
+class ShardedTurnServerTest : public ::testing::Test {
+ protected:
+  void CreateServer(int num_shards) {
+    ShardedTurnServer::Config config;
+    config.realm = kRealm;
+    config.auth_hook = &auth_;
+    server_ = std::make_unique<ShardedTurnServer>(num_shards, config);
+    ASSERT_TRUE(server_->AddInternalSocket(kLoopbackAddress, PROTO_UDP,
+                                           &server_address_));
+    server_->SetExternalAddress(kLoopbackAddress);
+  }
+
+  std::vector<std::unique_ptr<TurnLoadClient>> CreateClients(
+      int num_clients,
+      const std::vector<rtc::Thread*>& threads,
+      const rtc::SocketAddress& peer) {
+    std::vector<std::unique_ptr<TurnLoadClient>> clients;
+    for (int i = 0; i < num_clients; ++i) {
+      clients.push_back(std::make_unique<TurnLoadClient>(
+          threads[i % threads.size()], server_address_));
+      clients.back()->Start(peer);
+    }
+    for (auto& client : clients) {
+      EXPECT_TRUE(client->ready().Wait(kTimeoutMs));
+    }
+    return clients;
+  }
+
+  TestAuth auth_;
+  std::unique_ptr<ShardedTurnServer> server_;
+  rtc::SocketAddress server_address_;
+};
+
+}  // namespace
+
+// Several shards share their sockets with SO_REUSEPORT, which is only
+// supported on POSIX.
+#if defined(WEBRTC_POSIX)
+TEST_F(ShardedTurnServerTest, RelaysChannelDataWithTwoShards) {
+  // Enough clients that the kernel practically always spreads them over both
+  // shards.
+  constexpr int kNumClients = 32;
+  CreateServer(/*num_shards=*/2);
+  EXPECT_EQ(server_->num_shards(), 2);
+  EXPECT_NE(server_address_.port(), 0);
+
+  std::unique_ptr<rtc::Thread> client_thread =
+      rtc::Thread::CreateWithSocketServer();
+  client_thread->Start();
+  std::unique_ptr<rtc::Thread> peer_thread =
+      rtc::Thread::CreateWithSocketServer();
+  peer_thread->Start();
+  EchoPeer peer(peer_thread.get());
+
+  auto clients = CreateClients(kNumClients, {client_thread.get()},
+                               peer.address());
+  EXPECT_EQ(server_->GetNumAllocations(), static_cast<size_t>(kNumClients));
+  EXPECT_THAT(server_->GetNumAllocationsPerShard(), Each(Gt(0u)));
+
+  for (auto& client : clients) {
+    client->SendData(/*num_packets=*/1, /*payload_size=*/100);
+  }
+  for (auto& client : clients) {
+    EXPECT_EQ_WAIT(1, client->received_packets(), kTimeoutMs);
+  }
+  EXPECT_EQ(kNumClients, peer.received_packets());
+
+  clients.clear();
+  client_thread->Stop();
+}
+#endif  // defined(WEBRTC_POSIX)
+
+TEST_F(ShardedTurnServerTest, DoesNotRelayChannelDataPadding) {
+  CreateServer(/*num_shards=*/1);
+  std::unique_ptr<rtc::Thread> client_thread =
+      rtc::Thread::CreateWithSocketServer();
+  client_thread->Start();
+  std::unique_ptr<rtc::Thread> peer_thread =
+      rtc::Thread::CreateWithSocketServer();
+  peer_thread->Start();
+  EchoPeer peer(peer_thread.get());
+
+  auto clients = CreateClients(1, {client_thread.get()}, peer.address());
+  clients[0]->SendData(/*num_packets=*/1, /*payload_size=*/5, /*pad=*/true);
+  EXPECT_EQ_WAIT(1, clients[0]->received_packets(), kTimeoutMs);
+  EXPECT_EQ(5u, peer.last_packet_size());
+
+  clients.clear();
+  client_thread->Stop();
+}
+
+// Relays 200 byte packets from |kNumClients| clients to an echo peer and back
+// for |kDurationMs|, once with a single shard and once with one shard per
+// core, and prints the number of packets relayed per second in each
+// direction.
+TEST_F(ShardedTurnServerTest, DISABLED_RelayThroughputBenchmark) {
+  constexpr int kNumClients = 64;
+  constexpr int kNumClientThreads = 4;
+  constexpr int kDurationMs = 5000;
+  constexpr int kPacketsPerBurst = 32;
+  constexpr size_t kPayloadSize = 200;
+
+  std::vector<int> shard_counts = {1};
+#if defined(WEBRTC_POSIX)
+  const int num_cores = webrtc::CpuInfo::DetectNumberOfCores();
+  if (num_cores > 1) {
+    shard_counts.push_back(num_cores);
+  }
+#endif
+  for (int num_shards : shard_counts) {
+    CreateServer(num_shards);
+    std::vector<std::unique_ptr<rtc::Thread>> client_threads;
+    std::vector<rtc::Thread*> threads;
+    for (int i = 0; i < kNumClientThreads; ++i) {
+      client_threads.push_back(rtc::Thread::CreateWithSocketServer());
+      client_threads.back()->Start();
+      threads.push_back(client_threads.back().get());
+    }
+    std::unique_ptr<rtc::Thread> peer_thread =
+        rtc::Thread::CreateWithSocketServer();
+    peer_thread->Start();
+    auto peer = std::make_unique<EchoPeer>(peer_thread.get());
+    auto clients = CreateClients(kNumClients, threads, peer->address());
+
+    const int64_t start_ms = rtc::TimeMillis();
+    while (rtc::TimeMillis() - start_ms < kDurationMs) {
+      for (auto& client : clients) {
+        client->SendData(kPacketsPerBurst, kPayloadSize);
+      }
+      // Let the client threads drain their queues.
+      for (rtc::Thread* thread : threads) {
+        thread->Invoke<void>(RTC_FROM_HERE, [] {});
+      }
+    }
+    const int64_t elapsed_ms = rtc::TimeMillis() - start_ms;
+    int echoed_packets = 0;
+    for (auto& client : clients) {
+      echoed_packets += client->received_packets();
+    }
+    printf("%d shards: %.0f packets/s relayed to peers, %.0f to clients.\n",
+           num_shards, peer->received_packets() * 1000.0 / elapsed_ms,
+           echoed_packets * 1000.0 / elapsed_ms);
+
+    clients.clear();
+    peer = nullptr;
+    server_ = nullptr;
+  }
+}
+
+}  // namespace cricket
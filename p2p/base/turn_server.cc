@@ -14,8 +14,9 @@
 #include <tuple>  // for std::tie
 #include <utility>
 
-#include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "api/packet_socket_factory.h"
 #include "api/transport/stun.h"
 #include "p2p/base/async_stun_tcp_socket.h"
@@ -215,7 +216,8 @@ void TurnServer::OnInternalPacket(rtc::AsyncPacketSocket* socket,
     // This is a STUN message.
     HandleStunMessage(&conn, data, size);
   } else {
-    // This is a channel message; let the allocation handle it.
+    // This is a channel message; let the allocation handle it. ChannelData
+    // is relayed without being parsed as STUN.
     TurnServerAllocation* allocation = FindAllocation(&conn);
     if (allocation) {
       allocation->HandleChannelData(data, size);
@@ -229,13 +231,24 @@ void TurnServer::OnInternalPacket(rtc::AsyncPacketSocket* socket,
 void TurnServer::HandleStunMessage(TurnServerConnection* conn,
                                    const char* data,
                                    size_t size) {
+  StunMessageView view;
   TurnMessage msg;
-  rtc::ByteBufferReader buf(data, size);
-  if (!msg.Read(&buf) || (buf.Length() > 0)) {
+  if (!view.Parse(data, size) || !view.ReadHeader(&msg)) {
     RTC_LOG(LS_WARNING) << "Received invalid STUN message";
     return;
   }
 
+  // Requests that need authorization are checked on the view, and answered
+  // from the header if they fail, so their attributes are only read once
+  // they pass. The observer sees every message read.
+  const bool needs_authorization =
+      IsStunRequestType(msg.type()) && msg.type() != STUN_BINDING_REQUEST;
+  const bool read_first =
+      !needs_authorization || stun_message_observer_ != nullptr;
+  if (read_first && !view.ReadInto(&msg)) {
+    return;
+  }
+
   if (stun_message_observer_ != nullptr) {
     stun_message_observer_->ReceivedMessage(&msg);
   }
@@ -257,16 +270,18 @@ void TurnServer::HandleStunMessage(TurnServerConnection* conn,
   // Look up the key that we'll use to validate the M-I. If we have an
   // existing allocation, the key will already be cached.
   TurnServerAllocation* allocation = FindAllocation(conn);
-  std::string key;
+  std::string new_key;
   if (!allocation) {
-    GetKey(&msg, &key);
-  } else {
-    key = allocation->key();
+    GetKey(view, &new_key);
   }
+  const std::string& key = allocation ? allocation->key() : new_key;
 
   // Ensure the message is authorized; only needed for requests.
-  if (IsStunRequestType(msg.type())) {
-    if (!CheckAuthorization(conn, &msg, data, size, key)) {
+  if (needs_authorization) {
+    if (!CheckAuthorization(conn, &view, &msg, key)) {
+      return;
+    }
+    if (!read_first && !view.ReadInto(&msg)) {
       return;
     }
   }
@@ -293,73 +308,69 @@ void TurnServer::HandleStunMessage(TurnServerConnection* conn,
   }
 }
 
-bool TurnServer::GetKey(const StunMessage* msg, std::string* key) {
-  const StunByteStringAttribute* username_attr =
-      msg->GetByteString(STUN_ATTR_USERNAME);
-  if (!username_attr) {
+bool TurnServer::GetKey(const StunMessageView& msg, std::string* key) {
+  absl::optional<absl::string_view> username =
+      msg.GetByteString(STUN_ATTR_USERNAME);
+  if (!username) {
     return false;
   }
 
-  std::string username = username_attr->GetString();
-  return (auth_hook_ != NULL && auth_hook_->GetKey(username, realm_, key));
+  return (auth_hook_ != NULL &&
+          auth_hook_->GetKey(std::string(*username), realm_, key));
 }
 
 bool TurnServer::CheckAuthorization(TurnServerConnection* conn,
-                                    StunMessage* msg,
-                                    const char* data,
-                                    size_t size,
+                                    StunMessageView* view,
+                                    const StunMessage* msg,
                                     const std::string& key) {
   // RFC 5389, 10.2.2.
   RTC_DCHECK(IsStunRequestType(msg->type()));
-  const StunByteStringAttribute* mi_attr =
-      msg->GetByteString(STUN_ATTR_MESSAGE_INTEGRITY);
-  const StunByteStringAttribute* username_attr =
-      msg->GetByteString(STUN_ATTR_USERNAME);
-  const StunByteStringAttribute* realm_attr =
-      msg->GetByteString(STUN_ATTR_REALM);
-  const StunByteStringAttribute* nonce_attr =
-      msg->GetByteString(STUN_ATTR_NONCE);
 
   // Fail if no MESSAGE_INTEGRITY.
-  if (!mi_attr) {
+  if (!view->HasAttribute(STUN_ATTR_MESSAGE_INTEGRITY)) {
     SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_UNAUTHORIZED,
                                        STUN_ERROR_REASON_UNAUTHORIZED);
     return false;
   }
 
   // Fail if there is MESSAGE_INTEGRITY but no username, nonce, or realm.
-  if (!username_attr || !realm_attr || !nonce_attr) {
+  if (!view->HasAttribute(STUN_ATTR_USERNAME) ||
+      !view->HasAttribute(STUN_ATTR_REALM) ||
+      !view->HasAttribute(STUN_ATTR_NONCE)) {
     SendErrorResponse(conn, msg, STUN_ERROR_BAD_REQUEST,
                       STUN_ERROR_REASON_BAD_REQUEST);
     return false;
   }
 
   // Fail if bad nonce.
-  if (!ValidateNonce(nonce_attr->GetString())) {
+  absl::optional<absl::string_view> nonce =
+      view->GetByteString(STUN_ATTR_NONCE);
+  if (!nonce || !ValidateNonce(std::string(*nonce))) {
     SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_STALE_NONCE,
                                        STUN_ERROR_REASON_STALE_NONCE);
     return false;
   }
 
-  // Fail if bad MESSAGE_INTEGRITY.
-  if (key.empty() || msg->ValidateMessageIntegrity(key) !=
-                         StunMessage::IntegrityStatus::kIntegrityOk) {
+  // Fail if bad MESSAGE_INTEGRITY. The key of an allocation is precomputed.
+  TurnServerAllocation* allocation = FindAllocation(conn);
+  if (key.empty() ||
+      (allocation ? view->ValidateMessageIntegrity(allocation->integrity_key())
+                  : view->ValidateMessageIntegrity(key)) !=
+          StunMessage::IntegrityStatus::kIntegrityOk) {
     SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_UNAUTHORIZED,
                                        STUN_ERROR_REASON_UNAUTHORIZED);
     return false;
   }
 
   // Fail if one-time-use nonce feature is enabled.
-  TurnServerAllocation* allocation = FindAllocation(conn);
-  if (enable_otu_nonce_ && allocation &&
-      allocation->last_nonce() == nonce_attr->GetString()) {
+  if (enable_otu_nonce_ && allocation && allocation->last_nonce() == *nonce) {
     SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_STALE_NONCE,
                                        STUN_ERROR_REASON_STALE_NONCE);
     return false;
   }
 
   if (allocation) {
-    allocation->set_last_nonce(nonce_attr->GetString());
+    allocation->set_last_nonce(std::string(*nonce));
   }
   // Success.
   return true;
@@ -582,6 +593,14 @@ bool TurnServerConnection::operator<(const TurnServerConnection& c) const {
   return std::tie(src_, dst_, proto_) < std::tie(c.src_, c.dst_, c.proto_);
 }
 
+size_t TurnServerConnection::Hash::operator()(
+    const TurnServerConnection& conn) const {
+  // |dst_| is only set for TCP connections, which are told apart by their
+  // source address already.
+  return rtc::HashIP(conn.src_.ipaddr()) ^
+         (static_cast<size_t>(conn.src_.port()) << 16) ^ conn.proto_;
+}
+
 std::string TurnServerConnection::ToString() const {
   const char* const kProtos[] = {"unknown", "udp", "tcp", "ssltcp"};
   rtc::StringBuilder ost;
@@ -605,12 +624,11 @@ TurnServerAllocation::TurnServerAllocation(TurnServer* server,
 }
 
 TurnServerAllocation::~TurnServerAllocation() {
-  for (ChannelList::iterator it = channels_.begin(); it != channels_.end();
-       ++it) {
-    delete *it;
+  for (const auto& kv : channels_) {
+    delete kv.second;
   }
-  for (PermissionList::iterator it = perms_.begin(); it != perms_.end(); ++it) {
-    delete *it;
+  for (const auto& kv : perms_) {
+    delete kv.second;
   }
   thread_->Clear(this, MSG_ALLOCATION_TIMEOUT);
   RTC_LOG(LS_INFO) << ToString() << ": Allocation destroyed";
@@ -791,7 +809,8 @@ void TurnServerAllocation::HandleChannelBindRequest(const TurnMessage* msg) {
     channel1 = new Channel(thread_, channel_id, peer_attr->GetAddress());
     channel1->SignalDestroyed.connect(
         this, &TurnServerAllocation::OnChannelDestroyed);
-    channels_.push_back(channel1);
+    channels_[channel_id] = channel1;
+    peer_channels_[channel1->peer()] = channel1;
   } else {
     channel1->Refresh();
   }
@@ -811,11 +830,19 @@ void TurnServerAllocation::HandleChannelBindRequest(const TurnMessage* msg) {
 void TurnServerAllocation::HandleChannelData(const char* data, size_t size) {
   // Extract the channel number from the data.
   uint16_t channel_id = rtc::GetBE16(data);
+  // The length field excludes the padding that may follow the application
+  // data.
+  size_t length = rtc::GetBE16(data + 2);
+  if (length > size - TURN_CHANNEL_HEADER_SIZE) {
+    RTC_LOG(LS_WARNING) << ToString()
+                        << ": Received truncated channel data, id="
+                        << channel_id;
+    return;
+  }
   Channel* channel = FindChannel(channel_id);
   if (channel) {
     // Send the data to the peer address.
-    SendExternal(data + TURN_CHANNEL_HEADER_SIZE,
-                 size - TURN_CHANNEL_HEADER_SIZE, channel->peer());
+    SendExternal(data + TURN_CHANNEL_HEADER_SIZE, length, channel->peer());
   } else {
     RTC_LOG(LS_WARNING) << ToString()
                         << ": Received channel data for invalid channel, id="
@@ -833,11 +860,11 @@ void TurnServerAllocation::OnExternalPacket(
   Channel* channel = FindChannel(addr);
   if (channel) {
     // There is a channel bound to this address. Send as a channel message.
-    rtc::ByteBufferWriter buf;
-    buf.WriteUInt16(channel->id());
-    buf.WriteUInt16(static_cast<uint16_t>(size));
-    buf.WriteBytes(data, size);
-    server_->Send(&conn_, buf);
+    channel_data_buf_.Clear();
+    channel_data_buf_.WriteUInt16(channel->id());
+    channel_data_buf_.WriteUInt16(static_cast<uint16_t>(size));
+    channel_data_buf_.WriteBytes(data, size);
+    server_->Send(&conn_, channel_data_buf_);
   } else if (!server_->enable_permission_checks_ ||
              HasPermission(addr.ipaddr())) {
     // No channel, but a permission exists. Send as a data indication.
@@ -876,7 +903,7 @@ void TurnServerAllocation::AddPermission(const rtc::IPAddress& addr) {
     perm = new Permission(thread_, addr);
     perm->SignalDestroyed.connect(this,
                                   &TurnServerAllocation::OnPermissionDestroyed);
-    perms_.push_back(perm);
+    perms_[addr] = perm;
   } else {
     perm->Refresh();
   }
@@ -884,32 +911,20 @@ void TurnServerAllocation::AddPermission(const rtc::IPAddress& addr) {
 
 TurnServerAllocation::Permission* TurnServerAllocation::FindPermission(
     const rtc::IPAddress& addr) const {
-  for (PermissionList::const_iterator it = perms_.begin(); it != perms_.end();
-       ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  PermissionMap::const_iterator it = perms_.find(addr);
+  return (it != perms_.end()) ? it->second : NULL;
 }
 
 TurnServerAllocation::Channel* TurnServerAllocation::FindChannel(
     int channel_id) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->id() == channel_id)
-      return *it;
-  }
-  return NULL;
+  ChannelMap::const_iterator it = channels_.find(channel_id);
+  return (it != channels_.end()) ? it->second : NULL;
 }
 
 TurnServerAllocation::Channel* TurnServerAllocation::FindChannel(
     const rtc::SocketAddress& addr) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  PeerChannelMap::const_iterator it = peer_channels_.find(addr);
+  return (it != peer_channels_.end()) ? it->second : NULL;
 }
 
 void TurnServerAllocation::SendResponse(TurnMessage* msg) {
@@ -942,15 +957,25 @@ void TurnServerAllocation::OnMessage(rtc::Message* msg) {
 }
 
 void TurnServerAllocation::OnPermissionDestroyed(Permission* perm) {
-  auto it = absl::c_find(perms_, perm);
-  RTC_DCHECK(it != perms_.end());
-  perms_.erase(it);
+  size_t erased = perms_.erase(perm->peer());
+  RTC_DCHECK_EQ(erased, 1);
 }
 
 void TurnServerAllocation::OnChannelDestroyed(Channel* channel) {
-  auto it = absl::c_find(channels_, channel);
-  RTC_DCHECK(it != channels_.end());
-  channels_.erase(it);
+  size_t erased = channels_.erase(channel->id());
+  RTC_DCHECK_EQ(erased, 1);
+  erased = peer_channels_.erase(channel->peer());
+  RTC_DCHECK_EQ(erased, 1);
+}
+
+size_t TurnServerAllocation::IPAddressHash::operator()(
+    const rtc::IPAddress& addr) const {
+  return rtc::HashIP(addr);
+}
+
+size_t TurnServerAllocation::SocketAddressHash::operator()(
+    const rtc::SocketAddress& addr) const {
+  return rtc::HashIP(addr.ipaddr()) ^ (static_cast<size_t>(addr.port()) << 16);
 }
 
 TurnServerAllocation::Permission::Permission(rtc::Thread* thread,
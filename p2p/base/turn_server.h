@@ -11,29 +11,29 @@
 #ifndef P2P_BASE_TURN_SERVER_H_
 #define P2P_BASE_TURN_SERVER_H_
 
-#include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "api/sequence_checker.h"
+#include "api/transport/stun.h"
 #include "p2p/base/port_interface.h"
 #include "rtc_base/async_packet_socket.h"
+#include "rtc_base/byte_buffer.h"
 #include "rtc_base/socket_address.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
 #include "rtc_base/thread.h"
 
 namespace rtc {
-class ByteBufferWriter;
 class PacketSocketFactory;
 }  // namespace rtc
 
 namespace cricket {
 
-class StunMessage;
 class TurnMessage;
 class TurnServer;
 
@@ -43,6 +43,10 @@ const int TURN_SERVER_PORT = 3478;
 // Encapsulates the client's connection to the server.
 class TurnServerConnection {
  public:
+  struct Hash {
+    size_t operator()(const TurnServerConnection& conn) const;
+  };
+
   TurnServerConnection() : proto_(PROTO_UDP), socket_(NULL) {}
   TurnServerConnection(const rtc::SocketAddress& src,
                        ProtocolType proto,
@@ -76,7 +80,8 @@ class TurnServerAllocation : public rtc::MessageHandlerAutoCleanup,
   ~TurnServerAllocation() override;
 
   TurnServerConnection* conn() { return &conn_; }
-  const std::string& key() const { return key_; }
+  const std::string& key() const { return key_.key(); }
+  const StunIntegrityKey& integrity_key() const { return key_; }
   const std::string& transaction_id() const { return transaction_id_; }
   const std::string& username() const { return username_; }
   const std::string& origin() const { return origin_; }
@@ -93,8 +98,20 @@ class TurnServerAllocation : public rtc::MessageHandlerAutoCleanup,
  private:
   class Channel;
   class Permission;
-  typedef std::list<Permission*> PermissionList;
-  typedef std::list<Channel*> ChannelList;
+  struct IPAddressHash {
+    size_t operator()(const rtc::IPAddress& addr) const;
+  };
+  struct SocketAddressHash {
+    size_t operator()(const rtc::SocketAddress& addr) const;
+  };
+  // Permissions and channels are looked up for every relayed packet, so they
+  // are indexed by peer address and channel number. The objects are owned by
+  // the allocation and remove themselves from the maps when they expire.
+  typedef std::unordered_map<rtc::IPAddress, Permission*, IPAddressHash>
+      PermissionMap;
+  typedef std::unordered_map<int, Channel*> ChannelMap;
+  typedef std::unordered_map<rtc::SocketAddress, Channel*, SocketAddressHash>
+      PeerChannelMap;
 
   void HandleAllocateRequest(const TurnMessage* msg);
   void HandleRefreshRequest(const TurnMessage* msg);
@@ -132,13 +149,17 @@ class TurnServerAllocation : public rtc::MessageHandlerAutoCleanup,
   rtc::Thread* const thread_;
   TurnServerConnection conn_;
   std::unique_ptr<rtc::AsyncPacketSocket> external_socket_;
-  std::string key_;
+  StunIntegrityKey key_;
   std::string transaction_id_;
   std::string username_;
   std::string origin_;
   std::string last_nonce_;
-  PermissionList perms_;
-  ChannelList channels_;
+  PermissionMap perms_;
+  ChannelMap channels_;
+  PeerChannelMap peer_channels_;
+  // Reused for the ChannelData messages sent to the client, to avoid an
+  // allocation per relayed packet.
+  rtc::ByteBufferWriter channel_data_buf_;
 };
 
 // An interface through which the MD5 credential hash can be retrieved.
@@ -174,7 +195,9 @@ class StunMessageObserver {
 // Not yet wired up: TCP support.
 class TurnServer : public sigslot::has_slots<> {
  public:
-  typedef std::map<TurnServerConnection, std::unique_ptr<TurnServerAllocation>>
+  typedef std::unordered_map<TurnServerConnection,
+                             std::unique_ptr<TurnServerAllocation>,
+                             TurnServerConnection::Hash>
       AllocationMap;
 
   explicit TurnServer(rtc::Thread* thread);
@@ -280,11 +303,13 @@ class TurnServer : public sigslot::has_slots<> {
                              const TurnMessage* msg,
                              const std::string& key) RTC_RUN_ON(thread_);
 
-  bool GetKey(const StunMessage* msg, std::string* key) RTC_RUN_ON(thread_);
+  bool GetKey(const StunMessageView& msg, std::string* key)
+      RTC_RUN_ON(thread_);
+  // Checks the credentials of the request in |view|, and answers |msg|, which
+  // holds at least its header, if they are rejected.
   bool CheckAuthorization(TurnServerConnection* conn,
-                          StunMessage* msg,
-                          const char* data,
-                          size_t size,
+                          StunMessageView* view,
+                          const StunMessage* msg,
                           const std::string& key) RTC_RUN_ON(thread_);
   bool ValidateNonce(const std::string& nonce) const RTC_RUN_ON(thread_);
 
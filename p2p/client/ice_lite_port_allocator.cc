@@ -0,0 +1,458 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "p2p/client/ice_lite_port_allocator.h"
+
+#include <unordered_map>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "api/transport/stun.h"
+#include "p2p/base/port.h"
+#include "p2p/base/udp_port.h"
+#include "rtc_base/async_packet_socket.h"
+#include "rtc_base/checks.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/network.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+namespace cricket {
+
+// A UDP socket shared by the ports of all sessions. Routes the packets it
+// receives to the PortSocket of the port they are for.
+class IceLitePortAllocator::SharedSocket : public sigslot::has_slots<> {
+ public:
+  explicit SharedSocket(std::unique_ptr<rtc::AsyncPacketSocket> socket);
+
+  rtc::AsyncPacketSocket* socket() { return socket_.get(); }
+  rtc::Network* network() { return &network_; }
+
+  // Starts routing the binding requests for the ufrag of |port_socket| to
+  // it. Returns false if the ufrag is used by another port.
+  bool AddPortSocket(PortSocket* port_socket);
+  // Stops routing any packets to |port_socket|.
+  void RemovePortSocket(PortSocket* port_socket);
+
+ private:
+  void OnReadPacket(rtc::AsyncPacketSocket* socket,
+                    const char* data,
+                    size_t size,
+                    const rtc::SocketAddress& remote_addr,
+                    const int64_t& packet_time_us);
+  void OnReadyToSend(rtc::AsyncPacketSocket* socket);
+
+  std::unique_ptr<rtc::AsyncPacketSocket> socket_;
+  rtc::Network network_;
+  std::unordered_map<std::string, PortSocket*> port_sockets_by_ufrag_;
+  std::unordered_map<rtc::SocketAddress, PortSocket*, Port::SocketAddressHash>
+      port_sockets_by_remote_address_;
+};
+
+// The view of a SharedSocket given to a single port. Sends through the shared
+// socket, and signals only the packets that the shared socket routes to the
+// port.
+class IceLitePortAllocator::PortSocket : public rtc::AsyncPacketSocket {
+ public:
+  PortSocket(SharedSocket* shared_socket, const std::string& ufrag)
+      : shared_socket_(shared_socket), ufrag_(ufrag) {}
+
+  SharedSocket* shared_socket() { return shared_socket_; }
+  const std::string& ufrag() const { return ufrag_; }
+  void set_ufrag(const std::string& ufrag) { ufrag_ = ufrag; }
+  // The port using this socket, or null if it has been destroyed.
+  UDPPort* port() { return port_; }
+  void set_port(UDPPort* port) { port_ = port; }
+
+  // The remote addresses that have been routed to this socket.
+  const std::vector<rtc::SocketAddress>& remote_addresses() const {
+    return remote_addresses_;
+  }
+  void AddRemoteAddress(const rtc::SocketAddress& address) {
+    remote_addresses_.push_back(address);
+  }
+  void ClearRemoteAddresses() { remote_addresses_.clear(); }
+
+  rtc::SocketAddress GetLocalAddress() const override {
+    return shared_socket_->socket()->GetLocalAddress();
+  }
+  rtc::SocketAddress GetRemoteAddress() const override {
+    return rtc::SocketAddress();
+  }
+  int Send(const void* pv,
+           size_t cb,
+           const rtc::PacketOptions& options) override {
+    return shared_socket_->socket()->Send(pv, cb, options);
+  }
+  int SendTo(const void* pv,
+             size_t cb,
+             const rtc::SocketAddress& addr,
+             const rtc::PacketOptions& options) override {
+    // The shared socket signals the sent packets on itself, where nobody
+    // knows which port sent them.
+    rtc::SentPacket sent_packet(options.packet_id, rtc::TimeMillis(),
+                                options.info_signaled_after_sent);
+    CopySocketInformationToPacketInfo(cb, *this, true, &sent_packet.info);
+    int ret = shared_socket_->socket()->SendTo(pv, cb, addr, options);
+    SignalSentPacket(this, sent_packet);
+    return ret;
+  }
+  // The shared socket is closed by the allocator.
+  int Close() override { return 0; }
+  State GetState() const override {
+    return shared_socket_->socket()->GetState();
+  }
+  int GetOption(rtc::Socket::Option opt, int* value) override {
+    return shared_socket_->socket()->GetOption(opt, value);
+  }
+  int SetOption(rtc::Socket::Option opt, int value) override {
+    return shared_socket_->socket()->SetOption(opt, value);
+  }
+  int GetError() const override {
+    return shared_socket_->socket()->GetError();
+  }
+  void SetError(int error) override {
+    shared_socket_->socket()->SetError(error);
+  }
+
+ private:
+  SharedSocket* const shared_socket_;
+  std::string ufrag_;
+  UDPPort* port_ = nullptr;
+  std::vector<rtc::SocketAddress> remote_addresses_;
+};
+
+class IceLitePortAllocator::Session : public PortAllocatorSession {
+ public:
+  Session(IceLitePortAllocator* allocator,
+          const std::string& content_name,
+          int component,
+          const std::string& ice_ufrag,
+          const std::string& ice_pwd);
+  ~Session() override;
+
+  void SetCandidateFilter(uint32_t filter) override {
+    candidate_filter_ = filter;
+  }
+  void StartGettingPorts() override;
+  void StopGettingPorts() override { running_ = false; }
+  bool IsGettingPorts() override { return running_; }
+  void ClearGettingPorts() override {
+    running_ = false;
+    cleared_ = true;
+  }
+  bool IsCleared() const override { return cleared_; }
+  std::vector<PortInterface*> ReadyPorts() const override;
+  std::vector<Candidate> ReadyCandidates() const override;
+  bool CandidatesAllocationDone() const override { return allocation_done_; }
+  void PruneAllPorts() override;
+
+ protected:
+  void UpdateIceParametersInternal() override;
+
+ private:
+  struct PortData {
+    std::unique_ptr<PortSocket> socket;
+    // Owned, unless it has destroyed itself, in which case it is null. The
+    // socket is kept, since the port is still connected to its signals when
+    // it notifies that it's destroyed.
+    UDPPort* port;
+  };
+
+  void OnPortComplete(Port* port);
+  void OnPortDestroyed(PortInterface* port);
+
+  IceLitePortAllocator* const allocator_;
+  rtc::Thread* const network_thread_;
+  std::vector<PortData> ports_;
+  uint32_t candidate_filter_ = CF_ALL;
+  bool allocation_started_ = false;
+  bool allocation_done_ = false;
+  bool running_ = false;
+  bool cleared_ = false;
+};
+
+IceLitePortAllocator::SharedSocket::SharedSocket(
+    std::unique_ptr<rtc::AsyncPacketSocket> socket)
+    : socket_(std::move(socket)),
+      network_("ice-lite",
+               "IceLitePortAllocator",
+               socket_->GetLocalAddress().ipaddr(),
+               socket_->GetLocalAddress().family() == AF_INET ? 32 : 128) {
+  network_.AddIP(socket_->GetLocalAddress().ipaddr());
+  socket_->SignalReadPacket.connect(this, &SharedSocket::OnReadPacket);
+  socket_->SignalReadyToSend.connect(this, &SharedSocket::OnReadyToSend);
+}
+
+bool IceLitePortAllocator::SharedSocket::AddPortSocket(
+    PortSocket* port_socket) {
+  return port_sockets_by_ufrag_.emplace(port_socket->ufrag(), port_socket)
+      .second;
+}
+
+void IceLitePortAllocator::SharedSocket::RemovePortSocket(
+    PortSocket* port_socket) {
+  auto it = port_sockets_by_ufrag_.find(port_socket->ufrag());
+  if (it != port_sockets_by_ufrag_.end() && it->second == port_socket) {
+    port_sockets_by_ufrag_.erase(it);
+  }
+  // The addresses may have been routed to other ports since.
+  for (const rtc::SocketAddress& address : port_socket->remote_addresses()) {
+    auto addr_it = port_sockets_by_remote_address_.find(address);
+    if (addr_it != port_sockets_by_remote_address_.end() &&
+        addr_it->second == port_socket) {
+      port_sockets_by_remote_address_.erase(addr_it);
+    }
+  }
+  port_socket->ClearRemoteAddresses();
+}
+
+void IceLitePortAllocator::SharedSocket::OnReadPacket(
+    rtc::AsyncPacketSocket* socket,
+    const char* data,
+    size_t size,
+    const rtc::SocketAddress& remote_addr,
+    const int64_t& packet_time_us) {
+  RTC_DCHECK(socket == socket_.get());
+  PortSocket* port_socket = nullptr;
+  // Binding requests are routed by ufrag even from known addresses, since a
+  // remote address may be used for several sessions, e.g. by a client that
+  // doesn't bundle.
+  StunMessageView msg;
+  const bool is_binding_request =
+      msg.Parse(data, size) && msg.type() == STUN_BINDING_REQUEST;
+  if (is_binding_request) {
+    absl::optional<absl::string_view> username =
+        msg.GetByteString(STUN_ATTR_USERNAME);
+    absl::string_view local_ufrag;
+    absl::string_view remote_ufrag;
+    if (username &&
+        Port::ParseStunUsername(*username, &local_ufrag, &remote_ufrag)) {
+      auto it = port_sockets_by_ufrag_.find(std::string(local_ufrag));
+      if (it != port_sockets_by_ufrag_.end()) {
+        port_socket = it->second;
+      }
+    }
+  } else {
+    auto it = port_sockets_by_remote_address_.find(remote_addr);
+    if (it != port_sockets_by_remote_address_.end()) {
+      port_socket = it->second;
+    }
+  }
+  if (!port_socket || !port_socket->port()) {
+    RTC_LOG(LS_VERBOSE) << "Dropping packet of " << size
+                        << " bytes from unknown address "
+                        << remote_addr.ToSensitiveString();
+    return;
+  }
+
+  UDPPort* port = port_socket->port();
+  port->HandleIncomingPacket(port_socket, data, size, remote_addr,
+                             packet_time_us);
+  // Once the port has accepted a binding request and has a connection to the
+  // remote address, the other packets from it are routed to the port too.
+  if (is_binding_request && port->GetConnection(remote_addr)) {
+    PortSocket*& routed_socket = port_sockets_by_remote_address_[remote_addr];
+    if (routed_socket != port_socket) {
+      routed_socket = port_socket;
+      port_socket->AddRemoteAddress(remote_addr);
+    }
+  }
+}
+
+void IceLitePortAllocator::SharedSocket::OnReadyToSend(
+    rtc::AsyncPacketSocket* socket) {
+  for (const auto& kv : port_sockets_by_ufrag_) {
+    kv.second->SignalReadyToSend(kv.second);
+  }
+}
+
+IceLitePortAllocator::Session::Session(IceLitePortAllocator* allocator,
+                                       const std::string& content_name,
+                                       int component,
+                                       const std::string& ice_ufrag,
+                                       const std::string& ice_pwd)
+    : PortAllocatorSession(content_name,
+                           component,
+                           ice_ufrag,
+                           ice_pwd,
+                           allocator->flags()),
+      allocator_(allocator),
+      network_thread_(rtc::Thread::Current()) {}
+
+IceLitePortAllocator::Session::~Session() {
+  RTC_DCHECK_RUN_ON(network_thread_);
+  for (PortData& data : ports_) {
+    if (data.port) {
+      data.socket->shared_socket()->RemovePortSocket(data.socket.get());
+      delete data.port;
+    }
+  }
+}
+
+void IceLitePortAllocator::Session::StartGettingPorts() {
+  RTC_DCHECK_RUN_ON(network_thread_);
+  running_ = true;
+  if (allocation_started_) {
+    return;
+  }
+  allocation_started_ = true;
+
+  for (const std::unique_ptr<SharedSocket>& shared_socket :
+       allocator_->shared_sockets_) {
+    auto port_socket =
+        std::make_unique<PortSocket>(shared_socket.get(), ice_ufrag());
+    if (!shared_socket->AddPortSocket(port_socket.get())) {
+      RTC_LOG(LS_ERROR) << "ICE ufrag " << ice_ufrag()
+                        << " is used by another session.";
+      continue;
+    }
+    std::unique_ptr<UDPPort> port = UDPPort::Create(
+        network_thread_, allocator_->socket_factory_, shared_socket->network(),
+        port_socket.get(), ice_ufrag(), ice_pwd(), std::string(), false,
+        absl::nullopt);
+    if (!port) {
+      shared_socket->RemovePortSocket(port_socket.get());
+      continue;
+    }
+    port_socket->set_port(port.get());
+    port->set_content_name(content_name());
+    port->set_component(component());
+    port->set_generation(generation());
+    port->SignalPortComplete.connect(this, &Session::OnPortComplete);
+    port->SubscribePortDestroyed(
+        [this](PortInterface* port) { OnPortDestroyed(port); });
+    // The port serves the session until it is pruned, even while the remote
+    // side has no connections to it.
+    port->KeepAliveUntilPruned();
+    UDPPort* ready_port = port.release();
+    ports_.push_back({std::move(port_socket), ready_port});
+    SignalPortReady(this, ready_port);
+    // The shared socket is already bound, so this completes the port.
+    ready_port->PrepareAddress();
+  }
+
+  allocation_done_ = true;
+  SignalCandidatesAllocationDone(this);
+}
+
+std::vector<PortInterface*> IceLitePortAllocator::Session::ReadyPorts() const {
+  std::vector<PortInterface*> ports;
+  for (const PortData& data : ports_) {
+    if (data.port) {
+      ports.push_back(data.port);
+    }
+  }
+  return ports;
+}
+
+std::vector<Candidate> IceLitePortAllocator::Session::ReadyCandidates() const {
+  std::vector<Candidate> candidates;
+  if (!(candidate_filter_ & CF_HOST)) {
+    return candidates;
+  }
+  for (const PortData& data : ports_) {
+    if (data.port) {
+      candidates.insert(candidates.end(), data.port->Candidates().begin(),
+                        data.port->Candidates().end());
+    }
+  }
+  return candidates;
+}
+
+void IceLitePortAllocator::Session::PruneAllPorts() {
+  for (PortData& data : ports_) {
+    if (data.port) {
+      data.port->Prune();
+    }
+  }
+}
+
+void IceLitePortAllocator::Session::UpdateIceParametersInternal() {
+  RTC_DCHECK_RUN_ON(network_thread_);
+  for (PortData& data : ports_) {
+    if (!data.port) {
+      continue;
+    }
+    SharedSocket* shared_socket = data.socket->shared_socket();
+    shared_socket->RemovePortSocket(data.socket.get());
+    data.socket->set_ufrag(ice_ufrag());
+    if (!shared_socket->AddPortSocket(data.socket.get())) {
+      RTC_LOG(LS_ERROR) << "ICE ufrag " << ice_ufrag()
+                        << " is used by another session.";
+    }
+    data.port->set_content_name(content_name());
+    data.port->SetIceParameters(component(), ice_ufrag(), ice_pwd());
+  }
+}
+
+void IceLitePortAllocator::Session::OnPortComplete(Port* port) {
+  RTC_DCHECK_RUN_ON(network_thread_);
+  if (candidate_filter_ & CF_HOST) {
+    SignalCandidatesReady(this, port->Candidates());
+  }
+}
+
+void IceLitePortAllocator::Session::OnPortDestroyed(PortInterface* port) {
+  RTC_DCHECK_RUN_ON(network_thread_);
+  for (PortData& data : ports_) {
+    if (data.port == port) {
+      data.socket->shared_socket()->RemovePortSocket(data.socket.get());
+      data.socket->set_port(nullptr);
+      data.port = nullptr;
+      return;
+    }
+  }
+}
+
+IceLitePortAllocator::IceLitePortAllocator(
+    rtc::PacketSocketFactory* socket_factory)
+    : socket_factory_(socket_factory) {
+  RTC_DCHECK(socket_factory_);
+}
+
+IceLitePortAllocator::~IceLitePortAllocator() {
+  CheckRunOnValidThreadIfInitialized();
+  // Sessions must be destroyed before the sockets they share.
+  DiscardCandidatePool();
+}
+
+bool IceLitePortAllocator::AddSharedSocket(const rtc::SocketAddress& address,
+                                           rtc::SocketAddress* bound_address) {
+  CheckRunOnValidThreadIfInitialized();
+  if (address.IsAnyIP()) {
+    RTC_LOG(LS_ERROR) << "Can't share a socket on the any address.";
+    return false;
+  }
+  std::unique_ptr<rtc::AsyncPacketSocket> socket(
+      socket_factory_->CreateUdpSocket(address, 0, 0));
+  if (!socket) {
+    RTC_LOG(LS_ERROR) << "Failed to create a UDP socket on "
+                      << address.ToSensitiveString();
+    return false;
+  }
+  shared_sockets_.push_back(std::make_unique<SharedSocket>(std::move(socket)));
+  if (bound_address) {
+    *bound_address = shared_sockets_.back()->socket()->GetLocalAddress();
+  }
+  return true;
+}
+
+PortAllocatorSession* IceLitePortAllocator::CreateSessionInternal(
+    const std::string& content_name,
+    int component,
+    const std::string& ice_ufrag,
+    const std::string& ice_pwd) {
+  CheckRunOnValidThreadAndInitialized();
+  return new Session(this, content_name, component, ice_ufrag, ice_pwd);
+}
+
+}  // namespace cricket
@@ -0,0 +1,71 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef P2P_CLIENT_ICE_LITE_PORT_ALLOCATOR_H_
+#define P2P_CLIENT_ICE_LITE_PORT_ALLOCATOR_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/packet_socket_factory.h"
+#include "p2p/base/port_allocator.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/system/rtc_export.h"
+
+namespace cricket {
+
+// A port allocator for servers, e.g. SFUs, that serve many ICE-lite
+// transports on a few well known addresses. Instead of opening sockets per
+// session, it opens one UDP socket per local address and gives every session
+// a host port on each of these shared sockets. Incoming binding requests are
+// demultiplexed to the port of the session by the local ufrag in their
+// USERNAME, and all other packets by their remote address, which is
+// associated with a port once the port has a connection to it.
+//
+// Since the sessions are told apart by ufrag, their ufrags must be unique per
+// allocator; a session with the ufrag of another session gets no ports. The
+// sessions only gather host candidates, STUN and TURN servers are ignored.
+//
+// Must be used on the network thread, and must outlive its sessions.
+class RTC_EXPORT IceLitePortAllocator : public PortAllocator {
+ public:
+  // |socket_factory| is not owned and must outlive the allocator.
+  explicit IceLitePortAllocator(rtc::PacketSocketFactory* socket_factory);
+  ~IceLitePortAllocator() override;
+
+  // Opens the socket shared by all sessions on |address|, whose IP must not
+  // be the any address. Sessions only get ports on the sockets added before
+  // they start gathering. On success, returns true and stores the bound
+  // address in |bound_address|, if not null.
+  bool AddSharedSocket(const rtc::SocketAddress& address,
+                       rtc::SocketAddress* bound_address);
+  size_t num_shared_sockets() const { return shared_sockets_.size(); }
+
+  void SetNetworkIgnoreMask(int network_ignore_mask) override {}
+
+  PortAllocatorSession* CreateSessionInternal(
+      const std::string& content_name,
+      int component,
+      const std::string& ice_ufrag,
+      const std::string& ice_pwd) override;
+
+ private:
+  class SharedSocket;
+  class PortSocket;
+  class Session;
+
+  rtc::PacketSocketFactory* const socket_factory_;
+  std::vector<std::unique_ptr<SharedSocket>> shared_sockets_;
+};
+
+}  // namespace cricket
+
+#endif  // P2P_CLIENT_ICE_LITE_PORT_ALLOCATOR_H_
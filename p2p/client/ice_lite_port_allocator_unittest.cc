@@ -0,0 +1,322 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "p2p/client/ice_lite_port_allocator.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/transport/stun.h"
+#include "p2p/base/basic_packet_socket_factory.h"
+#include "p2p/base/fake_port_allocator.h"
+#include "p2p/base/p2p_constants.h"
+#include "p2p/base/p2p_transport_channel.h"
+#include "rtc_base/byte_buffer.h"
+#include "rtc_base/gunit.h"
+#include "rtc_base/helpers.h"
+#include "rtc_base/memory_usage.h"
+#include "rtc_base/physical_socket_server.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+#include "rtc_base/virtual_socket_server.h"
+#include "test/gtest.h"
+
+namespace cricket {
+namespace {
+
+const int kTimeoutMs = 5000;
+const rtc::SocketAddress kServerAddress("127.0.0.1", 0);
+const IceParameters kServerIceParams1("server1", "server1-password-0123456789",
+                                      false);
+const IceParameters kServerIceParams2("server2", "server2-password-0123456789",
+                                      false);
+const IceParameters kClientIceParams1("client1", "client1-password-0123456789",
+                                      false);
+const IceParameters kClientIceParams2("client2", "client2-password-0123456789",
+                                      false);
+
+std::unique_ptr<P2PTransportChannel> CreateChannel(
+    PortAllocator* allocator,
+    const IceParameters& ice_params,
+    const IceParameters& remote_ice_params,
+    IceRole role) {
+  auto channel = std::make_unique<P2PTransportChannel>(
+      "test", ICE_CANDIDATE_COMPONENT_DEFAULT, allocator);
+  channel->SetIceRole(role);
+  channel->SetIceParameters(ice_params);
+  channel->SetRemoteIceParameters(remote_ice_params);
+  channel->MaybeStartGathering();
+  return channel;
+}
+
+Candidate CreateHostCandidate(const rtc::SocketAddress& address) {
+  Candidate candidate;
+  candidate.set_component(ICE_CANDIDATE_COMPONENT_DEFAULT);
+  candidate.set_protocol(UDP_PROTOCOL_NAME);
+  candidate.set_address(address);
+  candidate.set_type(LOCAL_PORT_TYPE);
+  candidate.set_priority(1000);
+  return candidate;
+}
+
+// Creates the binding request a client with |remote_ice_params| sends to
+// the session with |local_ice_params|.
+std::string CreateBindingRequest(const IceParameters& local_ice_params,
+                                 const IceParameters& remote_ice_params) {
+  IceMessage msg;
+  msg.SetType(STUN_BINDING_REQUEST);
+  msg.SetTransactionID(rtc::CreateRandomString(kStunTransactionIdLength));
+  msg.AddAttribute(std::make_unique<StunByteStringAttribute>(
+      STUN_ATTR_USERNAME, local_ice_params.ufrag + ":" +
+                              remote_ice_params.ufrag));
+  msg.AddAttribute(
+      std::make_unique<StunUInt32Attribute>(STUN_ATTR_PRIORITY, 1000));
+  msg.AddAttribute(std::make_unique<StunUInt64Attribute>(
+      STUN_ATTR_ICE_CONTROLLING, 0));
+  msg.AddMessageIntegrity(local_ice_params.pwd);
+  msg.AddFingerprint();
+  rtc::ByteBufferWriter buf;
+  msg.Write(&buf);
+  return std::string(buf.Data(), buf.Length());
+}
+
+}  // namespace
+
+class IceLitePortAllocatorTest : public ::testing::Test,
+                                 public sigslot::has_slots<> {
+ public:
+  IceLitePortAllocatorTest()
+      : vss_(new rtc::VirtualSocketServer()),
+        thread_(vss_.get()),
+        socket_factory_(rtc::Thread::Current()),
+        allocator_(&socket_factory_),
+        client_allocator_(rtc::Thread::Current(), &socket_factory_) {
+    allocator_.Initialize();
+    EXPECT_TRUE(allocator_.AddSharedSocket(kServerAddress, &server_address_));
+  }
+
+ protected:
+  std::unique_ptr<P2PTransportChannel> CreateServer(
+      const IceParameters& ice_params,
+      const IceParameters& remote_ice_params) {
+    auto channel = CreateChannel(&allocator_, ice_params, remote_ice_params,
+                                 ICEROLE_CONTROLLED);
+    channel->SignalReadPacket.connect(this,
+                                      &IceLitePortAllocatorTest::OnReadPacket);
+    return channel;
+  }
+
+  std::unique_ptr<P2PTransportChannel> CreateClient(
+      const IceParameters& ice_params,
+      const IceParameters& remote_ice_params) {
+    auto channel = CreateChannel(&client_allocator_, ice_params,
+                                 remote_ice_params, ICEROLE_CONTROLLING);
+    channel->SignalReadPacket.connect(this,
+                                      &IceLitePortAllocatorTest::OnReadPacket);
+    channel->AddRemoteCandidate(CreateHostCandidate(server_address_));
+    return channel;
+  }
+
+  void SendPacket(P2PTransportChannel* channel, const std::string& data) {
+    rtc::PacketOptions options;
+    EXPECT_EQ(static_cast<int>(data.size()),
+              channel->SendPacket(data.data(), data.size(), options, 0));
+  }
+
+  void OnReadPacket(rtc::PacketTransportInternal* transport,
+                    const char* data,
+                    size_t size,
+                    const int64_t& packet_time_us,
+                    int flags) {
+    received_[transport].push_back(std::string(data, size));
+  }
+
+  std::unique_ptr<rtc::VirtualSocketServer> vss_;
+  rtc::AutoSocketServerThread thread_;
+  rtc::BasicPacketSocketFactory socket_factory_;
+  IceLitePortAllocator allocator_;
+  FakePortAllocator client_allocator_;
+  rtc::SocketAddress server_address_;
+  std::map<rtc::PacketTransportInternal*, std::vector<std::string>> received_;
+};
+
+TEST_F(IceLitePortAllocatorTest, SessionsGatherOnSharedSocket) {
+  auto server1 = CreateServer(kServerIceParams1, kClientIceParams1);
+  auto server2 = CreateServer(kServerIceParams2, kClientIceParams2);
+
+  ASSERT_EQ(1u, server1->ports().size());
+  ASSERT_EQ(1u, server2->ports().size());
+  EXPECT_NE(server1->ports()[0], server2->ports()[0]);
+  for (P2PTransportChannel* server : {server1.get(), server2.get()}) {
+    const std::vector<Candidate>& candidates =
+        static_cast<Port*>(server->ports()[0])->Candidates();
+    ASSERT_EQ(1u, candidates.size());
+    EXPECT_EQ(server_address_, candidates[0].address());
+    EXPECT_EQ(LOCAL_PORT_TYPE, candidates[0].type());
+    EXPECT_EQ(IceGatheringState::kIceGatheringComplete,
+              server->gathering_state());
+  }
+}
+
+TEST_F(IceLitePortAllocatorTest, RoutesPacketsToTheirSessions) {
+  auto server1 = CreateServer(kServerIceParams1, kClientIceParams1);
+  auto server2 = CreateServer(kServerIceParams2, kClientIceParams2);
+  auto client1 = CreateClient(kClientIceParams1, kServerIceParams1);
+  auto client2 = CreateClient(kClientIceParams2, kServerIceParams2);
+
+  EXPECT_TRUE_WAIT(server1->writable() && server2->writable() &&
+                       client1->writable() && client2->writable(),
+                   kTimeoutMs);
+  ASSERT_EQ(1u, server1->connections().size());
+  ASSERT_EQ(1u, server2->connections().size());
+  EXPECT_EQ(client1->selected_connection()->local_candidate().address(),
+            server1->connections()[0]->remote_candidate().address());
+  EXPECT_EQ(client2->selected_connection()->local_candidate().address(),
+            server2->connections()[0]->remote_candidate().address());
+
+  SendPacket(client1.get(), "from client1");
+  SendPacket(client2.get(), "from client2");
+  SendPacket(server1.get(), "from server1");
+  SendPacket(server2.get(), "from server2");
+  EXPECT_TRUE_WAIT(received_.size() == 4u, kTimeoutMs);
+  EXPECT_EQ(std::vector<std::string>{"from client1"}, received_[server1.get()]);
+  EXPECT_EQ(std::vector<std::string>{"from client2"}, received_[server2.get()]);
+  EXPECT_EQ(std::vector<std::string>{"from server1"}, received_[client1.get()]);
+  EXPECT_EQ(std::vector<std::string>{"from server2"}, received_[client2.get()]);
+}
+
+TEST_F(IceLitePortAllocatorTest, SessionsWithSameUfragGetNoPorts) {
+  std::unique_ptr<PortAllocatorSession> session1 = allocator_.CreateSession(
+      "test", ICE_CANDIDATE_COMPONENT_DEFAULT, kServerIceParams1.ufrag,
+      kServerIceParams1.pwd);
+  std::unique_ptr<PortAllocatorSession> session2 = allocator_.CreateSession(
+      "test", ICE_CANDIDATE_COMPONENT_DEFAULT, kServerIceParams1.ufrag,
+      kServerIceParams2.pwd);
+  session1->StartGettingPorts();
+  session2->StartGettingPorts();
+  EXPECT_EQ(1u, session1->ReadyPorts().size());
+  EXPECT_TRUE(session2->ReadyPorts().empty());
+  EXPECT_TRUE(session2->CandidatesAllocationDone());
+
+  // The ufrag can be used again once the session holding it is gone.
+  session1.reset();
+  std::unique_ptr<PortAllocatorSession> session3 = allocator_.CreateSession(
+      "test", ICE_CANDIDATE_COMPONENT_DEFAULT, kServerIceParams1.ufrag,
+      kServerIceParams1.pwd);
+  session3->StartGettingPorts();
+  EXPECT_EQ(1u, session3->ReadyPorts().size());
+}
+
+TEST_F(IceLitePortAllocatorTest, DropsBindingRequestsForUnknownUfrags) {
+  auto server1 = CreateServer(kServerIceParams1, kClientIceParams1);
+  std::unique_ptr<rtc::AsyncPacketSocket> client(
+      socket_factory_.CreateUdpSocket(rtc::SocketAddress("127.0.0.1", 0), 0,
+                                      0));
+  ASSERT_TRUE(client);
+
+  std::string request = CreateBindingRequest(kServerIceParams2,
+                                             kClientIceParams2);
+  client->SendTo(request.data(), request.size(), server_address_,
+                 rtc::PacketOptions());
+  request = CreateBindingRequest(kServerIceParams1, kClientIceParams1);
+  client->SendTo(request.data(), request.size(), server_address_,
+                 rtc::PacketOptions());
+  EXPECT_EQ_WAIT(1u, server1->connections().size(), kTimeoutMs);
+  EXPECT_EQ(client->GetLocalAddress(),
+            server1->connections()[0]->remote_candidate().address());
+}
+
+// Counts the binding requests from unknown addresses that reach a port.
+class UnknownAddressCounter : public sigslot::has_slots<> {
+ public:
+  void OnUnknownAddress(PortInterface* port,
+                        const rtc::SocketAddress& address,
+                        ProtocolType proto,
+                        IceMessage* stun_msg,
+                        const std::string& remote_username,
+                        bool port_muxed) {
+    ++count_;
+  }
+  int count() const { return count_; }
+
+ private:
+  int count_ = 0;
+};
+
+// Creates 10000 sessions on one socket over loopback, and has a single client
+// socket check each of them.
+TEST(IceLitePortAllocatorScaleTest, DISABLED_ManySessionsOnOneSocket) {
+  const int kNumSessions = 10000;
+  const int kBatchSize = 100;
+  rtc::PhysicalSocketServer ss;
+  rtc::AutoSocketServerThread thread(&ss);
+  rtc::BasicPacketSocketFactory socket_factory(&thread);
+  IceLitePortAllocator allocator(&socket_factory);
+  allocator.Initialize();
+  rtc::SocketAddress server_address;
+  ASSERT_TRUE(allocator.AddSharedSocket(kServerAddress, &server_address));
+
+  std::vector<IceParameters> ice_params;
+  for (int i = 0; i < kNumSessions; ++i) {
+    ice_params.emplace_back("server" + std::to_string(i),
+                            "server-password-" + std::to_string(i), false);
+  }
+  UnknownAddressCounter counter;
+  const int64_t start_bytes = rtc::GetProcessResidentSizeBytes();
+  int64_t start_us = rtc::TimeMicros();
+  std::vector<std::unique_ptr<PortAllocatorSession>> sessions;
+  for (const IceParameters& params : ice_params) {
+    sessions.push_back(allocator.CreateSession(
+        "test", ICE_CANDIDATE_COMPONENT_DEFAULT, params.ufrag, params.pwd));
+    sessions.back()->StartGettingPorts();
+    ASSERT_EQ(1u, sessions.back()->ReadyPorts().size());
+    Port* port = static_cast<Port*>(sessions.back()->ReadyPorts()[0]);
+    port->SetIceRole(ICEROLE_CONTROLLED);
+    port->SignalUnknownAddress.connect(
+        &counter, &UnknownAddressCounter::OnUnknownAddress);
+  }
+  const int64_t create_us = rtc::TimeMicros() - start_us;
+  const int64_t bytes_per_session =
+      (rtc::GetProcessResidentSizeBytes() - start_bytes) / kNumSessions;
+
+  std::unique_ptr<rtc::AsyncPacketSocket> client(
+      socket_factory.CreateUdpSocket(rtc::SocketAddress("127.0.0.1", 0), 0,
+                                     0));
+  ASSERT_TRUE(client);
+  start_us = rtc::TimeMicros();
+  for (int i = 0; i < kNumSessions; i += kBatchSize) {
+    for (int j = i; j < i + kBatchSize; ++j) {
+      std::string request =
+          CreateBindingRequest(ice_params[j], kClientIceParams1);
+      client->SendTo(request.data(), request.size(), server_address,
+                     rtc::PacketOptions());
+    }
+    // Not a WAIT, which sleeps between the packets.
+    const int64_t deadline_ms = rtc::TimeMillis() + kTimeoutMs;
+    while (counter.count() < i + kBatchSize &&
+           rtc::TimeMillis() < deadline_ms) {
+      thread.ProcessMessages(0);
+    }
+    ASSERT_EQ(i + kBatchSize, counter.count());
+  }
+  const int64_t check_us = rtc::TimeMicros() - start_us;
+
+  printf("%d sessions on %zu socket: %lld bytes per session, created in %lld "
+         "ms, %.0f binding requests/s\n",
+         kNumSessions, allocator.num_shared_sockets(),
+         static_cast<long long>(bytes_per_session),
+         static_cast<long long>(create_us / 1000),
+         kNumSessions * 1e6 / check_us);
+}
+
+}  // namespace cricket
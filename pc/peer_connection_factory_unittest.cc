@@ -11,6 +11,7 @@
 #include "pc/peer_connection_factory.h"
 
 #include <stddef.h>
+#include <stdio.h>
 
 #include <memory>
 #include <string>
@@ -38,7 +39,12 @@
 #include "p2p/base/port_interface.h"
 #include "pc/test/fake_audio_capture_module.h"
 #include "pc/test/fake_video_track_source.h"
+#include "pc/test/mock_peer_connection_observers.h"
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/rtc_certificate_pool.h"
 #include "rtc_base/socket_address.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
 #include "test/gtest.h"
 
 #ifdef WEBRTC_ANDROID
@@ -146,6 +152,47 @@ class PeerConnectionFactoryTest : public ::testing::Test {
     }
   }
 
+  // Creates |num_peer_connections| PeerConnections with real certificate
+  // generators, optionally sharing |pool|, and returns the average time in
+  // microseconds from creating each of them until its first offer is ready.
+  int64_t CreatePeerConnectionsAndOffers(
+      int num_peer_connections,
+      rtc::Thread* cert_worker_thread,
+      rtc::scoped_refptr<rtc::RTCCertificatePool> pool) {
+    std::vector<rtc::scoped_refptr<PeerConnectionInterface>> pcs;
+    int64_t total_time_us = 0;
+    for (int i = 0; i < num_peer_connections; ++i) {
+      int64_t start_us = rtc::TimeMicros();
+      std::unique_ptr<rtc::RTCCertificateGeneratorInterface> cert_generator(
+          new rtc::RTCCertificateGenerator(rtc::Thread::Current(),
+                                           cert_worker_thread, pool));
+      rtc::scoped_refptr<PeerConnectionInterface> pc(
+          factory_->CreatePeerConnection(
+              PeerConnectionInterface::RTCConfiguration(),
+              std::make_unique<cricket::FakePortAllocator>(
+                  rtc::Thread::Current(), nullptr),
+              std::move(cert_generator), &observer_));
+      EXPECT_TRUE(pc);
+      if (!pc) {
+        return 0;
+      }
+      auto observer = rtc::make_ref_counted<
+          webrtc::MockCreateSessionDescriptionObserver>();
+      pc->CreateOffer(observer,
+                      PeerConnectionInterface::RTCOfferAnswerOptions());
+      while (!observer->called()) {
+        rtc::Thread::Current()->ProcessMessages(0);
+      }
+      total_time_us += rtc::TimeMicros() - start_us;
+      EXPECT_TRUE(observer->result());
+      pcs.push_back(pc);
+    }
+    for (const auto& pc : pcs) {
+      pc->Close();
+    }
+    return total_time_us / num_peer_connections;
+  }
+
   void VerifyAudioCodecCapability(const webrtc::RtpCodecCapability& codec) {
     EXPECT_EQ(codec.kind, cricket::MEDIA_TYPE_AUDIO);
     EXPECT_FALSE(codec.name.empty());
@@ -481,3 +528,34 @@ TEST_F(PeerConnectionFactoryTest, LocalRendering) {
   EXPECT_EQ(3, local_renderer.num_rendered_frames());
   EXPECT_FALSE(local_renderer.black_frame());
 }
+
+// Benchmarks the time from PeerConnection creation to the first offer with
+// certificates generated on demand and taken from an RTCCertificatePool.
+TEST_F(PeerConnectionFactoryTest,
+       DISABLED_CreateOfferWithCertificatePoolPerformance) {
+  const int kNumPeerConnections = 1000;
+  const size_t kPoolDepth = 16;
+  std::unique_ptr<rtc::Thread> cert_worker_thread = rtc::Thread::Create();
+  ASSERT_TRUE(cert_worker_thread->Start());
+
+  int64_t unpooled_us = CreatePeerConnectionsAndOffers(
+      kNumPeerConnections, cert_worker_thread.get(), nullptr);
+
+  rtc::scoped_refptr<rtc::RTCCertificatePool> pool =
+      rtc::RTCCertificatePool::Create(cert_worker_thread.get(),
+                                      rtc::KeyParams(), kPoolDepth);
+  ASSERT_TRUE(pool);
+  while (pool->size() < kPoolDepth) {
+    rtc::Thread::Current()->ProcessMessages(1);
+  }
+  int64_t pooled_us = CreatePeerConnectionsAndOffers(
+      kNumPeerConnections, cert_worker_thread.get(), pool);
+
+  rtc::RTCCertificatePool::Stats stats = pool->GetStats();
+  printf("Time to first offer, %d PeerConnections: %.3f ms without pool, "
+         "%.3f ms with pool (%llu hits, %llu misses).\n",
+         kNumPeerConnections, unpooled_us / 1000.0, pooled_us / 1000.0,
+         static_cast<unsigned long long>(stats.hits),
+         static_cast<unsigned long long>(stats.misses));
+  EXPECT_GT(stats.hits, 0u);
+}
@@ -32,6 +32,8 @@
 #include "rtc_base/ssl_identity.h"
 #include "rtc_base/ssl_stream_adapter.h"
 #include "rtc_base/string_encode.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/metrics.h"
 
 using cricket::MediaSessionOptions;
 using rtc::UniqueRandomIdGenerator;
@@ -187,6 +189,7 @@ WebRtcSessionDescriptionFactory::WebRtcSessionDescriptionFactory(
 
     // Request certificate. This happens asynchronously, so that the caller gets
     // a chance to connect to |SignalCertificateReady|.
+    certificate_request_time_ms_ = rtc::TimeMillis();
     cert_generator_->GenerateCertificateAsync(key_params, absl::nullopt,
                                               callback);
   }
@@ -489,6 +492,14 @@ void WebRtcSessionDescriptionFactory::SetCertificate(
   RTC_DCHECK(certificate);
   RTC_LOG(LS_VERBOSE) << "Setting new certificate.";
 
+  if (certificate_request_time_ms_) {
+    // Close to zero when the certificate was taken from a pre-generated
+    // rtc::RTCCertificatePool.
+    RTC_HISTOGRAM_COUNTS_10000(
+        "WebRTC.PeerConnection.CertificateGenerationTimeMs",
+        rtc::TimeMillis() - *certificate_request_time_ms_);
+    certificate_request_time_ms_ = absl::nullopt;
+  }
   certificate_request_state_ = CERTIFICATE_SUCCEEDED;
 
   on_certificate_ready_(certificate);
@@ -18,6 +18,7 @@
 #include <queue>
 #include <string>
 
+#include "absl/types/optional.h"
 #include "api/jsep.h"
 #include "api/peer_connection_interface.h"
 #include "api/scoped_refptr.h"
@@ -156,6 +157,9 @@ class WebRtcSessionDescriptionFactory : public rtc::MessageHandler,
   const SdpStateProvider* sdp_info_;
   const std::string session_id_;
   CertificateRequestState certificate_request_state_;
+  // When the certificate was requested from |cert_generator_|, for the
+  // certificate generation time metric. Unset for constructor certificates.
+  absl::optional<int64_t> certificate_request_time_ms_;
 
   std::function<void(const rtc::scoped_refptr<rtc::RTCCertificate>&)>
       on_certificate_ready_;
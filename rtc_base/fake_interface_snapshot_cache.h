@@ -0,0 +1,45 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef RTC_BASE_FAKE_INTERFACE_SNAPSHOT_CACHE_H_
+#define RTC_BASE_FAKE_INTERFACE_SNAPSHOT_CACHE_H_
+
+#include <vector>
+
+#include "rtc_base/interface_snapshot.h"
+
+namespace rtc {
+
+// Serves |entries| instead of the interfaces of the host. Change notifications
+// are simulated with OnInterfacesChanged() and OnRoutesChanged().
+class FakeInterfaceSnapshotCache : public InterfaceSnapshotCache {
+ public:
+  FakeInterfaceSnapshotCache()
+      : InterfaceSnapshotCache(/*use_change_notifications=*/false) {}
+
+  bool change_notifications_enabled() const override {
+    return notifications_enabled;
+  }
+
+  std::vector<InterfaceSnapshot::Entry> entries;
+  bool enumeration_fails = false;
+  bool notifications_enabled = false;
+
+ protected:
+  bool EnumerateInterfaces(
+      std::vector<InterfaceSnapshot::Entry>* result) override {
+    *result = entries;
+    return !enumeration_fails;
+  }
+};
+
+}  // namespace rtc
+
+#endif  // RTC_BASE_FAKE_INTERFACE_SNAPSHOT_CACHE_H_
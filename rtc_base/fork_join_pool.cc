@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/fork_join_pool.h"
+
+#include <utility>
+
+#include "rtc_base/checks.h"
+#include "rtc_base/event.h"
+#include "rtc_base/platform_thread.h"
+
+namespace webrtc {
+
+// A thread running one job at a time for ForkJoinPool::Run().
+class ForkJoinPool::WorkerThread {
+ public:
+  explicit WorkerThread(absl::string_view name)
+      : thread_(rtc::PlatformThread::SpawnJoinable([this] { Loop(); }, name)) {}
+
+  ~WorkerThread() {
+    // An empty job stops the thread.
+    job_ = nullptr;
+    start_.Set();
+  }
+
+  void Start(std::function<void()> job) {
+    RTC_DCHECK(job);
+    job_ = std::move(job);
+    start_.Set();
+  }
+
+  void WaitForDone() { done_.Wait(rtc::Event::kForever); }
+
+ private:
+  void Loop() {
+    while (true) {
+      start_.Wait(rtc::Event::kForever);
+      if (!job_) {
+        return;
+      }
+      job_();
+      job_ = nullptr;
+      done_.Set();
+    }
+  }
+
+  // |job_| is handed over between the threads by |start_| and |done_|.
+  std::function<void()> job_;
+  rtc::Event start_;
+  rtc::Event done_;
+  // Placed last so that it's joined before the other members are destroyed.
+  rtc::PlatformThread thread_;
+};
+
+ForkJoinPool::ForkJoinPool(absl::string_view thread_name)
+    : thread_name_(thread_name) {}
+
+ForkJoinPool::~ForkJoinPool() = default;
+
+void ForkJoinPool::Run(int num_jobs, const std::function<void(int)>& job) {
+  RTC_DCHECK_GE(num_jobs, 1);
+  while (static_cast<int>(worker_threads_.size()) < num_jobs - 1) {
+    worker_threads_.push_back(std::make_unique<WorkerThread>(thread_name_));
+  }
+  for (int i = 1; i < num_jobs; ++i) {
+    worker_threads_[i - 1]->Start([&job, i] { job(i); });
+  }
+  job(0);
+  for (int i = 1; i < num_jobs; ++i) {
+    worker_threads_[i - 1]->WaitForDone();
+  }
+}
+
+}  // namespace webrtc
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef RTC_BASE_FORK_JOIN_POOL_H_
+#define RTC_BASE_FORK_JOIN_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace webrtc {
+
+// Splits work into jobs that run in parallel, and waits for all of them, as
+// for processing the parts of a frame. The threads are created on first use
+// and reused by later calls. Run() must not be called from several threads at
+// the same time.
+class ForkJoinPool {
+ public:
+  explicit ForkJoinPool(absl::string_view thread_name);
+  ~ForkJoinPool();
+
+  ForkJoinPool(const ForkJoinPool&) = delete;
+  ForkJoinPool& operator=(const ForkJoinPool&) = delete;
+
+  // Calls |job| with each index in [0, |num_jobs|), each on its own thread,
+  // and returns when all calls have returned. Job 0 runs on the calling
+  // thread, so a single job doesn't need any other thread.
+  void Run(int num_jobs, const std::function<void(int)>& job);
+
+ private:
+  class WorkerThread;
+
+  const std::string thread_name_;
+  std::vector<std::unique_ptr<WorkerThread>> worker_threads_;
+};
+
+}  // namespace webrtc
+
+#endif  // RTC_BASE_FORK_JOIN_POOL_H_
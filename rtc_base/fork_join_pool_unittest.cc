@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/fork_join_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "rtc_base/event.h"
+#include "rtc_base/platform_thread_types.h"
+#include "test/gtest.h"
+
+namespace webrtc {
+
+TEST(ForkJoinPoolTest, RunsSingleJobOnCallingThread) {
+  ForkJoinPool pool("TestThread");
+  const rtc::PlatformThreadRef current = rtc::CurrentThreadRef();
+  bool ran = false;
+  pool.Run(1, [&](int index) {
+    EXPECT_EQ(index, 0);
+    EXPECT_TRUE(rtc::IsThreadRefEqual(rtc::CurrentThreadRef(), current));
+    ran = true;
+  });
+  EXPECT_TRUE(ran);
+}
+
+TEST(ForkJoinPoolTest, RunsEachJobOnceAndWaitsForAll) {
+  ForkJoinPool pool("TestThread");
+  // Runs more jobs than before, which adds threads, and fewer, which leaves
+  // some idle.
+  for (int num_jobs : {3, 5, 2}) {
+    std::vector<int> runs(num_jobs, 0);
+    pool.Run(num_jobs, [&](int index) { ++runs[index]; });
+    EXPECT_EQ(runs, std::vector<int>(num_jobs, 1));
+  }
+}
+
+TEST(ForkJoinPoolTest, RunsJobsConcurrently) {
+  ForkJoinPool pool("TestThread");
+  constexpr int kNumJobs = 4;
+  // Each job waits for all others to have started, which only completes if
+  // they all run at the same time.
+  std::atomic<int> started(0);
+  rtc::Event all_started(/*manual_reset=*/true, /*initially_signaled=*/false);
+  pool.Run(kNumJobs, [&](int /*index*/) {
+    if (++started == kNumJobs) {
+      all_started.Set();
+    }
+    EXPECT_TRUE(all_started.Wait(5000));
+  });
+  EXPECT_EQ(started, kNumJobs);
+}
+
+}  // namespace webrtc
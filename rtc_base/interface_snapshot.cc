@@ -0,0 +1,251 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/interface_snapshot.h"
+
+#include <errno.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(WEBRTC_LINUX)
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif  // defined(WEBRTC_LINUX)
+
+#include <memory>
+#include <utility>
+
+#include "rtc_base/ifaddrs_converter.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+namespace rtc {
+
+namespace {
+
+#if defined(WEBRTC_LINUX)
+// Opens a non-blocking netlink socket which receives a message for every
+// change of the links, addresses and routes of the host. Returns -1 on
+// failure, e.g. if the process is not allowed to bind netlink sockets.
+int OpenNotificationSocket() {
+  int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  NETLINK_ROUTE);
+  if (fd < 0) {
+    RTC_LOG_ERR(LS_WARNING) << "Failed to create netlink socket";
+    return -1;
+  }
+  struct sockaddr_nl address;
+  memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+                      RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) != 0) {
+    RTC_LOG_ERR(LS_WARNING) << "Failed to bind netlink socket";
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+#endif  // defined(WEBRTC_LINUX)
+
+}  // namespace
+
+bool InterfaceSnapshot::Entry::operator==(const Entry& other) const {
+  return name == other.name && flags == other.flags && ip == other.ip &&
+         mask == other.mask && scope_id == other.scope_id;
+}
+
+// static
+std::vector<InterfaceSnapshot::Entry> InterfaceSnapshot::ConvertIfAddrs(
+    const struct ifaddrs* interfaces,
+    IfAddrsConverter* converter) {
+  std::vector<Entry> entries;
+  for (const struct ifaddrs* cursor = interfaces; cursor != nullptr;
+       cursor = cursor->ifa_next) {
+    // Some interfaces may not have address assigned.
+    if (!cursor->ifa_addr || !cursor->ifa_netmask) {
+      continue;
+    }
+    // Skip ones which are down.
+    if (!(cursor->ifa_flags & IFF_RUNNING)) {
+      continue;
+    }
+    // Skip unknown family.
+    if (cursor->ifa_addr->sa_family != AF_INET &&
+        cursor->ifa_addr->sa_family != AF_INET6) {
+      continue;
+    }
+    Entry entry;
+    // Convert to InterfaceAddress.
+    if (!converter->ConvertIfAddrsToIPAddress(cursor, &entry.ip,
+                                              &entry.mask)) {
+      continue;
+    }
+    entry.name = cursor->ifa_name;
+    entry.flags = cursor->ifa_flags;
+    if (cursor->ifa_addr->sa_family == AF_INET6) {
+      entry.scope_id =
+          reinterpret_cast<sockaddr_in6*>(cursor->ifa_addr)->sin6_scope_id;
+    }
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+InterfaceSnapshot::InterfaceSnapshot(std::vector<Entry> entries,
+                                     uint64_t generation)
+    : entries_(std::move(entries)), generation_(generation) {}
+
+InterfaceSnapshot::~InterfaceSnapshot() = default;
+
+// static
+InterfaceSnapshotCache* InterfaceSnapshotCache::Get() {
+  static InterfaceSnapshotCache* const cache =
+      new InterfaceSnapshotCache(/*use_change_notifications=*/true);
+  return cache;
+}
+
+InterfaceSnapshotCache::InterfaceSnapshotCache(bool use_change_notifications) {
+#if defined(WEBRTC_LINUX)
+  if (use_change_notifications) {
+    webrtc::MutexLock lock(&mutex_);
+    notification_fd_ = OpenNotificationSocket();
+  }
+#endif  // defined(WEBRTC_LINUX)
+}
+
+InterfaceSnapshotCache::~InterfaceSnapshotCache() {
+  webrtc::MutexLock lock(&mutex_);
+  if (notification_fd_ >= 0) {
+    close(notification_fd_);
+  }
+}
+
+scoped_refptr<const InterfaceSnapshot> InterfaceSnapshotCache::GetSnapshot(
+    int64_t max_age_ms) {
+  const bool polling = !change_notifications_enabled();
+  webrtc::MutexLock lock(&mutex_);
+  // Notifications that arrive while enumerating are only read on the next
+  // call, so no change can be missed.
+  ReadChangeNotifications();
+  const int64_t now = TimeMillis();
+  if (snapshot_ && !invalidated_ &&
+      ((!changed_ && !polling) || now - last_enumeration_ms_ < max_age_ms)) {
+    return snapshot_;
+  }
+
+  std::vector<InterfaceSnapshot::Entry> entries;
+  ++enumeration_count_;
+  if (!EnumerateInterfaces(&entries)) {
+    return snapshot_;
+  }
+  last_enumeration_ms_ = now;
+  changed_ = false;
+  invalidated_ = false;
+  if (snapshot_ && entries == snapshot_->entries()) {
+    return snapshot_;
+  }
+
+  RTC_LOG(LS_INFO) << "Interface addresses changed, " << entries.size()
+                   << " usable addresses.";
+  snapshot_ = scoped_refptr<const InterfaceSnapshot>(
+      new InterfaceSnapshot(std::move(entries), ++generation_));
+  return snapshot_;
+}
+
+void InterfaceSnapshotCache::OnInterfacesChanged() {
+  webrtc::MutexLock lock(&mutex_);
+  changed_ = true;
+}
+
+void InterfaceSnapshotCache::OnRoutesChanged() {
+  webrtc::MutexLock lock(&mutex_);
+  ++route_generation_;
+}
+
+void InterfaceSnapshotCache::Invalidate() {
+  webrtc::MutexLock lock(&mutex_);
+  invalidated_ = true;
+}
+
+bool InterfaceSnapshotCache::change_notifications_enabled() const {
+  webrtc::MutexLock lock(&mutex_);
+  return notification_fd_ >= 0;
+}
+
+uint64_t InterfaceSnapshotCache::route_generation() const {
+  webrtc::MutexLock lock(&mutex_);
+  return route_generation_;
+}
+
+int InterfaceSnapshotCache::enumeration_count() const {
+  webrtc::MutexLock lock(&mutex_);
+  return enumeration_count_;
+}
+
+bool InterfaceSnapshotCache::EnumerateInterfaces(
+    std::vector<InterfaceSnapshot::Entry>* entries) {
+  struct ifaddrs* interfaces;
+  int error = getifaddrs(&interfaces);
+  if (error != 0) {
+    RTC_LOG_ERR(LERROR) << "getifaddrs failed to gather interface data: "
+                        << error;
+    return false;
+  }
+  std::unique_ptr<IfAddrsConverter> converter(CreateIfAddrsConverter());
+  *entries = InterfaceSnapshot::ConvertIfAddrs(interfaces, converter.get());
+  freeifaddrs(interfaces);
+  return true;
+}
+
+void InterfaceSnapshotCache::ReadChangeNotifications() {
+#if defined(WEBRTC_LINUX)
+  // Route changes don't change the result of getifaddrs, but may change the
+  // default local addresses. Any other message may change the interfaces.
+  alignas(struct nlmsghdr) char buffer[4096];
+  while (notification_fd_ >= 0) {
+    ssize_t received = recv(notification_fd_, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+      struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+      for (int remaining = static_cast<int>(received);
+           NLMSG_OK(header, remaining);
+           header = NLMSG_NEXT(header, remaining)) {
+        if (header->nlmsg_type == RTM_NEWROUTE ||
+            header->nlmsg_type == RTM_DELROUTE) {
+          ++route_generation_;
+        } else {
+          changed_ = true;
+        }
+      }
+    } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (received < 0 && errno == EINTR) {
+      continue;
+    } else if (received < 0 && errno == ENOBUFS) {
+      // Messages were dropped.
+      changed_ = true;
+      ++route_generation_;
+    } else {
+      RTC_LOG_ERR(LS_WARNING)
+          << "Failed to read netlink socket, polling the interfaces instead";
+      close(notification_fd_);
+      notification_fd_ = -1;
+      changed_ = true;
+      ++route_generation_;
+    }
+  }
+#endif  // defined(WEBRTC_LINUX)
+}
+
+}  // namespace rtc
@@ -0,0 +1,137 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef RTC_BASE_INTERFACE_SNAPSHOT_H_
+#define RTC_BASE_INTERFACE_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "api/ref_counted_base.h"
+#include "api/scoped_refptr.h"
+#include "rtc_base/ip_address.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/system/rtc_export.h"
+#include "rtc_base/thread_annotations.h"
+
+struct ifaddrs;
+
+namespace rtc {
+
+class IfAddrsConverter;
+
+// An immutable list of the usable interface addresses of the host, as
+// enumerated by getifaddrs. Addresses without a netmask, of unknown families
+// or on interfaces which are down are left out.
+class RTC_EXPORT InterfaceSnapshot
+    : public RefCountedNonVirtual<InterfaceSnapshot> {
+ public:
+  struct Entry {
+    std::string name;
+    // The ifa_flags of the interface.
+    unsigned int flags = 0;
+    InterfaceAddress ip;
+    IPAddress mask;
+    // Only set for IPv6 addresses.
+    int scope_id = 0;
+
+    bool operator==(const Entry& other) const;
+    bool operator!=(const Entry& other) const { return !(*this == other); }
+  };
+
+  // Returns the usable addresses in |interfaces|, in the same order.
+  static std::vector<Entry> ConvertIfAddrs(const struct ifaddrs* interfaces,
+                                           IfAddrsConverter* converter);
+
+  InterfaceSnapshot(std::vector<Entry> entries, uint64_t generation);
+  ~InterfaceSnapshot();
+
+  const std::vector<Entry>& entries() const { return entries_; }
+  // Incremented by the InterfaceSnapshotCache each time the interfaces change,
+  // so that users can tell if they already processed a snapshot.
+  uint64_t generation() const { return generation_; }
+
+ private:
+  const std::vector<Entry> entries_;
+  const uint64_t generation_;
+};
+
+// Shares one InterfaceSnapshot between all the network managers of the
+// process, so that the interfaces are enumerated once per change instead of
+// once per manager and update interval.
+//
+// On Linux and Android, the interfaces are only enumerated again after a
+// netlink notification about a link or address change was received, and
+// route changes are counted by route_generation(). Elsewhere, or if the
+// netlink socket cannot be opened, the interfaces are polled and route changes
+// are not detected. Thread safe.
+class RTC_EXPORT InterfaceSnapshotCache {
+ public:
+  // Returns the process-wide cache, which is never destroyed.
+  static InterfaceSnapshotCache* Get();
+
+  // If |use_change_notifications| is false, the interfaces are always polled.
+  explicit InterfaceSnapshotCache(bool use_change_notifications);
+  virtual ~InterfaceSnapshotCache();
+
+  InterfaceSnapshotCache(const InterfaceSnapshotCache&) = delete;
+  InterfaceSnapshotCache& operator=(const InterfaceSnapshotCache&) = delete;
+
+  // Returns the current snapshot. The interfaces are enumerated again if
+  // Invalidate() was called, or if the last enumeration is at least
+  // |max_age_ms| old and either a change was notified since or change
+  // notifications are not available. Returns null if the interfaces have never
+  // been enumerated successfully.
+  scoped_refptr<const InterfaceSnapshot> GetSnapshot(int64_t max_age_ms);
+
+  // Marks the snapshot as outdated, as when a change notification arrives.
+  void OnInterfacesChanged();
+  // Increments route_generation(), as when a route change notification
+  // arrives.
+  void OnRoutesChanged();
+  // Makes the next GetSnapshot() call enumerate the interfaces regardless of
+  // the age of the snapshot.
+  void Invalidate();
+
+  virtual bool change_notifications_enabled() const;
+  // Incremented each time the routes of the host changed, which may change
+  // the default local addresses without changing the interfaces. Only
+  // meaningful if change_notifications_enabled(). Pending notifications are
+  // read by GetSnapshot().
+  uint64_t route_generation() const;
+  // The number of times the interfaces were enumerated.
+  int enumeration_count() const;
+
+ protected:
+  // Enumerates the interfaces of the host. Overridden in tests.
+  virtual bool EnumerateInterfaces(
+      std::vector<InterfaceSnapshot::Entry>* entries);
+
+ private:
+  // Reads all pending change notifications, if any.
+  void ReadChangeNotifications() RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable webrtc::Mutex mutex_;
+  // The netlink socket, or -1 if the interfaces are polled.
+  int notification_fd_ RTC_GUARDED_BY(mutex_) = -1;
+  scoped_refptr<const InterfaceSnapshot> snapshot_ RTC_GUARDED_BY(mutex_);
+  uint64_t generation_ RTC_GUARDED_BY(mutex_) = 0;
+  uint64_t route_generation_ RTC_GUARDED_BY(mutex_) = 0;
+  int64_t last_enumeration_ms_ RTC_GUARDED_BY(mutex_) = 0;
+  int enumeration_count_ RTC_GUARDED_BY(mutex_) = 0;
+  bool changed_ RTC_GUARDED_BY(mutex_) = false;
+  bool invalidated_ RTC_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace rtc
+
+#endif  // RTC_BASE_INTERFACE_SNAPSHOT_H_
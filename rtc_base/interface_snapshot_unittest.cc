@@ -0,0 +1,142 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/interface_snapshot.h"
+
+#include <net/if.h>
+
+#include <string>
+#include <vector>
+
+#include "api/units/time_delta.h"
+#include "rtc_base/fake_clock.h"
+#include "rtc_base/fake_interface_snapshot_cache.h"
+#include "rtc_base/ip_address.h"
+#include "test/gtest.h"
+
+namespace rtc {
+
+namespace {
+
+const int64_t kMaxAgeMs = 1000;
+
+InterfaceSnapshot::Entry MakeEntry(const std::string& name,
+                                   const std::string& ip) {
+  InterfaceSnapshot::Entry entry;
+  entry.name = name;
+  entry.flags = IFF_RUNNING;
+  IPAddress address;
+  IPFromString(ip, &address);
+  entry.ip = InterfaceAddress(address);
+  IPFromString("255.255.255.0", &entry.mask);
+  return entry;
+}
+
+}  // namespace
+
+class InterfaceSnapshotTest : public ::testing::Test {
+ protected:
+  InterfaceSnapshotTest() { clock_.AdvanceTime(webrtc::TimeDelta::Seconds(1)); }
+
+  ScopedFakeClock clock_;
+  FakeInterfaceSnapshotCache cache_;
+};
+
+TEST_F(InterfaceSnapshotTest, GenerationOnlyChangesWithTheInterfaces) {
+  cache_.entries = {MakeEntry("eth0", "192.168.0.2")};
+  scoped_refptr<const InterfaceSnapshot> first = cache_.GetSnapshot(kMaxAgeMs);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(1u, first->entries().size());
+
+  // Enumerating the same interfaces again keeps the snapshot.
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(kMaxAgeMs));
+  EXPECT_EQ(first, cache_.GetSnapshot(kMaxAgeMs));
+  EXPECT_EQ(2, cache_.enumeration_count());
+
+  cache_.entries.push_back(MakeEntry("eth1", "10.0.0.2"));
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(kMaxAgeMs));
+  scoped_refptr<const InterfaceSnapshot> second =
+      cache_.GetSnapshot(kMaxAgeMs);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(2u, second->entries().size());
+  EXPECT_GT(second->generation(), first->generation());
+}
+
+TEST_F(InterfaceSnapshotTest, PollsAfterMaxAge) {
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(1, cache_.enumeration_count());
+
+  // Other managers asking shortly after share the enumeration.
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(kMaxAgeMs - 1));
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(1, cache_.enumeration_count());
+
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(1));
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(2, cache_.enumeration_count());
+}
+
+TEST_F(InterfaceSnapshotTest, EnumeratesOnlyAfterChangeNotifications) {
+  cache_.notifications_enabled = true;
+  cache_.GetSnapshot(kMaxAgeMs);
+  clock_.AdvanceTime(webrtc::TimeDelta::Seconds(10));
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(1, cache_.enumeration_count());
+
+  cache_.OnInterfacesChanged();
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(2, cache_.enumeration_count());
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(2, cache_.enumeration_count());
+
+  // Bursts of notifications are coalesced.
+  cache_.OnInterfacesChanged();
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(2, cache_.enumeration_count());
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(kMaxAgeMs));
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(3, cache_.enumeration_count());
+}
+
+TEST_F(InterfaceSnapshotTest, RouteChangesDoNotEnumerate) {
+  cache_.notifications_enabled = true;
+  cache_.GetSnapshot(kMaxAgeMs);
+  const uint64_t route_generation = cache_.route_generation();
+
+  cache_.OnRoutesChanged();
+  clock_.AdvanceTime(webrtc::TimeDelta::Millis(kMaxAgeMs));
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(1, cache_.enumeration_count());
+  EXPECT_GT(cache_.route_generation(), route_generation);
+}
+
+TEST_F(InterfaceSnapshotTest, InvalidateForcesEnumeration) {
+  cache_.notifications_enabled = true;
+  cache_.GetSnapshot(kMaxAgeMs);
+  cache_.Invalidate();
+  cache_.GetSnapshot(kMaxAgeMs);
+  EXPECT_EQ(2, cache_.enumeration_count());
+}
+
+TEST_F(InterfaceSnapshotTest, FailedEnumerationKeepsPreviousSnapshot) {
+  cache_.enumeration_fails = true;
+  EXPECT_FALSE(cache_.GetSnapshot(kMaxAgeMs));
+
+  cache_.enumeration_fails = false;
+  scoped_refptr<const InterfaceSnapshot> snapshot =
+      cache_.GetSnapshot(kMaxAgeMs);
+  ASSERT_TRUE(snapshot);
+
+  cache_.enumeration_fails = true;
+  cache_.Invalidate();
+  EXPECT_EQ(snapshot, cache_.GetSnapshot(kMaxAgeMs));
+}
+
+}  // namespace rtc
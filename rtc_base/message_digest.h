@@ -37,6 +37,10 @@ class MessageDigest {
   // Outputs the digest value to |buf| with length |len|.
   // Returns the number of bytes written, i.e., Size().
   virtual size_t Finish(void* buf, size_t len) = 0;
+  // Replaces the state of this digest with the state of |other|, which must
+  // use the same algorithm, so that a common prefix is only hashed once.
+  // Returns false if not supported.
+  virtual bool CopyStateFrom(const MessageDigest& other) { return false; }
 };
 
 // A factory class for creating digest objects.
@@ -20,6 +20,7 @@
 #include "rtc_base/win32.h"
 #elif !defined(__native_client__)
 #include "rtc_base/ifaddrs_converter.h"
+#include "rtc_base/interface_snapshot.h"
 #endif
 
 #include <memory>
@@ -46,6 +47,11 @@ const uint32_t kSignalNetworksMessage = 2;
 // Fetch list of networks every two seconds.
 const int kNetworksUpdateIntervalMs = 2000;
 
+// The interface snapshot is shared by all network managers of the process, so
+// it may have been refreshed by another manager shortly before. Accept such
+// snapshots instead of enumerating the interfaces again.
+const int kInterfaceSnapshotMaxAgeMs = kNetworksUpdateIntervalMs / 2;
+
 const int kHighestNetworkPreference = 127;
 
 typedef struct {
@@ -487,13 +493,23 @@ BasicNetworkManager::BasicNetworkManager(
       allow_mac_based_ipv6_(
           webrtc::field_trial::IsEnabled("WebRTC-AllowMACBasedIPv6")),
       bind_using_ifname_(
-          !webrtc::field_trial::IsDisabled("WebRTC-BindUsingInterfaceName")) {}
+          !webrtc::field_trial::IsDisabled("WebRTC-BindUsingInterfaceName")) {
+#if defined(WEBRTC_POSIX) && !defined(__native_client__)
+  snapshot_cache_ = InterfaceSnapshotCache::Get();
+#endif
+}
 
 BasicNetworkManager::~BasicNetworkManager() {}
 
 void BasicNetworkManager::OnNetworksChanged() {
   RTC_DCHECK_RUN_ON(thread_);
   RTC_LOG(LS_INFO) << "Network change was observed";
+#if defined(WEBRTC_POSIX) && !defined(__native_client__)
+  // The network monitor may have noticed the change before the snapshot, and
+  // may also report adapter types that changed without any address change.
+  snapshot_cache_->Invalidate();
+  merged_snapshot_generation_ = 0;
+#endif
   UpdateNetworksOnce();
 }
 
@@ -511,76 +527,57 @@ void BasicNetworkManager::ConvertIfAddrs(struct ifaddrs* interfaces,
                                          IfAddrsConverter* ifaddrs_converter,
                                          bool include_ignored,
                                          NetworkList* networks) const {
+  InterfaceSnapshot snapshot(
+      InterfaceSnapshot::ConvertIfAddrs(interfaces, ifaddrs_converter),
+      /*generation=*/0);
+  ConvertSnapshot(snapshot, include_ignored, networks);
+}
+
+void BasicNetworkManager::ConvertSnapshot(const InterfaceSnapshot& snapshot,
+                                          bool include_ignored,
+                                          NetworkList* networks) const {
   NetworkMap current_networks;
 
-  for (struct ifaddrs* cursor = interfaces; cursor != nullptr;
-       cursor = cursor->ifa_next) {
+  for (const InterfaceSnapshot::Entry& entry : snapshot.entries()) {
+    const InterfaceAddress& ip = entry.ip;
     IPAddress prefix;
-    IPAddress mask;
-    InterfaceAddress ip;
-    int scope_id = 0;
-
-    // Some interfaces may not have address assigned.
-    if (!cursor->ifa_addr || !cursor->ifa_netmask) {
-      continue;
-    }
-    // Skip ones which are down.
-    if (!(cursor->ifa_flags & IFF_RUNNING)) {
-      continue;
-    }
-    // Skip unknown family.
-    if (cursor->ifa_addr->sa_family != AF_INET &&
-        cursor->ifa_addr->sa_family != AF_INET6) {
-      continue;
-    }
-    // Convert to InterfaceAddress.
-    if (!ifaddrs_converter->ConvertIfAddrsToIPAddress(cursor, &ip, &mask)) {
-      continue;
-    }
 
     // Special case for IPv6 address.
-    if (cursor->ifa_addr->sa_family == AF_INET6) {
-      if (IsIgnoredIPv6(allow_mac_based_ipv6_, ip)) {
-        continue;
-      }
-      scope_id =
-          reinterpret_cast<sockaddr_in6*>(cursor->ifa_addr)->sin6_scope_id;
+    if (ip.family() == AF_INET6 && IsIgnoredIPv6(allow_mac_based_ipv6_, ip)) {
+      continue;
     }
 
     AdapterType adapter_type = ADAPTER_TYPE_UNKNOWN;
     AdapterType vpn_underlying_adapter_type = ADAPTER_TYPE_UNKNOWN;
     NetworkPreference network_preference = NetworkPreference::NEUTRAL;
-    if (cursor->ifa_flags & IFF_LOOPBACK) {
+    if (entry.flags & IFF_LOOPBACK) {
       adapter_type = ADAPTER_TYPE_LOOPBACK;
     } else {
       // If there is a network_monitor, use it to get the adapter type.
       // Otherwise, get the adapter type based on a few name matching rules.
       if (network_monitor_) {
-        adapter_type = network_monitor_->GetAdapterType(cursor->ifa_name);
-        network_preference =
-            network_monitor_->GetNetworkPreference(cursor->ifa_name);
+        adapter_type = network_monitor_->GetAdapterType(entry.name);
+        network_preference = network_monitor_->GetNetworkPreference(entry.name);
       }
       if (adapter_type == ADAPTER_TYPE_UNKNOWN) {
-        adapter_type = GetAdapterTypeFromName(cursor->ifa_name);
+        adapter_type = GetAdapterTypeFromName(entry.name.c_str());
       }
     }
 
     if (adapter_type == ADAPTER_TYPE_VPN && network_monitor_) {
       vpn_underlying_adapter_type =
-          network_monitor_->GetVpnUnderlyingAdapterType(cursor->ifa_name);
+          network_monitor_->GetVpnUnderlyingAdapterType(entry.name);
     }
-    int prefix_length = CountIPMaskBits(mask);
+    int prefix_length = CountIPMaskBits(entry.mask);
     prefix = TruncateIP(ip, prefix_length);
-    std::string key =
-        MakeNetworkKey(std::string(cursor->ifa_name), prefix, prefix_length);
+    std::string key = MakeNetworkKey(entry.name, prefix, prefix_length);
     auto iter = current_networks.find(key);
     if (iter == current_networks.end()) {
       // TODO(phoglund): Need to recognize other types as well.
-      std::unique_ptr<Network> network(
-          new Network(cursor->ifa_name, cursor->ifa_name, prefix, prefix_length,
-                      adapter_type));
+      std::unique_ptr<Network> network(new Network(
+          entry.name, entry.name, prefix, prefix_length, adapter_type));
       network->set_default_local_address_provider(this);
-      network->set_scope_id(scope_id);
+      network->set_scope_id(entry.scope_id);
       network->AddIP(ip);
       network->set_ignored(IsIgnoredNetwork(*network));
       network->set_underlying_type_for_vpn(vpn_underlying_adapter_type);
@@ -604,19 +601,12 @@ void BasicNetworkManager::ConvertIfAddrs(struct ifaddrs* interfaces,
 
 bool BasicNetworkManager::CreateNetworks(bool include_ignored,
                                          NetworkList* networks) const {
-  struct ifaddrs* interfaces;
-  int error = getifaddrs(&interfaces);
-  if (error != 0) {
-    RTC_LOG_ERR(LERROR) << "getifaddrs failed to gather interface data: "
-                        << error;
+  scoped_refptr<const InterfaceSnapshot> snapshot =
+      snapshot_cache_->GetSnapshot(kInterfaceSnapshotMaxAgeMs);
+  if (!snapshot) {
     return false;
   }
-
-  std::unique_ptr<IfAddrsConverter> ifaddrs_converter(CreateIfAddrsConverter());
-  ConvertIfAddrs(interfaces, ifaddrs_converter.get(), include_ignored,
-                 networks);
-
-  freeifaddrs(interfaces);
+  ConvertSnapshot(*snapshot, include_ignored, networks);
   return true;
 }
 
@@ -938,7 +928,33 @@ void BasicNetworkManager::UpdateNetworksOnce() {
     return;
 
   NetworkList list;
-  if (!CreateNetworks(false, &list)) {
+  bool created = false;
+#if defined(WEBRTC_POSIX) && !defined(__native_client__)
+  scoped_refptr<const InterfaceSnapshot> snapshot =
+      snapshot_cache_->GetSnapshot(kInterfaceSnapshotMaxAgeMs);
+  const uint64_t route_generation = snapshot_cache_->route_generation();
+  if (snapshot && sent_first_update_ &&
+      snapshot->generation() == merged_snapshot_generation_) {
+    // The networks are up to date, but the default route may have changed.
+    // Without change notifications, that is not known.
+    if (route_generation != queried_route_generation_ ||
+        !snapshot_cache_->change_notifications_enabled()) {
+      queried_route_generation_ = route_generation;
+      set_default_local_addresses(QueryDefaultLocalAddress(AF_INET),
+                                  QueryDefaultLocalAddress(AF_INET6));
+    }
+    return;
+  }
+  if (snapshot) {
+    ConvertSnapshot(*snapshot, false, &list);
+    merged_snapshot_generation_ = snapshot->generation();
+    queried_route_generation_ = route_generation;
+    created = true;
+  }
+#else
+  created = CreateNetworks(false, &list);
+#endif
+  if (!created) {
     SignalError();
   } else {
     bool changed;
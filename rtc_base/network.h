@@ -39,6 +39,8 @@ extern const char kPublicIPv4Host[];
 extern const char kPublicIPv6Host[];
 
 class IfAddrsConverter;
+class InterfaceSnapshot;
+class InterfaceSnapshotCache;
 class Network;
 class NetworkMonitorInterface;
 class Thread;
@@ -265,6 +267,10 @@ class RTC_EXPORT BasicNetworkManager : public NetworkManagerBase,
                       IfAddrsConverter* converter,
                       bool include_ignored,
                       NetworkList* networks) const RTC_RUN_ON(thread_);
+  // Creates a network object for each network in |snapshot|.
+  void ConvertSnapshot(const InterfaceSnapshot& snapshot,
+                       bool include_ignored,
+                       NetworkList* networks) const RTC_RUN_ON(thread_);
 #endif  // defined(WEBRTC_POSIX)
 
   // Creates a network object for each network available on the machine.
@@ -305,6 +311,14 @@ class RTC_EXPORT BasicNetworkManager : public NetworkManagerBase,
       RTC_GUARDED_BY(thread_);
   bool allow_mac_based_ipv6_ RTC_GUARDED_BY(thread_) = false;
   bool bind_using_ifname_ RTC_GUARDED_BY(thread_) = false;
+#if defined(WEBRTC_POSIX)
+  // The process-wide interface snapshot, the generation of the snapshot that
+  // |networks_| were last merged from, and the route generation at which the
+  // default local addresses were last queried.
+  InterfaceSnapshotCache* snapshot_cache_ = nullptr;
+  uint64_t merged_snapshot_generation_ RTC_GUARDED_BY(thread_) = 0;
+  uint64_t queried_route_generation_ RTC_GUARDED_BY(thread_) = 0;
+#endif  // defined(WEBRTC_POSIX)
 };
 
 // Represents a Unix-type network interface, with a name and single address.
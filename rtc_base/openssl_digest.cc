@@ -55,6 +55,15 @@ size_t OpenSSLDigest::Finish(void* buf, size_t len) {
   return md_len;
 }
 
+bool OpenSSLDigest::CopyStateFrom(const MessageDigest& other) {
+  // OpenSSLDigest is the only MessageDigest.
+  const OpenSSLDigest& other_digest = static_cast<const OpenSSLDigest&>(other);
+  if (!md_ || other_digest.md_ != md_) {
+    return false;
+  }
+  return EVP_MD_CTX_copy_ex(ctx_, other_digest.ctx_) == 1;
+}
+
 bool OpenSSLDigest::GetDigestEVP(const std::string& algorithm,
                                  const EVP_MD** mdp) {
   const EVP_MD* md;
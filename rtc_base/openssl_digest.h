@@ -32,6 +32,8 @@ class OpenSSLDigest final : public MessageDigest {
   void Update(const void* buf, size_t len) override;
   // Outputs the digest value to |buf| with length |len|.
   size_t Finish(void* buf, size_t len) override;
+  // |other| must be an OpenSSLDigest too.
+  bool CopyStateFrom(const MessageDigest& other) override;
 
   // Helper function to look up a digest's EVP by name.
   static bool GetDigestEVP(const std::string& algorithm, const EVP_MD** md);
@@ -10,7 +10,10 @@
 
 #include "rtc_base/openssl_session_cache.h"
 
+#include <openssl/rand.h>
+
 #include "rtc_base/checks.h"
+#include "rtc_base/logging.h"
 #include "rtc_base/openssl.h"
 
 namespace rtc {
@@ -50,4 +53,93 @@ SSLMode OpenSSLSessionCache::GetSSLMode() const {
   return ssl_mode_;
 }
 
+namespace {
+// Identifies the sessions of the DTLS session cache. Servers refuse to resume
+// sessions with a different context.
+constexpr char kDtlsSessionIdContext[] = "webrtc-dtls";
+}  // namespace
+
+constexpr size_t DtlsSessionCache::kDefaultMaxSessions;
+
+DtlsSessionCache::DtlsSessionCache(size_t max_sessions)
+    : max_sessions_(max_sessions) {
+  RTC_DCHECK_GT(max_sessions, 0);
+  RTC_CHECK(RAND_bytes(ticket_keys_, sizeof(ticket_keys_)));
+}
+
+DtlsSessionCache::~DtlsSessionCache() {
+  for (const auto& it : sessions_) {
+    SSL_SESSION_free(it.second);
+  }
+}
+
+SSL_SESSION* DtlsSessionCache::LookupSession(const std::string& key) {
+  webrtc::MutexLock lock(&mutex_);
+  auto it = sessions_by_key_.find(key);
+  if (it == sessions_by_key_.end()) {
+    return nullptr;
+  }
+  sessions_.splice(sessions_.begin(), sessions_, it->second);
+  SSL_SESSION* session = it->second->second;
+  SSL_SESSION_up_ref(session);
+  return session;
+}
+
+void DtlsSessionCache::AddSession(const std::string& key,
+                                  SSL_SESSION* session) {
+  RTC_DCHECK(session);
+  SSL_SESSION_up_ref(session);
+  webrtc::MutexLock lock(&mutex_);
+  auto it = sessions_by_key_.find(key);
+  if (it != sessions_by_key_.end()) {
+    SSL_SESSION_free(it->second->second);
+    it->second->second = session;
+    sessions_.splice(sessions_.begin(), sessions_, it->second);
+    return;
+  }
+  sessions_.emplace_front(key, session);
+  sessions_by_key_[key] = sessions_.begin();
+  if (sessions_.size() > max_sessions_) {
+    SSL_SESSION_free(sessions_.back().second);
+    sessions_by_key_.erase(sessions_.back().first);
+    sessions_.pop_back();
+  }
+}
+
+void DtlsSessionCache::RemoveSession(const std::string& key) {
+  webrtc::MutexLock lock(&mutex_);
+  auto it = sessions_by_key_.find(key);
+  if (it == sessions_by_key_.end()) {
+    return;
+  }
+  SSL_SESSION_free(it->second->second);
+  sessions_.erase(it->second);
+  sessions_by_key_.erase(it);
+}
+
+size_t DtlsSessionCache::num_sessions() const {
+  webrtc::MutexLock lock(&mutex_);
+  return sessions_.size();
+}
+
+bool DtlsSessionCache::ConfigureServerContext(SSL_CTX* ctx) const {
+  // Both OpenSSL and BoringSSL return the size of their ticket keys when asked
+  // for the keys without an output buffer.
+  long keys_length = SSL_CTX_get_tlsext_ticket_keys(ctx, nullptr, 0);
+  if (keys_length <= 0 ||
+      static_cast<size_t>(keys_length) > sizeof(ticket_keys_)) {
+    RTC_LOG(LS_ERROR) << "Unexpected session ticket keys length "
+                      << keys_length;
+    return false;
+  }
+  // The keys are not modified, despite the non-const parameter.
+  if (!SSL_CTX_set_tlsext_ticket_keys(
+          ctx, const_cast<uint8_t*>(ticket_keys_), keys_length)) {
+    return false;
+  }
+  return SSL_CTX_set_session_id_context(
+             ctx, reinterpret_cast<const unsigned char*>(kDtlsSessionIdContext),
+             sizeof(kDtlsSessionIdContext) - 1) == 1;
+}
+
 }  // namespace rtc
@@ -12,12 +12,19 @@
 #define RTC_BASE_OPENSSL_SESSION_CACHE_H_
 
 #include <openssl/ossl_typ.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include <list>
 #include <map>
 #include <string>
+#include <utility>
 
 #include "rtc_base/constructor_magic.h"
 #include "rtc_base/ssl_stream_adapter.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/system/rtc_export.h"
+#include "rtc_base/thread_annotations.h"
 
 #ifndef OPENSSL_IS_BORINGSSL
 typedef struct ssl_session_st SSL_SESSION;
@@ -63,6 +70,60 @@ class OpenSSLSessionCache final {
   RTC_DISALLOW_COPY_AND_ASSIGN(OpenSSLSessionCache);
 };
 
+// The DtlsSessionCache lets DTLS associations between the same two
+// certificates skip the full handshake, which saves the certificate exchange
+// and all signing on both sides. It is shared by the OpenSSLStreamAdapters of
+// many DTLS transports, e.g. of all PeerConnections of a process.
+//
+// Clients cache the session of each completed handshake by the fingerprints
+// of the remote and the local certificate, and offer it when they connect to
+// the same peer again. Servers issue session tickets encrypted with keys that
+// are generated once per cache, so that any server adapter sharing the cache
+// can resume them. Resumed sessions are only accepted if the certificate of
+// the peer stored in the session matches the signaled fingerprint.
+//
+// Thread safe; the cache may be shared by adapters on different threads.
+class RTC_EXPORT DtlsSessionCache final {
+ public:
+  static constexpr size_t kDefaultMaxSessions = 1000;
+
+  // |max_sessions| bounds the number of client sessions in the cache; the
+  // least recently used session is dropped when it is exceeded.
+  explicit DtlsSessionCache(size_t max_sessions = kDefaultMaxSessions);
+  // Frees the cached SSL_SESSIONs.
+  ~DtlsSessionCache();
+
+  // Looks up the client session for |key|. The returned SSL_SESSION is
+  // up_refed and must be freed by the caller, or nullptr if there is none.
+  SSL_SESSION* LookupSession(const std::string& key);
+  // Adds a client session to the cache, and up_refs it. Any existing session
+  // with the same key is replaced.
+  void AddSession(const std::string& key, SSL_SESSION* session);
+  // Removes the client session for |key|, if any.
+  void RemoveSession(const std::string& key);
+  size_t num_sessions() const;
+
+  // Configures |ctx| of a server to issue and accept the session tickets of
+  // this cache. Returns false on failure.
+  bool ConfigureServerContext(SSL_CTX* ctx) const;
+
+ private:
+  typedef std::list<std::pair<std::string, SSL_SESSION*>> SessionList;
+
+  const size_t max_sessions_;
+  // Random keys used to encrypt and authenticate the session tickets. Large
+  // enough for the ticket key formats of both OpenSSL and BoringSSL.
+  uint8_t ticket_keys_[80];
+
+  mutable webrtc::Mutex mutex_;
+  // Sessions, most recently used first, and an index to them by key.
+  SessionList sessions_ RTC_GUARDED_BY(mutex_);
+  std::map<std::string, SessionList::iterator> sessions_by_key_
+      RTC_GUARDED_BY(mutex_);
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(DtlsSessionCache);
+};
+
 }  // namespace rtc
 
 #endif  // RTC_BASE_OPENSSL_SESSION_CACHE_H_
@@ -101,4 +101,77 @@ TEST(OpenSSLSessionCache, AddToExistingReplacesPrevious) {
   SSL_CTX_free(ssl_ctx);
 }
 
+TEST(DtlsSessionCache, InvalidLookupReturnsNullptr) {
+  DtlsSessionCache session_cache;
+  EXPECT_EQ(session_cache.LookupSession("Invalid"), nullptr);
+  EXPECT_EQ(session_cache.LookupSession(""), nullptr);
+}
+
+TEST(DtlsSessionCache, LookupReturnsAddedSession) {
+  SSL_CTX* ssl_ctx = NewDtlsContext();
+  SSL_SESSION* ssl_session = SSL_SESSION_new(ssl_ctx);
+
+  DtlsSessionCache session_cache;
+  session_cache.AddSession("fingerprints", ssl_session);
+  // The cache holds its own reference.
+  SSL_SESSION_free(ssl_session);
+  SSL_SESSION* found_session = session_cache.LookupSession("fingerprints");
+  EXPECT_EQ(found_session, ssl_session);
+  SSL_SESSION_free(found_session);
+  EXPECT_EQ(1u, session_cache.num_sessions());
+
+  SSL_CTX_free(ssl_ctx);
+}
+
+TEST(DtlsSessionCache, AddToExistingReplacesPrevious) {
+  SSL_CTX* ssl_ctx = NewDtlsContext();
+  SSL_SESSION* ssl_session_1 = SSL_SESSION_new(ssl_ctx);
+  SSL_SESSION* ssl_session_2 = SSL_SESSION_new(ssl_ctx);
+
+  DtlsSessionCache session_cache;
+  session_cache.AddSession("fingerprints", ssl_session_1);
+  session_cache.AddSession("fingerprints", ssl_session_2);
+  SSL_SESSION* found_session = session_cache.LookupSession("fingerprints");
+  EXPECT_EQ(found_session, ssl_session_2);
+  SSL_SESSION_free(found_session);
+  EXPECT_EQ(1u, session_cache.num_sessions());
+
+  SSL_SESSION_free(ssl_session_1);
+  SSL_SESSION_free(ssl_session_2);
+  SSL_CTX_free(ssl_ctx);
+}
+
+TEST(DtlsSessionCache, EvictsLeastRecentlyUsedSession) {
+  SSL_CTX* ssl_ctx = NewDtlsContext();
+  SSL_SESSION* ssl_session = SSL_SESSION_new(ssl_ctx);
+
+  DtlsSessionCache session_cache(/*max_sessions=*/2);
+  session_cache.AddSession("a", ssl_session);
+  session_cache.AddSession("b", ssl_session);
+  // Makes "b" the least recently used session.
+  SSL_SESSION_free(session_cache.LookupSession("a"));
+  session_cache.AddSession("c", ssl_session);
+  EXPECT_EQ(2u, session_cache.num_sessions());
+  EXPECT_EQ(session_cache.LookupSession("b"), nullptr);
+  SSL_SESSION* found_session = session_cache.LookupSession("a");
+  EXPECT_EQ(found_session, ssl_session);
+  SSL_SESSION_free(found_session);
+
+  session_cache.RemoveSession("a");
+  EXPECT_EQ(session_cache.LookupSession("a"), nullptr);
+  EXPECT_EQ(1u, session_cache.num_sessions());
+
+  SSL_SESSION_free(ssl_session);
+  SSL_CTX_free(ssl_ctx);
+}
+
+TEST(DtlsSessionCache, ConfiguresServerContext) {
+  SSL_CTX* ssl_ctx = NewDtlsContext();
+
+  DtlsSessionCache session_cache;
+  EXPECT_TRUE(session_cache.ConfigureServerContext(ssl_ctx));
+
+  SSL_CTX_free(ssl_ctx);
+}
+
 }  // namespace rtc
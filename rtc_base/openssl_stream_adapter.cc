@@ -13,6 +13,10 @@
 #include <openssl/bio.h>
 #include <openssl/crypto.h>
 #include <openssl/err.h>
+#ifdef OPENSSL_IS_BORINGSSL
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#endif
 #include <openssl/rand.h>
 #include <openssl/tls1.h>
 #include <openssl/x509v3.h>
@@ -32,6 +36,7 @@
 #include "rtc_base/openssl.h"
 #include "rtc_base/openssl_adapter.h"
 #include "rtc_base/openssl_digest.h"
+#include "rtc_base/openssl_session_cache.h"
 #ifdef OPENSSL_IS_BORINGSSL
 #include "rtc_base/boringssl_identity.h"
 #else
@@ -40,6 +45,7 @@
 #include "rtc_base/openssl_utility.h"
 #include "rtc_base/ssl_certificate.h"
 #include "rtc_base/stream.h"
+#include "rtc_base/string_encode.h"
 #include "rtc_base/task_utils/to_queued_task.h"
 #include "rtc_base/thread.h"
 #include "rtc_base/time_utils.h"
@@ -150,6 +156,39 @@ void TimeCallbackForTesting(const SSL* ssl, struct timeval* out_clock) {
   out_clock->tv_sec = time / kNumNanosecsPerSec;
   out_clock->tv_usec = (time % kNumNanosecsPerSec) / kNumNanosecsPerMicrosec;
 }
+
+// Computes the signature of |input| with |key| for the TLS signature algorithm
+// |signature_algorithm|. Thread safe.
+bool SignWithPrivateKey(EVP_PKEY* key,
+                        uint16_t signature_algorithm,
+                        const Buffer& input,
+                        Buffer* signature) {
+  bssl::ScopedEVP_MD_CTX ctx;
+  EVP_PKEY_CTX* pctx;
+  if (!EVP_DigestSignInit(ctx.get(), &pctx,
+                          SSL_get_signature_algorithm_digest(
+                              signature_algorithm),
+                          nullptr, key)) {
+    return false;
+  }
+  if (SSL_is_signature_algorithm_rsa_pss(signature_algorithm) &&
+      (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) ||
+       !EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1 /* hash length */))) {
+    return false;
+  }
+  size_t length = 0;
+  if (!EVP_DigestSign(ctx.get(), nullptr, &length, input.data(),
+                      input.size())) {
+    return false;
+  }
+  signature->SetSize(length);
+  if (!EVP_DigestSign(ctx.get(), signature->data(), &length, input.data(),
+                      input.size())) {
+    return false;
+  }
+  signature->SetSize(length);
+  return true;
+}
 #endif
 
 }  // namespace
@@ -370,6 +409,7 @@ bool OpenSSLStreamAdapter::SetPeerCertificateDigest(
   }
 
   if (state_ == SSL_CONNECTED) {
+    MaybeCacheSession();
     // Post the event asynchronously to unwind the stack. The caller
     // of ContinueSSL may be the same object listening for these
     // events and may not be prepared for reentrancy.
@@ -550,6 +590,29 @@ void OpenSSLStreamAdapter::SetInitialRetransmissionTimeout(int timeout_ms) {
   dtls_handshake_timeout_ms_ = timeout_ms;
 }
 
+void OpenSSLStreamAdapter::SetDtlsSessionCache(DtlsSessionCache* cache) {
+  RTC_DCHECK(ssl_ctx_ == nullptr);
+  session_cache_ = cache;
+}
+
+void OpenSSLStreamAdapter::SetHandshakeTaskQueue(
+    webrtc::TaskQueueBase* task_queue) {
+  RTC_DCHECK(ssl_ctx_ == nullptr);
+#ifdef OPENSSL_IS_BORINGSSL
+  handshake_task_queue_ = task_queue;
+#else
+  // OpenSSL has no asynchronous private key operations; the handshake signs
+  // synchronously.
+  if (task_queue) {
+    RTC_LOG(LS_INFO) << "Ignoring the handshake task queue with OpenSSL.";
+  }
+#endif
+}
+
+bool OpenSSLStreamAdapter::IsSessionResumed() const {
+  return state_ == SSL_CONNECTED && SSL_session_reused(ssl_);
+}
+
 //
 // StreamInterface Implementation
 //
@@ -890,6 +953,17 @@ int OpenSSLStreamAdapter::BeginSSL() {
   SSL_set_mode(ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE |
                          SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
+#ifdef OPENSSL_IS_BORINGSSL
+  if (handshake_task_queue_ && identity_) {
+    static const SSL_PRIVATE_KEY_METHOD kAsyncPrivateKeyMethod = {
+        &OpenSSLStreamAdapter::SignAsync, &OpenSSLStreamAdapter::DecryptAsync,
+        &OpenSSLStreamAdapter::CompleteAsync};
+    SSL_set_private_key_method(ssl_, &kAsyncPrivateKeyMethod);
+  }
+#endif
+
+  MaybeResumeCachedSession();
+
   // Do the connect
   return ContinueSSL();
 }
@@ -907,11 +981,23 @@ int OpenSSLStreamAdapter::ContinueSSL() {
   switch (ssl_error) {
     case SSL_ERROR_NONE:
       RTC_DLOG(LS_VERBOSE) << " -- success";
+      if (SSL_session_reused(ssl_)) {
+        // The certificate verification callback is not called for resumed
+        // sessions, so verify the certificate stored in the session here.
+        SetPeerCertChainFromResumedSession();
+        if (!peer_cert_chain_ ||
+            (HasPeerCertificateDigest() && !VerifyPeerCertificate())) {
+          RTC_LOG(LS_WARNING) << "Rejected resumed session.";
+          SignalSSLHandshakeError(SSLHandshakeError::UNKNOWN);
+          return -1;
+        }
+      }
       // By this point, OpenSSL should have given us a certificate, or errored
       // out if one was missing.
       RTC_DCHECK(peer_cert_chain_ || !GetClientAuthEnabled());
 
       state_ = SSL_CONNECTED;
+      MaybeCacheSession();
       if (!WaitingToVerifyPeerCertificate()) {
         // We have everything we need to start the connection, so signal
         // SE_OPEN. If we need a client certificate fingerprint and don't have
@@ -938,6 +1024,13 @@ int OpenSSLStreamAdapter::ContinueSSL() {
       RTC_DLOG(LS_VERBOSE) << " -- error want write";
       break;
 
+#ifdef OPENSSL_IS_BORINGSSL
+    case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
+      // Continued by OnPrivateKeyOperationDone().
+      RTC_DLOG(LS_VERBOSE) << " -- error want private key operation";
+      break;
+#endif
+
     case SSL_ERROR_ZERO_RETURN:
     default:
       SSLHandshakeError ssl_handshake_err = SSLHandshakeError::UNKNOWN;
@@ -947,6 +1040,10 @@ int OpenSSLStreamAdapter::ContinueSSL() {
       }
       RTC_DLOG(LS_VERBOSE) << " -- error " << code << ", " << err_code << ", "
                            << ERR_GET_REASON(err_code);
+      if (session_cache_ && !session_cache_key_.empty()) {
+        // Don't offer a session again that may have caused the failure.
+        session_cache_->RemoveSession(session_cache_key_);
+      }
       SignalSSLHandshakeError(ssl_handshake_err);
       return (ssl_error != 0) ? ssl_error : -1;
   }
@@ -1005,6 +1102,8 @@ void OpenSSLStreamAdapter::Cleanup(uint8_t alert) {
   }
   identity_.reset();
   peer_cert_chain_.reset();
+  private_key_operation_pending_ = false;
+  private_key_signature_.reset();
 
   // Clear the DTLS timer
   timeout_task_.Stop();
@@ -1104,6 +1203,12 @@ SSL_CTX* OpenSSLStreamAdapter::SetupSSLContext() {
     }
   }
 
+  if (session_cache_ && ssl_mode_ == SSL_MODE_DTLS && role_ == SSL_SERVER &&
+      !session_cache_->ConfigureServerContext(ctx)) {
+    SSL_CTX_free(ctx);
+    return nullptr;
+  }
+
   return ctx;
 }
 
@@ -1137,6 +1242,79 @@ bool OpenSSLStreamAdapter::VerifyPeerCertificate() {
   return true;
 }
 
+std::string OpenSSLStreamAdapter::SessionCacheKey() const {
+  if (!HasPeerCertificateDigest() || !identity_) {
+    return std::string();
+  }
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  size_t digest_length;
+  if (!identity_->certificate().ComputeDigest(
+          peer_certificate_digest_algorithm_, digest, sizeof(digest),
+          &digest_length)) {
+    return std::string();
+  }
+  return peer_certificate_digest_algorithm_ + ":" +
+         hex_encode(peer_certificate_digest_value_.data<char>(),
+                    peer_certificate_digest_value_.size()) +
+         ":" + hex_encode(reinterpret_cast<const char*>(digest), digest_length);
+}
+
+void OpenSSLStreamAdapter::MaybeResumeCachedSession() {
+  if (!session_cache_ || ssl_mode_ != SSL_MODE_DTLS || role_ != SSL_CLIENT) {
+    return;
+  }
+  session_cache_key_ = SessionCacheKey();
+  if (session_cache_key_.empty()) {
+    return;
+  }
+  SSL_SESSION* session = session_cache_->LookupSession(session_cache_key_);
+  if (!session) {
+    return;
+  }
+  if (!SSL_set_session(ssl_, session)) {
+    RTC_LOG(LS_WARNING) << "Failed to offer cached session.";
+  }
+  SSL_SESSION_free(session);
+}
+
+void OpenSSLStreamAdapter::MaybeCacheSession() {
+  if (!session_cache_ || ssl_mode_ != SSL_MODE_DTLS || role_ != SSL_CLIENT ||
+      state_ != SSL_CONNECTED || !peer_certificate_verified_) {
+    return;
+  }
+  if (session_cache_key_.empty()) {
+    session_cache_key_ = SessionCacheKey();
+  }
+  SSL_SESSION* session = SSL_get_session(ssl_);
+  if (session_cache_key_.empty() || !session ||
+      !SSL_SESSION_is_resumable(session)) {
+    return;
+  }
+  session_cache_->AddSession(session_cache_key_, session);
+}
+
+void OpenSSLStreamAdapter::SetPeerCertChainFromResumedSession() {
+#ifdef OPENSSL_IS_BORINGSSL
+  const STACK_OF(CRYPTO_BUFFER)* chain = SSL_get0_peer_certificates(ssl_);
+  if (!chain || sk_CRYPTO_BUFFER_num(chain) == 0) {
+    return;
+  }
+  std::vector<std::unique_ptr<SSLCertificate>> cert_chain;
+  for (CRYPTO_BUFFER* cert : chain) {
+    cert_chain.emplace_back(new BoringSSLCertificate(bssl::UpRef(cert)));
+  }
+  peer_cert_chain_.reset(new SSLCertChain(std::move(cert_chain)));
+#else
+  X509* cert = SSL_get_peer_certificate(ssl_);
+  if (!cert) {
+    return;
+  }
+  peer_cert_chain_.reset(
+      new SSLCertChain(std::make_unique<OpenSSLCertificate>(cert)));
+  X509_free(cert);
+#endif
+}
+
 std::unique_ptr<SSLCertChain> OpenSSLStreamAdapter::GetPeerSSLCertChain()
     const {
   return peer_cert_chain_ ? peer_cert_chain_->Clone() : nullptr;
@@ -1171,6 +1349,87 @@ enum ssl_verify_result_t OpenSSLStreamAdapter::SSLVerifyCallback(
 
   return ssl_verify_ok;
 }
+
+enum ssl_private_key_result_t OpenSSLStreamAdapter::SignAsync(
+    SSL* ssl,
+    uint8_t* out,
+    size_t* out_len,
+    size_t max_out,
+    uint16_t signature_algorithm,
+    const uint8_t* in,
+    size_t in_len) {
+  OpenSSLStreamAdapter* stream =
+      reinterpret_cast<OpenSSLStreamAdapter*>(SSL_get_app_data(ssl));
+  EVP_PKEY* key = SSL_get_privatekey(ssl);
+  if (stream->private_key_operation_pending_ || !key) {
+    return ssl_private_key_failure;
+  }
+  stream->private_key_operation_pending_ = true;
+  stream->private_key_signature_.reset();
+  stream->handshake_task_queue_->PostTask(webrtc::ToQueuedTask(
+      [owner = stream->owner_, safety = stream->task_safety_.flag(), stream,
+       key = bssl::UpRef(key), signature_algorithm,
+       input = Buffer(in, in_len)]() {
+        Buffer signature;
+        if (!SignWithPrivateKey(key.get(), signature_algorithm, input,
+                                &signature)) {
+          signature.Clear();
+        }
+        owner->PostTask(webrtc::ToQueuedTask(
+            safety, [stream, signature = std::move(signature)]() mutable {
+              stream->OnPrivateKeyOperationDone(std::move(signature));
+            }));
+      }));
+  return ssl_private_key_retry;
+}
+
+enum ssl_private_key_result_t OpenSSLStreamAdapter::DecryptAsync(
+    SSL* ssl,
+    uint8_t* out,
+    size_t* out_len,
+    size_t max_out,
+    const uint8_t* in,
+    size_t in_len) {
+  // Only used by the RSA key exchange, which none of the allowed cipher
+  // suites use.
+  return ssl_private_key_failure;
+}
+
+enum ssl_private_key_result_t OpenSSLStreamAdapter::CompleteAsync(
+    SSL* ssl,
+    uint8_t* out,
+    size_t* out_len,
+    size_t max_out) {
+  OpenSSLStreamAdapter* stream =
+      reinterpret_cast<OpenSSLStreamAdapter*>(SSL_get_app_data(ssl));
+  if (stream->private_key_operation_pending_) {
+    return ssl_private_key_retry;
+  }
+  if (!stream->private_key_signature_) {
+    return ssl_private_key_failure;
+  }
+  Buffer signature = std::move(*stream->private_key_signature_);
+  stream->private_key_signature_.reset();
+  if (signature.empty() || signature.size() > max_out) {
+    return ssl_private_key_failure;
+  }
+  memcpy(out, signature.data(), signature.size());
+  *out_len = signature.size();
+  return ssl_private_key_success;
+}
+
+void OpenSSLStreamAdapter::OnPrivateKeyOperationDone(Buffer signature) {
+  if (!private_key_operation_pending_) {
+    return;
+  }
+  private_key_operation_pending_ = false;
+  private_key_signature_ = std::move(signature);
+  if (state_ == SSL_CONNECTING) {
+    if (int err = ContinueSSL()) {
+      Error("ContinueSSL", err, 0, true);
+    }
+  }
+}
 #else   // OPENSSL_IS_BORINGSSL
 int OpenSSLStreamAdapter::SSLVerifyCallback(X509_STORE_CTX* store, void* arg) {
   // Get our SSL structure and OpenSSLStreamAdapter from the store.
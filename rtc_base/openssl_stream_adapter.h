@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "absl/types/optional.h"
+#include "api/task_queue/task_queue_base.h"
 #include "rtc_base/buffer.h"
 #ifdef OPENSSL_IS_BORINGSSL
 #include "rtc_base/boringssl_identity.h"
@@ -93,6 +94,9 @@ class OpenSSLStreamAdapter final : public SSLStreamAdapter {
   void SetMode(SSLMode mode) override;
   void SetMaxProtocolVersion(SSLProtocolVersion version) override;
   void SetInitialRetransmissionTimeout(int timeout_ms) override;
+  void SetDtlsSessionCache(DtlsSessionCache* cache) override;
+  void SetHandshakeTaskQueue(webrtc::TaskQueueBase* task_queue) override;
+  bool IsSessionResumed() const override;
 
   StreamResult Read(void* data,
                     size_t data_len,
@@ -183,6 +187,44 @@ class OpenSSLStreamAdapter final : public SSLStreamAdapter {
   // Verify the peer certificate matches the signaled digest.
   bool VerifyPeerCertificate();
 
+  // Returns the key of the sessions with the current peer in the DTLS session
+  // cache, made of the signaled digest of the peer certificate and the same
+  // digest of our certificate, or an empty string if there is none yet.
+  std::string SessionCacheKey() const;
+  // Offers the cached session with the current peer, if any, when connecting
+  // as a client.
+  void MaybeResumeCachedSession();
+  // Caches the session of a connection with a verified peer, as a client.
+  void MaybeCacheSession();
+  // Resumed sessions skip the certificate exchange; records the peer
+  // certificate stored in the session instead.
+  void SetPeerCertChainFromResumedSession();
+
+#ifdef OPENSSL_IS_BORINGSSL
+  // Private key callbacks which sign on |handshake_task_queue_|. See
+  // SSL_set_private_key_method.
+  static enum ssl_private_key_result_t SignAsync(SSL* ssl,
+                                                 uint8_t* out,
+                                                 size_t* out_len,
+                                                 size_t max_out,
+                                                 uint16_t signature_algorithm,
+                                                 const uint8_t* in,
+                                                 size_t in_len);
+  static enum ssl_private_key_result_t DecryptAsync(SSL* ssl,
+                                                    uint8_t* out,
+                                                    size_t* out_len,
+                                                    size_t max_out,
+                                                    const uint8_t* in,
+                                                    size_t in_len);
+  static enum ssl_private_key_result_t CompleteAsync(SSL* ssl,
+                                                     uint8_t* out,
+                                                     size_t* out_len,
+                                                     size_t max_out);
+  // Called on the owner thread with the signature computed on the handshake
+  // task queue, which is empty on failure.
+  void OnPrivateKeyOperationDone(Buffer signature);
+#endif
+
 #ifdef OPENSSL_IS_BORINGSSL
   // SSL certificate verification callback. See SSL_CTX_set_custom_verify.
   static enum ssl_verify_result_t SSLVerifyCallback(SSL* ssl,
@@ -246,6 +288,20 @@ class OpenSSLStreamAdapter final : public SSLStreamAdapter {
   // be too aggressive for low bandwidth links.
   int dtls_handshake_timeout_ms_ = 50;
 
+  // Shared cache of DTLS sessions, not owned; null if sessions are not
+  // resumed.
+  DtlsSessionCache* session_cache_ = nullptr;
+  // The key under which the session of the connection is cached, as a client.
+  std::string session_cache_key_;
+
+  // Task queue for the private key operations of the handshake, not owned;
+  // null if they run synchronously.
+  webrtc::TaskQueueBase* handshake_task_queue_ = nullptr;
+  // Whether a private key operation is running on |handshake_task_queue_|,
+  // and its result once it is done.
+  bool private_key_operation_pending_ = false;
+  absl::optional<Buffer> private_key_signature_;
+
   // TODO(https://bugs.webrtc.org/10261): Completely remove this option in M84.
   const bool support_legacy_tls_protocols_flag_;
 };
@@ -30,6 +30,17 @@ namespace {
 const char kIdentityName[] = "WebRTC";
 const uint64_t kYearInSeconds = 365 * 24 * 60 * 60;
 
+bool SameKeyParams(const KeyParams& a, const KeyParams& b) {
+  if (a.type() != b.type()) {
+    return false;
+  }
+  if (a.type() == KT_RSA) {
+    return a.rsa_params().mod_size == b.rsa_params().mod_size &&
+           a.rsa_params().pub_exp == b.rsa_params().pub_exp;
+  }
+  return a.ec_curve() == b.ec_curve();
+}
+
 }  // namespace
 
 // static
@@ -64,7 +75,15 @@ scoped_refptr<RTCCertificate> RTCCertificateGenerator::GenerateCertificate(
 
 RTCCertificateGenerator::RTCCertificateGenerator(Thread* signaling_thread,
                                                  Thread* worker_thread)
-    : signaling_thread_(signaling_thread), worker_thread_(worker_thread) {
+    : RTCCertificateGenerator(signaling_thread, worker_thread, nullptr) {}
+
+RTCCertificateGenerator::RTCCertificateGenerator(
+    Thread* signaling_thread,
+    Thread* worker_thread,
+    scoped_refptr<RTCCertificatePool> pool)
+    : signaling_thread_(signaling_thread),
+      worker_thread_(worker_thread),
+      pool_(std::move(pool)) {
   RTC_DCHECK(signaling_thread_);
   RTC_DCHECK(worker_thread_);
 }
@@ -76,6 +95,19 @@ void RTCCertificateGenerator::GenerateCertificateAsync(
   RTC_DCHECK(signaling_thread_->IsCurrent());
   RTC_DCHECK(callback);
 
+  if (pool_ && !expires_ms && SameKeyParams(key_params, pool_->key_params())) {
+    scoped_refptr<RTCCertificate> certificate = pool_->TakeCertificate();
+    if (certificate) {
+      // The callback is still invoked asynchronously.
+      signaling_thread_->PostTask(
+          RTC_FROM_HERE,
+          [cert = std::move(certificate), cb = callback]() {
+            cb->OnSuccess(cert);
+          });
+      return;
+    }
+  }
+
   // Create a new |RTCCertificateGenerationTask| for this generation request. It
   // is reference counted and referenced by the message data, ensuring it lives
   // until the task has completed (independent of |RTCCertificateGenerator|).
@@ -17,6 +17,7 @@
 #include "api/scoped_refptr.h"
 #include "rtc_base/ref_count.h"
 #include "rtc_base/rtc_certificate.h"
+#include "rtc_base/rtc_certificate_pool.h"
 #include "rtc_base/ssl_identity.h"
 #include "rtc_base/system/rtc_export.h"
 #include "rtc_base/thread.h"
@@ -53,7 +54,8 @@ class RTCCertificateGeneratorInterface {
 // Standard implementation of |RTCCertificateGeneratorInterface|.
 // The static function |GenerateCertificate| generates a certificate on the
 // current thread. The |RTCCertificateGenerator| instance generates certificates
-// asynchronously on the worker thread with |GenerateCertificateAsync|.
+// asynchronously on the worker thread with |GenerateCertificateAsync|, or takes
+// them from an |RTCCertificatePool| if it has one.
 class RTC_EXPORT RTCCertificateGenerator
     : public RTCCertificateGeneratorInterface {
  public:
@@ -67,6 +69,11 @@ class RTC_EXPORT RTCCertificateGenerator
       const absl::optional<uint64_t>& expires_ms);
 
   RTCCertificateGenerator(Thread* signaling_thread, Thread* worker_thread);
+  // Takes the certificates from |pool| when they are requested with the key
+  // params of the pool and without |expires_ms|, unless the pool is empty.
+  RTCCertificateGenerator(Thread* signaling_thread,
+                          Thread* worker_thread,
+                          scoped_refptr<RTCCertificatePool> pool);
   ~RTCCertificateGenerator() override {}
 
   // |RTCCertificateGeneratorInterface| overrides.
@@ -82,6 +89,7 @@ class RTC_EXPORT RTCCertificateGenerator
  private:
   Thread* const signaling_thread_;
   Thread* const worker_thread_;
+  const scoped_refptr<RTCCertificatePool> pool_;
 };
 
 }  // namespace rtc
@@ -0,0 +1,109 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/rtc_certificate_pool.h"
+
+#include <utility>
+
+#include "absl/types/optional.h"
+#include "rtc_base/checks.h"
+#include "rtc_base/location.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/ref_counted_object.h"
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/time_utils.h"
+
+namespace rtc {
+
+// static
+scoped_refptr<RTCCertificatePool> RTCCertificatePool::Create(
+    Thread* worker_thread,
+    const KeyParams& key_params,
+    size_t depth) {
+  if (!key_params.IsValid()) {
+    return nullptr;
+  }
+  scoped_refptr<RTCCertificatePool> pool(
+      new RefCountedObject<RTCCertificatePool>(worker_thread, key_params,
+                                               depth));
+  webrtc::MutexLock lock(&pool->mutex_);
+  pool->Refill();
+  return pool;
+}
+
+RTCCertificatePool::RTCCertificatePool(Thread* worker_thread,
+                                       const KeyParams& key_params,
+                                       size_t depth)
+    : worker_thread_(worker_thread), key_params_(key_params), depth_(depth) {
+  RTC_DCHECK(worker_thread_);
+}
+
+RTCCertificatePool::~RTCCertificatePool() = default;
+
+scoped_refptr<RTCCertificate> RTCCertificatePool::TakeCertificate() {
+  const uint64_t now = static_cast<uint64_t>(TimeUTCMillis());
+  webrtc::MutexLock lock(&mutex_);
+  scoped_refptr<RTCCertificate> certificate;
+  while (!certificates_.empty() && !certificate) {
+    certificate = std::move(certificates_.front());
+    certificates_.pop_front();
+    // Certificates that stayed in the pool for too long are useless.
+    if (certificate->HasExpired(now)) {
+      certificate = nullptr;
+    }
+  }
+  if (certificate) {
+    ++stats_.hits;
+  } else {
+    ++stats_.misses;
+  }
+  Refill();
+  return certificate;
+}
+
+size_t RTCCertificatePool::size() const {
+  webrtc::MutexLock lock(&mutex_);
+  return certificates_.size();
+}
+
+RTCCertificatePool::Stats RTCCertificatePool::GetStats() const {
+  webrtc::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void RTCCertificatePool::Refill() {
+  for (; certificates_.size() + pending_ < depth_; ++pending_) {
+    worker_thread_->PostTask(
+        RTC_FROM_HERE, [pool = scoped_refptr<RTCCertificatePool>(this)]() {
+          pool->GenerateCertificate();
+        });
+  }
+}
+
+void RTCCertificatePool::GenerateCertificate() {
+  RTC_DCHECK(worker_thread_->IsCurrent());
+  int64_t start_us = TimeMicros();
+  scoped_refptr<RTCCertificate> certificate =
+      RTCCertificateGenerator::GenerateCertificate(key_params_, absl::nullopt);
+  int64_t generation_time_us = TimeMicros() - start_us;
+
+  webrtc::MutexLock lock(&mutex_);
+  --pending_;
+  if (!certificate) {
+    // Not retried until the next certificate is taken.
+    RTC_LOG(LS_WARNING) << "Failed to generate a pooled certificate.";
+    return;
+  }
+  certificates_.push_back(std::move(certificate));
+  ++stats_.certificates_generated;
+  stats_.total_generation_time_us += generation_time_us;
+}
+
+}  // namespace rtc
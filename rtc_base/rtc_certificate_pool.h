@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef RTC_BASE_RTC_CERTIFICATE_POOL_H_
+#define RTC_BASE_RTC_CERTIFICATE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+
+#include "api/scoped_refptr.h"
+#include "rtc_base/ref_count.h"
+#include "rtc_base/rtc_certificate.h"
+#include "rtc_base/ssl_identity.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/system/rtc_export.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/thread_annotations.h"
+
+namespace rtc {
+
+// A pool of certificates that are generated ahead of time on a worker thread,
+// so that they can be handed out without waiting for key generation. Whenever
+// a certificate is taken, a new one is generated to keep |depth| certificates
+// ready. Typically shared by the RTCCertificateGenerators of all
+// PeerConnections of a process, see RTCCertificateGenerator.
+//
+// The pooled certificates have the default expiration time. Thread safe.
+class RTC_EXPORT RTCCertificatePool : public RefCountInterface {
+ public:
+  struct Stats {
+    // Number of certificates taken from the pool.
+    uint64_t hits = 0;
+    // Number of times the pool was empty.
+    uint64_t misses = 0;
+    // Number of certificates generated for the pool, and the total time spent
+    // generating them.
+    uint64_t certificates_generated = 0;
+    int64_t total_generation_time_us = 0;
+  };
+
+  // Creates a pool of up to |depth| certificates with |key_params|, and starts
+  // filling it on |worker_thread|, which must outlive the pool. Returns null
+  // if |key_params| are invalid.
+  static scoped_refptr<RTCCertificatePool> Create(Thread* worker_thread,
+                                                  const KeyParams& key_params,
+                                                  size_t depth);
+
+  // Takes a certificate from the pool and starts generating its replacement.
+  // Returns null if the pool is empty, which counts as a miss.
+  scoped_refptr<RTCCertificate> TakeCertificate();
+
+  const KeyParams& key_params() const { return key_params_; }
+  size_t depth() const { return depth_; }
+  // The number of certificates ready to be taken.
+  size_t size() const;
+  Stats GetStats() const;
+
+ protected:
+  RTCCertificatePool(Thread* worker_thread,
+                     const KeyParams& key_params,
+                     size_t depth);
+  ~RTCCertificatePool() override;
+
+ private:
+  // Starts generating certificates until the pool is full.
+  void Refill() RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Generates one certificate, on |worker_thread_|.
+  void GenerateCertificate();
+
+  Thread* const worker_thread_;
+  const KeyParams key_params_;
+  const size_t depth_;
+
+  mutable webrtc::Mutex mutex_;
+  std::deque<scoped_refptr<RTCCertificate>> certificates_
+      RTC_GUARDED_BY(mutex_);
+  // Number of certificates being generated.
+  size_t pending_ RTC_GUARDED_BY(mutex_) = 0;
+  Stats stats_ RTC_GUARDED_BY(mutex_);
+};
+
+}  // namespace rtc
+
+#endif  // RTC_BASE_RTC_CERTIFICATE_POOL_H_
@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2021 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "rtc_base/rtc_certificate_pool.h"
+
+#include <memory>
+
+#include "absl/types/optional.h"
+#include "rtc_base/checks.h"
+#include "rtc_base/gunit.h"
+#include "rtc_base/ref_counted_object.h"
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/thread.h"
+#include "test/gtest.h"
+
+namespace rtc {
+
+namespace {
+
+class CertificateCallback : public RTCCertificateGeneratorCallback {
+ public:
+  void OnSuccess(const scoped_refptr<RTCCertificate>& certificate) override {
+    certificate_ = certificate;
+    completed_ = true;
+  }
+  void OnFailure() override { completed_ = true; }
+
+  bool completed() const { return completed_; }
+  RTCCertificate* certificate() const { return certificate_.get(); }
+
+ private:
+  bool completed_ = false;
+  scoped_refptr<RTCCertificate> certificate_;
+};
+
+}  // namespace
+
+class RTCCertificatePoolTest : public ::testing::Test {
+ public:
+  RTCCertificatePoolTest() : worker_thread_(Thread::Create()) {
+    RTC_CHECK(worker_thread_->Start());
+  }
+
+ protected:
+  static constexpr int kGenerationTimeoutMs = 10000;
+
+  std::unique_ptr<Thread> worker_thread_;
+};
+
+TEST_F(RTCCertificatePoolTest, FillsOnWorkerThread) {
+  scoped_refptr<RTCCertificatePool> pool =
+      RTCCertificatePool::Create(worker_thread_.get(), KeyParams::ECDSA(), 2);
+  ASSERT_TRUE(pool);
+  EXPECT_EQ_WAIT(2u, pool->size(), kGenerationTimeoutMs);
+  EXPECT_EQ(2u, pool->GetStats().certificates_generated);
+  EXPECT_GT(pool->GetStats().total_generation_time_us, 0);
+}
+
+TEST_F(RTCCertificatePoolTest, TakeCertificateRefillsPool) {
+  scoped_refptr<RTCCertificatePool> pool =
+      RTCCertificatePool::Create(worker_thread_.get(), KeyParams::ECDSA(), 1);
+  ASSERT_EQ_WAIT(1u, pool->size(), kGenerationTimeoutMs);
+
+  scoped_refptr<RTCCertificate> certificate = pool->TakeCertificate();
+  EXPECT_TRUE(certificate);
+  EXPECT_EQ(1u, pool->GetStats().hits);
+  EXPECT_EQ(0u, pool->GetStats().misses);
+
+  EXPECT_EQ_WAIT(1u, pool->size(), kGenerationTimeoutMs);
+  EXPECT_NE(certificate, pool->TakeCertificate());
+}
+
+TEST_F(RTCCertificatePoolTest, EmptyPoolMisses) {
+  scoped_refptr<RTCCertificatePool> pool =
+      RTCCertificatePool::Create(worker_thread_.get(), KeyParams::ECDSA(), 0);
+  EXPECT_FALSE(pool->TakeCertificate());
+  EXPECT_EQ(0u, pool->GetStats().hits);
+  EXPECT_EQ(1u, pool->GetStats().misses);
+}
+
+TEST_F(RTCCertificatePoolTest, InvalidKeyParamsReturnNull) {
+  EXPECT_FALSE(RTCCertificatePool::Create(worker_thread_.get(),
+                                          KeyParams::RSA(0, 0), 1));
+}
+
+TEST_F(RTCCertificatePoolTest, GeneratorTakesMatchingCertificatesFromPool) {
+  scoped_refptr<RTCCertificatePool> pool =
+      RTCCertificatePool::Create(worker_thread_.get(), KeyParams::ECDSA(), 1);
+  ASSERT_EQ_WAIT(1u, pool->size(), kGenerationTimeoutMs);
+  RTCCertificateGenerator generator(Thread::Current(), worker_thread_.get(),
+                                    pool);
+
+  auto callback = make_ref_counted<CertificateCallback>();
+  generator.GenerateCertificateAsync(KeyParams::ECDSA(), absl::nullopt,
+                                     callback);
+  // The callback is invoked asynchronously also for pooled certificates.
+  EXPECT_FALSE(callback->completed());
+  EXPECT_TRUE_WAIT(callback->completed(), kGenerationTimeoutMs);
+  EXPECT_TRUE(callback->certificate());
+  EXPECT_EQ(1u, pool->GetStats().hits);
+
+  // Certificates with other key params or expiration times are generated.
+  ASSERT_EQ_WAIT(1u, pool->size(), kGenerationTimeoutMs);
+  callback = make_ref_counted<CertificateCallback>();
+  generator.GenerateCertificateAsync(KeyParams::ECDSA(), 60000, callback);
+  EXPECT_TRUE_WAIT(callback->completed(), kGenerationTimeoutMs);
+  EXPECT_TRUE(callback->certificate());
+  callback = make_ref_counted<CertificateCallback>();
+  generator.GenerateCertificateAsync(KeyParams::RSA(), absl::nullopt,
+                                     callback);
+  EXPECT_TRUE_WAIT(callback->completed(), kGenerationTimeoutMs);
+  EXPECT_TRUE(callback->certificate());
+  EXPECT_EQ(1u, pool->GetStats().hits);
+  EXPECT_EQ(0u, pool->GetStats().misses);
+}
+
+}  // namespace rtc
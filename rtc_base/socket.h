@@ -120,6 +120,9 @@ class Socket {
     OPT_RTP_SENDTIME_EXTN_ID,  // This is a non-traditional socket option param.
                                // This is specific to libjingle and will be used
                                // if SendTime option is needed at socket level.
+    OPT_REUSEPORT,             // Whether several sockets can be bound to the
+                               // same address, and share its load. Must be
+                               // set before Bind().
   };
   virtual int GetOption(Option opt, int* value) = 0;
   virtual int SetOption(Option opt, int value) = 0;
@@ -317,15 +317,17 @@ bool SocketAddressFromSockAddrStorage(const sockaddr_storage& addr,
   if (!out) {
     return false;
   }
+  // Called for every received packet, so |out| is updated in place rather
+  // than assigned a temporary, which would copy its hostname.
   if (addr.ss_family == AF_INET) {
     const sockaddr_in* saddr = reinterpret_cast<const sockaddr_in*>(&addr);
-    *out = SocketAddress(IPAddress(saddr->sin_addr),
-                         NetworkToHost16(saddr->sin_port));
+    out->SetIP(IPAddress(saddr->sin_addr));
+    out->SetPort(NetworkToHost16(saddr->sin_port));
     return true;
   } else if (addr.ss_family == AF_INET6) {
     const sockaddr_in6* saddr = reinterpret_cast<const sockaddr_in6*>(&addr);
-    *out = SocketAddress(IPAddress(saddr->sin6_addr),
-                         NetworkToHost16(saddr->sin6_port));
+    out->SetIP(IPAddress(saddr->sin6_addr));
+    out->SetPort(NetworkToHost16(saddr->sin6_port));
     out->SetScopeID(saddr->sin6_scope_id);
     return true;
   }
@@ -23,8 +23,14 @@
 #include "rtc_base/stream.h"
 #include "rtc_base/third_party/sigslot/sigslot.h"
 
+namespace webrtc {
+class TaskQueueBase;
+}  // namespace webrtc
+
 namespace rtc {
 
+class DtlsSessionCache;
+
 // Constants for SSL profile.
 const int TLS_NULL_WITH_NULL_NULL = 0;
 const int SSL_CIPHER_SUITE_MAX_VALUE = 0xFFFF;
@@ -157,6 +163,24 @@ class SSLStreamAdapter : public StreamInterface, public sigslot::has_slots<> {
   // This should only be called before StartSSL().
   virtual void SetInitialRetransmissionTimeout(int timeout_ms) = 0;
 
+  // Set a cache of DTLS sessions, shared with other streams, which lets the
+  // handshake with a peer that has been connected to before resume the
+  // earlier session instead of exchanging and signing with certificates
+  // again. |cache| is not owned and must outlive the stream.
+  // This should only be called before StartSSL().
+  virtual void SetDtlsSessionCache(DtlsSessionCache* cache) {}
+
+  // Set a task queue on which the private key operations of the handshake
+  // run, so that they do not block the thread of the stream. The handshake
+  // continues on the thread of the stream once they are done. |task_queue| is
+  // not owned and must outlive the stream.
+  // This should only be called before StartSSL().
+  virtual void SetHandshakeTaskQueue(webrtc::TaskQueueBase* task_queue) {}
+
+  // Returns true if the handshake resumed a session from the DTLS session
+  // cache rather than doing a full handshake.
+  virtual bool IsSessionResumed() const { return false; }
+
   // StartSSL starts negotiation with a peer, whose certificate is verified
   // using the certificate digest. Generally, SetIdentity() and possibly
   // SetServerRole() should have been called before this.
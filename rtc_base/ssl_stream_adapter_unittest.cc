@@ -9,6 +9,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -21,6 +22,8 @@
 #include "rtc_base/memory/fifo_buffer.h"
 #include "rtc_base/memory_stream.h"
 #include "rtc_base/message_digest.h"
+#include "rtc_base/null_socket_server.h"
+#include "rtc_base/openssl_session_cache.h"
 #include "rtc_base/openssl_stream_adapter.h"
 #include "rtc_base/ssl_adapter.h"
 #include "rtc_base/ssl_identity.h"
@@ -28,6 +31,8 @@
 #include "rtc_base/stream.h"
 #include "rtc_base/task_utils/pending_task_safety_flag.h"
 #include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
 #include "test/field_trial.h"
 
 using ::testing::Combine;
@@ -1736,3 +1741,286 @@ TEST_F(SSLStreamAdapterTestDTLSLegacyProtocols,
   SetupProtocolVersions(rtc::SSL_PROTOCOL_DTLS_10, rtc::SSL_PROTOCOL_DTLS_10);
   TestHandshake(false);
 }
+
+// Tests for resuming DTLS sessions from a DtlsSessionCache.
+class SSLStreamAdapterTestDTLSResumption : public SSLStreamAdapterTestDTLSBase {
+ public:
+  SSLStreamAdapterTestDTLSResumption()
+      : SSLStreamAdapterTestDTLSBase(rtc::KeyParams::ECDSA(rtc::EC_NIST_P256),
+                                     rtc::KeyParams::ECDSA(rtc::EC_NIST_P256)),
+        client_identity_(rtc::SSLIdentity::Create("client", client_key_type_)),
+        server_identity_(
+            rtc::SSLIdentity::Create("server", server_key_type_)) {}
+
+  // Do not use the SetUp version from the parent class.
+  void SetUp() override {}
+
+  void TearDown() override {
+    client_ssl_.reset();
+    server_ssl_.reset();
+  }
+
+  // Creates new streams, as for a new connection between the same two
+  // endpoints, which share |client_cache| and |server_cache| with the earlier
+  // connections.
+  void Configure(rtc::DtlsSessionCache* client_cache,
+                 rtc::DtlsSessionCache* server_cache,
+                 webrtc::TaskQueueBase* handshake_task_queue = nullptr) {
+    // Destroy the old streams before the buffers they write to.
+    client_ssl_.reset();
+    server_ssl_.reset();
+    to_client_ = std::make_unique<BufferQueueStream>(kBufferCapacity,
+                                                     kDefaultBufferSize);
+    to_server_ = std::make_unique<BufferQueueStream>(kBufferCapacity,
+                                                     kDefaultBufferSize);
+
+    client_stream_ = new SSLDummyStreamDTLS(this, "c2s", to_client_.get(),
+                                            to_server_.get());
+    client_ssl_ =
+        rtc::SSLStreamAdapter::Create(absl::WrapUnique(client_stream_));
+    client_ssl_->SignalEvent.connect(
+        static_cast<SSLStreamAdapterTestBase*>(this),
+        &SSLStreamAdapterTestBase::OnEvent);
+    client_ssl_->SignalEvent.connect(
+        this, &SSLStreamAdapterTestDTLSResumption::OnClientEvent);
+    client_ssl_->SetIdentity(client_identity_->Clone());
+    client_ssl_->SetDtlsSessionCache(client_cache);
+    client_ssl_->SetHandshakeTaskQueue(handshake_task_queue);
+
+    server_stream_ = new SSLDummyStreamDTLS(this, "s2c", to_server_.get(),
+                                            to_client_.get());
+    server_ssl_ =
+        rtc::SSLStreamAdapter::Create(absl::WrapUnique(server_stream_));
+    server_ssl_->SignalEvent.connect(
+        static_cast<SSLStreamAdapterTestBase*>(this),
+        &SSLStreamAdapterTestBase::OnEvent);
+    server_ssl_->SetIdentity(server_identity_->Clone());
+    server_ssl_->SetDtlsSessionCache(server_cache);
+    server_ssl_->SetHandshakeTaskQueue(handshake_task_queue);
+
+    identities_set_ = false;
+    client_opened_ = false;
+  }
+
+  // Like TestHandshake(), but polls without sleeping to time the handshake.
+  bool RunHandshake() {
+    client_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+    server_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+    SetPeerIdentitiesByDigest(true, true);
+    server_ssl_->SetServerRole();
+    if (server_ssl_->StartSSL() != 0 || client_ssl_->StartSSL() != 0) {
+      return false;
+    }
+    int64_t deadline = rtc::TimeMillis() + handshake_wait_;
+    while (client_ssl_->GetState() != rtc::SS_OPEN ||
+           server_ssl_->GetState() != rtc::SS_OPEN) {
+      if (client_ssl_->GetState() == rtc::SS_CLOSED ||
+          server_ssl_->GetState() == rtc::SS_CLOSED ||
+          rtc::TimeMillis() > deadline) {
+        return false;
+      }
+      rtc::Thread::Current()->ProcessMessages(0);
+    }
+    return true;
+  }
+
+  void ReadData(rtc::StreamInterface* stream) override {
+    if (stream == client_ssl_.get() &&
+        server_ssl_->GetState() == rtc::SS_CLOSED) {
+      // The server rejected the session after the client opened it, so the
+      // client only reads the end of the stream.
+      stream->Close();
+      return;
+    }
+    SSLStreamAdapterTestDTLSBase::ReadData(stream);
+  }
+
+  void OnClientEvent(rtc::StreamInterface* stream, int sig, int err) {
+    if (sig & rtc::SE_OPEN) {
+      client_opened_ = true;
+    }
+  }
+
+ protected:
+  const std::unique_ptr<rtc::SSLIdentity> client_identity_;
+  std::unique_ptr<rtc::SSLIdentity> server_identity_;
+  std::unique_ptr<BufferQueueStream> to_client_;
+  std::unique_ptr<BufferQueueStream> to_server_;
+  bool client_opened_ = false;
+};
+
+// Counts the tasks posted to it, which are the private key operations of the
+// handshakes using it as their handshake task queue.
+class CountingThread : public rtc::Thread {
+ public:
+  CountingThread()
+      : rtc::Thread(std::make_unique<rtc::NullSocketServer>()) {}
+  ~CountingThread() override { Stop(); }
+
+  void PostTask(std::unique_ptr<webrtc::QueuedTask> task) override {
+    ++num_tasks_;
+    rtc::Thread::PostTask(std::move(task));
+  }
+
+  int num_tasks() const { return num_tasks_; }
+
+ private:
+  std::atomic<int> num_tasks_{0};
+};
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, ResumesCachedSession) {
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsSessionResumed());
+  EXPECT_FALSE(server_ssl_->IsSessionResumed());
+  EXPECT_EQ(1u, client_cache.num_sessions());
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+  EXPECT_TRUE(client_ssl_->IsSessionResumed());
+  EXPECT_TRUE(server_ssl_->IsSessionResumed());
+  // The peer certificates are known from the resumed session.
+  ASSERT_TRUE(GetPeerCertificate(true));
+  EXPECT_EQ(server_identity_->certificate().ToPEMString(),
+            GetPeerCertificate(true)->ToPEMString());
+  ASSERT_TRUE(GetPeerCertificate(false));
+  EXPECT_EQ(client_identity_->certificate().ToPEMString(),
+            GetPeerCertificate(false)->ToPEMString());
+  TestTransfer(100);
+}
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, ResumedSessionsExportNewKeys) {
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+  unsigned char first_key[20];
+  unsigned char client_key[20];
+  unsigned char server_key[20];
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+  ASSERT_TRUE(ExportKeyingMaterial(kExporterLabel, kExporterContext,
+                                   kExporterContextLen, true, true, first_key,
+                                   sizeof(first_key)));
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+  ASSERT_TRUE(server_ssl_->IsSessionResumed());
+  ASSERT_TRUE(ExportKeyingMaterial(kExporterLabel, kExporterContext,
+                                   kExporterContextLen, true, true, client_key,
+                                   sizeof(client_key)));
+  ASSERT_TRUE(ExportKeyingMaterial(kExporterLabel, kExporterContext,
+                                   kExporterContextLen, true, false, server_key,
+                                   sizeof(server_key)));
+  EXPECT_EQ(0, memcmp(client_key, server_key, sizeof(client_key)));
+  EXPECT_NE(0, memcmp(first_key, client_key, sizeof(first_key)));
+}
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, DoesNotResumeWithOtherPeer) {
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+
+  server_identity_ = rtc::SSLIdentity::Create("server2", server_key_type_);
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsSessionResumed());
+  EXPECT_FALSE(server_ssl_->IsSessionResumed());
+  EXPECT_EQ(2u, client_cache.num_sessions());
+}
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, ServerWithoutCacheDoesNotResume) {
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+
+  // A server with other ticket keys falls back to the full handshake.
+  Configure(&client_cache, nullptr);
+  TestHandshake();
+  EXPECT_FALSE(client_ssl_->IsSessionResumed());
+  EXPECT_FALSE(server_ssl_->IsSessionResumed());
+}
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, RejectsResumedSessionOfOtherPeer) {
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+
+  Configure(&client_cache, &server_cache);
+  TestHandshake();
+
+  // The client offers its cached session, but the server was told the digest
+  // of another certificate than the one stored in the session.
+  Configure(&client_cache, &server_cache);
+  unsigned char digest[20];
+  size_t digest_len;
+  ASSERT_TRUE(server_identity()->certificate().ComputeDigest(
+      rtc::DIGEST_SHA_1, digest, sizeof(digest), &digest_len));
+  ASSERT_TRUE(client_ssl_->SetPeerCertificateDigest(rtc::DIGEST_SHA_1, digest,
+                                                    digest_len));
+  std::unique_ptr<rtc::SSLIdentity> other_identity =
+      rtc::SSLIdentity::Create("other", client_key_type_);
+  ASSERT_TRUE(other_identity->certificate().ComputeDigest(
+      rtc::DIGEST_SHA_1, digest, sizeof(digest), &digest_len));
+  ASSERT_TRUE(server_ssl_->SetPeerCertificateDigest(rtc::DIGEST_SHA_1, digest,
+                                                    digest_len));
+  identities_set_ = true;
+
+  client_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+  server_ssl_->SetMode(rtc::SSL_MODE_DTLS);
+  server_ssl_->SetServerRole();
+  ASSERT_EQ(0, server_ssl_->StartSSL());
+  ASSERT_EQ(0, client_ssl_->StartSSL());
+  EXPECT_TRUE_WAIT(server_ssl_->GetState() == rtc::SS_CLOSED, handshake_wait_);
+  // In a full handshake the server would reject the client certificate before
+  // the client can finish. The client only finishes a resumed handshake first.
+  EXPECT_TRUE(client_opened_);
+}
+
+TEST_F(SSLStreamAdapterTestDTLSResumption, HandshakesWithTaskQueue) {
+  CountingThread handshake_thread;
+  handshake_thread.Start();
+
+  Configure(nullptr, nullptr, &handshake_thread);
+  TestHandshake();
+  TestTransfer(100);
+#ifdef OPENSSL_IS_BORINGSSL
+  // The server signs its key exchange and the client its certificate verify.
+  EXPECT_EQ(2, handshake_thread.num_tasks());
+#else
+  // OpenSSL signs synchronously.
+  EXPECT_EQ(0, handshake_thread.num_tasks());
+#endif
+}
+
+// Measures the rate of full and of resumed DTLS handshakes over in-memory
+// streams.
+TEST_F(SSLStreamAdapterTestDTLSResumption, DISABLED_HandshakesPerSecond) {
+  const int kNumHandshakes = 500;
+  std::unique_ptr<rtc::Thread> handshake_thread = rtc::Thread::Create();
+  handshake_thread->Start();
+  rtc::DtlsSessionCache client_cache;
+  rtc::DtlsSessionCache server_cache;
+
+  for (int run = 0; run < 3; ++run) {
+    const bool resume = run == 1;
+    const bool offload = run == 2;
+    int64_t start_us = rtc::TimeMicros();
+    for (int i = 0; i < kNumHandshakes; ++i) {
+      Configure(resume ? &client_cache : nullptr,
+                resume ? &server_cache : nullptr,
+                offload ? handshake_thread.get() : nullptr);
+      ASSERT_TRUE(RunHandshake());
+      EXPECT_EQ(resume && i > 0, client_ssl_->IsSessionResumed());
+    }
+    int64_t elapsed_us = rtc::TimeMicros() - start_us;
+    printf("%s handshakes: %.0f handshakes/s\n",
+           resume ? "Resumed" : (offload ? "Offloaded" : "Full"),
+           kNumHandshakes * 1e6 / elapsed_us);
+  }
+}
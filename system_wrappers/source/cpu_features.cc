@@ -28,7 +28,7 @@ int GetCPUInfoNoASM(CPUFeature feature) {
 
 #if defined(WEBRTC_ARCH_X86_FAMILY)
 
-#if defined(WEBRTC_ENABLE_AVX2)
+#if defined(WEBRTC_ENABLE_AVX2) || defined(WEBRTC_ENABLE_AVX512)
 // xgetbv returns the value of an Intel Extended Control Register (XCR).
 // Currently only XCR0 is defined by Intel so |xcr| should always be zero.
 static uint64_t xgetbv(uint32_t xcr) {
@@ -41,7 +41,7 @@ static uint64_t xgetbv(uint32_t xcr) {
   return (static_cast<uint64_t>(edx) << 32) | eax;
 #endif  // _MSC_VER
 }
-#endif  // WEBRTC_ENABLE_AVX2
+#endif  // WEBRTC_ENABLE_AVX2 || WEBRTC_ENABLE_AVX512
 
 #ifndef _MSC_VER
 // Intrinsic for "cpuid".
@@ -102,6 +102,26 @@ int GetCPUInfo(CPUFeature feature) {
            (cpu_info7[1] & 0x00000020) != 0;
   }
 #endif  // WEBRTC_ENABLE_AVX2
+#if defined(WEBRTC_ENABLE_AVX512)
+  if (feature == kAVX512F &&
+      !webrtc::field_trial::IsEnabled("WebRTC-Avx512SupportKillSwitch")) {
+    int cpu_info7[4];
+    __cpuid(cpu_info7, 0);
+    int num_ids = cpu_info7[0];
+    if (num_ids < 7) {
+      return 0;
+    }
+    __cpuid(cpu_info7, 7);
+
+    // On top of the AVX requirements above, the kernel must have enabled the
+    // opmask and upper ZMM register state (XCR0 bits 5, 6 and 7).
+    return (cpu_info[2] & 0x10000000) != 0 &&
+           (cpu_info[2] & 0x04000000) != 0 /* XSAVE */ &&
+           (cpu_info[2] & 0x08000000) != 0 /* OSXSAVE */ &&
+           (xgetbv(0) & 0x000000E6) == 0xE6 /* ZMM state enabled by kernel */ &&
+           (cpu_info7[1] & 0x00010000) != 0 /* AVX512F */;
+  }
+#endif  // WEBRTC_ENABLE_AVX512
   return 0;
 }
 #else
@@ -0,0 +1,232 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "video/decode_executor.h"
+
+#include <deque>
+#include <utility>
+
+#include "rtc_base/checks.h"
+#include "rtc_base/time_utils.h"
+
+namespace webrtc {
+
+class DecodeExecutor::Sequence final : public TaskQueueBase {
+ public:
+  explicit Sequence(DecodeExecutor* executor) : executor_(executor) {}
+
+  void Delete() override { executor_->DeleteSequence(this); }
+  void PostTask(std::unique_ptr<QueuedTask> task) override {
+    executor_->PostTask(this, std::move(task));
+  }
+  void PostDelayedTask(std::unique_ptr<QueuedTask> task,
+                       uint32_t milliseconds) override {
+    executor_->PostDelayedTask(this, std::move(task), milliseconds);
+  }
+
+  void Run(std::unique_ptr<QueuedTask> task) {
+    CurrentTaskQueueSetter set_current(this);
+    if (!task->Run()) {
+      // The task took ownership of itself.
+      task.release();
+    }
+    task = nullptr;
+  }
+
+  // The members below are guarded by |executor_->mutex_|.
+  // Runnable tasks with their deadline, in FIFO order.
+  std::deque<std::pair<int64_t, std::unique_ptr<QueuedTask>>> tasks;
+  bool running = false;
+  bool deleted = false;
+  bool scheduled = false;
+  DeadlineKey scheduled_key = {};
+  // Signaled when the running task of a deleted sequence has returned.
+  rtc::Event idle;
+
+ private:
+  DecodeExecutor* const executor_;
+};
+
+constexpr int64_t DecodeExecutor::kLateTaskThresholdMs;
+
+DecodeExecutor::DecodeExecutor(int num_threads) {
+  RTC_DCHECK_GT(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.push_back(rtc::PlatformThread::SpawnJoinable(
+        [this] { ProcessTasks(); }, "DecodeExecutor",
+        rtc::ThreadAttributes().SetPriority(rtc::ThreadPriority::kHigh)));
+  }
+}
+
+DecodeExecutor::~DecodeExecutor() {
+  {
+    MutexLock lock(&mutex_);
+    RTC_DCHECK(ready_sequences_.empty());
+    RTC_DCHECK(delayed_tasks_.empty());
+    stopping_ = true;
+  }
+  wake_up_.Set();
+  // Joins the threads.
+  threads_.clear();
+}
+
+std::unique_ptr<TaskQueueBase, TaskQueueDeleter>
+DecodeExecutor::CreateDecodeQueue() {
+  return std::unique_ptr<TaskQueueBase, TaskQueueDeleter>(new Sequence(this));
+}
+
+DecodeExecutor::Stats DecodeExecutor::GetStats() const {
+  MutexLock lock(&mutex_);
+  return stats_;
+}
+
+void DecodeExecutor::PostTask(Sequence* sequence,
+                              std::unique_ptr<QueuedTask> task) {
+  {
+    MutexLock lock(&mutex_);
+    if (sequence->deleted) {
+      return;
+    }
+    sequence->tasks.emplace_back(rtc::TimeMillis(), std::move(task));
+    MaybeScheduleSequence(sequence);
+  }
+  wake_up_.Set();
+}
+
+void DecodeExecutor::PostDelayedTask(Sequence* sequence,
+                                     std::unique_ptr<QueuedTask> task,
+                                     uint32_t milliseconds) {
+  {
+    MutexLock lock(&mutex_);
+    if (sequence->deleted) {
+      return;
+    }
+    delayed_tasks_.emplace(
+        DeadlineKey{rtc::TimeMillis() + milliseconds, next_order_++},
+        DelayedTask{sequence, std::move(task)});
+  }
+  wake_up_.Set();
+}
+
+void DecodeExecutor::DeleteSequence(Sequence* sequence) {
+  RTC_DCHECK(!sequence->IsCurrent());
+  // Pending tasks are deleted without holding |mutex_|.
+  std::deque<std::pair<int64_t, std::unique_ptr<QueuedTask>>> tasks;
+  std::vector<std::unique_ptr<QueuedTask>> delayed_tasks;
+  bool running;
+  {
+    MutexLock lock(&mutex_);
+    sequence->deleted = true;
+    if (sequence->scheduled) {
+      ready_sequences_.erase(sequence->scheduled_key);
+      sequence->scheduled = false;
+    }
+    tasks.swap(sequence->tasks);
+    for (auto it = delayed_tasks_.begin(); it != delayed_tasks_.end();) {
+      if (it->second.sequence == sequence) {
+        delayed_tasks.push_back(std::move(it->second.task));
+        it = delayed_tasks_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    running = sequence->running;
+  }
+  tasks.clear();
+  delayed_tasks.clear();
+  if (running) {
+    sequence->idle.Wait(rtc::Event::kForever);
+  }
+  delete sequence;
+}
+
+void DecodeExecutor::MaybeScheduleSequence(Sequence* sequence) {
+  if (sequence->running || sequence->scheduled || sequence->tasks.empty()) {
+    return;
+  }
+  sequence->scheduled_key =
+      DeadlineKey{sequence->tasks.front().first, next_order_++};
+  sequence->scheduled = true;
+  ready_sequences_.emplace(sequence->scheduled_key, sequence);
+}
+
+void DecodeExecutor::ProcessTasks() {
+  while (true) {
+    Sequence* sequence = nullptr;
+    std::unique_ptr<QueuedTask> task;
+    int wait_ms = rtc::Event::kForever;
+    bool more_work = false;
+    {
+      MutexLock lock(&mutex_);
+      if (stopping_) {
+        break;
+      }
+      const int64_t now_ms = rtc::TimeMillis();
+      while (!delayed_tasks_.empty() &&
+             delayed_tasks_.begin()->first.deadline_ms <= now_ms) {
+        auto it = delayed_tasks_.begin();
+        Sequence* delayed_sequence = it->second.sequence;
+        delayed_sequence->tasks.emplace_back(it->first.deadline_ms,
+                                             std::move(it->second.task));
+        delayed_tasks_.erase(it);
+        MaybeScheduleSequence(delayed_sequence);
+      }
+
+      if (!ready_sequences_.empty()) {
+        auto it = ready_sequences_.begin();
+        sequence = it->second;
+        ready_sequences_.erase(it);
+        sequence->scheduled = false;
+        sequence->running = true;
+        ++stats_.tasks_run;
+        if (now_ms - sequence->tasks.front().first > kLateTaskThresholdMs) {
+          ++stats_.late_tasks;
+        }
+        task = std::move(sequence->tasks.front().second);
+        sequence->tasks.pop_front();
+        // The thread that took this task may have been the one waiting for
+        // the next delayed task, so another thread has to take over the wait.
+        more_work = !ready_sequences_.empty() || !delayed_tasks_.empty();
+      } else if (!delayed_tasks_.empty()) {
+        wait_ms = static_cast<int>(delayed_tasks_.begin()->first.deadline_ms -
+                                   now_ms);
+      }
+    }
+
+    if (!sequence) {
+      wake_up_.Wait(wait_ms);
+      continue;
+    }
+    // Let another thread pick up the other runnable sequences, or wait for the
+    // next delayed task.
+    if (more_work) {
+      wake_up_.Set();
+    }
+
+    sequence->Run(std::move(task));
+
+    bool deleted;
+    {
+      MutexLock lock(&mutex_);
+      sequence->running = false;
+      deleted = sequence->deleted;
+      if (!deleted) {
+        MaybeScheduleSequence(sequence);
+      }
+    }
+    if (deleted) {
+      sequence->idle.Set();
+    }
+  }
+  // Pass on the stop signal to the next thread.
+  wake_up_.Set();
+}
+
+}  // namespace webrtc
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef VIDEO_DECODE_EXECUTOR_H_
+#define VIDEO_DECODE_EXECUTOR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "api/task_queue/queued_task.h"
+#include "api/task_queue/task_queue_base.h"
+#include "rtc_base/event.h"
+#include "rtc_base/platform_thread.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread_annotations.h"
+
+namespace webrtc {
+
+// Runs the decode queues of many video receive streams on a shared pool of
+// threads, instead of one thread per stream. Each queue created by
+// CreateDecodeQueue() is a regular TaskQueueBase whose tasks run in FIFO order
+// and never concurrently, but on any of the pool's threads.
+//
+// When more queues have runnable tasks than there are threads, the queue whose
+// first task has the earliest deadline runs first. The deadline of a posted
+// task is the time it was posted and that of a delayed task is the time it is
+// due. Since the frame buffer of a receive stream schedules its decode task
+// for the time the next frame has to be decoded to be rendered on time, as
+// given by VCMTiming, streams with imminent render deadlines are decoded
+// first.
+class DecodeExecutor {
+ public:
+  struct Stats {
+    // Number of tasks run.
+    int64_t tasks_run = 0;
+    // Number of tasks that started more than |kLateTaskThresholdMs| after their
+    // deadline.
+    int64_t late_tasks = 0;
+  };
+  static constexpr int64_t kLateTaskThresholdMs = 10;
+
+  explicit DecodeExecutor(int num_threads);
+  DecodeExecutor(const DecodeExecutor&) = delete;
+  DecodeExecutor& operator=(const DecodeExecutor&) = delete;
+  // All queues created by CreateDecodeQueue() must be deleted before the
+  // executor.
+  ~DecodeExecutor();
+
+  std::unique_ptr<TaskQueueBase, TaskQueueDeleter> CreateDecodeQueue();
+
+  int num_threads() const { return static_cast<int>(threads_.size()); }
+  Stats GetStats() const;
+
+ private:
+  class Sequence;
+  using OrderId = uint64_t;
+
+  struct DeadlineKey {
+    int64_t deadline_ms;
+    OrderId order;
+
+    bool operator<(const DeadlineKey& o) const {
+      return std::tie(deadline_ms, order) < std::tie(o.deadline_ms, o.order);
+    }
+  };
+  struct DelayedTask {
+    Sequence* sequence;
+    std::unique_ptr<QueuedTask> task;
+  };
+
+  void PostTask(Sequence* sequence, std::unique_ptr<QueuedTask> task);
+  void PostDelayedTask(Sequence* sequence,
+                       std::unique_ptr<QueuedTask> task,
+                       uint32_t milliseconds);
+  void DeleteSequence(Sequence* sequence);
+  // Adds |sequence| to |ready_sequences_| if it has tasks and is neither
+  // running nor already there.
+  void MaybeScheduleSequence(Sequence* sequence)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ProcessTasks();
+
+  mutable Mutex mutex_;
+  // Signaled when there may be work for an idle thread.
+  rtc::Event wake_up_;
+  bool stopping_ RTC_GUARDED_BY(mutex_) = false;
+  OrderId next_order_ RTC_GUARDED_BY(mutex_) = 0;
+  // Sequences with runnable tasks, by the deadline of their first task.
+  std::map<DeadlineKey, Sequence*> ready_sequences_ RTC_GUARDED_BY(mutex_);
+  // Tasks posted with a delay, by the time they are due.
+  std::map<DeadlineKey, DelayedTask> delayed_tasks_ RTC_GUARDED_BY(mutex_);
+  Stats stats_ RTC_GUARDED_BY(mutex_);
+  // Placed last so that the threads don't touch uninitialized members.
+  std::vector<rtc::PlatformThread> threads_;
+};
+
+}  // namespace webrtc
+
+#endif  // VIDEO_DECODE_EXECUTOR_H_
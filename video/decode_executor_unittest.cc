@@ -0,0 +1,264 @@
+/*
+ *  Copyright (c) 2021 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "video/decode_executor.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "api/task_queue/default_task_queue_factory.h"
+#include "api/task_queue/task_queue_factory.h"
+#include "rtc_base/event.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/cpu_info.h"
+#include "system_wrappers/include/sleep.h"
+#include "test/gmock.h"
+#include "test/gtest.h"
+
+namespace webrtc {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr int kTimeoutMs = 5000;
+
+}  // namespace
+
+TEST(DecodeExecutorTest, RunsTasksOnTheirQueueInOrder) {
+  DecodeExecutor executor(/*num_threads=*/4);
+  std::unique_ptr<TaskQueueBase, TaskQueueDeleter> queue =
+      executor.CreateDecodeQueue();
+  std::vector<int> order;
+  rtc::Event done;
+  for (int i = 0; i < 100; ++i) {
+    queue->PostTask(ToQueuedTask([&order, &queue, i] {
+      EXPECT_TRUE(queue->IsCurrent());
+      order.push_back(i);
+    }));
+  }
+  queue->PostTask(ToQueuedTask([&done] { done.Set(); }));
+  ASSERT_TRUE(done.Wait(kTimeoutMs));
+  ASSERT_EQ(order.size(), 100u);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+  queue = nullptr;
+}
+
+TEST(DecodeExecutorTest, RunsQueuesConcurrently) {
+  DecodeExecutor executor(/*num_threads=*/2);
+  auto queue1 = executor.CreateDecodeQueue();
+  auto queue2 = executor.CreateDecodeQueue();
+  // Each task waits for the other, which only completes if both run at the
+  // same time.
+  rtc::Event event1;
+  rtc::Event event2;
+  rtc::Event done1;
+  rtc::Event done2;
+  queue1->PostTask(ToQueuedTask([&] {
+    event1.Set();
+    EXPECT_TRUE(event2.Wait(kTimeoutMs));
+    done1.Set();
+  }));
+  queue2->PostTask(ToQueuedTask([&] {
+    event2.Set();
+    EXPECT_TRUE(event1.Wait(kTimeoutMs));
+    done2.Set();
+  }));
+  EXPECT_TRUE(done1.Wait(kTimeoutMs));
+  EXPECT_TRUE(done2.Wait(kTimeoutMs));
+}
+
+TEST(DecodeExecutorTest, RunsDelayedTask) {
+  DecodeExecutor executor(/*num_threads=*/1);
+  auto queue = executor.CreateDecodeQueue();
+  rtc::Event done;
+  const int64_t start_ms = rtc::TimeMillis();
+  queue->PostDelayedTask(ToQueuedTask([&done] { done.Set(); }), 20);
+  ASSERT_TRUE(done.Wait(kTimeoutMs));
+  EXPECT_GE(rtc::TimeMillis() - start_ms, 20);
+}
+
+TEST(DecodeExecutorTest, RunsEarliestDeadlineFirst) {
+  DecodeExecutor executor(/*num_threads=*/1);
+  auto blocking_queue = executor.CreateDecodeQueue();
+  auto delayed_queue = executor.CreateDecodeQueue();
+  auto posted_queue = executor.CreateDecodeQueue();
+  rtc::Event unblock;
+  rtc::Event done;
+  Mutex mutex;
+  std::vector<int> order;
+  blocking_queue->PostTask(
+      ToQueuedTask([&unblock] { unblock.Wait(kTimeoutMs); }));
+  // Due while the only thread is blocked, but before the other task is posted.
+  delayed_queue->PostDelayedTask(ToQueuedTask([&] {
+                                   MutexLock lock(&mutex);
+                                   order.push_back(1);
+                                 }),
+                                 5);
+  SleepMs(20);
+  posted_queue->PostTask(ToQueuedTask([&] {
+    MutexLock lock(&mutex);
+    order.push_back(2);
+    done.Set();
+  }));
+  unblock.Set();
+  ASSERT_TRUE(done.Wait(kTimeoutMs));
+  MutexLock lock(&mutex);
+  EXPECT_THAT(order, ElementsAre(1, 2));
+}
+
+TEST(DecodeExecutorTest, RunsDelayedTaskWhileOtherThreadIsBusy) {
+  DecodeExecutor executor(/*num_threads=*/2);
+  auto blocking_queue = executor.CreateDecodeQueue();
+  auto delayed_queue = executor.CreateDecodeQueue();
+  // Either thread may be woken up for the posted task while the other one is
+  // idle, including the one waiting for the delayed task. Repeat to cover both.
+  for (int i = 0; i < 10; ++i) {
+    rtc::Event unblock;
+    rtc::Event delayed_done;
+    delayed_queue->PostDelayedTask(
+        ToQueuedTask([&delayed_done] { delayed_done.Set(); }), 20);
+    // Let both threads go idle before the posted task races the deadline.
+    SleepMs(5);
+    blocking_queue->PostTask(
+        ToQueuedTask([&unblock] { unblock.Wait(kTimeoutMs); }));
+    EXPECT_TRUE(delayed_done.Wait(kTimeoutMs / 10));
+    unblock.Set();
+  }
+}
+
+TEST(DecodeExecutorTest, DeletingQueueDropsPendingTasks) {
+  DecodeExecutor executor(/*num_threads=*/1);
+  auto blocking_queue = executor.CreateDecodeQueue();
+  auto queue = executor.CreateDecodeQueue();
+  rtc::Event unblock;
+  rtc::Event blocked;
+  std::atomic<bool> ran(false);
+  blocking_queue->PostTask(ToQueuedTask([&] {
+    blocked.Set();
+    unblock.Wait(kTimeoutMs);
+  }));
+  ASSERT_TRUE(blocked.Wait(kTimeoutMs));
+  queue->PostTask(ToQueuedTask([&ran] { ran = true; }));
+  queue->PostDelayedTask(ToQueuedTask([&ran] { ran = true; }), 1);
+  queue = nullptr;
+  unblock.Set();
+  // Deleting waits for the running task.
+  blocking_queue = nullptr;
+  EXPECT_FALSE(ran);
+}
+
+TEST(DecodeExecutorTest, DeleteWaitsForRunningTask) {
+  DecodeExecutor executor(/*num_threads=*/1);
+  auto queue = executor.CreateDecodeQueue();
+  rtc::Event started;
+  std::atomic<bool> finished(false);
+  queue->PostTask(ToQueuedTask([&] {
+    started.Set();
+    SleepMs(20);
+    finished = true;
+  }));
+  ASSERT_TRUE(started.Wait(kTimeoutMs));
+  queue = nullptr;
+  EXPECT_TRUE(finished);
+}
+
+// Simulates receiving |kNumStreams| 30 fps streams whose frames take
+// |kDecodeTimeMs| to decode, as for 360p VP8, once with one task queue per
+// stream and once with a DecodeExecutor with one thread per core, and prints
+// the number of decode threads and of frames that started decoding more than
+// DecodeExecutor::kLateTaskThresholdMs after they were due.
+TEST(DecodeExecutorTest, DISABLED_ManyStreamsBenchmark) {
+  constexpr int kNumStreams = 49;
+  constexpr int kFrameIntervalMs = 33;
+  constexpr int kDecodeTimeMs = 2;
+  constexpr int kNumFrames = 150;
+
+  class Stream {
+   public:
+    explicit Stream(std::unique_ptr<TaskQueueBase, TaskQueueDeleter> queue)
+        : queue_(std::move(queue)) {}
+
+    void Start(int64_t start_ms) { ScheduleFrame(start_ms); }
+    // Blocks until all frames have been decoded.
+    void Stop() {
+      done_.Wait(rtc::Event::kForever);
+      queue_ = nullptr;
+    }
+    int late_frames() const { return late_frames_; }
+
+   private:
+    void ScheduleFrame(int64_t due_ms) {
+      const int64_t delay_ms = std::max<int64_t>(0, due_ms - rtc::TimeMillis());
+      queue_->PostDelayedTask(ToQueuedTask([this, due_ms] { Decode(due_ms); }),
+                              static_cast<uint32_t>(delay_ms));
+    }
+    void Decode(int64_t due_ms) {
+      if (rtc::TimeMillis() - due_ms >
+          DecodeExecutor::kLateTaskThresholdMs) {
+        ++late_frames_;
+      }
+      // Busy wait to simulate decoding.
+      const int64_t decode_end_ms = rtc::TimeMillis() + kDecodeTimeMs;
+      while (rtc::TimeMillis() < decode_end_ms) {
+      }
+      if (++decoded_frames_ == kNumFrames) {
+        done_.Set();
+        return;
+      }
+      ScheduleFrame(due_ms + kFrameIntervalMs);
+    }
+
+    std::unique_ptr<TaskQueueBase, TaskQueueDeleter> queue_;
+    rtc::Event done_;
+    int decoded_frames_ = 0;
+    std::atomic<int> late_frames_{0};
+  };
+
+  const int num_cores = CpuInfo::DetectNumberOfCores();
+  std::unique_ptr<TaskQueueFactory> task_queue_factory =
+      CreateDefaultTaskQueueFactory();
+  for (bool shared : {false, true}) {
+    std::unique_ptr<DecodeExecutor> executor;
+    if (shared) {
+      executor = std::make_unique<DecodeExecutor>(num_cores);
+    }
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (int i = 0; i < kNumStreams; ++i) {
+      streams.push_back(std::make_unique<Stream>(
+          shared ? executor->CreateDecodeQueue()
+                 : task_queue_factory->CreateTaskQueue(
+                       "DecodingQueue", TaskQueueFactory::Priority::HIGH)));
+    }
+    // Spread the streams over one frame interval.
+    const int64_t start_ms = rtc::TimeMillis() + kFrameIntervalMs;
+    for (int i = 0; i < kNumStreams; ++i) {
+      streams[i]->Start(start_ms + i * kFrameIntervalMs / kNumStreams);
+    }
+    int late_frames = 0;
+    for (auto& stream : streams) {
+      stream->Stop();
+      late_frames += stream->late_frames();
+    }
+    printf("%s: %d decode threads, %d of %d frames late.\n",
+           shared ? "shared executor" : "queue per stream",
+           shared ? executor->num_threads() : kNumStreams, late_frames,
+           kNumStreams * kNumFrames);
+  }
+}
+
+}  // namespace webrtc
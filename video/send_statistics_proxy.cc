@@ -1237,6 +1237,11 @@ void SendStatisticsProxy::OnEncoderInternalScalerUpdate(bool is_scaled) {
   UpdateAdaptationStats();
 }
 
+void SendStatisticsProxy::OnPixelFormatConversions(int num_conversions) {
+  MutexLock lock(&mutex_);
+  stats_.pixel_format_conversions += num_conversions;
+}
+
 // TODO(asapersson): Include fps changes.
 void SendStatisticsProxy::OnInitialQualityResolutionAdaptDown() {
   MutexLock lock(&mutex_);
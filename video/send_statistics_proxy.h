@@ -83,6 +83,8 @@ class SendStatisticsProxy : public VideoStreamEncoderObserver,
 
   void OnEncoderInternalScalerUpdate(bool is_scaled) override;
 
+  void OnPixelFormatConversions(int num_conversions) override;
+
   void OnMinPixelLimitReached() override;
   void OnInitialQualityResolutionAdaptDown() override;
 
@@ -2170,6 +2170,14 @@ TEST_F(SendStatisticsProxyTest, GetStatsReportsBandwidthLimitedResolution) {
   EXPECT_TRUE(statistics_proxy_->GetStats().bw_limited_resolution);
 }
 
+TEST_F(SendStatisticsProxyTest, GetStatsReportsPixelFormatConversions) {
+  EXPECT_EQ(0u, statistics_proxy_->GetStats().pixel_format_conversions);
+  statistics_proxy_->OnPixelFormatConversions(0);
+  statistics_proxy_->OnPixelFormatConversions(2);
+  statistics_proxy_->OnPixelFormatConversions(1);
+  EXPECT_EQ(3u, statistics_proxy_->GetStats().pixel_format_conversions);
+}
+
 TEST_F(SendStatisticsProxyTest, GetStatsReportsTargetMediaBitrate) {
   // Initially zero.
   EXPECT_EQ(0, statistics_proxy_->GetStats().target_media_bitrate_bps);
@@ -218,7 +218,8 @@ VideoReceiveStream2::VideoReceiveStream2(TaskQueueFactory* task_queue_factory,
                                          VideoReceiveStream::Config config,
                                          CallStats* call_stats,
                                          Clock* clock,
-                                         VCMTiming* timing)
+                                         VCMTiming* timing,
+                                         DecodeExecutor* decode_executor)
     : task_queue_factory_(task_queue_factory),
       transport_adapter_(config.rtcp_send_transport),
       config_(std::move(config)),
@@ -252,9 +253,11 @@ VideoReceiveStream2::VideoReceiveStream2(TaskQueueFactory* task_queue_factory,
       low_latency_renderer_include_predecode_buffer_("include_predecode_buffer",
                                                      true),
       maximum_pre_stream_decoders_("max", kDefaultMaximumPreStreamDecoders),
-      decode_queue_(task_queue_factory_->CreateTaskQueue(
-          "DecodingQueue",
-          TaskQueueFactory::Priority::HIGH)) {
+      decode_queue_(decode_executor
+                        ? decode_executor->CreateDecodeQueue()
+                        : task_queue_factory_->CreateTaskQueue(
+                              "DecodingQueue",
+                              TaskQueueFactory::Priority::HIGH)) {
   RTC_LOG(LS_INFO) << "VideoReceiveStream2: " << config_.ToString();
 
   RTC_DCHECK(call_->worker_thread());
@@ -137,7 +137,8 @@ class VideoReceiveStream2Test : public ::testing::Test {
     video_receive_stream_ =
         std::make_unique<webrtc::internal::VideoReceiveStream2>(
             task_queue_factory_.get(), &fake_call_, kDefaultNumCpuCores,
-            &packet_router_, config_.Copy(), &call_stats_, clock_, timing_);
+            &packet_router_, config_.Copy(), &call_stats_, clock_, timing_,
+            /*decode_executor=*/nullptr);
     video_receive_stream_->RegisterWithTransport(
         &rtp_stream_receiver_controller_);
   }
@@ -154,6 +155,7 @@ class VideoReceiveStream2Test : public ::testing::Test {
   MockTransport mock_transport_;
   PacketRouter packet_router_;
   RtpStreamReceiverController rtp_stream_receiver_controller_;
+  std::unique_ptr<DecodeExecutor> decode_executor_;
   std::unique_ptr<webrtc::internal::VideoReceiveStream2> video_receive_stream_;
   Clock* clock_;
   VCMTiming* timing_;
@@ -187,6 +189,47 @@ TEST_F(VideoReceiveStream2Test, CreateFrameFromH264FmtpSpropAndIdr) {
   init_decode_event_.Wait(kDefaultTimeOutMs);
 }
 
+TEST_F(VideoReceiveStream2Test, DecodesOnSharedDecodeExecutor) {
+  video_receive_stream_->UnregisterFromTransport();
+  decode_executor_ = std::make_unique<DecodeExecutor>(/*num_threads=*/2);
+  timing_ = new VCMTiming(clock_);
+  video_receive_stream_ =
+      std::make_unique<webrtc::internal::VideoReceiveStream2>(
+          task_queue_factory_.get(), &fake_call_, /*num_cpu_cores=*/2,
+          &packet_router_, config_.Copy(), &call_stats_, clock_, timing_,
+          decode_executor_.get());
+  video_receive_stream_->RegisterWithTransport(
+      &rtp_stream_receiver_controller_);
+
+  constexpr uint8_t idr_nalu[] = {0x05, 0xFF, 0xFF, 0xFF};
+  RtpPacketToSend rtppacket(nullptr);
+  uint8_t* payload = rtppacket.AllocatePayload(sizeof(idr_nalu));
+  memcpy(payload, idr_nalu, sizeof(idr_nalu));
+  rtppacket.SetMarker(true);
+  rtppacket.SetSsrc(1111);
+  rtppacket.SetPayloadType(99);
+  rtppacket.SetSequenceNumber(1);
+  rtppacket.SetTimestamp(0);
+  rtc::Event decode_event;
+  EXPECT_CALL(mock_h264_video_decoder_, InitDecode(_, _));
+  EXPECT_CALL(mock_h264_video_decoder_, RegisterDecodeCompleteCallback(_));
+  video_receive_stream_->Start();
+  EXPECT_CALL(mock_h264_video_decoder_, Decode(_, false, _))
+      .WillOnce(Invoke([&decode_event](const EncodedImage& input_image,
+                                       bool missing_frames,
+                                       int64_t render_time_ms) {
+        decode_event.Set();
+        return 0;
+      }));
+  RtpPacketReceived parsed_packet;
+  ASSERT_TRUE(parsed_packet.Parse(rtppacket.data(), rtppacket.size()));
+  rtp_stream_receiver_controller_.OnRtpPacket(parsed_packet);
+  EXPECT_CALL(mock_h264_video_decoder_, Release());
+  EXPECT_TRUE(decode_event.Wait(/*give_up_after_ms=*/1000));
+  video_receive_stream_->Stop();
+  EXPECT_GE(decode_executor_->GetStats().tasks_run, 1);
+}
+
 TEST_F(VideoReceiveStream2Test, PlayoutDelay) {
   const VideoPlayoutDelay kPlayoutDelayMs = {123, 321};
   std::unique_ptr<FrameObjectFake> test_frame(new FrameObjectFake());
@@ -316,7 +359,8 @@ class VideoReceiveStream2TestWithFakeDecoder : public ::testing::Test {
     timing_ = new VCMTiming(clock_);
     video_receive_stream_.reset(new webrtc::internal::VideoReceiveStream2(
         task_queue_factory_.get(), &fake_call_, kDefaultNumCpuCores,
-        &packet_router_, config_.Copy(), &call_stats_, clock_, timing_));
+        &packet_router_, config_.Copy(), &call_stats_, clock_, timing_,
+        /*decode_executor=*/nullptr));
     video_receive_stream_->RegisterWithTransport(
         &rtp_stream_receiver_controller_);
     video_receive_stream_->SetAndGetRecordingState(std::move(state), false);
@@ -581,7 +625,8 @@ class VideoReceiveStream2TestWithSimulatedClock
                               config_.Copy(),
                               &call_stats_,
                               time_controller_.GetClock(),
-                              new VCMTiming(time_controller_.GetClock())) {
+                              new VCMTiming(time_controller_.GetClock()),
+                              /*decode_executor=*/nullptr) {
     video_receive_stream_.RegisterWithTransport(
         &rtp_stream_receiver_controller_);
     video_receive_stream_.Start();
@@ -749,7 +794,8 @@ class VideoReceiveStream2TestWithLazyDecoderCreation : public ::testing::Test {
     video_receive_stream_ =
         std::make_unique<webrtc::internal::VideoReceiveStream2>(
             task_queue_factory_.get(), &fake_call_, kDefaultNumCpuCores,
-            &packet_router_, config_.Copy(), &call_stats_, clock_, timing_);
+            &packet_router_, config_.Copy(), &call_stats_, clock_, timing_,
+            /*decode_executor=*/nullptr);
     video_receive_stream_->RegisterWithTransport(
         &rtp_stream_receiver_controller_);
   }
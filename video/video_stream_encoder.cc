@@ -496,8 +496,59 @@ void ApplyEncoderBitrateLimitsIfSingleActiveStream(
                encoder_bitrate_limits->max_bitrate_bps);
 }
 
+// Returns true if an encoder preferring |preferred_pixel_formats| is expected
+// to convert an input buffer of |type| to another pixel format before encoding
+// it.
+bool EncoderConvertsPixelFormat(
+    const absl::InlinedVector<VideoFrameBuffer::Type,
+                              kMaxPreferredPixelFormats>&
+        preferred_pixel_formats,
+    VideoFrameBuffer::Type type) {
+  // Native buffers are either encoded as is or mapped by the encoder, and
+  // whether mapping requires a conversion is not known here.
+  if (type == VideoFrameBuffer::Type::kNative) {
+    return false;
+  }
+  // The I420 planes of an I420A buffer are used directly.
+  if (type == VideoFrameBuffer::Type::kI420A) {
+    type = VideoFrameBuffer::Type::kI420;
+  }
+  if (preferred_pixel_formats.empty()) {
+    return type != VideoFrameBuffer::Type::kI420;
+  }
+  return !absl::c_linear_search(preferred_pixel_formats, type);
+}
+
+// Reduces |buffer| by |crop_width| x |crop_height| pixels. Small differences
+// are cropped, centered, while larger ones are scaled.
+rtc::scoped_refptr<VideoFrameBuffer> CropOrScaleBuffer(
+    VideoFrameBuffer& buffer,
+    int crop_width,
+    int crop_height) {
+  const int cropped_width = buffer.width() - crop_width;
+  const int cropped_height = buffer.height() - crop_height;
+  // TODO(ilnik): Remove scaling if cropping is too big, as it should never
+  // happen after SinkWants signaled correctly from ReconfigureEncoder.
+  if (crop_width < 4 && crop_height < 4) {
+    // The difference is small, crop without scaling.
+    return buffer.CropAndScale(crop_width / 2, crop_height / 2, cropped_width,
+                               cropped_height, cropped_width, cropped_height);
+  }
+  // The difference is large, scale it.
+  return buffer.Scale(cropped_width, cropped_height);
+}
+
 }  //  namespace
 
+VideoStreamEncoder::PreprocessingParameters::PreprocessingParameters() =
+    default;
+
+VideoStreamEncoder::PreprocessingParameters::PreprocessingParameters(
+    const PreprocessingParameters&) = default;
+
+VideoStreamEncoder::PreprocessingParameters::~PreprocessingParameters() =
+    default;
+
 VideoStreamEncoder::EncoderRateSettings::EncoderRateSettings()
     : rate_control(),
       encoder_target(DataRate::Zero()),
@@ -657,9 +708,17 @@ VideoStreamEncoder::VideoStreamEncoder(
           !field_trial::IsEnabled("WebRTC-DefaultBitrateLimitsKillSwitch")),
       qp_parsing_allowed_(
           !field_trial::IsEnabled("WebRTC-QpParsingKillSwitch")),
+      pipelined_preprocessing_(field_trial::IsEnabled(
+          "WebRTC-VideoStreamEncoder-PipelinedPreprocessing")),
       encoder_queue_(task_queue_factory->CreateTaskQueue(
           "EncoderQueue",
-          TaskQueueFactory::Priority::NORMAL)) {
+          TaskQueueFactory::Priority::NORMAL)),
+      preprocess_queue_(pipelined_preprocessing_
+                            ? std::make_unique<rtc::TaskQueue>(
+                                  task_queue_factory->CreateTaskQueue(
+                                      "PreprocessQueue",
+                                      TaskQueueFactory::Priority::NORMAL))
+                            : nullptr) {
   TRACE_EVENT0("webrtc", "VideoStreamEncoder::VideoStreamEncoder");
   RTC_DCHECK(main_queue_);
   RTC_DCHECK(encoder_stats_observer);
@@ -699,6 +758,14 @@ void VideoStreamEncoder::Stop() {
   RTC_DCHECK_RUN_ON(main_queue_);
   video_source_sink_controller_.SetSource(nullptr);
 
+  if (preprocess_queue_) {
+    // Wait for frames being preprocessed to be posted to the encoder queue.
+    rtc::Event preprocess_queue_drained;
+    preprocess_queue_->PostTask(
+        [&preprocess_queue_drained] { preprocess_queue_drained.Set(); });
+    preprocess_queue_drained.Wait(rtc::Event::kForever);
+  }
+
   rtc::Event shutdown_event;
 
   encoder_queue_.PostTask([this, &shutdown_event] {
@@ -1217,6 +1284,7 @@ void VideoStreamEncoder::ReconfigureEncoder() {
       encoder_config_.min_transmit_bitrate_bps);
 
   stream_resource_manager_.ConfigureQualityScaler(info);
+  UpdatePreprocessingParameters(info);
 }
 
 void VideoStreamEncoder::OnEncoderSettingsChanged() {
@@ -1286,52 +1354,137 @@ void VideoStreamEncoder::OnFrame(const VideoFrame& video_frame) {
   int64_t post_time_us = clock_->CurrentTime().us();
   ++posted_frames_waiting_for_encode_;
 
-  encoder_queue_.PostTask(
-      [this, incoming_frame, post_time_us, log_stats]() {
+  if (preprocess_queue_) {
+    preprocess_queue_->PostTask([this, incoming_frame, post_time_us,
+                                 log_stats]() {
+      // A newer frame is already queued, so this one will be dropped by the
+      // encoder queue and there is no need to preprocess it.
+      rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer =
+          posted_frames_waiting_for_encode_.load() == 1
+              ? PreprocessFrame(incoming_frame)
+              : nullptr;
+      encoder_queue_.PostTask([this, incoming_frame, preprocessed_buffer,
+                               post_time_us, log_stats]() {
         RTC_DCHECK_RUN_ON(&encoder_queue_);
-        encoder_stats_observer_->OnIncomingFrame(incoming_frame.width(),
-                                                 incoming_frame.height());
-        ++captured_frame_count_;
-        const int posted_frames_waiting_for_encode =
-            posted_frames_waiting_for_encode_.fetch_sub(1);
-        RTC_DCHECK_GT(posted_frames_waiting_for_encode, 0);
-        CheckForAnimatedContent(incoming_frame, post_time_us);
-        bool cwnd_frame_drop =
-            cwnd_frame_drop_interval_ &&
-            (cwnd_frame_counter_++ % cwnd_frame_drop_interval_.value() == 0);
-        if (posted_frames_waiting_for_encode == 1 && !cwnd_frame_drop) {
-          MaybeEncodeVideoFrame(incoming_frame, post_time_us);
-        } else {
-          if (cwnd_frame_drop) {
-            // Frame drop by congestion window pushback. Do not encode this
-            // frame.
-            ++dropped_frame_cwnd_pushback_count_;
-            encoder_stats_observer_->OnFrameDropped(
-                VideoStreamEncoderObserver::DropReason::kCongestionWindow);
-          } else {
-            // There is a newer frame in flight. Do not encode this frame.
-            RTC_LOG(LS_VERBOSE)
-                << "Incoming frame dropped due to that the encoder is blocked.";
-            ++dropped_frame_encoder_block_count_;
-            encoder_stats_observer_->OnFrameDropped(
-                VideoStreamEncoderObserver::DropReason::kEncoderQueue);
-          }
-          accumulated_update_rect_.Union(incoming_frame.update_rect());
-          accumulated_update_rect_is_valid_ &= incoming_frame.has_update_rect();
-        }
-        if (log_stats) {
-          RTC_LOG(LS_INFO) << "Number of frames: captured "
-                           << captured_frame_count_
-                           << ", dropped (due to congestion window pushback) "
-                           << dropped_frame_cwnd_pushback_count_
-                           << ", dropped (due to encoder blocked) "
-                           << dropped_frame_encoder_block_count_
-                           << ", interval_ms " << kFrameLogIntervalMs;
-          captured_frame_count_ = 0;
-          dropped_frame_cwnd_pushback_count_ = 0;
-          dropped_frame_encoder_block_count_ = 0;
-        }
+        OnFrameOnEncoderQueue(incoming_frame, preprocessed_buffer,
+                              post_time_us, log_stats);
       });
+    });
+    return;
+  }
+
+  encoder_queue_.PostTask([this, incoming_frame, post_time_us, log_stats]() {
+    RTC_DCHECK_RUN_ON(&encoder_queue_);
+    OnFrameOnEncoderQueue(incoming_frame, nullptr, post_time_us, log_stats);
+  });
+}
+
+void VideoStreamEncoder::OnFrameOnEncoderQueue(
+    const VideoFrame& incoming_frame,
+    rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer,
+    int64_t post_time_us,
+    bool log_stats) {
+  encoder_stats_observer_->OnIncomingFrame(incoming_frame.width(),
+                                           incoming_frame.height());
+  ++captured_frame_count_;
+  const int posted_frames_waiting_for_encode =
+      posted_frames_waiting_for_encode_.fetch_sub(1);
+  RTC_DCHECK_GT(posted_frames_waiting_for_encode, 0);
+  CheckForAnimatedContent(incoming_frame, post_time_us);
+  bool cwnd_frame_drop =
+      cwnd_frame_drop_interval_ &&
+      (cwnd_frame_counter_++ % cwnd_frame_drop_interval_.value() == 0);
+  if (posted_frames_waiting_for_encode == 1 && !cwnd_frame_drop) {
+    MaybeEncodeVideoFrame(incoming_frame, post_time_us,
+                          std::move(preprocessed_buffer));
+  } else {
+    if (cwnd_frame_drop) {
+      // Frame drop by congestion window pushback. Do not encode this
+      // frame.
+      ++dropped_frame_cwnd_pushback_count_;
+      encoder_stats_observer_->OnFrameDropped(
+          VideoStreamEncoderObserver::DropReason::kCongestionWindow);
+    } else {
+      // There is a newer frame in flight. Do not encode this frame.
+      RTC_LOG(LS_VERBOSE)
+          << "Incoming frame dropped due to that the encoder is blocked.";
+      ++dropped_frame_encoder_block_count_;
+      encoder_stats_observer_->OnFrameDropped(
+          VideoStreamEncoderObserver::DropReason::kEncoderQueue);
+    }
+    accumulated_update_rect_.Union(incoming_frame.update_rect());
+    accumulated_update_rect_is_valid_ &= incoming_frame.has_update_rect();
+  }
+  if (log_stats) {
+    RTC_LOG(LS_INFO) << "Number of frames: captured " << captured_frame_count_
+                     << ", dropped (due to congestion window pushback) "
+                     << dropped_frame_cwnd_pushback_count_
+                     << ", dropped (due to encoder blocked) "
+                     << dropped_frame_encoder_block_count_ << ", interval_ms "
+                     << kFrameLogIntervalMs;
+    captured_frame_count_ = 0;
+    dropped_frame_cwnd_pushback_count_ = 0;
+    dropped_frame_encoder_block_count_ = 0;
+  }
+}
+
+rtc::scoped_refptr<VideoFrameBuffer> VideoStreamEncoder::PreprocessFrame(
+    const VideoFrame& frame) {
+  RTC_DCHECK(preprocess_queue_->IsCurrent());
+  PreprocessingParameters parameters;
+  {
+    MutexLock lock(&preprocessing_mutex_);
+    parameters = preprocessing_parameters_;
+  }
+  if (frame.width() != parameters.input_width ||
+      frame.height() != parameters.input_height) {
+    return nullptr;
+  }
+  rtc::scoped_refptr<VideoFrameBuffer> buffer = frame.video_frame_buffer();
+  if (buffer->type() == VideoFrameBuffer::Type::kNative &&
+      parameters.supports_native_handle) {
+    return nullptr;
+  }
+
+  bool preprocessed = false;
+  if (parameters.crop_width > 0 || parameters.crop_height > 0) {
+    buffer = CropOrScaleBuffer(*buffer, parameters.crop_width,
+                               parameters.crop_height);
+    if (!buffer) {
+      return nullptr;
+    }
+    preprocessed = true;
+  }
+  // Convert to I420 here rather than in the encoder, if that is what the
+  // encoder would do.
+  if (EncoderConvertsPixelFormat(parameters.preferred_pixel_formats,
+                                 buffer->type()) &&
+      (parameters.preferred_pixel_formats.empty() ||
+       absl::c_linear_search(parameters.preferred_pixel_formats,
+                             VideoFrameBuffer::Type::kI420))) {
+    buffer = buffer->ToI420();
+    if (!buffer) {
+      return nullptr;
+    }
+    preprocessed = true;
+  }
+  return preprocessed ? buffer : nullptr;
+}
+
+void VideoStreamEncoder::UpdatePreprocessingParameters(
+    const VideoEncoder::EncoderInfo& encoder_info) {
+  if (!pipelined_preprocessing_ || !last_frame_info_) {
+    return;
+  }
+  MutexLock lock(&preprocessing_mutex_);
+  preprocessing_parameters_.input_width = last_frame_info_->width;
+  preprocessing_parameters_.input_height = last_frame_info_->height;
+  preprocessing_parameters_.crop_width = crop_width_;
+  preprocessing_parameters_.crop_height = crop_height_;
+  preprocessing_parameters_.supports_native_handle =
+      encoder_info.supports_native_handle;
+  preprocessing_parameters_.preferred_pixel_formats =
+      encoder_info.preferred_pixel_formats;
 }
 
 void VideoStreamEncoder::OnDiscardedFrame() {
@@ -1481,8 +1634,10 @@ void VideoStreamEncoder::SetEncoderRates(
   }
 }
 
-void VideoStreamEncoder::MaybeEncodeVideoFrame(const VideoFrame& video_frame,
-                                               int64_t time_when_posted_us) {
+void VideoStreamEncoder::MaybeEncodeVideoFrame(
+    const VideoFrame& video_frame,
+    int64_t time_when_posted_us,
+    rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer) {
   RTC_DCHECK_RUN_ON(&encoder_queue_);
   input_state_provider_.OnFrameSizeObserved(video_frame.size());
 
@@ -1603,11 +1758,14 @@ void VideoStreamEncoder::MaybeEncodeVideoFrame(const VideoFrame& video_frame,
     return;
   }
 
-  EncodeVideoFrame(video_frame, time_when_posted_us);
+  EncodeVideoFrame(video_frame, time_when_posted_us,
+                   std::move(preprocessed_buffer));
 }
 
-void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
-                                          int64_t time_when_posted_us) {
+void VideoStreamEncoder::EncodeVideoFrame(
+    const VideoFrame& video_frame,
+    int64_t time_when_posted_us,
+    rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer) {
   RTC_DCHECK_RUN_ON(&encoder_queue_);
 
   // If the encoder fail we can't continue to encode frames. When this happens
@@ -1640,6 +1798,7 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
     stream_resource_manager_.ConfigureEncodeUsageResource();
     RTC_LOG(LS_INFO) << "Encoder settings changed from "
                      << encoder_info_.ToString() << " to " << info.ToString();
+    UpdatePreprocessingParameters(info);
   }
 
   if (bitrate_adjuster_) {
@@ -1653,6 +1812,9 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
   encoder_info_ = info;
   last_encode_info_ms_ = clock_->TimeInMilliseconds();
 
+  // Number of times the frame is converted to another pixel format before
+  // being encoded.
+  int pixel_format_conversions = 0;
   VideoFrame out_frame(video_frame);
   // Crop or scale the frame if needed. Dimension may be reduced to fit encoder
   // requirements, e.g. some encoders may require them to be divisible by 4.
@@ -1663,23 +1825,21 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
     int cropped_width = video_frame.width() - crop_width_;
     int cropped_height = video_frame.height() - crop_height_;
     rtc::scoped_refptr<VideoFrameBuffer> cropped_buffer;
-    // TODO(ilnik): Remove scaling if cropping is too big, as it should never
-    // happen after SinkWants signaled correctly from ReconfigureEncoder.
+    if (preprocessed_buffer && preprocessed_buffer->width() == cropped_width &&
+        preprocessed_buffer->height() == cropped_height) {
+      cropped_buffer = std::move(preprocessed_buffer);
+    } else {
+      cropped_buffer = CropOrScaleBuffer(*video_frame.video_frame_buffer(),
+                                         crop_width_, crop_height_);
+    }
     VideoFrame::UpdateRect update_rect = video_frame.update_rect();
     if (crop_width_ < 4 && crop_height_ < 4) {
-      // The difference is small, crop without scaling.
-      cropped_buffer = video_frame.video_frame_buffer()->CropAndScale(
-          crop_width_ / 2, crop_height_ / 2, cropped_width, cropped_height,
-          cropped_width, cropped_height);
       update_rect.offset_x -= crop_width_ / 2;
       update_rect.offset_y -= crop_height_ / 2;
       update_rect.Intersect(
           VideoFrame::UpdateRect{0, 0, cropped_width, cropped_height});
 
     } else {
-      // The difference is large, scale it.
-      cropped_buffer = video_frame.video_frame_buffer()->Scale(cropped_width,
-                                                               cropped_height);
       if (!update_rect.IsEmpty()) {
         // Since we can't reason about pixels after scaling, we invalidate whole
         // picture, if anything changed.
@@ -1691,6 +1851,9 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
       RTC_LOG(LS_ERROR) << "Cropping and scaling frame failed, dropping frame.";
       return;
     }
+    if (cropped_buffer->type() != video_frame.video_frame_buffer()->type()) {
+      ++pixel_format_conversions;
+    }
 
     out_frame.set_video_frame_buffer(cropped_buffer);
     out_frame.set_update_rect(update_rect);
@@ -1703,6 +1866,12 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
           VideoFrame::UpdateRect{0, 0, out_frame.width(), out_frame.height()};
       accumulated_update_rect_is_valid_ = false;
     }
+  } else if (preprocessed_buffer &&
+             preprocessed_buffer->width() == video_frame.width() &&
+             preprocessed_buffer->height() == video_frame.height()) {
+    // Converted to a pixel format preferred by the encoder.
+    ++pixel_format_conversions;
+    out_frame.set_video_frame_buffer(std::move(preprocessed_buffer));
   }
 
   if (!accumulated_update_rect_is_valid_) {
@@ -1734,6 +1903,12 @@ void VideoStreamEncoder::EncodeVideoFrame(const VideoFrame& video_frame,
 
   frame_encode_metadata_writer_.OnEncodeStarted(out_frame);
 
+  if (EncoderConvertsPixelFormat(info.preferred_pixel_formats,
+                                 out_frame.video_frame_buffer()->type())) {
+    ++pixel_format_conversions;
+  }
+  encoder_stats_observer_->OnPixelFormatConversions(pixel_format_conversions);
+
   const int32_t encode_status = encoder_->Encode(out_frame, &next_frame_types_);
   was_encode_called_since_last_initialization_ = true;
 
@@ -2060,7 +2235,7 @@ void VideoStreamEncoder::OnBitrateUpdated(DataRate target_bitrate,
     int64_t pending_time_us =
         clock_->CurrentTime().us() - pending_frame_post_time_us_;
     if (pending_time_us < kPendingFrameTimeoutMs * 1000)
-      EncodeVideoFrame(*pending_frame_, pending_frame_post_time_us_);
+      EncodeVideoFrame(*pending_frame_, pending_frame_post_time_us_, nullptr);
     pending_frame_.reset();
   }
 }
@@ -39,6 +39,7 @@
 #include "rtc_base/numerics/exp_filter.h"
 #include "rtc_base/race_checker.h"
 #include "rtc_base/rate_statistics.h"
+#include "rtc_base/synchronization/mutex.h"
 #include "rtc_base/task_queue.h"
 #include "rtc_base/task_utils/pending_task_safety_flag.h"
 #include "rtc_base/thread_annotations.h"
@@ -177,11 +178,52 @@ class VideoStreamEncoder : public VideoStreamEncoderInterface,
   void OnFrame(const VideoFrame& video_frame) override;
   void OnDiscardedFrame() override;
 
-  void MaybeEncodeVideoFrame(const VideoFrame& frame,
-                             int64_t time_when_posted_in_ms);
+  // Parameters for preprocessing of input frames on |preprocess_queue_|,
+  // published by the encoder queue when the encoder is (re)configured.
+  struct PreprocessingParameters {
+    PreprocessingParameters();
+    PreprocessingParameters(const PreprocessingParameters&);
+    ~PreprocessingParameters();
+
+    // Input resolution the parameters are valid for.
+    int input_width = 0;
+    int input_height = 0;
+    int crop_width = 0;
+    int crop_height = 0;
+    bool supports_native_handle = false;
+    absl::InlinedVector<VideoFrameBuffer::Type, kMaxPreferredPixelFormats>
+        preferred_pixel_formats;
+  };
 
-  void EncodeVideoFrame(const VideoFrame& frame,
-                        int64_t time_when_posted_in_ms);
+  // Handles a frame posted by OnFrame(). |preprocessed_buffer| is the result
+  // of PreprocessFrame(), if any.
+  void OnFrameOnEncoderQueue(
+      const VideoFrame& incoming_frame,
+      rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer,
+      int64_t post_time_us,
+      bool log_stats) RTC_RUN_ON(&encoder_queue_);
+
+  void MaybeEncodeVideoFrame(
+      const VideoFrame& frame,
+      int64_t time_when_posted_in_ms,
+      rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer);
+
+  // Encodes |frame|. If |preprocessed_buffer| is the cropped, scaled or
+  // converted buffer of |frame| that the encoder expects, it is used instead
+  // of preparing the buffer again.
+  void EncodeVideoFrame(
+      const VideoFrame& frame,
+      int64_t time_when_posted_in_ms,
+      rtc::scoped_refptr<VideoFrameBuffer> preprocessed_buffer);
+
+  // Runs on |preprocess_queue_|. Crops, scales and converts the buffer of
+  // |frame| as the encoder expects it, according to the last published
+  // PreprocessingParameters. Returns null if there is nothing to do, or if the
+  // parameters are not valid for the resolution of |frame|.
+  rtc::scoped_refptr<VideoFrameBuffer> PreprocessFrame(const VideoFrame& frame);
+  void UpdatePreprocessingParameters(
+      const VideoEncoder::EncoderInfo& encoder_info)
+      RTC_RUN_ON(&encoder_queue_);
   // Indicates whether frame should be dropped because the pixel count is too
   // large for the current bitrate configuration.
   bool DropDueToSize(uint32_t pixel_count) const RTC_RUN_ON(&encoder_queue_);
@@ -409,9 +451,21 @@ class VideoStreamEncoder : public VideoStreamEncoderInterface,
   QpParser qp_parser_;
   const bool qp_parsing_allowed_;
 
+  // With the "WebRTC-VideoStreamEncoder-PipelinedPreprocessing" field trial,
+  // incoming frames are cropped, scaled and converted on |preprocess_queue_|
+  // before being posted to |encoder_queue_|, so that preprocessing of a frame
+  // overlaps with the encoding of the previous one.
+  const bool pipelined_preprocessing_;
+  Mutex preprocessing_mutex_;
+  PreprocessingParameters preprocessing_parameters_
+      RTC_GUARDED_BY(preprocessing_mutex_);
+
   // Public methods are proxied to the task queues. The queues must be destroyed
   // first to make sure no tasks run that use other members.
   rtc::TaskQueue encoder_queue_;
+  // Only created if |pipelined_preprocessing_| is set. Destroyed before
+  // |encoder_queue_|, since its tasks post to it.
+  std::unique_ptr<rtc::TaskQueue> preprocess_queue_;
 
   // Used to cancel any potentially pending tasks to the main thread.
   ScopedTaskSafety task_safety_;
@@ -51,8 +51,10 @@
 #include "rtc_base/logging.h"
 #include "rtc_base/ref_counted_object.h"
 #include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/time_utils.h"
 #include "system_wrappers/include/field_trial.h"
 #include "system_wrappers/include/metrics.h"
+#include "system_wrappers/include/sleep.h"
 #include "test/encoder_settings.h"
 #include "test/fake_encoder.h"
 #include "test/field_trial.h"
@@ -1646,6 +1648,66 @@ TEST_F(VideoStreamEncoderTest, NonI420FramesShouldNotBeConvertedToI420) {
   video_stream_encoder_->Stop();
 }
 
+TEST_F(VideoStreamEncoderTest, ReportsNoPixelFormatConversionForNv12Encoder) {
+  video_stream_encoder_->OnBitrateUpdatedAndWaitForManagedResources(
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps), 0, 0, 0);
+
+  fake_encoder_.SetPreferredPixelFormats(
+      {VideoFrameBuffer::Type::kI420, VideoFrameBuffer::Type::kNV12});
+  video_source_.IncomingCapturedFrame(
+      CreateNV12Frame(1, codec_width_, codec_height_));
+  WaitForEncodedFrame(1);
+  video_source_.IncomingCapturedFrame(CreateFrame(2, nullptr));
+  WaitForEncodedFrame(2);
+  EXPECT_EQ(0u, stats_proxy_->GetStats().pixel_format_conversions);
+  video_stream_encoder_->Stop();
+}
+
+TEST_F(VideoStreamEncoderTest, ReportsPixelFormatConversionForI420Encoder) {
+  video_stream_encoder_->OnBitrateUpdatedAndWaitForManagedResources(
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps), 0, 0, 0);
+
+  // No preference means that the encoder only accepts I420.
+  fake_encoder_.SetPreferredPixelFormats({});
+  video_source_.IncomingCapturedFrame(
+      CreateNV12Frame(1, codec_width_, codec_height_));
+  WaitForEncodedFrame(1);
+  EXPECT_EQ(1u, stats_proxy_->GetStats().pixel_format_conversions);
+  video_source_.IncomingCapturedFrame(CreateFrame(2, nullptr));
+  WaitForEncodedFrame(2);
+  EXPECT_EQ(1u, stats_proxy_->GetStats().pixel_format_conversions);
+  video_stream_encoder_->Stop();
+}
+
+TEST_F(VideoStreamEncoderTest, PipelinedPreprocessingConvertsForI420Encoder) {
+  test::ScopedFieldTrials field_trials(
+      "WebRTC-VideoStreamEncoder-PipelinedPreprocessing/Enabled/");
+  ConfigureEncoder(video_encoder_config_.Copy());
+  video_stream_encoder_->OnBitrateUpdatedAndWaitForManagedResources(
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps),
+      DataRate::BitsPerSec(kTargetBitrateBps), 0, 0, 0);
+
+  // No preference means that the encoder only accepts I420.
+  fake_encoder_.SetPreferredPixelFormats({});
+  video_source_.IncomingCapturedFrame(
+      CreateNV12Frame(1, codec_width_, codec_height_));
+  WaitForEncodedFrame(1);
+  // The first frame configures the encoder, after which the preprocessing
+  // parameters are known and following frames arrive already converted.
+  video_source_.IncomingCapturedFrame(
+      CreateNV12Frame(2, codec_width_, codec_height_));
+  WaitForEncodedFrame(2);
+  EXPECT_EQ(VideoFrameBuffer::Type::kI420,
+            fake_encoder_.GetLastInputPixelFormat());
+  EXPECT_EQ(2u, stats_proxy_->GetStats().pixel_format_conversions);
+  video_stream_encoder_->Stop();
+}
+
 TEST_F(VideoStreamEncoderTest, NativeFrameGetsDelivered_NoFrameTypePreference) {
   video_stream_encoder_->OnBitrateUpdatedAndWaitForManagedResources(
       DataRate::BitsPerSec(kTargetBitrateBps),
@@ -8532,4 +8594,154 @@ INSTANTIATE_TEST_SUITE_P(
     TestParametersVideoCodecAndAllowI420ConversionToString);
 #endif
 
+namespace {
+
+// Records the capture-to-encoded-image latency of every encoded frame, keyed by
+// the RTP timestamp which VideoStreamEncoder derives from the NTP time.
+class LatencyRecordingSink : public VideoStreamEncoder::EncoderSink {
+ public:
+  explicit LatencyRecordingSink(int num_frames)
+      : capture_time_us_(num_frames) {}
+
+  void OnFrameCaptured(int frame_index, int64_t capture_time_us) {
+    MutexLock lock(&mutex_);
+    capture_time_us_[frame_index] = capture_time_us;
+  }
+
+  std::vector<int64_t> latencies_us() const {
+    MutexLock lock(&mutex_);
+    return latencies_us_;
+  }
+
+ private:
+  Result OnEncodedImage(
+      const EncodedImage& encoded_image,
+      const CodecSpecificInfo* codec_specific_info) override {
+    const int64_t now_us = rtc::TimeMicros();
+    // Frame |i| is captured with an NTP time of |i + 1| ms.
+    const size_t frame_index = encoded_image.Timestamp() / 90 - 1;
+    MutexLock lock(&mutex_);
+    if (frame_index < capture_time_us_.size()) {
+      latencies_us_.push_back(now_us - capture_time_us_[frame_index]);
+    }
+    return Result(Result::OK);
+  }
+  void OnEncoderConfigurationChanged(
+      std::vector<VideoStream> streams,
+      bool is_svc,
+      VideoEncoderConfig::ContentType content_type,
+      int min_transmit_bitrate_bps) override {}
+  void OnBitrateAllocationUpdated(
+      const VideoBitrateAllocation& allocation) override {}
+  void OnVideoLayersAllocationUpdated(
+      VideoLayersAllocation allocation) override {}
+
+  mutable Mutex mutex_;
+  std::vector<int64_t> capture_time_us_ RTC_GUARDED_BY(mutex_);
+  std::vector<int64_t> latencies_us_ RTC_GUARDED_BY(mutex_);
+};
+
+// Captures |num_frames| 1080p NV12 frames at 30 fps in real time, encodes them
+// with an I420-only encoder which takes |encode_delay_ms| per frame, and
+// returns the sorted capture-to-encoded-image latencies.
+std::vector<int64_t> MeasureCaptureToEncodeLatencies(int num_frames,
+                                                     int encode_delay_ms) {
+  constexpr int kWidth = 1920;
+  constexpr int kHeight = 1080;
+  constexpr int kFrameIntervalMs = 33;
+  Clock* clock = Clock::GetRealTimeClock();
+  std::unique_ptr<TaskQueueFactory> task_queue_factory =
+      CreateDefaultTaskQueueFactory();
+  test::DelayedEncoder encoder(clock, encode_delay_ms);
+  test::VideoEncoderProxyFactory encoder_factory(&encoder);
+  std::unique_ptr<VideoBitrateAllocatorFactory> bitrate_allocator_factory =
+      CreateBuiltinVideoBitrateAllocatorFactory();
+  VideoSendStream::Config send_config(nullptr);
+  send_config.encoder_settings.encoder_factory = &encoder_factory;
+  send_config.encoder_settings.bitrate_allocator_factory =
+      bitrate_allocator_factory.get();
+  send_config.rtp.payload_name = "FAKE";
+  send_config.rtp.payload_type = 125;
+  SendStatisticsProxy stats_proxy(
+      clock, send_config, VideoEncoderConfig::ContentType::kRealtimeVideo);
+  LatencyRecordingSink sink(num_frames);
+  test::FrameForwarder source;
+
+  // VideoStreamEncoder must be created and destroyed on a task queue.
+  rtc::TaskQueue main_queue(task_queue_factory->CreateTaskQueue(
+      "Main", TaskQueueFactory::Priority::NORMAL));
+  std::unique_ptr<VideoStreamEncoder> video_stream_encoder;
+  rtc::Event done;
+  main_queue.PostTask([&] {
+    video_stream_encoder = std::make_unique<VideoStreamEncoder>(
+        clock, /*number_of_cores=*/1, &stats_proxy,
+        send_config.encoder_settings,
+        std::make_unique<OveruseFrameDetector>(&stats_proxy),
+        task_queue_factory.get(),
+        VideoStreamEncoder::BitrateAllocationCallbackType::
+            kVideoBitrateAllocationWhenScreenSharing);
+    video_stream_encoder->SetSink(&sink, /*rotation_applied=*/false);
+    video_stream_encoder->SetSource(&source,
+                                    DegradationPreference::DISABLED);
+    VideoEncoderConfig encoder_config;
+    test::FillEncoderConfiguration(kVideoCodecVP8, 1, &encoder_config);
+    video_stream_encoder->ConfigureEncoder(std::move(encoder_config),
+                                           kMaxPayloadLength);
+    const DataRate rate = DataRate::KilobitsPerSec(5000);
+    video_stream_encoder->OnBitrateUpdated(rate, rate, rate, 0, 0, 0);
+    done.Set();
+  });
+  done.Wait(rtc::Event::kForever);
+
+  for (int i = 0; i < num_frames; ++i) {
+    const int64_t capture_time_us = rtc::TimeMicros();
+    sink.OnFrameCaptured(i, capture_time_us);
+    source.IncomingCapturedFrame(
+        VideoFrame::Builder()
+            .set_video_frame_buffer(NV12Buffer::Create(kWidth, kHeight))
+            .set_ntp_time_ms(i + 1)
+            .set_timestamp_us(capture_time_us)
+            .set_rotation(kVideoRotation_0)
+            .build());
+    SleepMs(kFrameIntervalMs);
+  }
+  SleepMs(10 * encode_delay_ms);
+
+  main_queue.PostTask([&] {
+    video_stream_encoder->Stop();
+    video_stream_encoder.reset();
+    done.Set();
+  });
+  done.Wait(rtc::Event::kForever);
+
+  std::vector<int64_t> latencies_us = sink.latencies_us();
+  std::sort(latencies_us.begin(), latencies_us.end());
+  return latencies_us;
+}
+
+}  // namespace
+
+// Compares the capture-to-encoded-image latency percentiles with and without
+// pipelined preprocessing, for 1080p NV12 capture and an I420-only encoder.
+TEST(VideoStreamEncoderPerfTest, DISABLED_CaptureToEncodedImageLatency) {
+  constexpr int kNumFrames = 300;
+  constexpr int kEncodeDelayMs = 20;
+  for (bool pipelined : {false, true}) {
+    test::ScopedFieldTrials field_trials(
+        pipelined ? "WebRTC-VideoStreamEncoder-PipelinedPreprocessing/Enabled/"
+                  : "");
+    std::vector<int64_t> latencies_us =
+        MeasureCaptureToEncodeLatencies(kNumFrames, kEncodeDelayMs);
+    ASSERT_FALSE(latencies_us.empty());
+    auto percentile = [&latencies_us](int p) {
+      return latencies_us[(latencies_us.size() - 1) * p / 100];
+    };
+    printf("%s: %zu frames encoded, latency p50 %.2f ms, p95 %.2f ms, "
+           "p99 %.2f ms.\n",
+           pipelined ? "pipelined" : "sequential", latencies_us.size(),
+           percentile(50) / 1000.0, percentile(95) / 1000.0,
+           percentile(99) / 1000.0);
+  }
+}
+
 }  // namespace webrtc